@@ -0,0 +1,1034 @@
+// ============================================================================
+// 파일명: loadgen.cpp
+// 목적: 프로토콜 수준 부하 생성기 (서버 용량 산정 / 성능 회귀 확인)
+//
+// - epoll 스레드 몇 개가 수천 개 클라이언트 연결을 나눠 맡음 (클라이언트당 스레드 없음)
+// - 클라이언트 하나 = 소켓 하나, 한 번에 요청 하나 (응답이 끝나야 다음 요청)
+//   프레임은 protocol_lib 형식 (packet_put_header / packet_frame_ready), 요청은 protocol_schema.h
+// - 시나리오: 로그인 → 5초마다 폴링 + 생각 시간(think) 뒤 임의 작업
+//     작업 비율  --mix=send:40,list:40,upload:10,download:10
+//     업로드     UPLOAD_REQ → 64KB 청크 (ACK 마다 다음 청크, 마지막 ACK 의 file_id 기억)
+//     다운로드   기억한 파일 하나: 메타 → 청크들 → 완료
+//     클라이언트당 파일이 FILES_PER_CLIENT 개를 넘으면 업로드 대신 가장 오래된 파일 삭제
+// - 결과: 패킷 type 별 처리량, 오류 수, p50 / p99 / p999 / max
+//   (요청을 다 보낸 시각이 아니라 버퍼에 넣은 시각부터 응답 마지막 프레임까지, 다운로드는 완료 프레임까지)
+// - 계정: memory 백엔드의 bench 유저 (bench{i}@bench.local / pw_hash "bench", i = 1..--users)
+//   --clients 가 --users 보다 많으면 같은 계정이 중복 로그인으로 거절됨
+// - 한 IP 에서 로그인이 몰리면 서버 로그인 제한에 걸림 (거절되면 retry_after 뒤 다시 로그인)
+//   → --bind=127.0.0.2,127.0.0.3,... 로 출발 IP 를 나눔 (서버가 루프백일 때)
+//
+// 사용 예:
+//   LOUD_DB=memory LOUD_MEM_SEED_USERS=5000 ./server_app 5012 &
+//   ./bench_loadgen --clients=5000 --duration=60 --ramp=10 --threads=4
+//   ./bench_loadgen --clients=200 --mix=send:100 --think-ms=100     (메시지 전송만)
+// ============================================================================
+#include "packet.h"
+#include "protocol.h"
+#include "protocol_schema.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <queue>
+#include <random>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr int POLL_INTERVAL_MS = 5000;       // 폴링 주기 (실제 클라이언트 poll_loop 와 같음)
+static constexpr int64_t CHUNK_BYTES = 65536;       // 업로드 청크 크기 (file_client.cpp 와 같음)
+static constexpr size_t FILES_PER_CLIENT = 4;       // 이보다 많으면 업로드 대신 삭제 (디스크 / 할당량 유지)
+static constexpr int EPOLL_BATCH = 256;             // epoll_wait 한 번에 받는 이벤트 수
+static constexpr int MAX_WAIT_MS = 100;             // 타이머가 없어도 이 간격으로 종료 확인
+static constexpr uint32_t MAX_FRAME = 16 * 1024 * 1024;
+static constexpr int RECONNECT_MS = 1000;           // 연결이 끊긴 클라이언트를 다시 붙이는 간격
+
+static constexpr int HIST_SUB_BITS = 4;             // 2의 거듭제곱 구간을 16칸으로 (상대 오차 6.25% 이내)
+static constexpr uint64_t HIST_SUB = 1u << HIST_SUB_BITS;
+static constexpr size_t HIST_BUCKETS = 608;         // 마지막 칸 ≈ 2^40 us
+
+static std::atomic<bool> g_stop{false};
+static std::atomic<uint64_t> g_responses{0}; // 진행 상황 출력용 (모든 엔진 합)
+
+// ============================================================================
+// 설정
+// ============================================================================
+
+struct Config
+{
+    std::string host = "127.0.0.1";
+    int port = 5012;
+    int clients = 1000;
+    int users = 0;             // 0 이면 clients 와 같음
+    int threads = 2;
+    int duration_s = 60;
+    int ramp_s = 10;           // 이 시간에 걸쳐 고르게 연결
+    int think_ms = 2000;       // 작업 사이 평균 대기 (지수 분포)
+    int report_s = 5;          // 진행 상황 출력 간격
+    int upload_kb = 256;       // 업로드 파일 크기
+    std::string pw_hash = "bench";
+    std::vector<std::string> bind_ips;
+    int w_send = 40, w_list = 40, w_upload = 10, w_download = 10;
+};
+
+static std::vector<std::string> split(const std::string &s, char sep)
+{
+    std::vector<std::string> out;
+    size_t pos = 0;
+    while (pos <= s.size())
+    {
+        size_t next = s.find(sep, pos);
+        if (next == std::string::npos)
+            next = s.size();
+        if (next > pos)
+            out.push_back(s.substr(pos, next - pos));
+        pos = next + 1;
+    }
+    return out;
+}
+
+static bool parse_mix(Config &cfg, const std::string &v)
+{
+    cfg.w_send = cfg.w_list = cfg.w_upload = cfg.w_download = 0;
+    for (const auto &item : split(v, ','))
+    {
+        size_t colon = item.find(':');
+        if (colon == std::string::npos)
+            return false;
+        std::string name = item.substr(0, colon);
+        int w = std::atoi(item.c_str() + colon + 1);
+        if (name == "send")
+            cfg.w_send = w;
+        else if (name == "list")
+            cfg.w_list = w;
+        else if (name == "upload")
+            cfg.w_upload = w;
+        else if (name == "download")
+            cfg.w_download = w;
+        else
+            return false;
+    }
+    return cfg.w_send + cfg.w_list + cfg.w_upload + cfg.w_download > 0;
+}
+
+static void usage()
+{
+    std::fprintf(stderr,
+                 "usage: bench_loadgen [--host=127.0.0.1] [--port=5012] [--clients=1000] [--users=N]\n"
+                 "                     [--threads=2] [--duration=60] [--ramp=10] [--think-ms=2000]\n"
+                 "                     [--mix=send:40,list:40,upload:10,download:10] [--upload-kb=256]\n"
+                 "                     [--pw-hash=bench] [--bind=ip1,ip2,...] [--report=5]\n");
+}
+
+static bool parse_args(int argc, char **argv, Config &cfg)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        size_t eq = a.find('=');
+        if (a.compare(0, 2, "--") != 0 || eq == std::string::npos)
+            return false;
+        std::string k = a.substr(2, eq - 2);
+        std::string v = a.substr(eq + 1);
+        if (k == "host")
+            cfg.host = v;
+        else if (k == "port")
+            cfg.port = std::atoi(v.c_str());
+        else if (k == "clients")
+            cfg.clients = std::atoi(v.c_str());
+        else if (k == "users")
+            cfg.users = std::atoi(v.c_str());
+        else if (k == "threads")
+            cfg.threads = std::atoi(v.c_str());
+        else if (k == "duration")
+            cfg.duration_s = std::atoi(v.c_str());
+        else if (k == "ramp")
+            cfg.ramp_s = std::atoi(v.c_str());
+        else if (k == "think-ms")
+            cfg.think_ms = std::atoi(v.c_str());
+        else if (k == "report")
+            cfg.report_s = std::atoi(v.c_str());
+        else if (k == "upload-kb")
+            cfg.upload_kb = std::atoi(v.c_str());
+        else if (k == "pw-hash")
+            cfg.pw_hash = v;
+        else if (k == "bind")
+            cfg.bind_ips = split(v, ',');
+        else if (k == "mix")
+        {
+            if (!parse_mix(cfg, v))
+                return false;
+        }
+        else
+            return false;
+    }
+    if (cfg.users <= 0)
+        cfg.users = cfg.clients;
+    return cfg.clients > 0 && cfg.threads > 0 && cfg.duration_s > 0 && cfg.upload_kb > 0;
+}
+
+// ============================================================================
+// 지연 시간 히스토그램 (엔진 스레드 하나가 쓰고, 끝난 뒤 합침)
+// ============================================================================
+
+static size_t bucket_of(uint64_t v)
+{
+    if (v < HIST_SUB)
+        return static_cast<size_t>(v);
+    int e = 63 - __builtin_clzll(v);
+    size_t idx = static_cast<size_t>(e - HIST_SUB_BITS + 1) * HIST_SUB + ((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+    return idx < HIST_BUCKETS ? idx : HIST_BUCKETS - 1;
+}
+
+static uint64_t bucket_upper(size_t idx)
+{
+    if (idx < HIST_SUB)
+        return idx;
+    int e = static_cast<int>(idx / HIST_SUB) + HIST_SUB_BITS - 1;
+    uint64_t sub = idx % HIST_SUB;
+    return ((HIST_SUB + sub) << (e - HIST_SUB_BITS)) + (1ull << (e - HIST_SUB_BITS)) - 1;
+}
+
+struct LatencyHist
+{
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(HIST_BUCKETS, 0);
+    uint64_t count = 0;
+    uint64_t errors = 0; // code != 0 응답 (지연 시간에는 포함)
+    uint64_t max_us = 0;
+
+    void add(uint64_t us, bool ok)
+    {
+        buckets[bucket_of(us)]++;
+        count++;
+        if (!ok)
+            errors++;
+        max_us = std::max(max_us, us);
+    }
+
+    void merge(const LatencyHist &o)
+    {
+        for (size_t i = 0; i < HIST_BUCKETS; ++i)
+            buckets[i] += o.buckets[i];
+        count += o.count;
+        errors += o.errors;
+        max_us = std::max(max_us, o.max_us);
+    }
+
+    uint64_t quantile(double q) const
+    {
+        if (count == 0)
+            return 0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count) + 0.999999);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < HIST_BUCKETS; ++i)
+        {
+            seen += buckets[i];
+            if (seen >= std::max<uint64_t>(rank, 1))
+                return std::min(bucket_upper(i), max_us);
+        }
+        return max_us;
+    }
+};
+
+struct EngineTotals
+{
+    std::map<int, LatencyHist> by_type; // 패킷 type → 지연 시간
+    uint64_t connects = 0;
+    uint64_t connect_failures = 0;
+    uint64_t disconnects = 0;
+    uint64_t login_throttled = 0;
+    uint64_t unexpected = 0;    // 기다리는 요청이 없는데 온 프레임
+    uint64_t bytes_out = 0;
+    uint64_t bytes_in = 0;
+};
+
+// ============================================================================
+// 업로드 데이터 (모든 클라이언트가 같은 내용을 씀, 미리 base64)
+// ============================================================================
+
+static std::string b64_encode(const unsigned char *data, size_t len)
+{
+    static const char T[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+    for (size_t i = 0; i < len; i += 3)
+    {
+        uint32_t v = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < len)
+            v |= static_cast<uint32_t>(data[i + 1]) << 8;
+        if (i + 2 < len)
+            v |= data[i + 2];
+        out += T[(v >> 18) & 63];
+        out += T[(v >> 12) & 63];
+        out += i + 1 < len ? T[(v >> 6) & 63] : '=';
+        out += i + 2 < len ? T[v & 63] : '=';
+    }
+    return out;
+}
+
+struct UploadBody
+{
+    int64_t file_size = 0;
+    int64_t total_chunks = 0;
+    std::string full_b64; // CHUNK_BYTES 청크
+    std::string tail_b64; // 마지막 청크 (크기가 다르면)
+
+    explicit UploadBody(int kb)
+    {
+        file_size = static_cast<int64_t>(kb) * 1024;
+        total_chunks = (file_size + CHUNK_BYTES - 1) / CHUNK_BYTES;
+        std::vector<unsigned char> raw(static_cast<size_t>(CHUNK_BYTES));
+        std::mt19937 rng(12345);
+        for (auto &b : raw)
+            b = static_cast<unsigned char>(rng());
+        full_b64 = b64_encode(raw.data(), raw.size());
+        int64_t tail = file_size - (total_chunks - 1) * CHUNK_BYTES;
+        tail_b64 = b64_encode(raw.data(), static_cast<size_t>(tail));
+    }
+
+    const std::string &chunk_b64(int64_t idx) const { return idx == total_chunks - 1 ? tail_b64 : full_b64; }
+};
+
+// ============================================================================
+// 클라이언트 하나 (엔진 스레드만 접근)
+// ============================================================================
+
+enum class Op
+{
+    NONE,
+    LOGIN,
+    POLL,
+    SEND,
+    LIST,
+    UPLOAD,
+    DOWNLOAD,
+    DELETE
+};
+
+struct Client
+{
+    int id = 0;                 // 전체 번호 (계정 / 파일명)
+    int fd = -1;
+    bool connected = false;
+    bool want_out = false;      // EPOLLOUT 등록 중
+    std::string email;
+    std::string token;
+    bool logged_in = false;
+
+    std::string rbuf;
+    std::string wbuf;
+    size_t woff = 0;
+
+    Op op = Op::NONE;
+    int pending_type = 0;       // 응답을 기다리는 요청 type
+    Clock::time_point sent_at;  // 그 요청을 버퍼에 넣은 시각
+    Clock::time_point op_started;
+
+    std::string up_name;        // 서버가 정한 업로드 파일명
+    int64_t up_next = 0;        // 다음에 보낼 청크 번호
+    int up_seq = 0;
+    std::deque<int64_t> files;  // 올린 파일 id (오래된 순)
+
+    Clock::time_point poll_due;
+    Clock::time_point op_due;
+    uint64_t timer_seq = 0;     // 가장 최근 타이머만 유효
+};
+
+struct Timer
+{
+    Clock::time_point at;
+    size_t idx;
+    uint64_t seq;
+    bool operator>(const Timer &o) const { return at > o.at; }
+};
+
+static uint64_t us_since(Clock::time_point t0, Clock::time_point t1)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+}
+
+// ============================================================================
+// 엔진: epoll 하나 + 클라이언트 여러 개
+// ============================================================================
+
+class Engine
+{
+public:
+    Engine(const Config &cfg, const UploadBody &body, int index)
+        : cfg_(cfg), body_(body), rng_(static_cast<uint32_t>(index * 7919 + 1))
+    {
+        for (int id = index; id < cfg.clients; id += cfg.threads)
+        {
+            Client c;
+            c.id = id;
+            c.email = "bench" + std::to_string(id % cfg.users + 1) + "@bench.local";
+            clients_.push_back(std::move(c));
+        }
+        std::memset(&server_, 0, sizeof(server_));
+        server_.sin_family = AF_INET;
+        server_.sin_port = htons(static_cast<uint16_t>(cfg.port));
+        inet_pton(AF_INET, cfg.host.c_str(), &server_.sin_addr);
+    }
+
+    void run(Clock::time_point start, Clock::time_point end)
+    {
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd_ < 0)
+        {
+            std::perror("epoll_create1");
+            return;
+        }
+
+        // 연결 시작 시각을 ramp 구간에 고르게 (전체 번호 기준 → 엔진 수와 무관)
+        for (size_t i = 0; i < clients_.size(); ++i)
+        {
+            auto offset = std::chrono::milliseconds(static_cast<int64_t>(cfg_.ramp_s) * 1000 * clients_[i].id /
+                                                    std::max(cfg_.clients, 1));
+            arm(i, start + offset);
+        }
+
+        epoll_event events[EPOLL_BATCH];
+        while (!g_stop.load(std::memory_order_relaxed))
+        {
+            Clock::time_point now = Clock::now();
+            if (now >= end)
+                break;
+            int wait_ms = MAX_WAIT_MS;
+            if (!timers_.empty())
+            {
+                auto d = std::chrono::duration_cast<std::chrono::milliseconds>(timers_.top().at - now).count();
+                wait_ms = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(d, MAX_WAIT_MS)));
+            }
+            int n = epoll_wait(epfd_, events, EPOLL_BATCH, wait_ms);
+            if (n < 0 && errno != EINTR)
+            {
+                std::perror("epoll_wait");
+                break;
+            }
+            for (int i = 0; i < n; ++i)
+                on_event(events[i].data.u32, events[i].events);
+            fire_timers(Clock::now());
+        }
+
+        for (auto &c : clients_)
+            if (c.fd >= 0)
+                ::close(c.fd);
+        ::close(epfd_);
+    }
+
+    const EngineTotals &totals() const { return totals_; }
+
+private:
+    // ── 타이머 ───────────────────────────────────────────────────
+    void arm(size_t idx, Clock::time_point at)
+    {
+        Client &c = clients_[idx];
+        timers_.push(Timer{at, idx, ++c.timer_seq});
+    }
+
+    void fire_timers(Clock::time_point now)
+    {
+        while (!timers_.empty() && timers_.top().at <= now)
+        {
+            Timer t = timers_.top();
+            timers_.pop();
+            Client &c = clients_[t.idx];
+            if (t.seq != c.timer_seq)
+                continue; // 더 최근 타이머가 있음
+            if (c.fd < 0)
+                open_conn(t.idx);
+            else if (c.connected && !c.logged_in && c.op == Op::NONE)
+                send_login(t.idx);
+            else if (c.logged_in && c.op == Op::NONE)
+                start_next(t.idx);
+        }
+    }
+
+    // ── 연결 ─────────────────────────────────────────────────────
+    void open_conn(size_t idx)
+    {
+        Client &c = clients_[idx];
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            totals_.connect_failures++;
+            arm(idx, Clock::now() + std::chrono::milliseconds(RECONNECT_MS));
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (!cfg_.bind_ips.empty())
+        {
+            sockaddr_in local;
+            std::memset(&local, 0, sizeof(local));
+            local.sin_family = AF_INET;
+            inet_pton(AF_INET, cfg_.bind_ips[static_cast<size_t>(c.id) % cfg_.bind_ips.size()].c_str(),
+                      &local.sin_addr);
+            if (::bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) < 0)
+            {
+                ::close(fd);
+                totals_.connect_failures++;
+                arm(idx, Clock::now() + std::chrono::milliseconds(RECONNECT_MS));
+                return;
+            }
+        }
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&server_), sizeof(server_)) < 0 && errno != EINPROGRESS)
+        {
+            ::close(fd);
+            totals_.connect_failures++;
+            arm(idx, Clock::now() + std::chrono::milliseconds(RECONNECT_MS));
+            return;
+        }
+        c.fd = fd;
+        c.connected = false;
+        c.want_out = true;
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u32 = static_cast<uint32_t>(idx);
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    void drop(size_t idx)
+    {
+        Client &c = clients_[idx];
+        if (c.fd >= 0)
+        {
+            epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, nullptr);
+            ::close(c.fd);
+        }
+        if (c.connected)
+            totals_.disconnects++;
+        else
+            totals_.connect_failures++;
+        c.fd = -1;
+        c.connected = false;
+        c.want_out = false;
+        c.logged_in = false;
+        c.token.clear();
+        c.rbuf.clear();
+        c.wbuf.clear();
+        c.woff = 0;
+        c.op = Op::NONE;
+        c.pending_type = 0;
+        c.files.clear(); // 다시 로그인하면 새로 올린 파일만 씀
+        arm(idx, Clock::now() + std::chrono::milliseconds(RECONNECT_MS));
+    }
+
+    void set_out(size_t idx, bool want)
+    {
+        Client &c = clients_[idx];
+        if (c.want_out == want)
+            return;
+        c.want_out = want;
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | (want ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        ev.data.u32 = static_cast<uint32_t>(idx);
+        epoll_ctl(epfd_, EPOLL_CTL_MOD, c.fd, &ev);
+    }
+
+    void on_event(uint32_t idx, uint32_t events)
+    {
+        Client &c = clients_[idx];
+        if (c.fd < 0)
+            return;
+        if (!c.connected && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+        {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0)
+            {
+                drop(idx);
+                return;
+            }
+            c.connected = true;
+            totals_.connects++;
+            set_out(idx, false);
+            send_login(idx);
+            return;
+        }
+        if (events & EPOLLIN)
+        {
+            if (!read_frames(idx))
+                return;
+        }
+        if (clients_[idx].fd >= 0 && (events & EPOLLOUT))
+            flush(idx);
+        if (clients_[idx].fd >= 0 && (events & (EPOLLERR | EPOLLHUP)) && !(events & EPOLLIN))
+            drop(idx);
+    }
+
+    // ── 송신 ─────────────────────────────────────────────────────
+    void send_json(size_t idx, json req, int type)
+    {
+        Client &c = clients_[idx];
+        if (!c.token.empty())
+            req["token"] = c.token;
+        std::string body = req.dump();
+        char head[4];
+        packet_put_header(head, static_cast<uint32_t>(body.size()));
+        c.wbuf.append(head, sizeof(head));
+        c.wbuf.append(body);
+        c.pending_type = type;
+        c.sent_at = Clock::now();
+        flush(idx);
+    }
+
+    void flush(size_t idx)
+    {
+        Client &c = clients_[idx];
+        while (c.woff < c.wbuf.size())
+        {
+            ssize_t n = ::send(c.fd, c.wbuf.data() + c.woff, c.wbuf.size() - c.woff, MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                c.woff += static_cast<size_t>(n);
+                totals_.bytes_out += static_cast<uint64_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                set_out(idx, true);
+                return;
+            }
+            drop(idx);
+            return;
+        }
+        c.wbuf.clear();
+        c.woff = 0;
+        set_out(idx, false);
+    }
+
+    // ── 수신 ─────────────────────────────────────────────────────
+    // false 면 연결을 닫음
+    bool read_frames(size_t idx)
+    {
+        Client &c = clients_[idx];
+        char buf[65536];
+        while (true)
+        {
+            ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+            if (n > 0)
+            {
+                c.rbuf.append(buf, static_cast<size_t>(n));
+                totals_.bytes_in += static_cast<uint64_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            drop(idx); // 0 = 서버가 닫음
+            return false;
+        }
+
+        size_t off = 0;
+        while (true)
+        {
+            uint32_t len = 0;
+            int ready = packet_frame_ready(c.rbuf.data() + off, static_cast<uint32_t>(c.rbuf.size() - off), &len);
+            if (c.rbuf.size() - off >= 4 && len > MAX_FRAME)
+            {
+                drop(idx);
+                return false;
+            }
+            if (!ready)
+                break;
+            json frame = json::parse(c.rbuf.begin() + static_cast<std::ptrdiff_t>(off + 4),
+                                     c.rbuf.begin() + static_cast<std::ptrdiff_t>(off + 4 + len), nullptr, false);
+            off += 4 + len;
+            on_frame(idx, frame);
+            if (clients_[idx].fd < 0)
+                return false;
+        }
+        c.rbuf.erase(0, off);
+        return true;
+    }
+
+    void record(Client &c, bool ok)
+    {
+        totals_.by_type[c.pending_type].add(us_since(c.sent_at, Clock::now()), ok);
+        g_responses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void on_frame(size_t idx, const json &frame)
+    {
+        Client &c = clients_[idx];
+        if (c.op == Op::NONE || frame.is_discarded())
+        {
+            totals_.unexpected++;
+            return;
+        }
+        int type = frame.value("type", 0);
+        int code = frame.value("code", VALUE_ERR_UNKNOWN);
+        json payload = frame.value("payload", json::object());
+
+        switch (c.op)
+        {
+        case Op::LOGIN:
+            record(c, code == VALUE_SUCCESS);
+            c.op = Op::NONE;
+            if (code == VALUE_SUCCESS)
+            {
+                c.token = payload.value("token", "");
+                c.logged_in = true;
+                Clock::time_point now = Clock::now();
+                // 폴링 시작 시각을 흩어 놓음 (모두 같은 순간에 폴링하지 않도록)
+                c.poll_due = now + std::chrono::milliseconds(rng_() % POLL_INTERVAL_MS);
+                c.op_due = now + think();
+                start_next(idx);
+            }
+            else if (code == VALUE_ERR_RATE_LIMITED)
+            {
+                totals_.login_throttled++;
+                int retry = std::max(1, payload.value("retry_after", 1));
+                arm(idx, Clock::now() + std::chrono::seconds(retry));
+            }
+            else
+            {
+                drop(idx); // 계정 없음 / 중복 로그인 등 → 잠시 뒤 다시
+            }
+            return;
+
+        case Op::UPLOAD:
+            on_upload_frame(idx, code, payload);
+            return;
+
+        case Op::DOWNLOAD:
+            if (type == PKT_FILE_CHUNK)
+                return; // 청크 (완료 프레임까지 기다림)
+            if (type == PKT_FILE_DOWNLOAD_REQ && code == VALUE_SUCCESS && payload.contains("total_chunks"))
+                return; // 메타
+            record(c, code == VALUE_SUCCESS);
+            finish_op(idx);
+            return;
+
+        default: // POLL / SEND / LIST / DELETE: 응답 하나
+            record(c, code == VALUE_SUCCESS);
+            finish_op(idx);
+            return;
+        }
+    }
+
+    void on_upload_frame(size_t idx, int code, const json &payload)
+    {
+        Client &c = clients_[idx];
+        record(c, code == VALUE_SUCCESS);
+        if (code != VALUE_SUCCESS)
+        {
+            finish_op(idx);
+            return;
+        }
+        if (c.pending_type == PKT_FILE_UPLOAD_REQ)
+        {
+            c.up_name = payload.value("resolved_name", c.up_name);
+            c.up_next = 0;
+        }
+        else
+        {
+            c.up_next++;
+            if (c.up_next >= body_.total_chunks)
+            {
+                int64_t file_id = payload.value("file_id", static_cast<int64_t>(0));
+                if (file_id > 0)
+                    c.files.push_back(file_id);
+                finish_op(idx);
+                return;
+            }
+        }
+        send_chunk(idx);
+    }
+
+    // ── 시나리오 ─────────────────────────────────────────────────
+    std::chrono::milliseconds think()
+    {
+        std::exponential_distribution<double> d(1.0 / std::max(cfg_.think_ms, 1));
+        return std::chrono::milliseconds(static_cast<int64_t>(d(rng_)));
+    }
+
+    void send_login(size_t idx)
+    {
+        Client &c = clients_[idx];
+        c.op = Op::LOGIN;
+        c.op_started = Clock::now();
+        send_json(idx, AuthSchema::make_login_req(PKT_AUTH_LOGIN_REQ, c.email, cfg_.pw_hash), PKT_AUTH_LOGIN_REQ);
+    }
+
+    void send_chunk(size_t idx)
+    {
+        Client &c = clients_[idx];
+        json pl;
+        pl["file_name"] = c.up_name;
+        pl["folder"] = "";
+        pl["chunk_index"] = c.up_next;
+        pl["total_chunks"] = body_.total_chunks;
+        pl["data_b64"] = body_.chunk_b64(c.up_next);
+        pl["file_size"] = body_.file_size;
+        send_json(idx, make_req(PKT_FILE_CHUNK, pl), PKT_FILE_CHUNK);
+    }
+
+    void finish_op(size_t idx)
+    {
+        Client &c = clients_[idx];
+        Clock::time_point now = Clock::now();
+        if (c.op == Op::POLL)
+            c.poll_due = std::max(c.poll_due + std::chrono::milliseconds(POLL_INTERVAL_MS), now);
+        else
+            c.op_due = now + think();
+        c.op = Op::NONE;
+        c.pending_type = 0;
+        start_next(idx);
+    }
+
+    Op pick_op(Client &c)
+    {
+        int total = cfg_.w_send + cfg_.w_list + cfg_.w_upload + cfg_.w_download;
+        int r = static_cast<int>(rng_() % static_cast<uint32_t>(total));
+        Op op = Op::SEND;
+        if ((r -= cfg_.w_send) < 0)
+            op = Op::SEND;
+        else if ((r -= cfg_.w_list) < 0)
+            op = Op::LIST;
+        else if ((r -= cfg_.w_upload) < 0)
+            op = Op::UPLOAD;
+        else
+            op = Op::DOWNLOAD;
+
+        if (op == Op::DOWNLOAD && c.files.empty())
+            op = cfg_.w_upload > 0 ? Op::UPLOAD : Op::LIST; // 받을 파일이 아직 없음
+        if (op == Op::UPLOAD && c.files.size() >= FILES_PER_CLIENT)
+            op = Op::DELETE;
+        return op;
+    }
+
+    // 할 일이 있으면 요청을 보내고, 없으면 다음 시각에 타이머
+    void start_next(size_t idx)
+    {
+        Client &c = clients_[idx];
+        if (c.fd < 0 || !c.logged_in || c.op != Op::NONE)
+            return;
+        Clock::time_point now = Clock::now();
+        if (c.poll_due <= now)
+        {
+            c.op = Op::POLL;
+            send_json(idx, make_req(PKT_MSG_POLL_REQ), PKT_MSG_POLL_REQ);
+            return;
+        }
+        if (c.op_due > now)
+        {
+            arm(idx, std::min(c.poll_due, c.op_due));
+            return;
+        }
+
+        c.op = pick_op(c);
+        c.op_started = now;
+        switch (c.op)
+        {
+        case Op::SEND:
+        {
+            std::string to = "bench" + std::to_string(rng_() % static_cast<uint32_t>(cfg_.users) + 1) + "@bench.local";
+            send_json(idx, MessageSchema::make_send_req(PKT_MSG_SEND_REQ, to, "loadgen message " + std::to_string(c.id)),
+                      PKT_MSG_SEND_REQ);
+            break;
+        }
+        case Op::LIST:
+            send_json(idx, MessageSchema::make_list_req(PKT_MSG_LIST_REQ), PKT_MSG_LIST_REQ);
+            break;
+        case Op::UPLOAD:
+        {
+            json pl;
+            pl["file_name"] = "lg_" + std::to_string(c.id) + "_" + std::to_string(++c.up_seq) + ".bin";
+            pl["file_size"] = body_.file_size;
+            pl["folder"] = "";
+            c.up_name = pl["file_name"];
+            send_json(idx, make_req(PKT_FILE_UPLOAD_REQ, pl), PKT_FILE_UPLOAD_REQ);
+            break;
+        }
+        case Op::DOWNLOAD:
+        {
+            int64_t file_id = c.files[rng_() % c.files.size()];
+            send_json(idx, make_req(PKT_FILE_DOWNLOAD_REQ, json{{"file_id", file_id}}), PKT_FILE_DOWNLOAD_REQ);
+            break;
+        }
+        case Op::DELETE:
+        {
+            int64_t file_id = c.files.front();
+            c.files.pop_front();
+            send_json(idx, make_req(PKT_FILE_DELETE_REQ, json{{"file_id", file_id}}), PKT_FILE_DELETE_REQ);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    const Config &cfg_;
+    const UploadBody &body_;
+    std::mt19937 rng_;
+    std::vector<Client> clients_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    sockaddr_in server_;
+    int epfd_ = -1;
+    EngineTotals totals_;
+};
+
+// ============================================================================
+// 결과 출력
+// ============================================================================
+
+static const char *type_name(int type)
+{
+    switch (type)
+    {
+    case PKT_AUTH_LOGIN_REQ:
+        return "login";
+    case PKT_MSG_POLL_REQ:
+        return "msg_poll";
+    case PKT_MSG_SEND_REQ:
+        return "msg_send";
+    case PKT_MSG_LIST_REQ:
+        return "msg_list";
+    case PKT_FILE_UPLOAD_REQ:
+        return "file_upload";
+    case PKT_FILE_CHUNK:
+        return "file_chunk";
+    case PKT_FILE_DOWNLOAD_REQ:
+        return "file_download";
+    case PKT_FILE_DELETE_REQ:
+        return "file_delete";
+    default:
+        return "other";
+    }
+}
+
+static void print_report(const EngineTotals &t, double elapsed_s)
+{
+    std::printf("\n%-14s %8s %10s %7s %10s %10s %10s %10s %10s\n", "type", "hex", "count", "errors", "rps", "p50_ms",
+                "p99_ms", "p999_ms", "max_ms");
+    LatencyHist all;
+    for (const auto &kv : t.by_type)
+    {
+        const LatencyHist &h = kv.second;
+        all.merge(h);
+        std::printf("%-14s   0x%04x %10llu %7llu %10.1f %10.3f %10.3f %10.3f %10.3f\n", type_name(kv.first), kv.first,
+                    static_cast<unsigned long long>(h.count), static_cast<unsigned long long>(h.errors),
+                    h.count / elapsed_s, h.quantile(0.50) / 1000.0, h.quantile(0.99) / 1000.0,
+                    h.quantile(0.999) / 1000.0, h.max_us / 1000.0);
+    }
+    std::printf("%-14s %8s %10llu %7llu %10.1f %10.3f %10.3f %10.3f %10.3f\n", "total", "",
+                static_cast<unsigned long long>(all.count), static_cast<unsigned long long>(all.errors),
+                all.count / elapsed_s, all.quantile(0.50) / 1000.0, all.quantile(0.99) / 1000.0,
+                all.quantile(0.999) / 1000.0, all.max_us / 1000.0);
+    std::printf("\nconnects=%llu connect_failures=%llu disconnects=%llu login_throttled=%llu unexpected_frames=%llu\n",
+                static_cast<unsigned long long>(t.connects), static_cast<unsigned long long>(t.connect_failures),
+                static_cast<unsigned long long>(t.disconnects), static_cast<unsigned long long>(t.login_throttled),
+                static_cast<unsigned long long>(t.unexpected));
+    std::printf("sent=%.1f MB received=%.1f MB elapsed=%.1f s\n", t.bytes_out / 1e6, t.bytes_in / 1e6, elapsed_s);
+}
+
+// 클라이언트 수만큼 fd 가 필요 → soft limit 을 hard limit 까지
+static void raise_fd_limit(int clients)
+{
+    rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0)
+        return;
+    if (rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    if (rl.rlim_cur < static_cast<rlim_t>(clients) + 64)
+        std::fprintf(stderr, "[loadgen] fd limit %llu < clients %d (ulimit -n 로 올려야 함)\n",
+                     static_cast<unsigned long long>(rl.rlim_cur), clients);
+}
+
+int main(int argc, char **argv)
+{
+    Config cfg;
+    if (!parse_args(argc, argv, cfg))
+    {
+        usage();
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, [](int) { g_stop = true; }); // Ctrl+C → 지금까지 결과 출력
+    raise_fd_limit(cfg.clients);
+    cfg.threads = std::min(cfg.threads, cfg.clients);
+
+    UploadBody body(cfg.upload_kb);
+    std::printf("[loadgen] %s:%d clients=%d users=%d threads=%d duration=%ds ramp=%ds think=%dms "
+                "mix=send:%d,list:%d,upload:%d,download:%d upload=%dKB\n",
+                cfg.host.c_str(), cfg.port, cfg.clients, cfg.users, cfg.threads, cfg.duration_s, cfg.ramp_s,
+                cfg.think_ms, cfg.w_send, cfg.w_list, cfg.w_upload, cfg.w_download, cfg.upload_kb);
+
+    std::vector<std::unique_ptr<Engine>> engines;
+    for (int i = 0; i < cfg.threads; ++i)
+        engines.push_back(std::make_unique<Engine>(cfg, body, i));
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::seconds(cfg.duration_s);
+    std::vector<std::thread> threads;
+    for (auto &e : engines)
+        threads.emplace_back([&e, start, end] { e->run(start, end); });
+
+    // 진행 상황 (report_s 마다 직전 구간 처리량)
+    uint64_t last = 0;
+    Clock::time_point last_t = start;
+    while (!g_stop.load() && Clock::now() < end)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        Clock::time_point now = Clock::now();
+        if (cfg.report_s > 0 && now - last_t >= std::chrono::seconds(cfg.report_s))
+        {
+            uint64_t cur = g_responses.load();
+            double dt = std::chrono::duration<double>(now - last_t).count();
+            std::printf("[loadgen] t=%.0fs responses=%llu (%.1f/s)\n", std::chrono::duration<double>(now - start).count(),
+                        static_cast<unsigned long long>(cur), (cur - last) / dt);
+            std::fflush(stdout);
+            last = cur;
+            last_t = now;
+        }
+    }
+    for (auto &th : threads)
+        th.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    EngineTotals all;
+    for (auto &e : engines)
+    {
+        const EngineTotals &t = e->totals();
+        for (const auto &kv : t.by_type)
+            all.by_type[kv.first].merge(kv.second);
+        all.connects += t.connects;
+        all.connect_failures += t.connect_failures;
+        all.disconnects += t.disconnects;
+        all.login_throttled += t.login_throttled;
+        all.unexpected += t.unexpected;
+        all.bytes_out += t.bytes_out;
+        all.bytes_in += t.bytes_in;
+    }
+    print_report(all, elapsed);
+    return 0;
+}
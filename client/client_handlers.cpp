@@ -25,6 +25,10 @@
 
 using namespace std;
 
+extern std::string g_msg_prefix;        // client_messagehandler.cpp
+extern std::string g_msg_suffix;        // client_messagehandler.cpp
+extern std::atomic<bool> g_has_unread;  // skeleton_client.cpp
+
 // ============================================================================
 // [내부 유틸] 입력 버퍼 비우기 및 문자열 입력 받기
 // ============================================================================
@@ -267,7 +271,13 @@ bool handle_login(int sock)
     g_current_pw_hash = hashed_pw; // 폴링 소켓 재로그인용
 
     // 4.스키마를 이용해 요청 패킷 생성
-    json req = AuthSchema::make_login_req(PKT_AUTH_LOGIN_REQ, email, hashed_pw);
+    //   로그인 + 메시지 설정 동기화 + 첫 화면 안읽음 확인을 묶음 1개로 전송 (왕복 1회)
+    //   로그인이 실패하면 뒤의 두 요청은 서버에서 세션 오류로 끝남
+    json login_req = AuthSchema::make_login_req(PKT_AUTH_LOGIN_REQ, email, hashed_pw);
+    json req = BatchSchema::make_batch_req(PKT_BATCH,
+                                           {login_req,
+                                            make_request(PKT_MSG_SETTING_GET_REQ),
+                                            make_request(PKT_MSG_POLL_REQ)}); // 세션 기준 안읽은 수 (목록 페이지 조회 없음)
 
     // 5. 서버 전송 (수정: 실패 시 메시지 + 대기)
     if (!send_json(sock, req))
@@ -278,13 +288,14 @@ bool handle_login(int sock)
     }
 
     // 6. 응답 수신 (수정: 실패 시 메시지 + 대기)
-    json res;
-    if (!recv_json(sock, res))
+    json batch_res;
+    if (!recv_json(sock, batch_res))
     {
         cout << ">> [오류] 서버로부터 응답을 받지 못했습니다." << endl;
         wait_for_enter();
         return false;
     }
+    json res = BatchSchema::get_sub_response(batch_res, 0);
 
     // 7. 결과 처리
     int code = res.value("code", -1);
@@ -299,9 +310,24 @@ bool handle_login(int sock)
             // 서버가 보낸 "user_no" 값을 읽어서 g_user_no에 저장
             // (만약 user_no가 없으면 0으로 설정)
             g_user_no = payload.value("user_no", (uint32_t)0);
+            // 폴링 / 업로드 / 다운로드 소켓 인증용 세션 토큰 (send_json 이 요청마다 붙임)
+            set_session_token(payload.value("token", ""));
         }
         g_current_user_email = email; // 폴링용 이메일 저장
 
+        // 로그인 직후 메시지 설정(prefix, suffix) 동기화
+        json sync_res = BatchSchema::get_sub_response(batch_res, 1);
+        if (sync_res.value("code", -1) == VALUE_SUCCESS)
+        {
+            json sync_pl = sync_res.value("payload", json::object());
+            g_msg_prefix = sync_pl.value("prefix", "");
+            g_msg_suffix = sync_pl.value("suffix", "");
+        }
+
+        // 첫 메인 메뉴용 안읽은 메시지 여부
+        json list_res = BatchSchema::get_sub_response(batch_res, 2);
+        g_has_unread.store(list_res.value("payload", json::object()).value("has_unread", false));
+
         cout << ">> [로그인 성공] " << msg << endl;
         wait_for_enter();
         return true;
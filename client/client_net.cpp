@@ -8,6 +8,22 @@
 #include <unistd.h>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+
+static std::string g_session_token; // 로그인 응답으로 받은 세션 토큰
+static std::mutex g_session_token_m; // 메인 / 업로드 / 다운로드 / 폴링 스레드 공용
+
+void set_session_token(const std::string &token)
+{
+    std::lock_guard<std::mutex> lk(g_session_token_m);
+    g_session_token = token;
+}
+
+std::string session_token()
+{
+    std::lock_guard<std::mutex> lk(g_session_token_m);
+    return g_session_token;
+}
 
 int connect_server(const std::string &ip, int port)
 {
@@ -32,7 +48,18 @@ int connect_server(const std::string &ip, int port)
 bool send_json(int sock, const json &j)
 {
     // 설명: "인코딩 에러가 나면 멈추지 말고, 깨진 글자를  같은 걸로 바꿔서라도 계속 진행해라"
-    std::string payload = j.dump(-1, ' ', false, json::error_handler_t::replace);
+    std::string token = session_token();
+    std::string payload;
+    if (!token.empty() && j.is_object() && !j.contains("token"))
+    {
+        json with_token = j;
+        with_token["token"] = token;
+        payload = with_token.dump(-1, ' ', false, json::error_handler_t::replace);
+    }
+    else
+    {
+        payload = j.dump(-1, ' ', false, json::error_handler_t::replace);
+    }
 
     uint32_t len = payload.size(); // 길이 계산
     uint32_t net_len = htonl(len); // 네트워크 바이트 순서 변환
@@ -13,7 +13,12 @@ using json = nlohmann::json;
 int connect_server(const std::string& ip, int port);
 
 // JSON 전송 함수 (length-prefix 기반)
+// 세션 토큰이 설정돼 있으면 요청 최상위에 "token" 을 붙여 보냄 (어느 소켓이든 서버가 세션으로 인식)
 bool send_json(int sock, const json& j);
 
+// 로그인 응답의 token 저장 / 로그아웃 시 빈 문자열
+void set_session_token(const std::string& token);
+std::string session_token();
+
 // JSON 수신 함수 (length-prefix 기반)
 bool recv_json(int sock, json& j);
\ No newline at end of file
@@ -100,10 +100,19 @@ static void poll_loop()
         if (g_poll_sock < 0)
             continue;
 
-        // PKT_MSG_POLL_REQ 전송 (세션 없이 email+pw_hash 인증, has_unread 확인)
+        // PKT_MSG_POLL_REQ 전송 (로그인 때 받은 세션 토큰으로 인증, has_unread 확인)
+        //   토큰이 없으면 (구버전 서버) email+pw_hash 로 인증
         json req = make_request(PKT_MSG_POLL_REQ);
-        req["payload"]["email"] = g_current_user_email;
-        req["payload"]["pw_hash"] = g_current_pw_hash;
+        std::string token = session_token();
+        if (!token.empty())
+        {
+            req["token"] = token;
+        }
+        else
+        {
+            req["payload"]["email"] = g_current_user_email;
+            req["payload"]["pw_hash"] = g_current_pw_hash;
+        }
         std::string s = req.dump();
 
         if (packet_send(g_poll_sock, s.c_str(), (uint32_t)s.size()) < 0)
@@ -155,6 +164,7 @@ static void stop_poll_thread()
         g_poll_sock = -1;
     }
     g_has_unread.store(false);
+    set_session_token(""); // 로그아웃 → 서버도 로그인 소켓 종료 시 토큰 폐기
 }
 
 void clear_stdin_line()                                                 // cin 잔여 입력 제거 함수
@@ -211,6 +221,7 @@ int main()                              // main 시작
 
     bool running = true;    // 프로그램 실행 플래그
     bool logged_in = false; // 로그인 상태 플래그
+    bool unread_prefetched = false; // 로그인 묶음 응답으로 안읽음 여부를 이미 받았는지
 
     // ===================================================================== // 메인 루프(프로그램 전체)
     while (running) // 프로그램이 실행 중이면 반복
@@ -245,36 +256,9 @@ int main()                              // main 시작
                     if (!connect_download_socket(SERVER_IP, SERVER_PORT)) {
                         std::cerr << "[경고] 다운로드 전용 소켓 연결 실패 - 다운로드 기능 불가\n";
                     }
-                    // [추가] 로그인 직후 메시지 설정(prefix, suffix) 동기화
-                    // =======================================================
-                    json sync_req = make_request(PKT_MSG_SETTING_GET_REQ);
-                    std::string sync_str = sync_req.dump();
-
-                    if (packet_send(sock, sync_str.c_str(), (uint32_t)sync_str.size()) >= 0)
-                    {
-                        char *sync_buf = nullptr;
-                        uint32_t sync_len = 0;
-                        if (packet_recv(sock, &sync_buf, &sync_len) >= 0)
-                        {
-                            try
-                            {
-                                json sync_res = json::parse(std::string(sync_buf, sync_len));
-                                if (sync_res.value("code", -1) == VALUE_SUCCESS)
-                                {
-                                    auto &payload = sync_res["payload"];
-                                    // 서버에서 받아온 값으로 전역 변수 초기화
-                                    g_msg_prefix = payload.value("prefix", "");
-                                    g_msg_suffix = payload.value("suffix", "");
-                                }
-                            }
-                            catch (...)
-                            {
-                                // 파싱 실패 시 조용히 넘김 (기본값인 빈 문자열 유지)
-                            }
-                            if (sync_buf)
-                                free(sync_buf);
-                        }
-                    }
+                    // 메시지 설정(prefix, suffix) 동기화와 안읽음 여부는
+                    // handle_login의 묶음 요청(PKT_BATCH) 응답으로 이미 받아 둠
+                    unread_prefetched = true;
                 }
                 continue; // 메뉴 루프 진행
             }
@@ -295,10 +279,14 @@ int main()                              // main 시작
         while (running && logged_in) // 로그인 상태에서만 반복
         {                            // while 시작
             // ── 안읽은 메시지 여부 확인 (메인 메뉴 진입마다 1회 요청) ──
-            bool has_unread = false;
+            //    로그인된 소켓이라 PKT_MSG_POLL_REQ 는 payload 없이 세션 기준 (서버 메모리 카운터에서 응답)
+            if (unread_prefetched)
+            {
+                unread_prefetched = false; // 로그인 직후 첫 메뉴는 추가 요청 없이 표시
+            }
+            else
             {
-                json poll_req = make_request(PKT_MSG_LIST_REQ);
-                poll_req["payload"]["page"] = 0;
+                json poll_req = make_request(PKT_MSG_POLL_REQ);
                 std::string s = poll_req.dump();
 
                 if (packet_send(sock, s.c_str(), (uint32_t)s.size()) == 0)
@@ -307,8 +295,9 @@ int main()                              // main 시작
                     uint32_t rlen = 0;
                     if (packet_recv(sock, &rbuf, &rlen) == 0)
                     {
-                        auto r = json::parse(std::string(rbuf, rlen));
-                        has_unread = r["payload"].value("has_unread", false);
+                        auto r = json::parse(std::string(rbuf, rlen), nullptr, false);
+                        if (!r.is_discarded())
+                            g_has_unread.store(r.value("payload", json::object()).value("has_unread", false));
                         free(rbuf);
                     }
                 }
@@ -12,26 +12,54 @@
 using json = nlohmann::json;
 extern uint32_t g_user_no;
 
-void admin_show_user_list(int sock, bool only_inactive)
+// 유저 목록 한 페이지 수신
+// - 서버는 한 페이지를 여러 프레임으로 나눠 보내므로 final 프레임까지 모두 받음
+// - next_cursor 는 다음 페이지 시작점 (없으면 null)
+static bool admin_fetch_users(int sock, const json &filter, unsigned int cursor,
+                              json &users, json &next_cursor)
 {
+    json req = make_request(PKT_ADMIN_USER_LIST_REQ);
+    req["payload"] = filter;
+    req["payload"]["cursor"] = cursor;
+    if (!send_json(sock, req))
+        return false;
+
+    users = json::array();
     while (true)
     {
-        // 1. 목록 요청
-        json req = make_request(PKT_ADMIN_USER_LIST_REQ);
-        req["payload"]["only_inactive"] = only_inactive;
-        if (!send_json(sock, req))
-            return;
-
         json res;
-        if (!recv_json(sock, res) || res["code"] != VALUE_SUCCESS)
+        if (!recv_json(sock, res))
+            return false;
+
+        json pl = res.value("payload", json::object());
+        for (auto &u : pl.value("users", json::array()))
+            users.push_back(u);
+        if (pl.value("final", true))
+        {
+            next_cursor = pl.value("next_cursor", json());
+            return res.value("code", -1) == VALUE_SUCCESS;
+        }
+    }
+}
+
+static void admin_show_user_list(int sock, const json &filter, const std::string &title)
+{
+    std::vector<unsigned int> cursors{0}; // cursors[page] = 그 페이지 시작 커서
+    int page = 0;
+
+    while (true)
+    {
+        // 1. 목록 요청 (현재 페이지)
+        json users, next_cursor;
+        if (!admin_fetch_users(sock, filter, cursors[page], users, next_cursor))
             return;
+        bool has_next = !next_cursor.is_null();
 
-        json users = res["payload"]["users"];
         if (users.empty())
         {
             tui_detail::clear();
             std::cout << "==========================================\n";
-            std::cout << "  " << (only_inactive ? "비활성화된 유저 목록" : "전체 유저 목록") << "\n";
+            std::cout << "  " << title << "\n";
             std::cout << "------------------------------------------\n";
             std::cout << "  해당 조건에 맞는 유저가 없습니다.\n";
             std::cout << "==========================================\n";
@@ -51,11 +79,32 @@ void admin_show_user_list(int sock, bool only_inactive)
                 line += " \033[90m[오프라인]\033[0m"; // 회색
             items.push_back(line);
         }
+        if (page > 0)
+            items.push_back("◀ 이전 페이지");
+        if (has_next)
+            items.push_back("▶ 다음 페이지");
         items.push_back("뒤로 가기");
 
-        int choice = tui_menu(only_inactive ? "비활성화된 유저 목록" : "전체 접속 유저 목록", items);
-        if (choice == -1 || choice == (int)items.size() - 1)
+        int choice = tui_menu(title + " (페이지 " + std::to_string(page + 1) + ")", items);
+
+        int nav = (int)users.size();
+        int prev_idx = (page > 0) ? nav++ : -1;
+        int next_idx = has_next ? nav++ : -1;
+        if (choice == -1 || choice == nav)
             break;
+        if (page > 0 && choice == prev_idx)
+        {
+            page--;
+            cursors.resize(page + 1);
+            continue;
+        }
+        if (has_next && choice == next_idx)
+        {
+            cursors.resize(page + 1);
+            cursors.push_back(next_cursor.get<unsigned int>());
+            page++;
+            continue;
+        }
 
         // 3. 상세 정보 요청 및 표시
         int target_no = users[choice]["no"];
@@ -140,13 +189,20 @@ void admin_show_user_list(int sock, bool only_inactive)
 
 void admin_broadcast_message(int sock)
 {
-    // 1. 전체 유저 로드
-    json req = make_request(PKT_ADMIN_USER_LIST_REQ);
-    req["payload"]["only_inactive"] = false;
-    send_json(sock, req);
-    json res;
-    recv_json(sock, res);
-    json users = res["payload"]["users"];
+    // 1. 전체 유저 로드 (페이지 끝까지)
+    json users = json::array();
+    unsigned int cursor = 0;
+    while (true)
+    {
+        json part, next_cursor;
+        if (!admin_fetch_users(sock, json::object(), cursor, part, next_cursor))
+            return;
+        for (auto &u : part)
+            users.push_back(u);
+        if (next_cursor.is_null())
+            break;
+        cursor = next_cursor.get<unsigned int>();
+    }
 
     std::vector<bool> selected(users.size(), false);
     int cur = 0, n = users.size(), offset = 0;
@@ -227,15 +283,25 @@ void handle_admin_menu(int sock)
         int choice = tui_menu("관리자 모드", {"접속 유저 목록",
                                               "모든 유저에게 메시지 보내기",
                                               "비활성화된 유저 목록",
+                                              "유저 검색 (이메일/닉네임 접두어)",
                                               "뒤로 가기"});
 
-        if (choice == -1 || choice == 3)
+        if (choice == -1 || choice == 4)
             break;
         if (choice == 0)
-            admin_show_user_list(sock, false);
+            admin_show_user_list(sock, json::object(), "전체 접속 유저 목록");
         if (choice == 1)
             admin_broadcast_message(sock);
         if (choice == 2)
-            admin_show_user_list(sock, true);
+            admin_show_user_list(sock, {{"state", "inactive"}}, "비활성화된 유저 목록");
+        if (choice == 3)
+        {
+            tui_detail::clear();
+            std::cout << "\n[유저 검색]\n이메일 또는 닉네임 앞부분: ";
+            std::string prefix;
+            std::getline(std::cin, prefix);
+            if (!prefix.empty())
+                admin_show_user_list(sock, {{"prefix", prefix}}, "검색 결과: " + prefix);
+        }
     }
 }
\ No newline at end of file
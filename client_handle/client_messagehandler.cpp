@@ -299,12 +299,12 @@ static bool handle_message_list_ui(int sock)
 {
     int page = 0;
     bool last_unread = false;
+    std::vector<json> cursors{json()}; // cursors[page] = 그 페이지를 가져올 커서 (첫 페이지는 null)
 
     while (true)
     {
-        // ── 서버에서 메시지 목록 조회 ──
-        json req = MessageSchema::make_list_req(PKT_MSG_LIST_REQ);
-        req["payload"]["page"] = page;
+        // ── 서버에서 메시지 목록 조회 (커서 기반) ──
+        json req = MessageSchema::make_list_cursor_req(PKT_MSG_LIST_REQ, cursors[page]);
         json res = send_recv(sock, req);
 
         if (res.value("code", -1) != VALUE_SUCCESS)
@@ -317,12 +317,15 @@ static bool handle_message_list_ui(int sock)
         auto msgs = payload["messages"]; // copy (참조면 루프 중 수정 위험)
         bool has_unread = payload.value("has_unread", false);
         last_unread = has_unread;
+        json next_cursor = payload.value("next_cursor", json());
+        bool has_next = !next_cursor.is_null();
 
         if (msgs.empty())
         {
             if (page > 0)
             {
                 page--;
+                cursors.resize(page + 1);
                 continue;
             }
             tui_menu("메시지 없음", {"확인"});
@@ -346,10 +349,17 @@ static bool handle_message_list_ui(int sock)
             items.push_back(mark + " [" + date + "] " + from + "  " + body);
         }
 
+        // 첫 페이지: 지금 보이는 가장 최신 메시지까지 모두 읽음 처리
+        json head_cursor = payload.value("head_cursor", json());
+        bool can_mark_all = (page == 0 && !head_cursor.is_null());
+        if (can_mark_all)
+            items.push_back("✔ 모두 읽음 처리");
+
         // 페이지 네비게이션 항목 추가
         if (page > 0)
             items.push_back("◀ 이전 페이지");
-        items.push_back("▶ 다음 페이지");
+        if (has_next)
+            items.push_back("▶ 다음 페이지");
         items.push_back("뒤로가기");
 
         std::string title = "메시지 목록 (페이지 " + std::to_string(page + 1) + ")";
@@ -360,20 +370,35 @@ static bool handle_message_list_ui(int sock)
 
         // ── 선택 처리 ──
         int msg_count = (int)msgs.size();
-        int prev_idx = (page > 0) ? msg_count : -1;
-        int next_idx = (page > 0) ? msg_count + 1 : msg_count;
-        int back_idx = (page > 0) ? msg_count + 2 : msg_count + 1;
+        int nav = msg_count;
+        int mark_idx = can_mark_all ? nav++ : -1;
+        int prev_idx = (page > 0) ? nav++ : -1;
+        int next_idx = has_next ? nav++ : -1;
+        int back_idx = nav;
 
         if (sel == -1 || sel == back_idx)
             break; // ESC / 뒤로가기
-        if (sel == next_idx)
+        if (can_mark_all && sel == mark_idx)
+        {
+            json read_req = MessageSchema::make_read_up_to_req(PKT_MSG_READ_REQ, head_cursor);
+            json read_res = send_recv(sock, read_req);
+            if (read_res.value("code", -1) == VALUE_SUCCESS)
+                last_unread = false;
+            else
+                tui_menu("읽음 처리 실패: " + read_res.value("msg", "오류"), {"확인"});
+            continue;
+        } // 모두 읽음 처리
+        if (has_next && sel == next_idx)
         {
+            cursors.resize(page + 1);
+            cursors.push_back(next_cursor);
             page++;
             continue;
         } // 다음 페이지
         if (page > 0 && sel == prev_idx)
         {
             page--;
+            cursors.resize(page + 1);
             continue;
         } // 이전 페이지
 
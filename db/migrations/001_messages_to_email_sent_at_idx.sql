@@ -0,0 +1,13 @@
+-- ============================================================================
+-- 파일명: 001_messages_to_email_sent_at_idx.sql
+-- 목적: 메시지 목록(PKT_MSG_LIST_REQ 0x0012) 커서 페이징용 인덱스
+--
+-- handle_msg_list → storage list_messages (storage_mariadb.cpp) 의
+--   WHERE to_email = ? AND (sent_at < ? OR (sent_at = ? AND msg_id < ?))
+--   ORDER BY sent_at DESC, msg_id DESC LIMIT 20
+-- 를 인덱스 범위 스캔 20행으로 끝내기 위함 (filesort / OFFSET 스캔 없음)
+--
+-- 적용: mysql -u <user> -p <db> < db/migrations/001_messages_to_email_sent_at_idx.sql
+-- ============================================================================
+CREATE INDEX idx_messages_to_sent
+    ON messages (to_email, sent_at, msg_id);
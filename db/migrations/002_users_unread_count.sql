@@ -0,0 +1,21 @@
+-- ============================================================================
+-- 파일명: 002_users_unread_count.sql
+-- 목적: 유저별 안읽은 메시지 수 (폴링 0x0011 / 메인 메뉴 안읽음 표시용)
+--
+-- 폴링이 5초마다
+--   SELECT ... FROM messages WHERE to_email = ? AND is_read = 0
+-- 를 돌리지 않도록 users 에 카운터를 두고, 메시지 INSERT / 읽음 처리 / 삭제 문장과
+-- 같은 트랜잭션에서 갱신 (storage_mariadb.cpp bump_unread)
+-- 서버는 이 값을 메모리(unread_counter)에 올려 두고 폴링에 답함
+--
+-- 적용 (서버 정지 상태에서, 기존 메시지 기준으로 한 번 채움):
+--   mysql -u <user> -p <db> < db/migrations/002_users_unread_count.sql
+-- ============================================================================
+ALTER TABLE users
+    ADD COLUMN unread_count INT NOT NULL DEFAULT 0;
+
+UPDATE users u
+   SET u.unread_count = (SELECT COUNT(*)
+                           FROM messages m
+                          WHERE m.to_email = u.email
+                            AND m.is_read = 0);
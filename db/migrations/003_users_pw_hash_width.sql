@@ -0,0 +1,14 @@
+-- ============================================================================
+-- 파일명: 003_users_pw_hash_width.sql
+-- 목적: users.pw_hash 를 서버 측 PBKDF2 저장 형식 길이에 맞게 넓힘
+--
+-- 저장 형식 (server/credential_pool.h)
+--   pbkdf2-sha256$<반복 수>$<salt hex 32자>$<결과 hex 64자>   ← 약 120자
+-- 예전 행(클라이언트 SHA-256 hex 그대로)은 로그인 성공 시 서버가 새 형식으로 바꿈
+-- → 별도 데이터 변환 없이 컬럼 길이만 늘리면 됨
+--
+-- 적용 (새 서버 배포 전에):
+--   mysql -u <user> -p <db> < db/migrations/003_users_pw_hash_width.sql
+-- ============================================================================
+ALTER TABLE users
+    MODIFY pw_hash VARCHAR(255) NOT NULL;
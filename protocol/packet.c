@@ -50,4 +50,20 @@ int packet_recv(int sock, char** out_buf, uint32_t* out_len)
     *out_buf = buf;
     *out_len = len;
     return 0;
-}
\ No newline at end of file
+}
+
+void packet_put_header(char* out4, uint32_t len)
+{
+    uint32_t net_len = htonl(len);
+    memcpy(out4, &net_len, sizeof(net_len));
+}
+
+int packet_frame_ready(const char* buf, uint32_t avail, uint32_t* out_len)
+{
+    uint32_t net_len;
+    if (avail < sizeof(net_len)) return 0;
+    memcpy(&net_len, buf, sizeof(net_len));
+    uint32_t len = ntohl(net_len);
+    *out_len = len;
+    return avail - sizeof(net_len) >= len ? 1 : 0;
+}
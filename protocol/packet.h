@@ -10,6 +10,10 @@ extern "C" {
 int packet_send(int sock, const char* data, uint32_t len);                          //  length-prefix 전송 API
 int packet_recv(int sock, char** out_buf, uint32_t* out_len);                       // length-prefix 수신 API (malloc 버퍼 반환)
 
+/* 논블로킹 소켓(epoll 등)용: 소켓을 직접 읽고 쓰는 쪽이 같은 형식으로 프레임을 만들고 자름 */
+void packet_put_header(char* out4, uint32_t len);                                   // out4 에 길이 머리 4바이트 기록
+int packet_frame_ready(const char* buf, uint32_t avail, uint32_t* out_len);         // buf 앞에 완성된 패킷이 있으면 1, 모자라면 0 (머리 4바이트가 있으면 out_len = payload 길이)
+
 #ifdef __cplusplus                                                                  // C++ 컴파일러면
 }                                                                                   // extern "C" 닫기
 #endif                                                                             
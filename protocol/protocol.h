@@ -43,6 +43,10 @@ typedef enum
     PKT_ADMIN_USER_LIST_REQ    = 0x0040,
     PKT_ADMIN_USER_INFO_REQ    = 0x0041,
     PKT_ADMIN_STATE_CHANGE_REQ = 0x0042,
+    PKT_ADMIN_STATS_REQ        = 0x0043, /* 서버 지표 요약 (큐 대기 / 처리 시간 / DB 시간 / 세션 수) */
+
+    /* ================= 묶음 요청 ================= */
+    PKT_BATCH = 0x0050, /* payload.requests 배열을 한 번에 처리, payload.responses 배열로 응답 */
 
 } PacketType;
 
@@ -62,6 +66,7 @@ typedef enum
     VALUE_ERR_SESSION        = -3,
     VALUE_ERR_PERMISSION     = -4,
     VALUE_ERR_INVALID_PACKET = -5,
+    VALUE_ERR_RATE_LIMITED   = -6, /* 로그인 / 비밀번호 확인 시도 제한 (payload.retry_after 초) */
 
     /* 회원가입 */
     VALUE_ERR_ID_DUPLICATE   = -10,
@@ -115,6 +115,15 @@ namespace MessageSchema
                         make_list_payload());
     }
 
+    // 커서 기반 목록 조회 (cursor = 이전 응답의 payload.next_cursor, null 이면 첫 페이지)
+    inline json make_list_cursor_req(int type_msg_list_req, const json &cursor)
+    {
+        json pl = make_list_payload();
+        if (!cursor.is_null())
+            pl["cursor"] = cursor;
+        return make_req(type_msg_list_req, pl);
+    }
+
     // 메시지 읽기 payload
     inline json make_read_payload(int msg_id)
     {
@@ -130,6 +139,23 @@ namespace MessageSchema
                         make_read_payload(msg_id));
     }
 
+    // 여러 메시지 읽음 처리 (msg_ids 배열, 최대 100)
+    inline json make_bulk_read_req(int type_msg_read_req,
+                                   const std::vector<int>& msg_ids)
+    {
+        json pl;
+        pl["msg_ids"] = msg_ids;
+        return make_req(type_msg_read_req, pl);
+    }
+
+    // 커서까지 모두 읽음 처리 (cursor = 목록 응답의 head_cursor 등)
+    inline json make_read_up_to_req(int type_msg_read_req, const json &cursor)
+    {
+        json pl;
+        pl["up_to"] = cursor;
+        return make_req(type_msg_read_req, pl);
+    }
+
     // 메시지 삭제 payload
     inline json make_delete_payload(int msg_id)
     {
@@ -183,4 +209,32 @@ namespace MessageSchema
         return make_req(type_msg_setting_save_req,
                         make_setting_save_payload(user_no, prefix, suffix));
     }
-}
\ No newline at end of file
+}
+
+// ============================================================
+// Batch Schema
+// ============================================================
+namespace BatchSchema
+{
+    // 묶음 요청 패킷: 하위 요청(make_req 결과)들을 순서대로 담음
+    // atomic = true 이면 서버가 하나의 DB 트랜잭션으로 처리
+    inline json make_batch_req(int type_batch,
+                               const std::vector<json> &requests,
+                               bool atomic = false)
+    {
+        json pl;
+        pl["requests"] = requests;
+        pl["atomic"] = atomic;
+        return make_req(type_batch, pl);
+    }
+
+    // 묶음 응답에서 idx 번째 하위 응답 꺼내기 (없으면 빈 object)
+    inline json get_sub_response(const json &batch_res, size_t idx)
+    {
+        const json pl = batch_res.value("payload", json::object());
+        if (!pl.contains("responses") || !pl["responses"].is_array() ||
+            idx >= pl["responses"].size())
+            return json::object();
+        return pl["responses"][idx];
+    }
+}
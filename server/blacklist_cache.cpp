@@ -0,0 +1,164 @@
+// ============================================================================
+// 파일명: blacklist_cache.cpp
+// 목적: 블랙리스트 메모리 색인 구현 (blacklist_cache.h 설명 참고)
+// ============================================================================
+#include "blacklist_cache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+static constexpr size_t BLACKLIST_SHARDS = 16;   // 샤드 수
+static constexpr size_t BLOOM_MIN_ENTRIES = 64;  // 이 개수 이상이면 Bloom filter 구성
+static constexpr size_t BLOOM_BITS_PER_KEY = 10; // 해시 3개 기준 오탐률 약 1~2%
+
+// ─────────────────────────────────────────────────────────────────
+//  BloomFilter
+// ─────────────────────────────────────────────────────────────────
+static void bloom_hashes(const std::string &key, size_t nbits, size_t out[3])
+{
+    // 해시 하나에서 3개를 만들어 씀 (double hashing)
+    uint64_t h1 = std::hash<std::string>{}(key);
+    uint64_t h2 = (h1 >> 33) | (h1 << 31);
+    h2 = h2 * 0x9E3779B97F4A7C15ULL | 1;
+    for (size_t i = 0; i < 3; ++i)
+        out[i] = static_cast<size_t>((h1 + i * h2) % nbits);
+}
+
+void BloomFilter::build(const std::unordered_set<std::string> &keys)
+{
+    bits_.clear();
+    if (keys.size() < BLOOM_MIN_ENTRIES)
+        return;
+
+    size_t nbits = keys.size() * BLOOM_BITS_PER_KEY;
+    bits_.assign((nbits + 63) / 64, 0);
+    nbits = bits_.size() * 64;
+    for (const auto &k : keys)
+    {
+        size_t h[3];
+        bloom_hashes(k, nbits, h);
+        for (size_t b : h)
+            bits_[b / 64] |= (1ULL << (b % 64));
+    }
+}
+
+bool BloomFilter::maybe_contains(const std::string &key) const
+{
+    if (bits_.empty())
+        return true; // filter 없음 → 해시셋에서 확인
+    size_t nbits = bits_.size() * 64;
+    size_t h[3];
+    bloom_hashes(key, nbits, h);
+    for (size_t b : h)
+        if (!(bits_[b / 64] & (1ULL << (b % 64))))
+            return false;
+    return true;
+}
+
+// ─────────────────────────────────────────────────────────────────
+//  owner 별 차단 집합
+// ─────────────────────────────────────────────────────────────────
+namespace
+{
+struct Shard
+{
+    std::mutex m;
+    std::unordered_map<std::string, BlockSetPtr> sets;
+    uint64_t epoch = 0; // 추가/해제 때마다 증가 (조회 중 변경된 로드 결과는 버림)
+};
+
+Shard g_shards[BLACKLIST_SHARDS];
+
+std::string lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+Shard &shard_of(const std::string &owner_key)
+{
+    return g_shards[std::hash<std::string>{}(owner_key) % BLACKLIST_SHARDS];
+}
+
+// 현재 집합을 복사해서 수정 후 교체
+template <typename Fn>
+void modify(const std::string &owner_email, Fn fn)
+{
+    std::string key = lower(owner_email);
+    Shard &sh = shard_of(key);
+    std::lock_guard<std::mutex> lk(sh.m);
+    sh.epoch++;
+    auto it = sh.sets.find(key);
+    if (it == sh.sets.end())
+        return; // 아직 로드 전 → 다음 조회 때 DB 에서 최신 상태로 읽음
+
+    auto next = std::make_shared<BlockSet>();
+    next->emails = it->second->emails;
+    fn(next->emails);
+    next->bloom.build(next->emails);
+    it->second = std::move(next);
+}
+} // namespace
+
+BlockSetPtr blacklist_cache_get(Storage &db, const std::string &owner_email)
+{
+    std::string key = lower(owner_email);
+    Shard &sh = shard_of(key);
+    uint64_t epoch = 0;
+    {
+        std::lock_guard<std::mutex> lk(sh.m);
+        auto it = sh.sets.find(key);
+        if (it != sh.sets.end())
+            return it->second;
+        epoch = sh.epoch;
+    }
+
+    auto loaded = std::make_shared<BlockSet>();
+    for (const auto &e : db.blocked_emails(owner_email))
+        loaded->emails.insert(lower(e));
+    loaded->bloom.build(loaded->emails);
+
+    if (db.is_replica())
+        return loaded; // 복제 지연분이 캐시에 남지 않도록 주 DB 에서 읽은 값만 보관
+
+    std::lock_guard<std::mutex> lk(sh.m);
+    if (sh.epoch == epoch)
+        sh.sets.emplace(key, loaded); // 다른 스레드가 먼저 넣었으면 그대로 둠
+    return loaded;
+}
+
+bool blacklist_cache_is_blocked(Storage &db, const std::string &owner_email, const std::string &sender_email)
+{
+    BlockSetPtr bs = blacklist_cache_get(db, owner_email);
+    if (bs->emails.empty())
+        return false;
+    std::string key = lower(sender_email);
+    if (!bs->bloom.maybe_contains(key))
+        return false;
+    return bs->emails.count(key) > 0;
+}
+
+void blacklist_cache_add(const std::string &owner_email, const std::string &blocked_email)
+{
+    std::string blocked = lower(blocked_email);
+    modify(owner_email, [&](std::unordered_set<std::string> &s) { s.insert(blocked); });
+}
+
+void blacklist_cache_remove(const std::string &owner_email, const std::string &blocked_email)
+{
+    std::string blocked = lower(blocked_email);
+    modify(owner_email, [&](std::unordered_set<std::string> &s) { s.erase(blocked); });
+}
+
+void blacklist_cache_forget(const std::string &owner_email)
+{
+    std::string key = lower(owner_email);
+    Shard &sh = shard_of(key);
+    std::lock_guard<std::mutex> lk(sh.m);
+    sh.epoch++;
+    sh.sets.erase(key);
+}
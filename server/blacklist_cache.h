@@ -0,0 +1,56 @@
+// ============================================================================
+// 파일명: blacklist_cache.h
+// 목적: 차단자(owner_email) 별 차단 이메일 집합을 메모리에 보관
+//
+// - owner 별로 처음 조회할 때 blacklist 테이블에서 한 번 읽어옴 (lazy load)
+// - 블랙리스트 추가/해제 핸들러가 DB 반영 직후 blacklist_cache_add/remove 호출
+// - 집합은 통째로 교체(copy-on-write) → 읽는 쪽은 락 없이 shared_ptr 로 사용
+// - 차단 목록이 큰 owner 는 Bloom filter 를 앞에 둠 (대부분의 "차단 아님" 을 해시셋 조회 없이 판정)
+// - 비교는 소문자 기준 (DB 컬럼 collation 이 대소문자 구분 없음)
+//
+// 사용 예:
+//   if (blacklist_cache_is_blocked(db, owner_email, sender_email)) { ... 무시 ... }
+//   BlockSetPtr bs = blacklist_cache_get(db, owner_email);
+//   for (const auto &e : bs->emails) { ... }
+// ============================================================================
+#pragma once
+
+#include "storage.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// 고정 크기 Bloom filter (해시 3개)
+class BloomFilter
+{
+public:
+    void build(const std::unordered_set<std::string> &keys);
+    bool maybe_contains(const std::string &key) const;
+    bool empty() const { return bits_.empty(); }
+
+private:
+    std::vector<uint64_t> bits_; // 비어 있으면 사용 안 함
+};
+
+struct BlockSet
+{
+    std::unordered_set<std::string> emails; // 차단된 이메일 (소문자)
+    BloomFilter bloom;                      // emails 가 BLOOM_MIN_ENTRIES 이상일 때만 구성
+};
+
+using BlockSetPtr = std::shared_ptr<const BlockSet>;
+
+// owner 의 차단 집합 (없으면 빈 집합). StorageError 는 그대로 전달
+BlockSetPtr blacklist_cache_get(Storage &db, const std::string &owner_email);
+
+// owner 가 sender 를 차단했는지 (메모리 조회만, 처음 한 번만 DB)
+bool blacklist_cache_is_blocked(Storage &db, const std::string &owner_email, const std::string &sender_email);
+
+// 블랙리스트 DB 변경 직후 호출 (로드되지 않은 owner 면 아무것도 안 함)
+void blacklist_cache_add(const std::string &owner_email, const std::string &blocked_email);
+void blacklist_cache_remove(const std::string &owner_email, const std::string &blocked_email);
+
+// owner 의 집합을 버림 (트랜잭션 rollback 등으로 DB 와 어긋났을 수 있을 때)
+void blacklist_cache_forget(const std::string &owner_email);
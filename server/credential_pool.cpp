@@ -0,0 +1,444 @@
+// ============================================================================
+// 파일명: credential_pool.cpp
+// 목적: 비밀번호 해싱 풀 + 검증 결과 캐시 구현 (credential_pool.h 설명 참고)
+// ============================================================================
+#include "credential_pool.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr int PW_HASH_ITERATIONS = 100000;                 // 새로 만드는 해시의 PBKDF2 반복 수
+static constexpr size_t PW_SALT_BYTES = 16;                       // salt 길이
+static constexpr size_t PW_DK_BYTES = 32;                         // 결과 길이 (SHA-256)
+static constexpr size_t VERIFY_CACHE_SHARDS = 16;                 // 캐시 샤드 수
+static constexpr size_t VERIFY_CACHE_SHARD_MAX = 4096;            // 샤드당 최대 항목 수
+static constexpr std::chrono::minutes VERIFY_CACHE_OK_TTL{10};    // 일치 결과 보관 시간
+static constexpr std::chrono::seconds VERIFY_CACHE_FAIL_TTL{60};  // 불일치 결과 보관 시간
+static constexpr size_t MADE_MAX = 4096;                          // 꺼내 가지 않은 새 해시 최대 보관 수
+static constexpr std::chrono::seconds MADE_TTL{60};               // 새 해시 보관 시간 (다시 들어온 요청이 꺼내 감)
+
+static const std::string PW_HASH_PREFIX = "pbkdf2-sha256$";
+
+namespace
+{
+// ── 검증 결과 캐시 ───────────────────────────────────────────────────────────
+
+struct Verdict
+{
+    bool ok = false;
+    std::string upgrade; // ok 이고 저장 형식을 바꿔야 하면 새 값
+};
+
+struct CacheEntry
+{
+    Verdict v;
+    Clock::time_point expires;
+};
+
+struct CacheShard
+{
+    std::mutex m;
+    std::unordered_map<std::string, CacheEntry> entries; // sha256(stored \n presented) -> 결과
+};
+CacheShard g_cache[VERIFY_CACHE_SHARDS];
+
+std::atomic<uint64_t> g_cache_hits{0};
+std::atomic<uint64_t> g_cache_misses{0};
+std::atomic<uint64_t> g_submitted{0};
+std::atomic<uint64_t> g_inline_runs{0};
+std::atomic<uint64_t> g_rejected{0};
+std::atomic<uint64_t> g_hashes{0};
+std::atomic<uint64_t> g_hash_us{0};
+std::atomic<uint64_t> g_hash_us_max{0};
+
+// 캐시 키: 원문을 그대로 들고 있지 않도록 해시로
+std::string cache_key(const std::string &stored, const std::string &presented)
+{
+    std::string in;
+    in.reserve(stored.size() + 1 + presented.size());
+    in += stored;
+    in += '\n';
+    in += presented;
+    unsigned char md[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char *>(in.data()), in.size(), md);
+    return std::string(reinterpret_cast<const char *>(md), sizeof(md));
+}
+
+CacheShard &shard_of(const std::string &key)
+{
+    return g_cache[static_cast<unsigned char>(key[0]) % VERIFY_CACHE_SHARDS];
+}
+
+bool cache_get(const std::string &key, Verdict &out)
+{
+    CacheShard &sh = shard_of(key);
+    std::lock_guard<std::mutex> lk(sh.m);
+    auto it = sh.entries.find(key);
+    if (it == sh.entries.end())
+        return false;
+    if (Clock::now() > it->second.expires)
+    {
+        sh.entries.erase(it);
+        return false;
+    }
+    out = it->second.v;
+    return true;
+}
+
+void cache_put(const std::string &key, const Verdict &v)
+{
+    Clock::time_point now = Clock::now();
+    CacheShard &sh = shard_of(key);
+    std::lock_guard<std::mutex> lk(sh.m);
+    if (sh.entries.size() >= VERIFY_CACHE_SHARD_MAX)
+    {
+        for (auto it = sh.entries.begin(); it != sh.entries.end();)
+            it = (now > it->second.expires) ? sh.entries.erase(it) : std::next(it);
+        if (sh.entries.size() >= VERIFY_CACHE_SHARD_MAX)
+            sh.entries.erase(sh.entries.begin()); // 그래도 가득이면 아무거나 하나
+    }
+    sh.entries[key] = CacheEntry{v, now + (v.ok ? std::chrono::duration_cast<Clock::duration>(VERIFY_CACHE_OK_TTL)
+                                                : std::chrono::duration_cast<Clock::duration>(VERIFY_CACHE_FAIL_TTL))};
+}
+
+// ── 새로 만든 해시 (pw_hash_new) ─────────────────────────────────────────────
+// salt 가 매번 달라야 하므로 검증 캐시와 달리 한 번 꺼내면 지움
+
+struct Made
+{
+    std::string hash;
+    Clock::time_point expires;
+};
+std::mutex g_made_m;
+std::unordered_map<std::string, Made> g_made; // sha256(owner \n presented) -> 새 저장값
+
+bool made_has(const std::string &key)
+{
+    std::lock_guard<std::mutex> lk(g_made_m);
+    auto it = g_made.find(key);
+    return it != g_made.end() && Clock::now() <= it->second.expires;
+}
+
+bool made_take(const std::string &key, std::string &out)
+{
+    std::lock_guard<std::mutex> lk(g_made_m);
+    auto it = g_made.find(key);
+    if (it == g_made.end())
+        return false;
+    bool fresh = Clock::now() <= it->second.expires;
+    if (fresh)
+        out = std::move(it->second.hash);
+    g_made.erase(it);
+    return fresh;
+}
+
+void made_put(const std::string &key, std::string hash)
+{
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lk(g_made_m);
+    if (g_made.size() >= MADE_MAX)
+    {
+        for (auto it = g_made.begin(); it != g_made.end();)
+            it = (now > it->second.expires) ? g_made.erase(it) : std::next(it);
+        if (g_made.size() >= MADE_MAX)
+            g_made.erase(g_made.begin());
+    }
+    g_made[key] = Made{std::move(hash), now + std::chrono::duration_cast<Clock::duration>(MADE_TTL)};
+}
+
+// ── PBKDF2 ───────────────────────────────────────────────────────────────────
+
+std::string to_hex(const unsigned char *p, size_t n)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string s;
+    s.reserve(n * 2);
+    for (size_t i = 0; i < n; ++i)
+    {
+        s += digits[p[i] >> 4];
+        s += digits[p[i] & 0x0f];
+    }
+    return s;
+}
+
+bool from_hex(const std::string &s, std::vector<unsigned char> &out)
+{
+    if (s.size() % 2 != 0)
+        return false;
+    auto nib = [](char c) -> int {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    };
+    out.clear();
+    out.reserve(s.size() / 2);
+    for (size_t i = 0; i < s.size(); i += 2)
+    {
+        int hi = nib(s[i]), lo = nib(s[i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        out.push_back(static_cast<unsigned char>(hi << 4 | lo));
+    }
+    return true;
+}
+
+// PBKDF2 한 번 (계산 시간 집계 포함)
+bool derive(const std::string &presented, const unsigned char *salt, size_t salt_len, int iter,
+            unsigned char *out, size_t out_len)
+{
+    auto t0 = Clock::now();
+    int rc = PKCS5_PBKDF2_HMAC(presented.data(), static_cast<int>(presented.size()), salt, static_cast<int>(salt_len),
+                               iter, EVP_sha256(), static_cast<int>(out_len), out);
+    uint64_t us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count());
+    g_hashes++;
+    g_hash_us += us;
+    uint64_t prev = g_hash_us_max.load();
+    while (us > prev && !g_hash_us_max.compare_exchange_weak(prev, us))
+    {
+    }
+    return rc == 1;
+}
+
+// "pbkdf2-sha256$iter$salt$dk" 분해 (형식이 아니면 false)
+bool parse_stored(const std::string &stored, int &iter, std::vector<unsigned char> &salt, std::vector<unsigned char> &dk)
+{
+    if (stored.compare(0, PW_HASH_PREFIX.size(), PW_HASH_PREFIX) != 0)
+        return false;
+    size_t p1 = PW_HASH_PREFIX.size();
+    size_t p2 = stored.find('$', p1);
+    if (p2 == std::string::npos)
+        return false;
+    size_t p3 = stored.find('$', p2 + 1);
+    if (p3 == std::string::npos)
+        return false;
+    iter = std::atoi(stored.substr(p1, p2 - p1).c_str());
+    return iter > 0 && from_hex(stored.substr(p2 + 1, p3 - p2 - 1), salt) &&
+           from_hex(stored.substr(p3 + 1), dk) && !dk.empty();
+}
+
+bool is_legacy(const std::string &stored) { return stored.compare(0, PW_HASH_PREFIX.size(), PW_HASH_PREFIX) != 0; }
+
+bool same_bytes(const void *a, const void *b, size_t n) { return CRYPTO_memcmp(a, b, n) == 0; }
+
+// 느린 검증 (풀 스레드 또는 호출 스레드)
+Verdict compute_verdict(const std::string &stored, const std::string &presented)
+{
+    Verdict v;
+    if (is_legacy(stored))
+    {
+        // 예전 행: 클라이언트 해시 그대로 비교, 맞으면 새 형식으로
+        v.ok = stored.size() == presented.size() && same_bytes(stored.data(), presented.data(), stored.size());
+        if (v.ok)
+            v.upgrade = pw_hash_make(presented);
+        return v;
+    }
+
+    int iter = 0;
+    std::vector<unsigned char> salt, dk;
+    if (!parse_stored(stored, iter, salt, dk))
+        return v; // 깨진 저장값 → 불일치
+
+    std::vector<unsigned char> got(dk.size());
+    if (!derive(presented, salt.data(), salt.size(), iter, got.data(), got.size()))
+        return v;
+    v.ok = same_bytes(got.data(), dk.data(), dk.size());
+    if (v.ok && iter < PW_HASH_ITERATIONS)
+        v.upgrade = pw_hash_make(presented); // 반복 수 기준이 올라간 뒤의 예전 해시
+    return v;
+}
+
+// ── 풀 ───────────────────────────────────────────────────────────────────────
+
+std::mutex g_q_m;
+std::condition_variable g_q_cv;
+std::deque<std::function<void()>> g_q;
+size_t g_q_max = 0;
+size_t g_q_peak = 0;
+bool g_pool_running = false;
+std::vector<std::thread> g_threads;
+
+void pool_loop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lk(g_q_m);
+            g_q_cv.wait(lk, [] { return !g_q.empty() || !g_pool_running; });
+            if (g_q.empty())
+                return; // 정지 + 남은 작업 없음
+            job = std::move(g_q.front());
+            g_q.pop_front();
+        }
+        job();
+    }
+}
+} // namespace
+
+void credential_pool_start(size_t threads, size_t queue_max)
+{
+    std::lock_guard<std::mutex> lk(g_q_m);
+    if (g_pool_running)
+        return;
+    g_pool_running = true;
+    g_q_max = std::max<size_t>(1, queue_max);
+    for (size_t i = 0; i < std::max<size_t>(1, threads); ++i)
+        g_threads.emplace_back(pool_loop);
+}
+
+void credential_pool_stop()
+{
+    {
+        std::lock_guard<std::mutex> lk(g_q_m);
+        g_pool_running = false;
+    }
+    g_q_cv.notify_all();
+    for (auto &t : g_threads)
+        t.join();
+    g_threads.clear();
+}
+
+PwCheck pw_check(const std::string &stored, const std::string &presented,
+                 const PwResume &resume, std::string *upgrade)
+{
+    if (upgrade)
+        upgrade->clear();
+
+    // 예전 행인데 값이 다르면 계산할 것이 없음 (캐시도 필요 없음)
+    if (is_legacy(stored) &&
+        (stored.size() != presented.size() || !same_bytes(stored.data(), presented.data(), stored.size())))
+        return PwCheck::MISMATCH;
+
+    std::string key = cache_key(stored, presented);
+    Verdict v;
+    if (cache_get(key, v))
+    {
+        g_cache_hits++;
+        if (v.ok && upgrade)
+            *upgrade = v.upgrade;
+        return v.ok ? PwCheck::OK : PwCheck::MISMATCH;
+    }
+    g_cache_misses++;
+
+    if (resume)
+    {
+        std::unique_lock<std::mutex> lk(g_q_m);
+        if (g_pool_running)
+        {
+            if (g_q.size() >= g_q_max)
+            {
+                g_rejected++;
+                return PwCheck::BUSY;
+            }
+            g_q.push_back([stored, presented, key, done = resume()] {
+                cache_put(key, compute_verdict(stored, presented));
+                done();
+            });
+            g_q_peak = std::max(g_q_peak, g_q.size());
+            g_submitted++;
+            lk.unlock();
+            g_q_cv.notify_one();
+            return PwCheck::PENDING;
+        }
+    }
+
+    // 기다릴 수 없는 호출 (묶음 요청 안 / 다시 들어온 요청인데 캐시에서 밀려남 / 풀 정지)
+    g_inline_runs++;
+    v = compute_verdict(stored, presented);
+    cache_put(key, v);
+    if (v.ok && upgrade)
+        *upgrade = v.upgrade;
+    return v.ok ? PwCheck::OK : PwCheck::MISMATCH;
+}
+
+PwCheck pw_hash_new(const std::string &owner, const std::string &presented,
+                    const PwResume &resume, std::string *out)
+{
+    std::string key = cache_key(owner, presented);
+    if (out ? made_take(key, *out) : made_has(key))
+    {
+        g_cache_hits++;
+        return PwCheck::OK;
+    }
+    g_cache_misses++;
+
+    if (resume)
+    {
+        std::unique_lock<std::mutex> lk(g_q_m);
+        if (g_pool_running)
+        {
+            if (g_q.size() >= g_q_max)
+            {
+                g_rejected++;
+                return PwCheck::BUSY;
+            }
+            g_q.push_back([presented, key, done = resume()] {
+                made_put(key, pw_hash_make(presented));
+                done();
+            });
+            g_q_peak = std::max(g_q_peak, g_q.size());
+            g_submitted++;
+            lk.unlock();
+            g_q_cv.notify_one();
+            return PwCheck::PENDING;
+        }
+    }
+
+    // 기다릴 수 없는 호출 (묶음 요청 안 / 다시 들어온 요청인데 보관 시간 초과 / 풀 정지)
+    g_inline_runs++;
+    std::string made = pw_hash_make(presented);
+    if (out)
+        *out = std::move(made);
+    else
+        made_put(key, std::move(made));
+    return PwCheck::OK;
+}
+
+std::string pw_hash_make(const std::string &presented)
+{
+    unsigned char salt[PW_SALT_BYTES];
+    if (RAND_bytes(salt, sizeof(salt)) != 1)
+        return "";
+    unsigned char dk[PW_DK_BYTES];
+    if (!derive(presented, salt, sizeof(salt), PW_HASH_ITERATIONS, dk, sizeof(dk)))
+        return "";
+    return PW_HASH_PREFIX + std::to_string(PW_HASH_ITERATIONS) + "$" + to_hex(salt, sizeof(salt)) + "$" +
+           to_hex(dk, sizeof(dk));
+}
+
+CredentialPoolStats credential_pool_stats()
+{
+    CredentialPoolStats st;
+    st.cache_hits = g_cache_hits.load();
+    st.cache_misses = g_cache_misses.load();
+    st.submitted = g_submitted.load();
+    st.inline_runs = g_inline_runs.load();
+    st.rejected = g_rejected.load();
+    st.hashes = g_hashes.load();
+    st.hash_us = g_hash_us.load();
+    st.hash_us_max = g_hash_us_max.load();
+    std::lock_guard<std::mutex> lk(g_q_m);
+    st.queued = g_q.size();
+    st.queued_max = g_q_peak;
+    return st;
+}
@@ -0,0 +1,79 @@
+// ============================================================================
+// 파일명: credential_pool.h
+// 목적: 비밀번호 검증 / 해싱 전용 스레드 풀 (DB worker 밖에서 느린 해시 계산)
+//
+// - 저장 형식: users.pw_hash = "pbkdf2-sha256$<반복 수>$<salt hex>$<결과 hex>"
+//   클라이언트가 보내는 SHA-256 문자열 위에 PBKDF2-HMAC-SHA256 (OpenSSL) 을 한 번 더 적용
+//   예전 행(클라이언트 해시를 그대로 저장)은 비교 후 로그인 성공 시 새 형식으로 바꿈 (upgrade)
+//   반복 수가 현재 기준보다 적은 행도 같은 방식으로 다시 해싱
+// - pw_check() 는 최근 검증 결과 캐시 (저장값 + 입력값 → ok) 를 먼저 봄 → 적중이면 즉시 답
+// - miss 면 resume 이 있으면 풀에 넣고 PENDING (DB worker 는 바로 다음 요청 처리)
+//   풀에 넣을 때 resume() 으로 "끝나면 부를 콜백" 을 만들어 받음 (미루지 않는 요청은 아무것도 안 만듦)
+//   풀 스레드가 계산해 캐시에 넣은 뒤 그 콜백 → 요청을 다시 큐에 넣으면 그때는 캐시 적중
+//   resume 이 없거나 풀이 멈춰 있으면 호출한 스레드에서 바로 계산 (묶음 요청 안 등)
+// - 풀 큐는 크기 제한, 가득 차면 BUSY (로그인 폭주가 메시지 처리를 굶기지 않도록)
+// - 가입 인증 / 비밀번호 변경의 새 해시도 pw_hash_new() 로 같은 풀에서 계산
+//   (PENDING → 콜백 → 다시 들어온 요청이 결과를 한 번 꺼내 감)
+//
+// 사용 예 (worker):
+//   std::string upgrade;
+//   switch (pw_check(user->pw_hash, client_pw_hash, ctx.resume, &upgrade)) {
+//   case PwCheck::PENDING: return "";          // 계산 끝나면 요청이 다시 들어옴
+//   case PwCheck::BUSY:    ... 잠시 후 재시도 응답 ...
+//   case PwCheck::OK:      if (!upgrade.empty()) db.update_user_field(no, UserField::PW_HASH, upgrade);
+//   ...
+// ============================================================================
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// 풀에 넣을 때만 호출: 계산이 끝나면 풀 스레드가 부를 콜백을 만들어 돌려줌
+// (요청마다 콜백을 미리 만들면 캐시 적중 / 해시가 필요 없는 요청도 payload 를 복사하게 됨)
+using PwResume = std::function<std::function<void()>()>;
+
+enum class PwCheck
+{
+    OK,       // 일치
+    MISMATCH, // 불일치
+    PENDING,  // 풀에서 계산 중 (끝나면 resume 이 만든 콜백 호출)
+    BUSY      // 풀 큐가 가득 참
+};
+
+struct CredentialPoolStats
+{
+    uint64_t cache_hits = 0;   // 캐시로 답한 검증
+    uint64_t cache_misses = 0; // 해시 계산이 필요했던 검증
+    uint64_t submitted = 0;    // 풀에 넣은 작업
+    uint64_t inline_runs = 0;  // 호출 스레드에서 계산한 검증 (resume 없음 / 풀 정지)
+    uint64_t rejected = 0;     // 큐가 가득 차서 BUSY
+    uint64_t hashes = 0;       // PBKDF2 계산 횟수
+    uint64_t hash_us = 0;      // PBKDF2 계산 시간 합 (us)
+    uint64_t hash_us_max = 0;  // 가장 오래 걸린 계산 (us)
+    size_t queued = 0;         // 현재 큐 길이
+    size_t queued_max = 0;     // 가장 길었던 큐 길이
+};
+
+// main 에서 worker 시작 전 / worker join 후 (남은 작업은 버리지 않고 끝까지 계산)
+void credential_pool_start(size_t threads, size_t queue_max);
+void credential_pool_stop();
+
+// stored(users.pw_hash) 와 클라이언트 pw_hash 비교
+// OK 이고 upgrade 가 채워지면 호출자가 users.pw_hash 를 그 값으로 바꿈
+PwCheck pw_check(const std::string &stored, const std::string &presented,
+                 const PwResume &resume, std::string *upgrade);
+
+// 새 저장 형식을 풀에서 계산 (가입 인증 / 비밀번호 변경)
+// - owner 는 요청 주체 ("verify:<email>", "user:<no>" 등), owner + presented 로 결과를 보관
+// - OK 면 out 에 결과 (난수 생성 실패 시 빈 문자열). 결과는 한 번 꺼내면 지움
+// - out 이 nullptr 이면 미리 계산만 (묶음 요청 처리 전), 결과는 다음 호출이 꺼내 감
+// - resume 이 없거나 풀이 멈춰 있으면 호출한 스레드에서 바로 계산
+PwCheck pw_hash_new(const std::string &owner, const std::string &presented,
+                    const PwResume &resume, std::string *out);
+
+// 새 저장 형식 (호출 스레드에서 바로 계산). 난수 생성 실패 시 빈 문자열
+std::string pw_hash_make(const std::string &presented);
+
+CredentialPoolStats credential_pool_stats();
@@ -0,0 +1,309 @@
+// ============================================================================
+// 파일명: db_pool.cpp
+// 목적: DbPool 구현 (db_pool.h 설명 참고)
+// ============================================================================
+#include "db_pool.h"
+#include "logger.h"
+
+
+using Clock = std::chrono::steady_clock;
+
+// ─────────────────────────────────────────────────────────────────
+//  Lease
+// ─────────────────────────────────────────────────────────────────
+DbPool::Lease &DbPool::Lease::operator=(Lease &&o) noexcept
+{
+    if (this != &o)
+    {
+        release();
+        pool_ = o.pool_;
+        slot_ = o.slot_;
+        o.pool_ = nullptr;
+    }
+    return *this;
+}
+
+DbPool::Lease::Lease(DbPool *pool, size_t slot) : pool_(pool), slot_(slot)
+{
+    Slot &s = pool_->slots_[slot_];
+    stmt_cache_bind(s.conn.get(), &s.stmts);
+}
+
+sql::Connection &DbPool::Lease::operator*() const
+{
+    return *pool_->slots_[slot_].conn;
+}
+
+void DbPool::Lease::discard()
+{
+    if (pool_)
+        pool_->slots_[slot_].discard = true; // 대여 중에는 이 슬롯을 나만 만짐
+}
+
+void DbPool::Lease::release()
+{
+    if (pool_)
+    {
+        stmt_cache_unbind(pool_->slots_[slot_].conn.get());
+        pool_->give_back(slot_);
+        pool_ = nullptr;
+    }
+}
+
+// ─────────────────────────────────────────────────────────────────
+//  DbPool
+// ─────────────────────────────────────────────────────────────────
+DbPool::DbPool(DbConfig cfg, Options opt) : cfg_(std::move(cfg)), opt_(opt)
+{
+    if (opt_.size == 0)
+        opt_.size = 1;
+}
+
+DbPool::~DbPool()
+{
+    stop();
+}
+
+void DbPool::close_slot(Slot &s)
+{
+    s.stmts.clear();
+    s.conn.reset();
+}
+
+std::unique_ptr<sql::Connection> DbPool::connect_one()
+{
+    try
+    {
+        sql::Driver *driver = sql::mariadb::get_driver_instance();
+        sql::Properties props({{"user", cfg_.user},
+                               {"password", cfg_.pw},
+                               {"connectTimeout", "3000"},
+                               // 캐시를 쓸 때만 서버 측 prepare (한 번 준비해서 계속 재사용)
+                               {"useServerPrepStmts", stmt_cache_enabled() ? "true" : "false"}});
+        std::unique_ptr<sql::Connection> conn(driver->connect(cfg_.url, props));
+        {
+            std::unique_ptr<sql::Statement> st(conn->createStatement());
+            st->execute("SET NAMES 'utf8mb4'");
+            if (opt_.read_only)
+                st->execute("SET SESSION TRANSACTION READ ONLY"); // 잘못 들어온 쓰기는 오류로
+        }
+        connects_++;
+        return conn;
+    }
+    catch (const sql::SQLException &e)
+    {
+        connect_fails_++;
+        LOG_ERROR("[DbPool] DB connect failed: " << e.what());
+        return nullptr;
+    }
+}
+
+void DbPool::start()
+{
+    if (running_.exchange(true))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        slots_.resize(opt_.size);
+    }
+
+    // 슬롯마다 스레드 하나씩 병렬 연결 → 연결되는 슬롯부터 바로 대여 가능
+    for (size_t i = 0; i < opt_.size; ++i)
+    {
+        starters_.emplace_back([this, i] {
+            std::unique_ptr<sql::Connection> conn = connect_one();
+            std::lock_guard<std::mutex> lk(m_);
+            Slot &s = slots_[i];
+            s.conn = std::move(conn);
+            s.created = s.last_used = Clock::now();
+            idle_.push_back(i);
+            cv_.notify_one();
+        });
+    }
+
+    maint_ = std::thread(&DbPool::maintenance_loop, this);
+}
+
+void DbPool::stop()
+{
+    if (!running_.exchange(false))
+        return;
+
+    cv_.notify_all();
+    maint_cv_.notify_all();
+    for (auto &th : starters_)
+        if (th.joinable())
+            th.join();
+    starters_.clear();
+    if (maint_.joinable())
+        maint_.join();
+
+    std::lock_guard<std::mutex> lk(m_);
+    for (auto &s : slots_)
+        close_slot(s);
+    idle_.clear();
+}
+
+bool DbPool::prepare_slot(Slot &s, bool reconnect)
+{
+    auto now = Clock::now();
+
+    // 1) 수명 초과 → 교체
+    if (s.conn && now - s.created > opt_.max_lifetime)
+    {
+        close_slot(s);
+        rotations_++;
+    }
+
+    // 2) 오래 쉬었으면 살아있는지 확인 (끊긴 링크는 여기서 걸러짐)
+    if (s.conn && now - s.last_used > opt_.validate_after_idle)
+    {
+        bool ok = false;
+        try
+        {
+            ok = s.conn->isValid();
+        }
+        catch (...)
+        {
+        }
+        if (!ok)
+            close_slot(s);
+    }
+
+    // 3) 연결이 없으면 재연결
+    if (!s.conn && reconnect)
+    {
+        s.conn = connect_one();
+        s.created = Clock::now();
+    }
+
+    s.last_used = Clock::now();
+    return s.conn != nullptr;
+}
+
+DbPool::Lease DbPool::acquire()
+{
+    auto t0 = Clock::now();
+    size_t idx = 0;
+    {
+        std::unique_lock<std::mutex> lk(m_);
+        bool got = cv_.wait_for(lk, opt_.acquire_timeout, [this] {
+            return !idle_.empty() || !running_.load();
+        });
+        if (!got || !running_.load())
+        {
+            timeouts_++;
+            return Lease();
+        }
+
+        // 연결이 살아있는 슬롯 우선 (끊긴 슬롯은 재연결 비용이 있으므로 마지막에)
+        size_t pick = idle_.size() - 1;
+        for (size_t i = idle_.size(); i-- > 0;)
+        {
+            if (slots_[idle_[i]].conn)
+            {
+                pick = i;
+                break;
+            }
+        }
+        idx = idle_[pick];
+        idle_.erase(idle_.begin() + static_cast<std::ptrdiff_t>(pick));
+        slots_[idx].in_use = true;
+    }
+
+    uint64_t waited = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count());
+    acquires_++;
+    wait_us_total_ += waited;
+    uint64_t prev = wait_us_max_.load();
+    while (waited > prev && !wait_us_max_.compare_exchange_weak(prev, waited))
+    {
+    }
+
+    // 대여 중인 슬롯은 이 스레드만 만지므로 락 없이 점검/재연결
+    if (!prepare_slot(slots_[idx], opt_.reconnect_on_acquire))
+    {
+        give_back(idx);
+        return Lease();
+    }
+    return Lease(this, idx);
+}
+
+void DbPool::give_back(size_t slot)
+{
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        Slot &s = slots_[slot];
+        if (s.discard)
+        {
+            close_slot(s);
+            s.discard = false;
+        }
+        s.in_use = false;
+        s.last_used = Clock::now();
+        idle_.push_back(slot);
+    }
+    cv_.notify_one();
+}
+
+void DbPool::maintenance_loop()
+{
+    while (running_.load())
+    {
+        {
+            std::unique_lock<std::mutex> lk(m_);
+            maint_cv_.wait_for(lk, opt_.maintenance_interval, [this] { return !running_.load(); });
+        }
+        if (!running_.load())
+            break;
+
+        // 놀고 있는 슬롯만 하나씩 꺼내서 점검 (대여 중인 슬롯은 건드리지 않음)
+        for (size_t i = 0; i < opt_.size && running_.load(); ++i)
+        {
+            bool taken = false;
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                for (size_t k = 0; k < idle_.size(); ++k)
+                {
+                    if (idle_[k] == i)
+                    {
+                        idle_.erase(idle_.begin() + static_cast<std::ptrdiff_t>(k));
+                        slots_[i].in_use = true;
+                        taken = true;
+                        break;
+                    }
+                }
+            }
+            if (!taken)
+                continue;
+
+            Slot &s = slots_[i];
+            bool was_down = (s.conn == nullptr);
+            s.last_used = Clock::time_point{}; // 강제로 isValid() 점검
+            if (prepare_slot(s, true) && was_down)
+                LOG_INFO("[DbPool] slot " << i << " reconnected");
+            give_back(i);
+        }
+    }
+}
+
+DbPoolStats DbPool::stats() const
+{
+    DbPoolStats st;
+    st.acquires = acquires_.load();
+    st.timeouts = timeouts_.load();
+    st.wait_us_total = wait_us_total_.load();
+    st.wait_us_max = wait_us_max_.load();
+    st.connects = connects_.load();
+    st.connect_fails = connect_fails_.load();
+    st.rotations = rotations_.load();
+
+    std::lock_guard<std::mutex> lk(m_);
+    st.size = slots_.size();
+    st.idle = idle_.size();
+    for (const auto &s : slots_)
+        if (s.in_use || s.conn) // 대여 중인 슬롯은 점검을 통과한 상태
+            st.connected++;
+    return st;
+}
@@ -0,0 +1,147 @@
+// ============================================================================
+// 파일명: db_pool.h
+// 목적: worker 스레드와 분리된 MariaDB 커넥션 풀
+//
+// - 시작 시 커넥션을 병렬로 연결 (start()는 즉시 반환, 연결되는 대로 사용 가능)
+// - 대여(acquire) 시 오래 쉬었던 커넥션은 isValid()로 점검 후 필요하면 재연결
+// - max_lifetime 이 지난 커넥션은 반납/대여 시점에 교체
+// - 백그라운드 점검 스레드가 끊긴 슬롯을 주기적으로 재연결 (DB 순단 후 자동 복구)
+// - 복제본 풀은 read_only + reconnect_on_acquire=false (죽은 복제본에서 대여가 연결 시간만큼 막히지 않게)
+// - 대기 시간 / 재연결 횟수 등은 stats() 로 조회
+// - 슬롯마다 PreparedStatement 캐시 소유 (stmt_cache.h)
+//
+// 사용 예 (worker_loop):
+//   DbPool::Lease db = pool.acquire();
+//   if (!db) { ... VALUE_ERR_DB 응답 ... }
+//   handle_xxx(req, *db);
+// ============================================================================
+#pragma once
+
+#include "stmt_cache.h"
+#include <mariadb/conncpp.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct DbConfig
+{
+    std::string url;  // jdbc:mariadb://host/db
+    std::string user; // 접속 계정
+    std::string pw;   // 접속 비밀번호
+};
+
+struct DbPoolStats
+{
+    uint64_t acquires = 0;       // 총 대여 횟수
+    uint64_t timeouts = 0;       // 대기 시간 초과로 실패한 대여
+    uint64_t wait_us_total = 0;  // 대여 대기 시간 합 (마이크로초)
+    uint64_t wait_us_max = 0;    // 최대 대여 대기 시간
+    uint64_t connects = 0;       // 성공한 (재)연결 수
+    uint64_t connect_fails = 0;  // 실패한 (재)연결 수
+    uint64_t rotations = 0;      // max_lifetime 초과로 교체한 수
+    size_t size = 0;             // 슬롯 수
+    size_t idle = 0;             // 현재 놀고 있는 슬롯
+    size_t connected = 0;        // 현재 연결이 살아있는 슬롯
+};
+
+class DbPool
+{
+public:
+    struct Options
+    {
+        size_t size = 4;                                              // 커넥션 개수
+        std::chrono::milliseconds acquire_timeout{3000};              // 대여 최대 대기
+        std::chrono::seconds max_lifetime{30 * 60};                   // 커넥션 최대 수명
+        std::chrono::seconds validate_after_idle{5};                  // 이만큼 쉬었으면 대여 전 점검
+        std::chrono::seconds maintenance_interval{10};                // 백그라운드 점검 주기
+        bool read_only = false;            // 연결 직후 SET SESSION TRANSACTION READ ONLY (복제본 풀)
+        bool reconnect_on_acquire = true;  // false 면 끊긴 슬롯은 대여 실패 (재연결은 점검 스레드만)
+    };
+
+    // 대여한 커넥션 (소멸 시 자동 반납)
+    class Lease
+    {
+    public:
+        Lease() = default;
+        Lease(Lease &&o) noexcept : pool_(o.pool_), slot_(o.slot_) { o.pool_ = nullptr; }
+        Lease &operator=(Lease &&o) noexcept;
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        ~Lease() { release(); }
+
+        explicit operator bool() const { return pool_ != nullptr; }
+        sql::Connection &operator*() const;
+        sql::Connection *operator->() const { return &**this; }
+
+        // 사용 중 연결 오류가 난 커넥션: 반납 시 닫고 다음 대여 때 재연결
+        void discard();
+        void release();
+
+    private:
+        friend class DbPool;
+        Lease(DbPool *pool, size_t slot); // 현재 스레드에 statement 캐시 바인딩
+        DbPool *pool_ = nullptr;
+        size_t slot_ = 0;
+    };
+
+    DbPool(DbConfig cfg, Options opt);
+    ~DbPool();
+
+    DbPool(const DbPool &) = delete;
+    DbPool &operator=(const DbPool &) = delete;
+
+    // 슬롯별 병렬 연결 시작 + 점검 스레드 시작 (즉시 반환)
+    void start();
+    // 점검 스레드 종료 + 모든 커넥션 닫기 (대여 중인 Lease가 없을 때 호출)
+    void stop();
+
+    // 커넥션 대여. 시간 초과 / 재연결 실패 시 빈 Lease 반환
+    Lease acquire();
+
+    DbPoolStats stats() const;
+
+private:
+    struct Slot
+    {
+        std::unique_ptr<sql::Connection> conn;
+        StatementCache stmts; // 이 커넥션에서 준비된 statement (커넥션보다 먼저 정리)
+        std::chrono::steady_clock::time_point created{};
+        std::chrono::steady_clock::time_point last_used{};
+        bool in_use = false;
+        bool discard = false;
+    };
+
+    std::unique_ptr<sql::Connection> connect_one();
+    static void close_slot(Slot &s); // statement 캐시 정리 후 커넥션 닫기
+    bool prepare_slot(Slot &s, bool reconnect); // 대여 직전 수명/점검/재연결 (락 밖에서 호출)
+    void give_back(size_t slot);
+    void maintenance_loop();
+
+    DbConfig cfg_;
+    Options opt_;
+
+    mutable std::mutex m_;
+    std::condition_variable cv_;
+    std::vector<Slot> slots_;
+    std::vector<size_t> idle_; // 대여 가능한 슬롯 번호 (LIFO: 최근 쓴 커넥션 우선)
+
+    std::atomic<bool> running_{false};
+    std::vector<std::thread> starters_;
+    std::thread maint_;
+    std::condition_variable maint_cv_;
+
+    // 통계
+    std::atomic<uint64_t> acquires_{0};
+    std::atomic<uint64_t> timeouts_{0};
+    std::atomic<uint64_t> wait_us_total_{0};
+    std::atomic<uint64_t> wait_us_max_{0};
+    std::atomic<uint64_t> connects_{0};
+    std::atomic<uint64_t> connect_fails_{0};
+    std::atomic<uint64_t> rotations_{0};
+};
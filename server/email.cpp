@@ -1,21 +1,40 @@
 // email.cpp
 #include "email.h"
+#include "email_outbox.h"
+#include "logger.h"
 #include <iostream>
-#include <queue>
+#include <deque>
+#include <map>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <curl/curl.h>
 
 // ==========================================
-// [설정] 구글 앱 비밀번호 입력 필수
+// [설정] 구글 앱 비밀번호 입력 필수 (환경변수로 덮어쓸 수 있음, email.h 참고)
 // ==========================================
 static const std::string SMTP_URL = "smtps://smtp.gmail.com:465";
 static const std::string SMTP_USER = "sleimneer@gmail.com";
 static const std::string SMTP_PASS = "lqcq tdyh dsug ahfo";
 
+static constexpr size_t EMAIL_WORKERS = 4;         // 발송 스레드 수 (기본)
+static constexpr size_t EMAIL_QUEUE_MAX = 1024;    // 대기 최대 개수 (재시도 대기 포함)
+static constexpr int EMAIL_MAX_ATTEMPTS = 5;       // 메일 1통당 최대 시도 횟수
+static constexpr int EMAIL_BACKOFF_BASE_MS = 500;  // 첫 재시도 대기 (이후 2배씩)
+static constexpr int EMAIL_BACKOFF_MAX_MS = 30000; // 재시도 대기 상한
+static constexpr long SMTP_CONN_MAX_AGE = 60;      // 이보다 오래 쉰 연결은 재사용하지 않음(초)
+static constexpr long SMTP_TIMEOUT = 30;           // 메일 1통 발송 제한 시간(초)
+static const std::string EMAIL_OUTBOX_PATH = "./email_outbox.log"; // 발송 대기 메일 기록 (LOUD_EMAIL_OUTBOX)
+static constexpr std::chrono::seconds EMAIL_REPLAY_MAX_AGE{600};  // 재시작 후 이보다 오래된 메일은 버림
+
+using Clock = std::chrono::steady_clock;
+
 // ==========================================
 // [내부 전용] 구조체 및 변수 (외부 노출 X)
 // ==========================================
@@ -24,13 +43,36 @@ struct EmailTask
     std::string to;
     std::string subject;
     std::string body;
+    Clock::time_point enqueued; // 지연 시간 측정용
+    int attempts = 0;           // 지금까지 시도 횟수
+    uint64_t outbox_id = 0;     // outbox 기록 번호 (0 = 기록 안 됨)
+};
+
+struct SmtpConfig
+{
+    std::string url = SMTP_URL;
+    std::string user = SMTP_USER;
+    std::string pass = SMTP_PASS;
+    std::string outbox = EMAIL_OUTBOX_PATH;
+    size_t workers = EMAIL_WORKERS;
 };
 
-static std::queue<EmailTask> g_queue;
+static SmtpConfig g_cfg;
+static std::deque<EmailTask> g_queue;                       // 새 요청
+static std::multimap<Clock::time_point, EmailTask> g_retry; // 재시도 대기 (시각 순)
 static std::mutex g_mutex;
 static std::condition_variable g_cv;
-static std::atomic<bool> g_running(false);
-static std::thread g_worker;
+static bool g_running = false;  // 새 요청 받는 중 (g_mutex)
+static bool g_draining = false; // 종료 중: 재시도 대기 없이 바로 처리 (g_mutex)
+static std::vector<std::thread> g_workers;
+
+static std::atomic<uint64_t> g_sent{0};
+static std::atomic<uint64_t> g_failed{0};
+static std::atomic<uint64_t> g_retries{0};
+static std::atomic<uint64_t> g_rejected{0};
+static std::atomic<uint64_t> g_connects{0};
+static std::atomic<uint64_t> g_latency_ms{0};
+static std::atomic<uint64_t> g_latency_ms_max{0};
 
 // ==========================================
 // [내부 전용] libcurl 헬퍼 함수들
@@ -59,91 +101,274 @@ static size_t payload_source(void *ptr, size_t size, size_t nmemb, void *userp)
     return 0;
 }
 
-static void send_email_real(const std::string &to, const std::string &subject, const std::string &body)
+// 보내는 주소 (AUTH 를 생략하는 로컬 SMTP 대역이면 임의 주소)
+static std::string mail_from()
+{
+    return g_cfg.user.empty() ? std::string("noreply@localhost") : g_cfg.user;
+}
+
+// 발송 스레드 하나가 계속 쓰는 curl 핸들 (연결 캐시가 핸들에 붙어 있음)
+static CURL *smtp_handle_open()
+{
+    CURL *curl = curl_easy_init();
+    if (!curl)
+        return nullptr;
+    curl_easy_setopt(curl, CURLOPT_URL, g_cfg.url.c_str());
+    if (!g_cfg.user.empty())
+    {
+        curl_easy_setopt(curl, CURLOPT_USERNAME, g_cfg.user.c_str());
+        curl_easy_setopt(curl, CURLOPT_PASSWORD, g_cfg.pass.c_str());
+    }
+    // smtps:// 는 TLS 필수, smtp:// 는 STARTTLS 가능할 때만 (로컬 SMTP 대역)
+    bool implicit_tls = g_cfg.url.compare(0, 8, "smtps://") == 0;
+    curl_easy_setopt(curl, CURLOPT_USE_SSL, implicit_tls ? CURLUSESSL_ALL : CURLUSESSL_TRY);
+    static const std::string from = mail_from(); // email_init 이후에만 불림 (설정 고정)
+    curl_easy_setopt(curl, CURLOPT_MAIL_FROM, from.c_str());
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, payload_source);
+    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L); // 여러 스레드에서 사용
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, SMTP_TIMEOUT);
+#if LIBCURL_VERSION_NUM >= 0x074100 // 7.65.0
+    curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, SMTP_CONN_MAX_AGE);
+#endif
+    return curl;
+}
+
+enum class SendResult
+{
+    OK,
+    RETRY, // 네트워크 / 4xx 등 일시적 실패
+    GIVE_UP // 5xx / 인증 실패 / 설정 오류
+};
+
+static SendResult send_email_real(CURL *curl, const EmailTask &task)
 {
-    CURL *curl;
-    CURLcode res = CURLE_OK;
     struct curl_slist *recipients = NULL;
 
     std::string payload_text =
-        "To: " + to + "\r\n"
-                      "From: " +
-        SMTP_USER + "\r\n"
-                    "Subject: " +
-        subject + "\r\n"
-                  "\r\n" +
-        body + "\r\n";
+        "To: " + task.to + "\r\n"
+                           "From: " +
+        mail_from() + "\r\n"
+                     "Subject: " +
+        task.subject + "\r\n"
+                       "\r\n" +
+        task.body + "\r\n";
 
     UploadStatus upload_ctx = {payload_text.c_str(), payload_text.size(), 0};
 
-    curl = curl_easy_init();
-    if (curl)
+    recipients = curl_slist_append(recipients, task.to.c_str());
+    curl_easy_setopt(curl, CURLOPT_MAIL_RCPT, recipients);
+    curl_easy_setopt(curl, CURLOPT_READDATA, &upload_ctx);
+
+    CURLcode res = curl_easy_perform(curl);
+
+    long new_conns = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_conns);
+    g_connects += static_cast<uint64_t>(new_conns);
+    long smtp_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &smtp_code);
+
+    curl_easy_setopt(curl, CURLOPT_MAIL_RCPT, NULL);
+    curl_slist_free_all(recipients);
+
+    if (res == CURLE_OK)
+        return SendResult::OK;
+
+    LOG_ERROR("[Email Fail] " << task.to << " (" << task.attempts << "/" << EMAIL_MAX_ATTEMPTS << ") "
+              << curl_easy_strerror(res) << " smtp=" << smtp_code);
+    if ((smtp_code >= 500 && smtp_code < 600) || res == CURLE_LOGIN_DENIED || res == CURLE_URL_MALFORMAT ||
+        res == CURLE_UNSUPPORTED_PROTOCOL)
+        return SendResult::GIVE_UP;
+    return SendResult::RETRY;
+}
+
+static int backoff_ms(int attempts)
+{
+    int ms = EMAIL_BACKOFF_BASE_MS << std::min(attempts - 1, 16);
+    return std::min(ms, EMAIL_BACKOFF_MAX_MS);
+}
+
+static void record_sent(const EmailTask &task)
+{
+    uint64_t ms = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - task.enqueued).count());
+    g_sent++;
+    g_latency_ms += ms;
+    uint64_t prev = g_latency_ms_max.load();
+    while (ms > prev && !g_latency_ms_max.compare_exchange_weak(prev, ms))
     {
-        curl_easy_setopt(curl, CURLOPT_USERNAME, SMTP_USER.c_str());
-        curl_easy_setopt(curl, CURLOPT_PASSWORD, SMTP_PASS.c_str());
-        curl_easy_setopt(curl, CURLOPT_URL, SMTP_URL.c_str());
-        curl_easy_setopt(curl, CURLOPT_USE_SSL, CURLUSESSL_ALL);
-        curl_easy_setopt(curl, CURLOPT_MAIL_FROM, SMTP_USER.c_str());
-        recipients = curl_slist_append(recipients, to.c_str());
-        curl_easy_setopt(curl, CURLOPT_MAIL_RCPT, recipients);
-        curl_easy_setopt(curl, CURLOPT_READFUNCTION, payload_source);
-        curl_easy_setopt(curl, CURLOPT_READDATA, &upload_ctx);
-        curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
-
-        res = curl_easy_perform(curl);
-
-        if (res != CURLE_OK)
-            std::cerr << "[Email Fail] " << curl_easy_strerror(res) << std::endl;
-        else
-            std::cout << "[Email Success] Sent to " << to << std::endl;
+    }
+    LOG_INFO("[Email Success] Sent to " << task.to << " (" << ms << "ms)");
+}
 
-        curl_slist_free_all(recipients);
-        curl_easy_cleanup(curl);
+// 다음 작업 꺼내기: 기한이 된 재시도 → 새 요청 순. 정지 + 남은 작업 없음이면 false
+static bool next_task(EmailTask &task)
+{
+    std::unique_lock<std::mutex> lock(g_mutex);
+    while (true)
+    {
+        if (!g_retry.empty() && (g_draining || g_retry.begin()->first <= Clock::now()))
+        {
+            task = std::move(g_retry.begin()->second);
+            g_retry.erase(g_retry.begin());
+            return true;
+        }
+        if (!g_queue.empty())
+        {
+            task = std::move(g_queue.front());
+            g_queue.pop_front();
+            return true;
+        }
+        if (!g_running && g_retry.empty())
+            return false;
+        if (g_retry.empty())
+            g_cv.wait(lock);
+        else
+        {
+            Clock::time_point due = g_retry.begin()->first; // 기다리는 동안 다른 worker 가 항목을 꺼낼 수 있으므로 복사
+            g_cv.wait_until(lock, due);
+        }
     }
 }
 
 static void worker_loop()
 {
-    while (g_running)
+    CURL *curl = smtp_handle_open();
+    EmailTask task;
+    while (next_task(task))
     {
-        EmailTask task;
+        if (!curl)
+            curl = smtp_handle_open();
+        task.attempts++;
+        SendResult r = curl ? send_email_real(curl, task) : SendResult::RETRY;
+        if (r == SendResult::OK)
+        {
+            record_sent(task);
+            outbox_sent(task.outbox_id);
+            continue;
+        }
+
+        // 실패한 연결은 버리고 다음 메일은 새 연결로
+        if (curl)
+            curl_easy_cleanup(curl);
+        curl = nullptr;
+
+        if (r == SendResult::GIVE_UP || task.attempts >= EMAIL_MAX_ATTEMPTS)
         {
-            std::unique_lock<std::mutex> lock(g_mutex);
-            g_cv.wait(lock, []
-                      { return !g_queue.empty() || !g_running; });
-            if (!g_running && g_queue.empty())
-                break;
-            task = g_queue.front();
-            g_queue.pop();
+            g_failed++;
+            outbox_sent(task.outbox_id); // 다시 띄워도 보내지 않음
+            LOG_ERROR("[Email Fail] give up " << task.to);
+            continue;
         }
-        send_email_real(task.to, task.subject, task.body);
+        g_retries++;
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            g_retry.emplace(Clock::now() + std::chrono::milliseconds(backoff_ms(task.attempts)), std::move(task));
+        }
+        g_cv.notify_one();
     }
+    if (curl)
+        curl_easy_cleanup(curl);
+}
+
+static void env_override(const char *name, std::string &dst)
+{
+    const char *v = std::getenv(name);
+    if (v)
+        dst = v; // 빈 값도 허용 (LOUD_SMTP_USER= → AUTH 생략)
 }
 
 // ==========================================
 // [외부 공개] email.h 구현
 // ==========================================
-void email_init()
+void email_init(const std::function<void(const std::string &meta, uint64_t outbox_id)> &on_replay)
 {
+    std::lock_guard<std::mutex> lock(g_mutex);
     if (g_running)
         return;
+    curl_global_init(CURL_GLOBAL_DEFAULT); // 스레드 만들기 전에 한 번
+    env_override("LOUD_SMTP_URL", g_cfg.url);
+    env_override("LOUD_SMTP_USER", g_cfg.user);
+    env_override("LOUD_SMTP_PASSWORD", g_cfg.pass);
+    env_override("LOUD_EMAIL_OUTBOX", g_cfg.outbox);
+    if (const char *v = std::getenv("LOUD_SMTP_WORKERS"))
+        g_cfg.workers = std::max<size_t>(1, std::strtoul(v, nullptr, 10));
+    // 지난 실행에서 못 보낸 메일을 먼저 큐에 (outbox 를 못 열면 메모리 큐만으로 동작)
+    std::vector<OutboxEntry> pending;
+    if (!g_cfg.outbox.empty() && outbox_open(g_cfg.outbox, EMAIL_REPLAY_MAX_AGE, pending))
+    {
+        for (auto &e : pending)
+        {
+            if (!e.meta.empty() && on_replay)
+                on_replay(e.meta, e.id); // 메일에 딸린 상태 (가입 대기 정보 등) 복원
+            if (!e.sent)
+                g_queue.push_back(
+                    EmailTask{std::move(e.to), std::move(e.subject), std::move(e.body), Clock::now(), 0, e.id});
+        }
+        LOG_INFO("[Email] outbox=" << g_cfg.outbox << " replay=" << pending.size());
+    }
+
     g_running = true;
-    g_worker = std::thread(worker_loop);
-    g_worker.detach(); // 백그라운드에서 실행
+    g_draining = false;
+    for (size_t i = 0; i < g_cfg.workers; ++i)
+        g_workers.emplace_back(worker_loop);
+    LOG_INFO("[Email] workers=" << g_cfg.workers << " url=" << g_cfg.url);
 }
 
-void email_send(const std::string &to, const std::string &subject, const std::string &body)
+bool email_send(const std::string &to, const std::string &subject, const std::string &body,
+                const std::string &meta, uint64_t *outbox_id)
 {
     {
         std::lock_guard<std::mutex> lock(g_mutex);
-        g_queue.push({to, subject, body});
+        if (!g_running || g_queue.size() + g_retry.size() >= EMAIL_QUEUE_MAX)
+        {
+            g_rejected++;
+            return false;
+        }
+        // outbox 는 메모리 버퍼에 붙이기만 함 (fdatasync 는 outbox flush 스레드가 모아서)
+        uint64_t id = outbox_append(to, subject, body, meta);
+        g_queue.push_back(EmailTask{to, subject, body, Clock::now(), 0, id});
+        if (outbox_id)
+            *outbox_id = id;
     }
     g_cv.notify_one();
+    return true;
+}
+
+void email_forget(uint64_t outbox_id)
+{
+    outbox_done(outbox_id);
 }
 
 void email_shutdown()
 {
-    g_running = false;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_running)
+            return;
+        g_running = false;
+        g_draining = true; // 남은 재시도는 기다리지 않고 바로 (시도 횟수 제한은 그대로)
+    }
     g_cv.notify_all();
-    // detach 했으므로 join 불필요, 혹은 joinable 확인 후 join
-}
\ No newline at end of file
+    for (auto &t : g_workers)
+        t.join();
+    g_workers.clear();
+    outbox_close(); // DONE 기록까지 디스크에
+    curl_global_cleanup();
+}
+
+EmailStats email_stats()
+{
+    EmailStats st;
+    st.sent = g_sent.load();
+    st.failed = g_failed.load();
+    st.retries = g_retries.load();
+    st.rejected = g_rejected.load();
+    st.connects = g_connects.load();
+    st.latency_ms = g_latency_ms.load();
+    st.latency_ms_max = g_latency_ms_max.load();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    st.queued = g_queue.size() + g_retry.size();
+    return st;
+}
@@ -1,18 +1,60 @@
 // email.h
+// 인증번호 메일 발송 (SMTP 발송 스레드 풀)
+//
+// - 발송 스레드 N개가 각자 curl 핸들 하나를 계속 재사용
+//   → 같은 SMTP 서버로의 연결(TLS 포함)을 메일마다 새로 맺지 않음
+// - 큐는 크기 제한, 가득 차면 email_send() 가 false (가입 요청에 재시도 안내)
+// - 일시적 실패는 지수 백오프로 재시도, 5xx 응답 / 인증 실패는 바로 포기
+// - email_shutdown() 은 새 요청을 막고 큐(재시도 대기 포함)를 비운 뒤 스레드 join
+// - 큐에 넣은 메일은 outbox 파일(email_outbox.h)에도 기록 → 재시작하면 못 보낸 메일부터 발송
+//   경로: LOUD_EMAIL_OUTBOX (기본 ./email_outbox.log, 빈 값이면 기록 안 함)
+//   meta 를 같이 남기면 재시작 때 email_init(on_replay) 로 돌려줌 (email_forget 전까지)
+// - 접속 정보는 환경변수로 바꿀 수 있음 (로컬 SMTP 대역으로 시험할 때)
+//     LOUD_SMTP_URL      smtps://smtp.gmail.com:465 (기본) / smtp://127.0.0.1:2525 등
+//     LOUD_SMTP_USER     비우면 SMTP AUTH 생략
+//     LOUD_SMTP_PASSWORD
+//     LOUD_SMTP_WORKERS  발송 스레드 수
+//   smtps:// 는 TLS 필수, smtp:// 는 서버가 STARTTLS 를 지원할 때만 TLS
+//   예) python3 -m aiosmtpd -n -l 127.0.0.1:2525 &
+//       LOUD_SMTP_URL=smtp://127.0.0.1:2525 LOUD_SMTP_USER= ./server_app
 #ifndef EMAIL_H
 #define EMAIL_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 
+struct EmailStats
+{
+    uint64_t sent = 0;        // 발송 성공
+    uint64_t failed = 0;      // 재시도 끝에 / 영구 오류로 포기
+    uint64_t retries = 0;     // 재시도 예약 횟수
+    uint64_t rejected = 0;    // 큐가 가득 차서 받지 않은 요청
+    uint64_t connects = 0;    // 새로 맺은 SMTP 연결 수 (나머지는 재사용)
+    uint64_t latency_ms = 0;  // 요청 → 발송 완료 시간 합 (ms, 성공분만)
+    uint64_t latency_ms_max = 0;
+    size_t queued = 0;        // 현재 대기 중 (재시도 대기 포함)
+};
+
 // 외부에서 호출할 함수들만 선언 (인터페이스)
 
-// 1. 이메일 시스템 초기화 (스레드 시작)
-void email_init();
+// 1. 이메일 시스템 초기화 (발송 스레드 시작)
+//    on_replay: outbox 에 meta 와 함께 남아 있던 메일마다 호출 (발송 스레드 시작 전)
+void email_init(const std::function<void(const std::string &meta, uint64_t outbox_id)> &on_replay = nullptr);
 
 // 2. 이메일 전송 요청 (큐에 넣기만 하고 바로 리턴 - 비동기)
-void email_send(const std::string &to, const std::string &subject, const std::string &body);
+//    큐가 가득 찼거나 종료 중이면 false
+//    meta 는 outbox 에 메일과 함께 남김 (email_forget 전까지), outbox_id 에 기록 번호 (0 = 기록 안 됨)
+bool email_send(const std::string &to, const std::string &subject, const std::string &body,
+                const std::string &meta = "", uint64_t *outbox_id = nullptr);
+
+// meta 가 더 필요 없음 → outbox 기록 삭제 (아직 안 보냈으면 재시작 후에도 보내지 않음). 0 은 무시
+void email_forget(uint64_t outbox_id);
 
-// 3. 시스템 종료 시 정리 (선택 사항)
+// 3. 시스템 종료 시 정리 (남은 메일 발송 후 스레드 join)
 void email_shutdown();
 
-#endif
\ No newline at end of file
+EmailStats email_stats();
+
+#endif
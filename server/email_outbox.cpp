@@ -0,0 +1,400 @@
+// ============================================================================
+// 파일명: email_outbox.cpp
+// 목적: 메일 outbox 파일 구현 (email_outbox.h 설명 참고)
+// ============================================================================
+#include "email_outbox.h"
+#include "logger.h"
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+static constexpr int OUTBOX_FLUSH_DELAY_MS = 2;         // 첫 기록 후 더 모으는 시간 (fdatasync 한 번에 묶음)
+static constexpr uint64_t OUTBOX_COMPACT_MIN_DEAD = 1024; // 이만큼 끝난 기록이 쌓이고
+static constexpr uint64_t OUTBOX_COMPACT_RATIO = 4;       // 남은 메일의 이 배수를 넘으면 압축
+static constexpr int OUTBOX_RETRY_DELAY_MS = 100;         // 기록 실패 후 다시 쓰기까지 대기
+
+namespace
+{
+std::mutex g_m;
+std::condition_variable g_cv;
+bool g_open = false;
+std::string g_path;
+int g_fd = -1;                            // flush 스레드만 씀 (open / close 때는 스레드 없음)
+std::string g_buf;                        // 아직 파일에 쓰지 않은 기록
+std::map<uint64_t, OutboxEntry> g_live;   // DONE 이 없는 메일 (압축 때 이것만 새 파일에)
+uint64_t g_next_id = 1;
+uint64_t g_dead = 0;                      // 마지막 압축 이후 쓸모없어진 기록 수 (끝난 ADD + DONE + SENT)
+bool g_force_compact = false;             // 파일 끝을 되돌리지 못함 → 다음 기록은 압축(새 파일)으로
+std::thread g_flusher;
+
+std::atomic<uint64_t> g_appends{0};
+std::atomic<uint64_t> g_dones{0};
+std::atomic<uint64_t> g_syncs{0};
+std::atomic<uint64_t> g_compactions{0};
+std::atomic<uint64_t> g_write_errors{0};
+std::atomic<uint64_t> g_file_bytes{0};
+
+void encode_sent(std::string &out, uint64_t id)
+{
+    out += "S " + std::to_string(id) + "\n";
+}
+
+void encode_add(std::string &out, const OutboxEntry &e)
+{
+    char head[160];
+    std::snprintf(head, sizeof(head), "A %llu %lld %zu %zu %zu %zu\n", static_cast<unsigned long long>(e.id),
+                  static_cast<long long>(e.created), e.to.size(), e.subject.size(), e.body.size(), e.meta.size());
+    out += head;
+    out += e.to;
+    out += e.subject;
+    out += e.body;
+    out += e.meta;
+    out += '\n';
+    if (e.sent)
+        encode_sent(out, e.id); // 압축한 파일에도 발송 끝 표시 유지
+}
+
+void encode_done(std::string &out, uint64_t id)
+{
+    out += "D " + std::to_string(id) + "\n";
+}
+
+bool write_all(int fd, const std::string &data)
+{
+    size_t off = 0;
+    while (off < data.size())
+    {
+        ssize_t n = ::write(fd, data.data() + off, data.size() - off);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_all(const std::string &path, std::string &out)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno == ENOENT; // 처음 띄우는 서버면 파일 없음
+    char buf[65536];
+    while (true)
+    {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            ::close(fd);
+            return n == 0;
+        }
+        out.append(buf, static_cast<size_t>(n));
+    }
+}
+
+// 파일 내용 → 남은 메일. 잘린 / 깨진 기록을 만나면 거기서 멈춤
+void parse_records(const std::string &data, std::map<uint64_t, OutboxEntry> &live, uint64_t &max_id)
+{
+    size_t pos = 0;
+    while (pos < data.size())
+    {
+        size_t nl = data.find('\n', pos);
+        if (nl == std::string::npos)
+            break;
+        std::string head = data.substr(pos, nl - pos);
+        if (head.size() > 2 && head[0] == 'D' && head[1] == ' ')
+        {
+            uint64_t id = std::strtoull(head.c_str() + 2, nullptr, 10);
+            live.erase(id);
+            pos = nl + 1;
+            continue;
+        }
+        if (head.size() > 2 && head[0] == 'S' && head[1] == ' ')
+        {
+            auto it = live.find(std::strtoull(head.c_str() + 2, nullptr, 10));
+            if (it != live.end())
+                it->second.sent = true;
+            pos = nl + 1;
+            continue;
+        }
+        unsigned long long id = 0;
+        long long created = 0;
+        size_t lt = 0, ls = 0, lb = 0, lm = 0;
+        int fields = std::sscanf(head.c_str(), "A %llu %lld %zu %zu %zu %zu", &id, &created, &lt, &ls, &lb, &lm);
+        if (fields != 5 && fields != 6) // 5 개는 meta 가 없던 예전 기록
+            break;
+        size_t body_at = nl + 1;
+        size_t end = body_at + lt + ls + lb + lm;
+        if (end + 1 > data.size() || data[end] != '\n')
+            break; // 쓰는 도중 종료된 마지막 기록
+        OutboxEntry e;
+        e.id = id;
+        e.created = created;
+        e.to = data.substr(body_at, lt);
+        e.subject = data.substr(body_at + lt, ls);
+        e.body = data.substr(body_at + lt + ls, lb);
+        e.meta = data.substr(body_at + lt + ls + lb, lm);
+        live[e.id] = std::move(e);
+        if (id > max_id)
+            max_id = id;
+        pos = end + 1;
+    }
+}
+
+// 남은 메일만 담은 새 파일로 교체 (tmp 에 쓰고 fdatasync → rename → 디렉터리 fsync)
+// 성공하면 새 파일 fd (O_APPEND), 실패하면 -1
+int rewrite_file(const std::string &path, const std::string &contents)
+{
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return -1;
+    if (!write_all(fd, contents) || ::fdatasync(fd) != 0 || ::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        return -1;
+    }
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash == 0 ? 1 : slash);
+    int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0)
+    {
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+    g_file_bytes = contents.size();
+    return fd;
+}
+
+void flusher_loop()
+{
+    while (true)
+    {
+        std::string out;
+        std::string snapshot;
+        bool compact = false;
+        bool forced = false; // 파일 끝이 깨졌을 수 있어 이어 쓰면 안 됨
+        {
+            std::unique_lock<std::mutex> lk(g_m);
+            g_cv.wait(lk, [] { return !g_buf.empty() || !g_open; });
+            if (g_buf.empty())
+                return; // 닫힘 + 남은 기록 없음
+            if (g_open)
+            {
+                // 조금 더 모아서 fdatasync 한 번으로
+                lk.unlock();
+                std::this_thread::sleep_for(std::chrono::milliseconds(OUTBOX_FLUSH_DELAY_MS));
+                lk.lock();
+            }
+            out.swap(g_buf);
+            forced = g_force_compact;
+            compact = forced || (g_dead >= OUTBOX_COMPACT_MIN_DEAD && g_dead > g_live.size() * OUTBOX_COMPACT_RATIO);
+            if (compact)
+            {
+                // g_live 는 버퍼의 기록까지 반영된 상태 → 새 파일이 버퍼 내용을 대신함
+                for (const auto &kv : g_live)
+                    encode_add(snapshot, kv.second);
+                g_dead = 0;
+            }
+        }
+
+        if (compact)
+        {
+            int fd = rewrite_file(g_path, snapshot);
+            if (fd >= 0)
+            {
+                ::close(g_fd);
+                g_fd = fd;
+                g_compactions++;
+                g_syncs++;
+                std::lock_guard<std::mutex> lk(g_m);
+                g_force_compact = false;
+                continue;
+            }
+            LOG_ERROR("[Outbox] 압축 실패: " << std::strerror(errno) << " (기존 파일에 이어 씀)");
+        }
+
+        if (forced || !write_all(g_fd, out) || ::fdatasync(g_fd) != 0)
+        {
+            // 반쯤 쓴 기록이 남으면 다시 읽을 때 그 뒤가 모두 버려짐
+            // → 마지막으로 성공한 크기로 파일을 되돌리고 같은 기록을 버퍼 앞에 다시 넣어 재시도
+            //   되돌리지 못하면 다음 번에 g_live 로 새 파일을 만듦 (압축, 버퍼 내용도 포함됨)
+            g_write_errors++;
+            LOG_ERROR("[Outbox] 기록 실패: " << std::strerror(errno) << " (다시 시도)");
+            bool truncated = !forced && ::ftruncate(g_fd, static_cast<off_t>(g_file_bytes.load())) == 0;
+            {
+                std::lock_guard<std::mutex> lk(g_m);
+                if (!g_open)
+                {
+                    LOG_ERROR("[Outbox] 종료 중이라 기록 " << out.size() << " bytes 포기");
+                    continue;
+                }
+                g_buf.insert(0, out);
+                if (!truncated)
+                    g_force_compact = true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(OUTBOX_RETRY_DELAY_MS));
+            continue;
+        }
+        g_file_bytes += out.size();
+        g_syncs++;
+    }
+}
+} // namespace
+
+bool outbox_open(const std::string &path, std::chrono::seconds replay_max_age, std::vector<OutboxEntry> &pending)
+{
+    std::lock_guard<std::mutex> lk(g_m);
+    if (g_open)
+        return true;
+
+    std::string data;
+    if (!read_all(path, data))
+    {
+        LOG_ERROR("[Outbox] 읽기 실패: " << path << " " << std::strerror(errno));
+        return false;
+    }
+    std::map<uint64_t, OutboxEntry> live;
+    uint64_t max_id = 0;
+    parse_records(data, live, max_id);
+
+    // 너무 오래된 메일은 버림 (인증번호라면 이미 만료)
+    int64_t cutoff = static_cast<int64_t>(time(NULL)) - replay_max_age.count();
+    for (auto it = live.begin(); it != live.end();)
+        it = (it->second.created < cutoff) ? live.erase(it) : std::next(it);
+
+    // 시작할 때 한 번 압축 (잘린 꼬리 / 끝난 기록 정리)
+    std::string contents;
+    for (const auto &kv : live)
+        encode_add(contents, kv.second);
+    int fd = rewrite_file(path, contents);
+    if (fd < 0)
+    {
+        LOG_ERROR("[Outbox] 파일 준비 실패: " << path << " " << std::strerror(errno));
+        return false;
+    }
+
+    pending.clear();
+    for (const auto &kv : live)
+        pending.push_back(kv.second);
+    g_live = std::move(live);
+    g_path = path;
+    g_fd = fd;
+    g_next_id = max_id + 1;
+    g_dead = 0;
+    g_buf.clear();
+    g_open = true;
+    g_flusher = std::thread(flusher_loop);
+    return true;
+}
+
+uint64_t outbox_append(const std::string &to, const std::string &subject, const std::string &body,
+                       const std::string &meta)
+{
+    OutboxEntry e;
+    e.created = static_cast<int64_t>(time(NULL));
+    e.to = to;
+    e.subject = subject;
+    e.body = body;
+    e.meta = meta;
+    uint64_t id = 0;
+    {
+        std::lock_guard<std::mutex> lk(g_m);
+        if (!g_open)
+            return 0;
+        id = e.id = g_next_id++;
+        encode_add(g_buf, e);
+        g_live.emplace(id, std::move(e));
+    }
+    g_appends++;
+    g_cv.notify_one();
+    return id;
+}
+
+void outbox_sent(uint64_t id)
+{
+    if (id == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lk(g_m);
+        if (!g_open)
+            return;
+        auto it = g_live.find(id);
+        if (it == g_live.end() || it->second.sent)
+            return;
+        if (!it->second.meta.empty())
+        {
+            // meta 는 outbox_done 까지 남김 (발송만 끝났다고 표시)
+            it->second.sent = true;
+            encode_sent(g_buf, id);
+            g_dead += 1;
+        }
+        else
+        {
+            g_live.erase(it);
+            encode_done(g_buf, id);
+            g_dead += 2; // 끝난 ADD + 이 DONE
+        }
+    }
+    g_dones++;
+    g_cv.notify_one();
+}
+
+void outbox_done(uint64_t id)
+{
+    if (id == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lk(g_m);
+        if (!g_open || g_live.erase(id) == 0)
+            return;
+        encode_done(g_buf, id);
+        g_dead += 2; // 끝난 ADD + 이 DONE
+    }
+    g_dones++;
+    g_cv.notify_one();
+}
+
+void outbox_close()
+{
+    {
+        std::lock_guard<std::mutex> lk(g_m);
+        if (!g_open)
+            return;
+        g_open = false;
+    }
+    g_cv.notify_all();
+    if (g_flusher.joinable())
+        g_flusher.join();
+    ::close(g_fd);
+    g_fd = -1;
+}
+
+OutboxStats outbox_stats()
+{
+    OutboxStats st;
+    st.appends = g_appends.load();
+    st.dones = g_dones.load();
+    st.syncs = g_syncs.load();
+    st.compactions = g_compactions.load();
+    st.write_errors = g_write_errors.load();
+    st.file_bytes = g_file_bytes.load();
+    std::lock_guard<std::mutex> lk(g_m);
+    st.live = g_live.size();
+    return st;
+}
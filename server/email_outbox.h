@@ -0,0 +1,80 @@
+// ============================================================================
+// 파일명: email_outbox.h
+// 목적: 발송 대기 메일을 디스크에 남기는 추가 전용(append-only) outbox
+//
+// - email_send() 가 큐에 넣을 때 ADD 기록, 발송 성공 / 포기 때 DONE 기록
+//   → 서버가 죽었다 다시 떠도 DONE / SENT 가 없는 메일은 email_init() 에서 다시 큐에
+// - meta 가 있는 메일 (가입 대기 정보 등) 은 발송이 끝나도 SENT 만 기록하고 남겨 둠
+//   → 재시작 때 meta 로 메모리 상태를 되살림, 호출자가 outbox_done() 하면 DONE
+//   meta 에 비밀번호 해시 / 인증번호가 들어가므로 파일은 0600 으로 만듦
+// - 기록은 메모리 버퍼에 붙이기만 하고 바로 리턴 (worker 는 디스크를 기다리지 않음)
+//   전용 flush 스레드가 모아서 write + fdatasync 한 번 (group commit)
+// - 아직 남은 메일만 새 파일에 쓰고 rename 하는 압축도 flush 스레드가 함
+//   (DONE 이 쌓이면, 파일에 쓰는 스레드가 하나뿐이라 추가 기록과 겹치지 않음)
+// - 파일 끝이 잘린 기록(쓰는 도중 종료)은 읽을 때 버리고 그 앞에서부터 이어 씀
+// - write / fdatasync 가 실패하면 마지막으로 성공한 크기로 되돌리고 같은 기록을 다시 씀
+//   (되돌리지 못하면 남은 메일로 새 파일을 만듦) → 깨진 기록 뒤의 기록을 잃지 않음
+// - 너무 오래된 메일은 다시 보내지 않음 (replay_max_age)
+//
+// 기록 형식 (한 줄 머리 + 본문 바이트):
+//   A <id> <unix 시각> <to 길이> <subject 길이> <body 길이> <meta 길이>\n<to><subject><body><meta>\n
+//   S <id>\n   (발송 끝, meta 는 남김)
+//   D <id>\n
+//   (meta 길이가 없는 예전 A 기록도 읽음)
+//
+// 사용 예 (email.cpp):
+//   std::vector<OutboxEntry> pending;
+//   outbox_open(path, std::chrono::minutes(10), pending);   // 다시 보낼 메일
+//   uint64_t id = outbox_append(to, subject, body, meta);
+//   ... 발송 ...
+//   outbox_sent(id);   // meta 가 없으면 여기서 끝
+//   outbox_done(id);   // meta 가 더 필요 없을 때 (예: 가입 인증 완료 / 만료)
+// ============================================================================
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct OutboxEntry
+{
+    uint64_t id = 0;
+    int64_t created = 0; // unix 시각 (초)
+    std::string to;
+    std::string subject;
+    std::string body;
+    std::string meta;  // 호출자 정보 (없으면 빈 문자열)
+    bool sent = false; // 발송은 끝났고 meta 때문에 남아 있음 (다시 보내지 않음)
+};
+
+struct OutboxStats
+{
+    uint64_t appends = 0;     // ADD 기록 수
+    uint64_t dones = 0;       // DONE / SENT 기록 수
+    uint64_t syncs = 0;       // fdatasync 횟수 (appends + dones 보다 훨씬 적어야 함)
+    uint64_t compactions = 0; // 파일 압축 횟수
+    uint64_t write_errors = 0;
+    size_t live = 0;          // DONE 이 없는 메일 수
+    uint64_t file_bytes = 0;  // 현재 파일 크기
+};
+
+// 파일 열기 + 남은 메일 읽기 + flush 스레드 시작 (실패하면 false, outbox 없이 동작)
+// replay_max_age 보다 오래된 메일은 pending 에 넣지 않고 버림 (시작할 때 파일도 한 번 압축)
+// pending 에는 SENT 인 항목도 들어감 (sent = true, meta 복원용, 다시 보내지 않음)
+bool outbox_open(const std::string &path, std::chrono::seconds replay_max_age, std::vector<OutboxEntry> &pending);
+
+// 버퍼에 기록하고 id 리턴 (열려 있지 않으면 0)
+uint64_t outbox_append(const std::string &to, const std::string &subject, const std::string &body,
+                       const std::string &meta = "");
+
+// 발송 끝 (성공 / 포기). meta 가 없으면 outbox_done 과 같음. id 0 은 무시
+void outbox_sent(uint64_t id);
+
+// 기록 삭제 (다시 보내지도, 되살리지도 않음). id 0 은 무시
+void outbox_done(uint64_t id);
+
+// 남은 버퍼를 기록하고 flush 스레드 종료
+void outbox_close();
+
+OutboxStats outbox_stats();
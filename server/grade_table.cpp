@@ -0,0 +1,110 @@
+// ============================================================================
+// 파일명: grade_table.cpp
+// 목적: grades 스냅샷 구현 (grade_table.h 설명 참고)
+// ============================================================================
+#include "grade_table.h"
+#include "logger.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static constexpr std::chrono::seconds GRADE_RETRY_INTERVAL{1}; // 첫 로드 실패 시 재시도 간격
+
+static GradeSnapshotPtr g_snapshot;           // std::atomic_load/atomic_store 로만 접근
+static std::mutex g_load_m;                   // 동시에 여러 스레드가 로드하지 않도록
+static std::atomic<uint64_t> g_version{0};
+
+static std::atomic<bool> g_reload_requested{false}; // SIGHUP 등 즉시 재로딩 요청
+static std::atomic<bool> g_reloader_running{false};
+static std::thread g_reloader;
+static std::mutex g_reloader_m;
+static std::condition_variable g_reloader_cv;
+
+GradeSnapshotPtr grade_table_snapshot()
+{
+    return std::atomic_load(&g_snapshot);
+}
+
+bool grade_table_reload(Storage &db)
+{
+    std::lock_guard<std::mutex> lk(g_load_m);
+    try
+    {
+        auto snap = std::make_shared<GradeSnapshot>();
+        snap->max_filesize = db.grade_limits();
+        snap->version = ++g_version;
+
+        std::atomic_store(&g_snapshot, GradeSnapshotPtr(std::move(snap)));
+        LOG_INFO("[Grades] loaded " << grade_table_snapshot()->max_filesize.size()
+                 << " grades (v" << g_version.load() << ")");
+        return true;
+    }
+    catch (const StorageError &e)
+    {
+        LOG_ERROR("[Grades] reload failed: " << e.what());
+        return false;
+    }
+}
+
+int64_t grade_max_filesize(Storage &db, int grade)
+{
+    GradeSnapshotPtr snap = grade_table_snapshot();
+    if (!snap)
+    {
+        grade_table_reload(db);
+        snap = grade_table_snapshot();
+        if (!snap)
+            return -1;
+    }
+    auto it = snap->max_filesize.find(grade);
+    return it == snap->max_filesize.end() ? -1 : it->second;
+}
+
+static void reloader_loop(StorageBackend *backend, std::chrono::seconds interval)
+{
+    while (g_reloader_running.load())
+    {
+        bool loaded = false;
+        {
+            std::unique_ptr<Storage> db = backend->open();
+            if (db)
+                loaded = grade_table_reload(*db);
+        }
+
+        // 아직 한 번도 못 읽었으면 짧게, 아니면 주기대로 대기
+        // (시그널 핸들러는 cv 를 깨울 수 없으므로 1초 단위로 요청 플래그 확인)
+        std::chrono::seconds wait = (loaded || grade_table_snapshot()) ? interval : GRADE_RETRY_INTERVAL;
+        auto deadline = std::chrono::steady_clock::now() + wait;
+        std::unique_lock<std::mutex> lk(g_reloader_m);
+        while (g_reloader_running.load() && !g_reload_requested.load() &&
+               std::chrono::steady_clock::now() < deadline)
+        {
+            g_reloader_cv.wait_for(lk, GRADE_RETRY_INTERVAL);
+        }
+        g_reload_requested = false;
+    }
+}
+
+void grade_table_start_reloader(StorageBackend &backend, std::chrono::seconds interval)
+{
+    if (g_reloader_running.exchange(true))
+        return;
+    g_reloader = std::thread(reloader_loop, &backend, interval);
+}
+
+void grade_table_request_reload()
+{
+    // 시그널 핸들러에서 불릴 수 있으므로 플래그만 세움 (reloader 가 최대 1초 안에 확인)
+    g_reload_requested = true;
+}
+
+void grade_table_stop_reloader()
+{
+    if (!g_reloader_running.exchange(false))
+        return;
+    g_reloader_cv.notify_all();
+    if (g_reloader.joinable())
+        g_reloader.join();
+}
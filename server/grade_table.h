@@ -0,0 +1,44 @@
+// ============================================================================
+// 파일명: grade_table.h
+// 목적: grades 테이블 스냅샷 (등급별 최대 용량을 메모리에서 조회)
+//
+// - 서버 시작 시 reloader 스레드가 grades 전체를 읽어 불변 스냅샷 생성
+// - 재로딩은 새 스냅샷을 만들어 원자적으로 교체 (읽는 쪽은 락 없이 shared_ptr 사용)
+//   주기 재로딩 + SIGHUP(grade_table_request_reload) 시 즉시 재로딩
+// - 시작 직후 DB가 아직 안 붙어서 스냅샷이 없으면, 처음 조회하는 핸들러가
+//   자기 커넥션으로 한 번 로드
+// - 스냅샷에 없는 등급은 -1 (하드코딩 기본값 없음 → 호출자가 오류 응답)
+//
+// 사용 예:
+//   int64_t limit = grade_max_filesize(db, user->grade);
+//   if (limit < 0) { ... 등급 정보 없음 ... }
+// ============================================================================
+#pragma once
+
+#include "storage.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+struct GradeSnapshot
+{
+    std::unordered_map<int, int64_t> max_filesize; // grade -> max_filesize
+    uint64_t version = 0;                          // 로드할 때마다 1씩 증가
+};
+
+using GradeSnapshotPtr = std::shared_ptr<const GradeSnapshot>;
+
+// 현재 스냅샷 (아직 로드 전이면 nullptr)
+GradeSnapshotPtr grade_table_snapshot();
+
+// grades 를 다시 읽어 스냅샷 교체. 실패 시 기존 스냅샷 유지하고 false
+bool grade_table_reload(Storage &db);
+
+// 등급별 최대 용량 (바이트). 스냅샷이 없으면 db 로 한 번 로드, 모르는 등급이면 -1
+int64_t grade_max_filesize(Storage &db, int grade);
+
+// 백그라운드 재로딩 (main 에서 저장소 start 후 시작, worker join 후 정지)
+void grade_table_start_reloader(StorageBackend &backend, std::chrono::seconds interval);
+void grade_table_request_reload(); // 시그널 핸들러에서 호출 가능
+void grade_table_stop_reloader();
@@ -0,0 +1,283 @@
+// ============================================================================
+// 파일명: logger.cpp
+// 목적: 비동기 레벨 로그 구현 (logger.h 설명 참고)
+// ============================================================================
+#include "logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static constexpr size_t LOG_RING_SLOTS = 4096;  // 스레드당 ring 크기 (2의 거듭제곱)
+static constexpr uint32_t LOG_SITE_BURST = 20;  // 호출 위치당 1초에 남기는 최대 줄 수
+static constexpr int LOG_WRITER_IDLE_MS = 5;    // 비어 있을 때 writer 가 다시 보는 간격
+
+std::atomic<int> g_log_level{LOG_LEVEL_INFO};
+
+namespace
+{
+struct LogRecord
+{
+    int64_t ts_us = 0; // 벽시계 (us)
+    int level = 0;
+    uint32_t tid = 0;  // ring 번호 (스레드 구분용)
+    std::string msg;
+};
+
+// 단일 생산자(소유 스레드) / 단일 소비자(writer) ring
+struct LogRing
+{
+    LogRecord slots[LOG_RING_SLOTS];
+    std::atomic<uint64_t> head{0}; // writer 가 다음에 읽을 위치
+    std::atomic<uint64_t> tail{0}; // 소유 스레드가 다음에 쓸 위치
+    std::atomic<bool> closed{false}; // 소유 스레드 종료 (비면 writer 가 정리)
+    uint32_t tid = 0;
+};
+
+std::mutex g_rings_m; // ring 목록 (스레드 등록 / 정리 때만)
+std::vector<std::shared_ptr<LogRing>> g_rings;
+uint32_t g_next_tid = 1;
+
+std::atomic<bool> g_writer_running{false};
+std::thread g_writer;
+std::mutex g_direct_m; // writer 가 없을 때 바로 쓰는 경로
+
+std::atomic<uint64_t> g_written{0};
+std::atomic<uint64_t> g_dropped{0};
+std::atomic<uint64_t> g_suppressed{0};
+std::atomic<uint64_t> g_flushes{0};
+
+// 스레드 종료 시 ring 을 닫힘으로 표시 (남은 줄은 writer 가 마저 씀)
+struct RingHolder
+{
+    std::shared_ptr<LogRing> ring;
+    ~RingHolder()
+    {
+        if (ring)
+            ring->closed.store(true, std::memory_order_release);
+    }
+};
+thread_local RingHolder t_ring;
+
+LogRing *my_ring()
+{
+    if (!t_ring.ring)
+    {
+        auto r = std::make_shared<LogRing>();
+        std::lock_guard<std::mutex> lk(g_rings_m);
+        r->tid = g_next_tid++;
+        g_rings.push_back(r);
+        t_ring.ring = std::move(r);
+    }
+    return t_ring.ring.get();
+}
+
+int64_t now_us()
+{
+    auto d = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+const char *level_name(int level)
+{
+    switch (level)
+    {
+    case LOG_LEVEL_DEBUG:
+        return "DEBUG";
+    case LOG_LEVEL_INFO:
+        return "INFO ";
+    case LOG_LEVEL_WARN:
+        return "WARN ";
+    default:
+        return "ERROR";
+    }
+}
+
+// "HH:MM:SS.mmm LEVEL tid 메시지\n"
+void format_record(std::string &out, const LogRecord &r)
+{
+    time_t sec = static_cast<time_t>(r.ts_us / 1000000);
+    struct tm tmv;
+    localtime_r(&sec, &tmv);
+    char head[48];
+    std::snprintf(head, sizeof(head), "%02d:%02d:%02d.%03d %s t%u ", tmv.tm_hour, tmv.tm_min, tmv.tm_sec,
+                  static_cast<int>(r.ts_us / 1000 % 1000), level_name(r.level), r.tid);
+    out += head;
+    out += r.msg;
+    out += '\n';
+}
+
+void write_all(const std::string &data)
+{
+    size_t off = 0;
+    while (off < data.size())
+    {
+        ssize_t n = ::write(STDOUT_FILENO, data.data() + off, data.size() - off);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return; // stdout 이 닫힘 → 버림
+        }
+        off += static_cast<size_t>(n);
+    }
+}
+
+// 모든 ring 에서 꺼내 시각 순으로 출력. 꺼낸 줄 수 리턴
+size_t drain_once()
+{
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lk(g_rings_m);
+        rings = g_rings;
+    }
+
+    std::vector<LogRecord> batch;
+    for (auto &r : rings)
+    {
+        uint64_t head = r->head.load(std::memory_order_relaxed);
+        uint64_t tail = r->tail.load(std::memory_order_acquire);
+        for (; head < tail; ++head)
+            batch.push_back(std::move(r->slots[head & (LOG_RING_SLOTS - 1)]));
+        r->head.store(head, std::memory_order_release);
+    }
+
+    // 종료한 스레드의 빈 ring 정리
+    {
+        std::lock_guard<std::mutex> lk(g_rings_m);
+        g_rings.erase(std::remove_if(g_rings.begin(), g_rings.end(),
+                                     [](const std::shared_ptr<LogRing> &r) {
+                                         return r->closed.load(std::memory_order_acquire) &&
+                                                r->head.load() == r->tail.load(std::memory_order_acquire);
+                                     }),
+                      g_rings.end());
+    }
+
+    if (batch.empty())
+        return 0;
+    std::stable_sort(batch.begin(), batch.end(),
+                     [](const LogRecord &a, const LogRecord &b) { return a.ts_us < b.ts_us; });
+    std::string out;
+    for (const auto &r : batch)
+        format_record(out, r);
+    write_all(out);
+    g_written += batch.size();
+    g_flushes++;
+    return batch.size();
+}
+
+void writer_loop()
+{
+    while (g_writer_running.load(std::memory_order_acquire))
+    {
+        if (drain_once() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(LOG_WRITER_IDLE_MS));
+    }
+    while (drain_once() > 0)
+    {
+    }
+}
+
+int parse_level(const char *v)
+{
+    std::string s = v;
+    if (s == "debug")
+        return LOG_LEVEL_DEBUG;
+    if (s == "warn")
+        return LOG_LEVEL_WARN;
+    if (s == "error")
+        return LOG_LEVEL_ERROR;
+    return LOG_LEVEL_INFO;
+}
+} // namespace
+
+void log_start()
+{
+    if (const char *v = std::getenv("LOUD_LOG_LEVEL"))
+        g_log_level = parse_level(v);
+    bool expected = false;
+    if (!g_writer_running.compare_exchange_strong(expected, true))
+        return;
+    g_writer = std::thread(writer_loop);
+    std::atexit(log_stop); // main 의 조기 return / exit() 에서도 남은 로그를 쓰고 join
+}
+
+void log_stop()
+{
+    if (!g_writer_running.exchange(false))
+        return;
+    g_writer.join();
+}
+
+bool log_site_admit(LogSite &site, uint32_t &suppressed)
+{
+    uint64_t window = static_cast<uint64_t>(now_us() / 1000000);
+    uint64_t cur = site.window.load(std::memory_order_relaxed);
+    if (cur != window && site.window.compare_exchange_strong(cur, window, std::memory_order_relaxed))
+    {
+        // 새 창의 첫 줄이 직전 창에서 버린 수를 같이 알림
+        site.count.store(1, std::memory_order_relaxed);
+        suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    if (site.count.fetch_add(1, std::memory_order_relaxed) < LOG_SITE_BURST)
+        return true;
+    site.suppressed.fetch_add(1, std::memory_order_relaxed);
+    g_suppressed++;
+    return false;
+}
+
+void log_write(int level, std::string msg, uint32_t suppressed)
+{
+    if (suppressed > 0)
+        msg += " (+" + std::to_string(suppressed) + " suppressed)";
+
+    if (!g_writer_running.load(std::memory_order_acquire))
+    {
+        // writer 가 없음 (시작 전 / 종료 후) → 바로 출력
+        LogRecord r;
+        r.ts_us = now_us();
+        r.level = level;
+        r.msg = std::move(msg);
+        std::string out;
+        format_record(out, r);
+        std::lock_guard<std::mutex> lk(g_direct_m);
+        write_all(out);
+        g_written++;
+        return;
+    }
+
+    LogRing *ring = my_ring();
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail - ring->head.load(std::memory_order_acquire) >= LOG_RING_SLOTS)
+    {
+        g_dropped++;
+        return;
+    }
+    LogRecord &slot = ring->slots[tail & (LOG_RING_SLOTS - 1)];
+    slot.ts_us = now_us();
+    slot.level = level;
+    slot.tid = ring->tid;
+    slot.msg = std::move(msg);
+    ring->tail.store(tail + 1, std::memory_order_release);
+}
+
+LoggerStats logger_stats()
+{
+    LoggerStats st;
+    st.written = g_written.load();
+    st.dropped = g_dropped.load();
+    st.suppressed = g_suppressed.load();
+    st.flushes = g_flushes.load();
+    std::lock_guard<std::mutex> lk(g_rings_m);
+    st.threads = g_rings.size();
+    return st;
+}
@@ -0,0 +1,96 @@
+// ============================================================================
+// 파일명: logger.h
+// 목적: 비동기 레벨 로그 (hot path 가 stdout lock / flush 를 기다리지 않도록)
+//
+// - 스레드마다 고정 크기 ring buffer (단일 생산자 / 단일 소비자, lock-free)
+//   로그를 남기는 스레드는 문자열을 만들어 자기 ring 에 넣기만 함
+//   ring 이 가득 차면 기다리지 않고 버림 (dropped 로 집계)
+// - 전용 writer 스레드가 모든 ring 을 모아 시각 순으로 정렬해 write(2) 한 번
+// - 레벨: DEBUG < INFO < WARN < ERROR
+//   LOUD_LOG_MIN_LEVEL 보다 낮은 레벨은 컴파일 시 제거 (조건이 상수라 코드가 남지 않음)
+//   기본: NDEBUG 빌드면 INFO 부터, 아니면 DEBUG 부터 (CMake 옵션 LOUD_LOG_DEBUG)
+//   실행 중 레벨은 LOUD_LOG_LEVEL=debug|info|warn|error (기본 info)
+// - 같은 호출 위치에서 1초에 LOG_SITE_BURST 번을 넘으면 나머지는 버리고
+//   다음 창의 첫 줄에 "(+N suppressed)" 로 표시 (청크 / accept 로그 폭주 방지)
+//   WARN / ERROR 는 제한 없음 (장애 때 필요한 줄 / [Slow] 가 가려지지 않도록)
+// - log_start() 전 / log_stop() 후에는 호출한 스레드에서 바로 stdout 으로 씀
+//
+// 사용 예:
+//   LOG_INFO("[Accept] fd=" << cfd << " ip=" << ipbuf);
+//   LOG_DEBUG("[Chunk] " << uploaded << "/" << total);   // 배포 빌드에서는 사라짐
+//   LOG_ERROR("[DB Error] " << e.what());
+// ============================================================================
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+enum LogLevel
+{
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO = 1,
+    LOG_LEVEL_WARN = 2,
+    LOG_LEVEL_ERROR = 3
+};
+
+#ifndef LOUD_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOUD_LOG_MIN_LEVEL 1
+#else
+#define LOUD_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+struct LoggerStats
+{
+    uint64_t written = 0;    // writer 가 출력한 줄 수
+    uint64_t dropped = 0;    // ring 이 가득 차서 버린 줄 수
+    uint64_t suppressed = 0; // 호출 위치별 빈도 제한으로 버린 줄 수
+    uint64_t flushes = 0;    // write(2) 호출 수
+    size_t threads = 0;      // ring 을 가진 스레드 수
+};
+
+// 호출 위치별 빈도 제한 상태 (매크로가 위치마다 static 으로 하나씩)
+struct LogSite
+{
+    std::atomic<uint64_t> window{0};     // 현재 1초 창 번호
+    std::atomic<uint32_t> count{0};      // 창 안에서 남긴 횟수
+    std::atomic<uint32_t> suppressed{0}; // 창 안에서 버린 횟수
+};
+
+// main 시작 / 끝에서 (stop 은 남은 로그를 모두 쓰고 writer 종료)
+void log_start();
+void log_stop();
+
+// 실행 중 레벨 (LOUD_LOG_LEVEL 로 초기화)
+extern std::atomic<int> g_log_level;
+
+// 이 위치의 이번 호출을 남길지 (빈도 제한). suppressed 에 직전 창에서 버린 수
+bool log_site_admit(LogSite &site, uint32_t &suppressed);
+
+void log_write(int level, std::string msg, uint32_t suppressed);
+
+LoggerStats logger_stats();
+
+#define LOUD_LOG_AT(lvl, expr)                                                                         \
+    do                                                                                                 \
+    {                                                                                                  \
+        if ((lvl) >= LOUD_LOG_MIN_LEVEL && (lvl) >= g_log_level.load(std::memory_order_relaxed))      \
+        {                                                                                              \
+            static LogSite loud_log_site_;                                                             \
+            uint32_t loud_log_supp_ = 0;                                                               \
+            if ((lvl) >= LOG_LEVEL_WARN || log_site_admit(loud_log_site_, loud_log_supp_))             \
+            {                                                                                          \
+                std::ostringstream loud_log_os_;                                                       \
+                loud_log_os_ << expr;                                                                  \
+                log_write((lvl), loud_log_os_.str(), loud_log_supp_);                                  \
+            }                                                                                          \
+        }                                                                                              \
+    } while (0)
+
+#define LOG_DEBUG(expr) LOUD_LOG_AT(LOG_LEVEL_DEBUG, expr)
+#define LOG_INFO(expr) LOUD_LOG_AT(LOG_LEVEL_INFO, expr)
+#define LOG_WARN(expr) LOUD_LOG_AT(LOG_LEVEL_WARN, expr)
+#define LOG_ERROR(expr) LOUD_LOG_AT(LOG_LEVEL_ERROR, expr)
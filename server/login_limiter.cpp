@@ -0,0 +1,204 @@
+// ============================================================================
+// 파일명: login_limiter.cpp
+// 목적: 로그인 시도 token bucket 표 구현 (login_limiter.h 설명 참고)
+// ============================================================================
+#include "login_limiter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <functional>
+
+static constexpr size_t LIMITER_SLOTS = 8192; // 표 하나의 슬롯 수 (2의 거듭제곱)
+static constexpr size_t LIMITER_PROBES = 16;  // 키 하나가 살펴보는 연속 슬롯 수
+
+namespace
+{
+struct BucketSpec
+{
+    uint64_t capacity;  // 최대 토큰 수 (연속 시도 허용 횟수)
+    uint64_t refill_ms; // 토큰 1개가 다시 채워지는 시간
+};
+
+// IP 는 NAT / 강의실처럼 여러 명이 한 주소를 쓰는 경우를 고려해 넉넉하게
+constexpr BucketSpec IP_BUCKET{30, 2000};      // 연속 30회, 이후 2초에 1회
+constexpr BucketSpec ACCOUNT_BUCKET{5, 12000}; // 연속 5회, 이후 12초에 1회
+
+// state = (마지막 갱신 ms << TOKEN_BITS) | 남은 milli-token
+// 0 이면 가득 찬 새 버킷 (빈 슬롯을 잡은 직후 / 재사용 직후)
+constexpr uint64_t MILLI = 1000;
+constexpr int TOKEN_BITS = 16;
+constexpr uint64_t TOKEN_MASK = (uint64_t{1} << TOKEN_BITS) - 1;
+static_assert(IP_BUCKET.capacity * MILLI <= TOKEN_MASK, "IP bucket capacity too large");
+static_assert(ACCOUNT_BUCKET.capacity * MILLI <= TOKEN_MASK, "account bucket capacity too large");
+
+struct Slot
+{
+    std::atomic<uint64_t> key{0};   // 키 해시 (0 = 빈 슬롯, 한 번 잡히면 0 으로 돌아가지 않음)
+    std::atomic<uint64_t> state{0}; // 위 state 형식
+};
+
+struct Table
+{
+    explicit Table(BucketSpec s) : spec(s) {}
+    const BucketSpec spec;
+    Slot slots[LIMITER_SLOTS];
+};
+
+Table g_ip_table(IP_BUCKET);
+Table g_account_table(ACCOUNT_BUCKET);
+
+std::atomic<uint64_t> g_allowed{0};
+std::atomic<uint64_t> g_throttled_ip{0};
+std::atomic<uint64_t> g_throttled_account{0};
+std::atomic<uint64_t> g_table_full{0};
+
+uint64_t now_ms()
+{
+    auto d = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(d).count()) + 1;
+}
+
+uint64_t hash_key(const std::string &s)
+{
+    uint64_t h = std::hash<std::string>{}(s);
+    // 하위 비트로 슬롯을 고르므로 한 번 더 섞음 (splitmix64 마무리 단계)
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h ? h : 1;
+}
+
+// now 시점까지 채워진 milli-token
+uint64_t refilled(uint64_t state, uint64_t now, const BucketSpec &spec)
+{
+    uint64_t cap = spec.capacity * MILLI;
+    if (state == 0)
+        return cap;
+    uint64_t last = state >> TOKEN_BITS;
+    uint64_t tok = state & TOKEN_MASK;
+    if (now <= last)
+        return tok;
+    return std::min(cap, tok + (now - last) * MILLI / spec.refill_ms);
+}
+
+// 키의 슬롯 찾기 / 잡기 (못 잡으면 nullptr + wait_ms 에 주변 슬롯이 비워질 수 있을 때까지 ms)
+// 빈 슬롯을 순서대로 잡으므로 같은 키가 두 슬롯에 들어가지 않음
+Slot *find_slot(Table &t, uint64_t h, uint64_t now, uint64_t &wait_ms)
+{
+    size_t base = static_cast<size_t>(h) & (LIMITER_SLOTS - 1);
+    Slot *reusable = nullptr;
+    uint64_t reusable_key = 0;
+    const uint64_t cap = t.spec.capacity * MILLI;
+    wait_ms = cap * t.spec.refill_ms / MILLI + 1;
+
+    for (size_t i = 0; i < LIMITER_PROBES; ++i)
+    {
+        Slot &s = t.slots[(base + i) & (LIMITER_SLOTS - 1)];
+        uint64_t k = s.key.load(std::memory_order_acquire);
+        if (k == h)
+            return &s;
+        if (k == 0)
+        {
+            if (s.key.compare_exchange_strong(k, h, std::memory_order_acq_rel))
+                return &s;
+            if (k == h)
+                return &s; // 같은 키를 다른 스레드가 먼저 잡음
+            continue;
+        }
+        // 가득 찬 버킷 = 한동안 시도가 없었던 키 → 지워도 제한 결과가 같음
+        uint64_t tok = refilled(s.state.load(std::memory_order_acquire), now, t.spec);
+        if (tok >= cap)
+        {
+            if (!reusable)
+            {
+                reusable = &s;
+                reusable_key = k;
+            }
+        }
+        else
+        {
+            wait_ms = std::min(wait_ms, (cap - tok) * t.spec.refill_ms / MILLI + 1);
+        }
+    }
+
+    if (reusable && reusable->key.compare_exchange_strong(reusable_key, h, std::memory_order_acq_rel))
+    {
+        reusable->state.store(0, std::memory_order_release);
+        return reusable;
+    }
+    return nullptr;
+}
+
+// 토큰 1개 사용 (없으면 false + 다음 토큰까지 ms)
+bool take(Table &t, const std::string &key, uint64_t now, uint64_t &retry_ms)
+{
+    Slot *s = find_slot(t, hash_key(key), now, retry_ms);
+    if (!s)
+    {
+        // 주변 슬롯이 모두 최근 시도 중 → 제한 없이 통과시키지 않고 거절
+        // (키를 바꿔 가며 표를 채우는 방식으로 제한을 피하지 못하도록)
+        g_table_full++;
+        return false;
+    }
+
+    uint64_t cur = s->state.load(std::memory_order_acquire);
+    while (true)
+    {
+        uint64_t tok = refilled(cur, now, t.spec);
+        if (tok < MILLI)
+        {
+            retry_ms = (MILLI - tok) * t.spec.refill_ms / MILLI + 1;
+            return false;
+        }
+        uint64_t last = std::max(now, cur >> TOKEN_BITS);
+        uint64_t next = (last << TOKEN_BITS) | (tok - MILLI);
+        if (s->state.compare_exchange_weak(cur, next, std::memory_order_acq_rel, std::memory_order_acquire))
+            return true;
+    }
+}
+
+int to_retry_seconds(uint64_t retry_ms)
+{
+    return static_cast<int>(std::max<uint64_t>(1, (retry_ms + 999) / 1000));
+}
+} // namespace
+
+int login_limiter_take(const std::string &ip, const std::string &account)
+{
+    uint64_t now = now_ms();
+    uint64_t retry_ms = 0;
+
+    if (!ip.empty() && !take(g_ip_table, ip, now, retry_ms))
+    {
+        g_throttled_ip++;
+        return to_retry_seconds(retry_ms);
+    }
+
+    if (!account.empty())
+    {
+        std::string key = account;
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (!take(g_account_table, key, now, retry_ms))
+        {
+            g_throttled_account++;
+            return to_retry_seconds(retry_ms);
+        }
+    }
+
+    g_allowed++;
+    return 0;
+}
+
+LoginLimiterStats login_limiter_stats()
+{
+    LoginLimiterStats st;
+    st.allowed = g_allowed.load();
+    st.throttled_ip = g_throttled_ip.load();
+    st.throttled_account = g_throttled_account.load();
+    st.table_full = g_table_full.load();
+    return st;
+}
@@ -0,0 +1,34 @@
+// ============================================================================
+// 파일명: login_limiter.h
+// 목적: 로그인 / 비밀번호 확인 시도 속도 제한 (IP 별 + 계정 별 token bucket)
+//
+// - epoll 스레드가 요청을 큐에 넣기 전에 확인 → 막힌 시도는 worker / DB 까지 가지 않음
+//   (기존 g_fail_counts 5회 잠금은 DB 조회 뒤에야 동작하므로 대입 공격 부하를 못 막음)
+// - 시도 한 번마다 IP 버킷과 계정 버킷에서 토큰 한 개씩 사용, 하나라도 비었으면 거절
+// - 표는 고정 크기 open addressing, 슬롯은 atomic CAS 로만 갱신 (mutex 없음)
+//   오래 안 쓰여 가득 찬 버킷의 슬롯은 다른 키가 재사용
+//   주변 슬롯이 모두 사용 중이면 그 키는 거절 (fail closed, table_full 로 집계)
+//   → 가장 먼저 비워질 슬롯이 가득 찰 때까지의 시간을 retry 로 돌려줌
+// - 계정 키는 소문자 email (users.email collation 과 동일하게 대소문자 무시)
+//
+// 사용 예 (epoll 스레드):
+//   int retry = login_limiter_take(s.peer_ip, email);   // email 모르면 ""
+//   if (retry > 0) { ... VALUE_ERR_RATE_LIMITED 응답, retry 초 뒤 재시도 ... }
+// ============================================================================
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct LoginLimiterStats
+{
+    uint64_t allowed = 0;           // 통과한 시도
+    uint64_t throttled_ip = 0;      // IP 버킷이 비어서 거절
+    uint64_t throttled_account = 0; // 계정 버킷이 비어서 거절
+    uint64_t table_full = 0;        // 슬롯을 못 잡아 거절 (throttled_* 에도 포함)
+};
+
+// 시도 한 번 기록. 통과면 0, 거절이면 다시 시도할 수 있을 때까지 남은 초 (1 이상)
+int login_limiter_take(const std::string &ip, const std::string &account);
+
+LoginLimiterStats login_limiter_stats();
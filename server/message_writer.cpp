@@ -0,0 +1,230 @@
+// ============================================================================
+// 파일명: message_writer.cpp
+// 목적: 메시지 INSERT 묶음 처리 구현 (message_writer.h 설명 참고)
+// ============================================================================
+#include "message_writer.h"
+#include "unread_counter.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+static std::deque<OutgoingMessage> g_queue;
+static std::mutex g_m;
+static std::condition_variable g_cv;
+static bool g_accepting = false; // g_m 으로 보호
+static std::atomic<bool> g_running{false};
+static std::thread g_writer;
+
+static StorageBackend *g_backend = nullptr;
+static size_t g_max_rows = 32;
+static std::chrono::milliseconds g_max_delay{2};
+
+static std::atomic<uint64_t> g_batches{0};
+static std::atomic<uint64_t> g_rows{0};
+static std::atomic<uint64_t> g_max_batch{0};
+static std::atomic<uint64_t> g_retries{0};
+static std::atomic<uint64_t> g_failed{0};
+
+// 여러 행 INSERT 로 나누는 방식은 백엔드가 정함 (mariadb: 2의 거듭제곱 행 수)
+static void insert_rows(Storage &db, const std::vector<OutgoingMessage> &batch)
+{
+    std::vector<NewMessage> rows;
+    rows.reserve(batch.size());
+    for (const auto &m : batch)
+        rows.push_back({m.from_email, m.to_email, m.content});
+    db.insert_messages(rows);
+}
+
+static std::vector<std::string> recipients(const std::vector<OutgoingMessage> &batch)
+{
+    std::vector<std::string> to;
+    to.reserve(batch.size());
+    for (const auto &m : batch)
+        to.push_back(m.to_email);
+    return to;
+}
+
+// commit 된 묶음만큼 수신자 안읽은 수 증가 (메모리 카운터)
+static void count_unread(UnreadChange &uc, const std::vector<OutgoingMessage> &batch)
+{
+    for (const auto &m : batch)
+        uc.add(m.to_email, 1);
+}
+
+static void finish(std::vector<OutgoingMessage> &batch, bool ok, const std::string &err)
+{
+    for (auto &m : batch)
+    {
+        if (m.done)
+            m.done(ok, err);
+    }
+    if (!ok)
+        g_failed += batch.size();
+}
+
+// 묶음 실패 시: 한 행씩 auto-commit 으로 다시 시도
+static void retry_one_by_one(std::vector<OutgoingMessage> &batch)
+{
+    g_retries++;
+    for (auto &m : batch)
+    {
+        std::vector<OutgoingMessage> one{std::move(m)};
+        UnreadChange uc(nullptr, recipients(one));
+        std::unique_ptr<Storage> db = g_backend->open();
+        if (!db)
+        {
+            finish(one, false, "DB 연결 불가");
+            continue;
+        }
+        try
+        {
+            insert_rows(*db, one);
+            count_unread(uc, one);
+            g_rows++;
+            finish(one, true, "");
+        }
+        catch (const StorageError &e)
+        {
+            LOG_ERROR("[MsgWriter] insert failed: " << e.what());
+            db->discard();
+            finish(one, false, e.what());
+        }
+    }
+}
+
+static void write_batch(std::vector<OutgoingMessage> &batch)
+{
+    UnreadChange uc(nullptr, recipients(batch)); // commit 후 소멸 (db 보다 먼저 생성)
+    std::unique_ptr<Storage> db = g_backend->open();
+    if (!db)
+    {
+        finish(batch, false, "DB 연결 불가");
+        return;
+    }
+
+    try
+    {
+        db->begin();
+        insert_rows(*db, batch);
+        db->commit();
+        count_unread(uc, batch);
+    }
+    catch (const StorageError &e)
+    {
+        LOG_ERROR("[MsgWriter] batch of " << batch.size() << " failed: " << e.what());
+        try
+        {
+            db->rollback();
+        }
+        catch (...)
+        {
+        }
+        db->discard();
+        if (batch.size() == 1)
+            finish(batch, false, e.what());
+        else
+            retry_one_by_one(batch);
+        return;
+    }
+
+    g_batches++;
+    g_rows += batch.size();
+    uint64_t n = batch.size();
+    uint64_t cur = g_max_batch.load();
+    while (n > cur && !g_max_batch.compare_exchange_weak(cur, n))
+    {
+    }
+    finish(batch, true, "");
+}
+
+static void writer_loop()
+{
+    while (true)
+    {
+        std::vector<OutgoingMessage> batch;
+        {
+            std::unique_lock<std::mutex> lk(g_m);
+            g_cv.wait(lk, [] { return !g_queue.empty() || !g_running.load(); });
+            if (g_queue.empty())
+                break; // 정지 + 큐 비었음
+
+            // 첫 메시지 이후 잠깐 더 모음 (다른 worker 의 전송이 같은 commit 에 타도록)
+            if (g_running.load() && g_queue.size() < g_max_rows)
+            {
+                auto deadline = std::chrono::steady_clock::now() + g_max_delay;
+                g_cv.wait_until(lk, deadline, [] { return g_queue.size() >= g_max_rows || !g_running.load(); });
+            }
+
+            size_t n = std::min(g_queue.size(), g_max_rows);
+            batch.reserve(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                batch.push_back(std::move(g_queue.front()));
+                g_queue.pop_front();
+            }
+        }
+        write_batch(batch);
+    }
+}
+
+void message_writer_start(StorageBackend &backend, size_t max_rows, std::chrono::milliseconds max_delay)
+{
+    if (g_running.exchange(true))
+        return;
+    g_backend = &backend;
+    g_max_rows = std::max<size_t>(1, max_rows);
+    g_max_delay = max_delay;
+    {
+        std::lock_guard<std::mutex> lk(g_m);
+        g_accepting = true;
+    }
+    g_writer = std::thread(writer_loop);
+}
+
+void message_writer_stop()
+{
+    {
+        std::lock_guard<std::mutex> lk(g_m);
+        if (!g_accepting)
+            return;
+        g_accepting = false; // 이후 submit 은 false → 호출자가 직접 INSERT
+    }
+    g_running = false;
+    g_cv.notify_all();
+    if (g_writer.joinable())
+        g_writer.join();
+}
+
+bool message_writer_submit(OutgoingMessage msg)
+{
+    {
+        std::lock_guard<std::mutex> lk(g_m);
+        if (!g_accepting)
+            return false;
+        g_queue.push_back(std::move(msg));
+        if (g_queue.size() != 1 && g_queue.size() < g_max_rows)
+            return true; // writer 는 이미 첫 메시지로 깨어 모으는 중
+    }
+    g_cv.notify_one();
+    return true;
+}
+
+MessageWriterStats message_writer_stats()
+{
+    MessageWriterStats st;
+    st.batches = g_batches.load();
+    st.rows = g_rows.load();
+    st.max_rows = g_max_batch.load();
+    st.retries = g_retries.load();
+    st.failed = g_failed.load();
+    std::lock_guard<std::mutex> lk(g_m);
+    st.queued = g_queue.size();
+    return st;
+}
@@ -0,0 +1,54 @@
+// ============================================================================
+// 파일명: message_writer.h
+// 목적: 메시지 INSERT 묶음 처리 (group commit)
+//
+// - worker 는 검증이 끝난 메시지를 큐에 넣고 바로 다음 요청 처리
+// - 전용 writer 스레드가 큐를 모아 여러 행 INSERT + commit 한 번
+//   (첫 메시지가 들어온 뒤 max_delay 가 지나거나 max_rows 가 차면 기록)
+// - 묶음이 commit 된 뒤에 메시지마다 완료 콜백 호출 → 그때 송신자에게 응답
+// - 묶음이 실패하면 한 행씩 다시 시도 (문제 있는 행만 실패 응답)
+// - 정지 시 큐에 남은 메시지 모두 기록 후 종료
+//
+// 사용 예:
+//   bool queued = message_writer_submit({from, to, content,
+//       [](bool ok, const std::string &err) { ... 응답 전송 ... }});
+//   if (!queued) { ... 직접 INSERT ... }
+// ============================================================================
+#pragma once
+
+#include "storage.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// ok=false 면 err 에 DB 오류 내용
+using MessageAck = std::function<void(bool ok, const std::string &err)>;
+
+struct OutgoingMessage
+{
+    std::string from_email; // messages.from_email
+    std::string to_email;   // messages.to_email
+    std::string content;    // messages.content
+    MessageAck done;        // commit 후 호출 (writer 스레드에서)
+};
+
+struct MessageWriterStats
+{
+    uint64_t batches = 0;  // commit 한 묶음 수
+    uint64_t rows = 0;     // 기록한 메시지 수
+    uint64_t max_rows = 0; // 가장 큰 묶음 크기
+    uint64_t retries = 0;  // 묶음 실패 후 한 행씩 재시도한 횟수
+    uint64_t failed = 0;   // 최종 실패한 메시지 수
+    size_t queued = 0;     // 현재 대기 중인 메시지 수
+};
+
+// main 에서 저장소 start 후 시작, worker join 후 정지 (남은 메시지 기록)
+void message_writer_start(StorageBackend &backend, size_t max_rows, std::chrono::milliseconds max_delay);
+void message_writer_stop();
+
+// 큐에 넣기. writer 가 돌고 있지 않으면 false (호출자가 직접 INSERT)
+bool message_writer_submit(OutgoingMessage msg);
+
+MessageWriterStats message_writer_stats();
@@ -0,0 +1,496 @@
+// ============================================================================
+// 파일명: metrics.cpp
+// 목적: 지표 shard / 히스토그램 / 노출 구현 (metrics.h 설명 참고)
+// ============================================================================
+#include "metrics.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static constexpr int HIST_SUB_BITS = 3;                  // 2의 거듭제곱 구간을 8칸으로
+static constexpr uint64_t HIST_SUB = 1u << HIST_SUB_BITS;
+static constexpr size_t HIST_BUCKETS = 280;              // 마지막 칸 ≈ 2^36 us (약 19시간), 넘으면 마지막 칸
+static constexpr int METRICS_HTTP_POLL_MS = 200;         // 종료 플래그를 다시 보는 간격
+static constexpr int METRICS_HTTP_TIMEOUT_S = 1;         // 요청 읽기 / 응답 쓰기 제한
+static constexpr size_t METRICS_HTTP_MAX_REQUEST = 4096;
+
+// Prometheus 로 내보내는 구간 경계 (us). 세밀한 칸은 상한이 경계 이하인 곳에 합산
+static const uint64_t PROM_LE_US[] = {100,    250,    500,     1000,    2500,    5000,    10000,   25000,
+                                      50000,  100000, 250000,  500000,  1000000, 2500000, 5000000, 10000000};
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+using json = nlohmann::json;
+
+// 소유 스레드만 쓰므로 load + store (읽는 쪽은 relaxed 로 합산, 약간 늦은 값이어도 됨)
+inline void bump(std::atomic<uint64_t> &a, uint64_t d)
+{
+    a.store(a.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+}
+
+size_t bucket_of(uint64_t v)
+{
+    if (v < HIST_SUB)
+        return static_cast<size_t>(v);
+    int e = 63 - __builtin_clzll(v);
+    size_t idx = static_cast<size_t>(e - HIST_SUB_BITS + 1) * HIST_SUB + ((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+    return idx < HIST_BUCKETS ? idx : HIST_BUCKETS - 1;
+}
+
+// 칸에 들어가는 가장 큰 값
+uint64_t bucket_upper(size_t idx)
+{
+    if (idx < HIST_SUB)
+        return idx;
+    int e = static_cast<int>(idx / HIST_SUB) + HIST_SUB_BITS - 1;
+    uint64_t sub = idx % HIST_SUB;
+    uint64_t width = 1ull << (e - HIST_SUB_BITS);
+    return ((HIST_SUB + sub) << (e - HIST_SUB_BITS)) + width - 1;
+}
+
+struct Hist
+{
+    std::atomic<uint64_t> buckets[HIST_BUCKETS] = {};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+
+    void observe(uint64_t us)
+    {
+        bump(buckets[bucket_of(us)], 1);
+        bump(count, 1);
+        bump(sum, us);
+        if (us > max.load(std::memory_order_relaxed))
+            max.store(us, std::memory_order_relaxed);
+    }
+};
+
+struct TypeHists
+{
+    Hist handler;
+    Hist db;
+};
+
+struct Shard
+{
+    Hist stages[METRIC_STAGE_COUNT];
+    std::atomic<TypeHists *> types[METRIC_MAX_TYPE] = {}; // 처음 본 type 만 할당 (소유 스레드가)
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+
+    ~Shard()
+    {
+        for (auto &t : types)
+            delete t.load();
+    }
+};
+
+// 스레드가 끝나도 shard 는 남김 (누적 값이 줄어들면 안 됨, 스레드 수는 고정)
+std::mutex g_shards_m;
+std::vector<std::unique_ptr<Shard>> g_shards;
+thread_local Shard *t_shard = nullptr;
+
+struct Gauge
+{
+    std::string name;
+    std::string help;
+    std::function<double()> read;
+};
+std::mutex g_gauges_m;
+std::vector<Gauge> g_gauges;
+
+const Clock::time_point g_started = Clock::now();
+
+std::atomic<bool> g_http_running{false};
+std::thread g_http;
+int g_http_fd = -1;
+
+Shard &my_shard()
+{
+    if (!t_shard)
+    {
+        auto s = std::make_unique<Shard>();
+        t_shard = s.get();
+        std::lock_guard<std::mutex> lk(g_shards_m);
+        g_shards.push_back(std::move(s));
+    }
+    return *t_shard;
+}
+
+// 읽는 쪽: 모든 shard 합산 결과
+struct HistSnap
+{
+    uint64_t buckets[HIST_BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    void add(const Hist &h)
+    {
+        for (size_t i = 0; i < HIST_BUCKETS; ++i)
+            buckets[i] += h.buckets[i].load(std::memory_order_relaxed);
+        count += h.count.load(std::memory_order_relaxed);
+        sum += h.sum.load(std::memory_order_relaxed);
+        max = std::max(max, h.max.load(std::memory_order_relaxed));
+    }
+
+    // q 분위 값 (해당 칸의 상한, max 를 넘지 않게)
+    uint64_t quantile(double q) const
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < HIST_BUCKETS; ++i)
+            total += buckets[i];
+        if (total == 0)
+            return 0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total) + 0.999999);
+        if (rank == 0)
+            rank = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < HIST_BUCKETS; ++i)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+                return std::min(bucket_upper(i), max);
+        }
+        return max;
+    }
+
+    json summary() const
+    {
+        return {{"count", count},
+                {"avg_us", count ? sum / count : 0},
+                {"p50_us", quantile(0.50)},
+                {"p90_us", quantile(0.90)},
+                {"p99_us", quantile(0.99)},
+                {"max_us", max}};
+    }
+};
+
+struct Snapshot
+{
+    HistSnap stages[METRIC_STAGE_COUNT];
+    HistSnap handler[METRIC_MAX_TYPE];
+    HistSnap db[METRIC_MAX_TYPE];
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+};
+
+std::unique_ptr<Snapshot> take_snapshot()
+{
+    auto snap = std::make_unique<Snapshot>();
+    std::lock_guard<std::mutex> lk(g_shards_m);
+    for (const auto &s : g_shards)
+    {
+        for (int i = 0; i < METRIC_STAGE_COUNT; ++i)
+            snap->stages[i].add(s->stages[i]);
+        for (int t = 0; t < METRIC_MAX_TYPE; ++t)
+        {
+            const TypeHists *th = s->types[t].load(std::memory_order_acquire);
+            if (!th)
+                continue;
+            snap->handler[t].add(th->handler);
+            snap->db[t].add(th->db);
+        }
+        snap->bytes_in += s->bytes_in.load(std::memory_order_relaxed);
+        snap->bytes_out += s->bytes_out.load(std::memory_order_relaxed);
+    }
+    return snap;
+}
+
+// 콜백은 lock 밖에서 (콜백이 다른 모듈 lock 을 잡음)
+std::vector<std::pair<const Gauge *, double>> read_gauges(std::vector<Gauge> &copy)
+{
+    {
+        std::lock_guard<std::mutex> lk(g_gauges_m);
+        copy = g_gauges;
+    }
+    std::vector<std::pair<const Gauge *, double>> out;
+    for (const auto &g : copy)
+        out.emplace_back(&g, g.read ? g.read() : 0.0);
+    return out;
+}
+
+const char *stage_name(int stage)
+{
+    switch (stage)
+    {
+    case METRIC_REACTOR_LOOP:
+        return "reactor_loop";
+    case METRIC_QUEUE_WAIT:
+        return "queue_wait";
+    case METRIC_RESPONSE_FLUSH:
+        return "response_flush";
+    default:
+        return "db_acquire";
+    }
+}
+
+std::string type_label(int type)
+{
+    char buf[8];
+    std::snprintf(buf, sizeof(buf), "0x%04x", type);
+    return buf;
+}
+
+std::string seconds(uint64_t us)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.6f", static_cast<double>(us) / 1e6);
+    return buf;
+}
+
+// 히스토그램 한 벌 (labels 는 {..} 안쪽, 비어 있으면 le 만)
+void prom_hist(std::string &out, const std::string &name, const std::string &labels, const HistSnap &h)
+{
+    std::string sep = labels.empty() ? "" : labels + ",";
+    uint64_t cum = 0;
+    size_t i = 0;
+    for (uint64_t le : PROM_LE_US)
+    {
+        for (; i < HIST_BUCKETS && bucket_upper(i) <= le; ++i)
+            cum += h.buckets[i];
+        out += name + "_bucket{" + sep + "le=\"" + seconds(le) + "\"} " + std::to_string(cum) + "\n";
+    }
+    for (; i < HIST_BUCKETS; ++i)
+        cum += h.buckets[i];
+    // count 대신 칸 합계 (기록 중에 읽어도 +Inf 가 앞 구간보다 작아지지 않도록)
+    out += name + "_bucket{" + sep + "le=\"+Inf\"} " + std::to_string(cum) + "\n";
+    std::string lb = labels.empty() ? "" : "{" + labels + "}";
+    out += name + "_sum" + lb + " " + seconds(h.sum) + "\n";
+    out += name + "_count" + lb + " " + std::to_string(cum) + "\n";
+}
+
+bool send_all(int fd, const std::string &data)
+{
+    size_t off = 0;
+    while (off < data.size())
+    {
+        ssize_t n = ::send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 한 연결 = 요청 하나 (Connection: close)
+void serve_one(int cfd)
+{
+    timeval tv{METRICS_HTTP_TIMEOUT_S, 0};
+    setsockopt(cfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(cfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    std::string req;
+    char buf[1024];
+    while (req.find("\r\n\r\n") == std::string::npos && req.size() < METRICS_HTTP_MAX_REQUEST)
+    {
+        ssize_t n = ::recv(cfd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        req.append(buf, static_cast<size_t>(n));
+    }
+
+    std::string status = "404 Not Found";
+    std::string body = "not found\n";
+    if (req.compare(0, 13, "GET /metrics ") == 0 || req.compare(0, 13, "GET /metrics?") == 0)
+    {
+        status = "200 OK";
+        body = metrics_prometheus_text();
+    }
+    std::string resp = "HTTP/1.1 " + status +
+                       "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: " +
+                       std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    send_all(cfd, resp);
+}
+
+void http_loop()
+{
+    while (g_http_running.load(std::memory_order_acquire))
+    {
+        pollfd p{g_http_fd, POLLIN, 0};
+        int r = ::poll(&p, 1, METRICS_HTTP_POLL_MS);
+        if (r <= 0)
+            continue;
+        int cfd = ::accept4(g_http_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (cfd < 0)
+            continue;
+        serve_one(cfd);
+        ::close(cfd);
+    }
+}
+} // namespace
+
+void metrics_observe_stage(MetricStage stage, uint64_t us)
+{
+    my_shard().stages[stage].observe(us);
+}
+
+void metrics_observe_request(int type, uint64_t handler_us, uint64_t db_us)
+{
+    if (type <= 0 || type >= METRIC_MAX_TYPE)
+        return;
+    Shard &s = my_shard();
+    TypeHists *th = s.types[type].load(std::memory_order_relaxed);
+    if (!th)
+    {
+        th = new TypeHists();
+        s.types[type].store(th, std::memory_order_release);
+    }
+    th->handler.observe(handler_us);
+    th->db.observe(db_us);
+}
+
+void metrics_add_bytes_in(uint64_t n)
+{
+    bump(my_shard().bytes_in, n);
+}
+
+void metrics_add_bytes_out(uint64_t n)
+{
+    bump(my_shard().bytes_out, n);
+}
+
+void metrics_register_gauge(const std::string &name, const std::string &help, std::function<double()> read)
+{
+    std::lock_guard<std::mutex> lk(g_gauges_m);
+    g_gauges.push_back(Gauge{name, help, std::move(read)});
+}
+
+json metrics_snapshot_json()
+{
+    std::unique_ptr<Snapshot> snap = take_snapshot();
+    std::vector<Gauge> copy;
+    auto gauges = read_gauges(copy);
+
+    json out;
+    out["uptime_s"] = std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - g_started).count();
+    out["bytes_in"] = snap->bytes_in;
+    out["bytes_out"] = snap->bytes_out;
+
+    json g = json::object();
+    for (const auto &kv : gauges)
+        g[kv.first->name] = kv.second;
+    out["gauges"] = std::move(g);
+
+    json stages = json::object();
+    for (int i = 0; i < METRIC_STAGE_COUNT; ++i)
+        stages[stage_name(i)] = snap->stages[i].summary();
+    out["stages"] = std::move(stages);
+
+    json types = json::array();
+    for (int t = 1; t < METRIC_MAX_TYPE; ++t)
+    {
+        if (snap->handler[t].count == 0)
+            continue;
+        types.push_back({{"type", t}, {"handler", snap->handler[t].summary()}, {"db", snap->db[t].summary()}});
+    }
+    out["types"] = std::move(types);
+    return out;
+}
+
+std::string metrics_prometheus_text()
+{
+    std::unique_ptr<Snapshot> snap = take_snapshot();
+    std::vector<Gauge> copy;
+    auto gauges = read_gauges(copy);
+
+    std::string out;
+    out.reserve(64 * 1024);
+
+    out += "# HELP loud_bytes_received_total Bytes read from client sockets.\n";
+    out += "# TYPE loud_bytes_received_total counter\n";
+    out += "loud_bytes_received_total " + std::to_string(snap->bytes_in) + "\n";
+    out += "# HELP loud_bytes_sent_total Bytes written to client sockets by the reactor.\n";
+    out += "# TYPE loud_bytes_sent_total counter\n";
+    out += "loud_bytes_sent_total " + std::to_string(snap->bytes_out) + "\n";
+
+    for (const auto &kv : gauges)
+    {
+        out += "# HELP " + kv.first->name + " " + kv.first->help + "\n";
+        out += "# TYPE " + kv.first->name + " gauge\n";
+        char val[32];
+        std::snprintf(val, sizeof(val), "%.17g", kv.second);
+        out += kv.first->name + " " + val + "\n";
+    }
+
+    out += "# HELP loud_stage_seconds Time spent in each server stage.\n";
+    out += "# TYPE loud_stage_seconds histogram\n";
+    for (int i = 0; i < METRIC_STAGE_COUNT; ++i)
+        prom_hist(out, "loud_stage_seconds", std::string("stage=\"") + stage_name(i) + "\"", snap->stages[i]);
+
+    out += "# HELP loud_handler_seconds Worker time per request by packet type.\n";
+    out += "# TYPE loud_handler_seconds histogram\n";
+    for (int t = 1; t < METRIC_MAX_TYPE; ++t)
+        if (snap->handler[t].count)
+            prom_hist(out, "loud_handler_seconds", "type=\"" + type_label(t) + "\"", snap->handler[t]);
+
+    out += "# HELP loud_db_seconds Storage time per request by packet type (session acquire + statements).\n";
+    out += "# TYPE loud_db_seconds histogram\n";
+    for (int t = 1; t < METRIC_MAX_TYPE; ++t)
+        if (snap->db[t].count)
+            prom_hist(out, "loud_db_seconds", "type=\"" + type_label(t) + "\"", snap->db[t]);
+    return out;
+}
+
+bool metrics_http_start(int port)
+{
+    if (port <= 0 || g_http_running.load())
+        return port <= 0;
+
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        LOG_ERROR("[Metrics] socket failed: " << std::strerror(errno));
+        return false;
+    }
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // 로컬에서만 (외부 노출 없음)
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(fd, 16) < 0)
+    {
+        LOG_ERROR("[Metrics] bind 127.0.0.1:" << port << " failed: " << std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    g_http_fd = fd;
+    g_http_running = true;
+    g_http = std::thread(http_loop);
+    LOG_INFO("[Metrics] listening 127.0.0.1:" << port << "/metrics");
+    return true;
+}
+
+void metrics_http_stop()
+{
+    if (!g_http_running.exchange(false))
+        return;
+    g_http.join();
+    ::close(g_http_fd);
+    g_http_fd = -1;
+}
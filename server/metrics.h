@@ -0,0 +1,57 @@
+// ============================================================================
+// 파일명: metrics.h
+// 목적: 서버 내부 지표 (큐 대기 / worker 처리 / DB 시간 / 전송량 / 세션 수)
+//
+// - 기록은 스레드별 shard 에만 (자기 shard 는 자기만 씀 → lock / RMW 없음)
+//   읽는 쪽(관리자 패킷 / 지표 포트)이 모든 shard 를 합산
+// - 지연 시간은 log-linear 히스토그램 (2의 거듭제곱 구간마다 8칸, 상대 오차 12.5% 이내, us 단위)
+//   → 평균이 아니라 p50 / p90 / p99 / max 를 볼 수 있음
+// - 패킷 type 별: 처리 시간 (worker 가 꺼낸 뒤 응답을 만들 때까지), DB 시간 (커넥션 대여 + statement)
+// - 단계별: reactor 루프 한 바퀴, g_req_q 대기, 응답 flush (write_buf 가 찬 뒤 비워질 때까지), 커넥션 대여
+// - gauge 는 읽을 때 콜백을 불러 현재 값 (세션 수, 큐 길이 등)
+// - 노출:
+//   PKT_ADMIN_STATS_REQ → metrics_snapshot_json()
+//   127.0.0.1:<port>/metrics → Prometheus 텍스트 (LOUD_METRICS_PORT, 0 이면 끔)
+//
+// 사용 예:
+//   metrics_observe_stage(METRIC_QUEUE_WAIT, waited_us);
+//   metrics_observe_request(type, handler_us, db_us);
+//   metrics_register_gauge("loud_sessions_active", "열린 클라이언트 소켓 수", [] { return ...; });
+//   curl -s 127.0.0.1:9112/metrics
+// ============================================================================
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <nlohmann/json.hpp>
+
+enum MetricStage
+{
+    METRIC_REACTOR_LOOP = 0, // epoll_wait 이 돌려준 이벤트를 처리한 시간 (대기 제외)
+    METRIC_QUEUE_WAIT,       // reactor 가 g_req_q 에 넣은 뒤 worker 가 꺼낼 때까지
+    METRIC_RESPONSE_FLUSH,   // write_buf 가 비어 있다가 찬 뒤 모두 보낼 때까지
+    METRIC_DB_ACQUIRE,       // 저장소 세션(커넥션) 대여 시간
+    METRIC_STAGE_COUNT
+};
+
+// 이 값 이상인 type 은 type 별 집계 없이 버림 (정의된 type 은 모두 이 아래)
+static constexpr int METRIC_MAX_TYPE = 0x60;
+
+void metrics_observe_stage(MetricStage stage, uint64_t us);
+void metrics_observe_request(int type, uint64_t handler_us, uint64_t db_us);
+void metrics_add_bytes_in(uint64_t n);
+void metrics_add_bytes_out(uint64_t n);
+
+// 읽을 때마다 read() 를 부름 (읽는 스레드에서, 짧게 끝나야 함)
+void metrics_register_gauge(const std::string &name, const std::string &help, std::function<double()> read);
+
+// 관리자 패킷용 요약 (단계별 / type 별 count, avg, p50, p90, p99, max)
+nlohmann::json metrics_snapshot_json();
+
+// Prometheus text exposition (version 0.0.4)
+std::string metrics_prometheus_text();
+
+// 127.0.0.1:port 에서 GET /metrics 응답 (port 0 이면 아무것도 안 함, 실패하면 false)
+bool metrics_http_start(int port);
+void metrics_http_stop();
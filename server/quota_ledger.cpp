@@ -0,0 +1,339 @@
+// ============================================================================
+// 파일명: quota_ledger.cpp
+// 목적: 사용량 장부 구현 (quota_ledger.h 설명 참고)
+// ============================================================================
+#include "quota_ledger.h"
+#include "logger.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static constexpr size_t QUOTA_SHARDS = 16;                    // 계정 맵 샤드 수
+static constexpr std::chrono::seconds UPLOAD_IDLE_TIMEOUT{120}; // 청크가 이만큼 안 오면 예약 해제
+
+namespace
+{
+struct Account
+{
+    std::atomic<int64_t> used{0};     // 확정 사용량
+    std::atomic<int64_t> reserved{0}; // 진행 중인 업로드 예약량
+    std::atomic<int64_t> pending{0};  // 아직 users.storage_used 에 반영 안 된 변경분
+};
+using AccountPtr = std::shared_ptr<Account>;
+
+struct Shard
+{
+    std::mutex m;
+    std::unordered_map<uint32_t, AccountPtr> accounts;
+};
+Shard g_shards[QUOTA_SHARDS];
+
+struct Reservation
+{
+    uint32_t uno = 0;
+    int64_t bytes = 0;   // 예약량
+    int64_t written = 0; // 지금까지 청크로 쓴 양
+    int sock = -1;
+    Clock::time_point last;
+    AccountPtr acc;
+};
+std::mutex g_resv_m;
+std::unordered_map<std::string, Reservation> g_resv; // abs_path -> 예약
+
+std::atomic<uint64_t> g_commits{0};
+std::atomic<uint64_t> g_aborts{0};
+std::atomic<uint64_t> g_flushes{0};
+std::atomic<uint64_t> g_flushed_rows{0};
+
+StorageBackend *g_backend = nullptr;
+std::atomic<bool> g_running{false};
+std::thread g_flusher;
+std::mutex g_flusher_m;
+std::condition_variable g_flusher_cv;
+
+Shard &shard_of(uint32_t uno) { return g_shards[uno % QUOTA_SHARDS]; }
+
+// 계정 조회 (처음이면 users.storage_used 로드). 실패 시 nullptr
+AccountPtr account(Storage &db, uint32_t uno)
+{
+    Shard &sh = shard_of(uno);
+    {
+        std::lock_guard<std::mutex> lk(sh.m);
+        auto it = sh.accounts.find(uno);
+        if (it != sh.accounts.end())
+            return it->second;
+    }
+
+    int64_t used = 0;
+    try
+    {
+        used = db.storage_used(uno);
+        if (used < 0)
+            return nullptr;
+    }
+    catch (const StorageError &e)
+    {
+        LOG_ERROR("[Quota] load failed user=" << uno << ": " << e.what());
+        return nullptr;
+    }
+
+    auto acc = std::make_shared<Account>();
+    acc->used = used;
+    if (db.is_replica())
+        return acc; // 복제본 값은 조회에만 쓰고 장부 기준값으로 삼지 않음
+
+    std::lock_guard<std::mutex> lk(sh.m);
+    auto res = sh.accounts.emplace(uno, acc); // 동시에 로드했으면 먼저 넣은 쪽 사용
+    return res.first->second;
+}
+
+// used 에서 bytes 차감 (0 아래로 내려가지 않음), 실제 차감량 반환
+int64_t debit_used(Account &acc, int64_t bytes)
+{
+    int64_t cur = acc.used.load();
+    int64_t next = 0;
+    do
+    {
+        next = cur > bytes ? cur - bytes : 0;
+    } while (!acc.used.compare_exchange_weak(cur, next));
+    return cur - next;
+}
+
+// 예약 해제 공통 (g_resv_m 잡은 상태에서 호출)
+void drop_reservation(std::unordered_map<std::string, Reservation>::iterator it, bool remove_file)
+{
+    it->second.acc->reserved -= it->second.bytes;
+    if (remove_file)
+    {
+        std::error_code ec;
+        fs::remove(it->first, ec); // 조각 파일 정리
+    }
+    g_aborts++;
+    g_resv.erase(it);
+}
+
+void sweep_idle_reservations()
+{
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lk(g_resv_m);
+    for (auto it = g_resv.begin(); it != g_resv.end();)
+    {
+        auto cur = it++;
+        if (now - cur->second.last > UPLOAD_IDLE_TIMEOUT)
+        {
+            LOG_INFO("[Quota] upload timed out user=" << cur->second.uno << " path=" << cur->first);
+            drop_reservation(cur, true);
+        }
+    }
+}
+
+// 모아둔 변경분을 한 트랜잭션으로 users.storage_used 에 반영
+void flush_pending()
+{
+    std::vector<std::pair<uint32_t, AccountPtr>> all;
+    for (auto &sh : g_shards)
+    {
+        std::lock_guard<std::mutex> lk(sh.m);
+        for (auto &kv : sh.accounts)
+            all.emplace_back(kv.first, kv.second);
+    }
+
+    std::vector<std::pair<AccountPtr, int64_t>> deltas;
+    std::vector<std::pair<uint32_t, int64_t>> rows; // (users.no, delta)
+    for (auto &a : all)
+    {
+        int64_t d = a.second->pending.exchange(0);
+        if (d != 0)
+        {
+            deltas.emplace_back(a.second, d);
+            rows.emplace_back(a.first, d);
+        }
+    }
+    if (deltas.empty())
+        return;
+
+    auto restore = [&] {
+        for (auto &d : deltas)
+            d.first->pending += d.second; // 다음 주기에 다시 시도
+    };
+
+    std::unique_ptr<Storage> db = g_backend->open();
+    if (!db)
+    {
+        restore();
+        return;
+    }
+
+    try
+    {
+        db->begin();
+        db->apply_storage_deltas(rows);
+        db->commit();
+        g_flushes++;
+        g_flushed_rows += rows.size();
+    }
+    catch (const StorageError &e)
+    {
+        LOG_ERROR("[Quota] flush failed: " << e.what());
+        try
+        {
+            db->rollback();
+        }
+        catch (...)
+        {
+        }
+        db->discard();
+        restore();
+    }
+}
+
+void flusher_loop(std::chrono::seconds interval)
+{
+    while (g_running.load())
+    {
+        {
+            std::unique_lock<std::mutex> lk(g_flusher_m);
+            g_flusher_cv.wait_for(lk, interval, [] { return !g_running.load(); });
+        }
+        sweep_idle_reservations();
+        flush_pending();
+    }
+    flush_pending(); // 종료 전 남은 변경분 반영
+}
+} // namespace
+
+int64_t quota_used(Storage &db, uint32_t uno)
+{
+    AccountPtr acc = account(db, uno);
+    return acc ? acc->used.load() : -1;
+}
+
+QuotaResult quota_reserve(Storage &db, uint32_t uno, int64_t limit, int64_t bytes,
+                          const std::string &key, int sock, int64_t *remaining_out)
+{
+    AccountPtr acc = account(db, uno);
+    if (!acc)
+        return QuotaResult::ERROR;
+
+    // used + reserved + bytes <= limit 이면 reserved 에 bytes 추가 (CAS, 락 없음)
+    int64_t r = acc->reserved.load();
+    do
+    {
+        int64_t remaining = limit - acc->used.load() - r;
+        if (remaining < 0)
+            remaining = 0;
+        if (remaining_out)
+            *remaining_out = remaining;
+        if (bytes > remaining)
+            return QuotaResult::EXCEEDED;
+    } while (!acc->reserved.compare_exchange_weak(r, r + bytes));
+
+    std::lock_guard<std::mutex> lk(g_resv_m);
+    if (g_resv.count(key))
+    {
+        acc->reserved -= bytes; // 같은 경로로 진행 중인 업로드가 있음 → 되돌림
+        return QuotaResult::BUSY;
+    }
+    g_resv.emplace(key, Reservation{uno, bytes, 0, sock, Clock::now(), acc});
+    return QuotaResult::OK;
+}
+
+QuotaWrite quota_touch(const std::string &key, int64_t bytes, bool first)
+{
+    std::lock_guard<std::mutex> lk(g_resv_m);
+    auto it = g_resv.find(key);
+    if (it == g_resv.end())
+        return QuotaWrite::NO_RESERVATION;
+    Reservation &r = it->second;
+    int64_t written = first ? 0 : r.written;
+    if (bytes < 0 || written + bytes > r.bytes)
+        return QuotaWrite::OVER_RESERVED;
+    r.written = written + bytes;
+    r.last = Clock::now();
+    return QuotaWrite::OK;
+}
+
+bool quota_commit(const std::string &key, int64_t bytes)
+{
+    AccountPtr acc;
+    {
+        std::lock_guard<std::mutex> lk(g_resv_m);
+        auto it = g_resv.find(key);
+        if (it == g_resv.end() || bytes < 0 || bytes > it->second.bytes)
+            return false; // 예약 안에서만 확정 (용량 검사는 예약 때 끝남)
+        acc = it->second.acc;
+        acc->used += bytes; // 먼저 더하고 예약을 빼야 순간적으로도 용량이 남아 보이지 않음
+        acc->reserved -= it->second.bytes;
+        g_resv.erase(it);
+    }
+    acc->pending += bytes;
+    g_commits++;
+    return true;
+}
+
+void quota_release(const std::string &key)
+{
+    std::lock_guard<std::mutex> lk(g_resv_m);
+    auto it = g_resv.find(key);
+    if (it != g_resv.end())
+        drop_reservation(it, false);
+}
+
+void quota_release_sock(int sock)
+{
+    std::lock_guard<std::mutex> lk(g_resv_m);
+    for (auto it = g_resv.begin(); it != g_resv.end();)
+    {
+        auto cur = it++;
+        if (cur->second.sock == sock)
+            drop_reservation(cur, true);
+    }
+}
+
+void quota_credit(Storage &db, uint32_t uno, int64_t bytes)
+{
+    AccountPtr acc = account(db, uno);
+    if (!acc)
+        return;
+    acc->pending -= debit_used(*acc, bytes);
+}
+
+void quota_ledger_start(StorageBackend &backend, std::chrono::seconds flush_interval)
+{
+    if (g_running.exchange(true))
+        return;
+    g_backend = &backend;
+    g_flusher = std::thread(flusher_loop, flush_interval);
+}
+
+void quota_ledger_stop()
+{
+    if (!g_running.exchange(false))
+        return;
+    g_flusher_cv.notify_all();
+    if (g_flusher.joinable())
+        g_flusher.join();
+}
+
+QuotaStats quota_ledger_stats()
+{
+    QuotaStats st;
+    {
+        std::lock_guard<std::mutex> lk(g_resv_m);
+        st.reservations = g_resv.size();
+    }
+    st.commits = g_commits.load();
+    st.aborts = g_aborts.load();
+    st.flushes = g_flushes.load();
+    st.flushed_rows = g_flushed_rows.load();
+    return st;
+}
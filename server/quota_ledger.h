@@ -0,0 +1,75 @@
+// ============================================================================
+// 파일명: quota_ledger.h
+// 목적: 유저별 클라우드 사용량 장부 (확정 사용량 + 업로드 예약량)
+//
+// - 유저별 used / reserved 를 atomic 으로 관리 → 용량 검사에 락/DB 조회 없음
+// - 업로드 시작(0x0020) 때 파일 크기만큼 예약, 마지막 청크 때 확정(used 로 이동)
+//   청크는 예약량을 넘겨 쓸 수 없고, 확정은 디스크에 실제로 쓴 크기로 (클라이언트가 보낸 크기 아님)
+// - 중간에 끊기거나(소켓 종료) 일정 시간 청크가 안 오면 예약 해제 + 조각 파일 삭제
+// - 삭제(0x0023)는 used 에서 차감
+// - users.storage_used 는 변경분(delta)을 모아 주기적으로 한 트랜잭션에 반영
+//   (업로드/삭제마다 UPDATE 하지 않음, 종료 시 남은 변경분 반영)
+// - 장부가 기준값. 유저를 처음 볼 때만 users.storage_used 를 읽어옴
+//
+// 예약 키는 서버 저장 경로(abs_path) — 업로드 요청과 청크가 같은 경로를 계산함
+// ============================================================================
+#pragma once
+
+#include "storage.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+enum class QuotaResult
+{
+    OK,       // 예약 성공
+    EXCEEDED, // 남은 용량 부족
+    BUSY,     // 같은 경로로 이미 업로드 중
+    ERROR     // 사용량 로드 실패 (DB)
+};
+
+enum class QuotaWrite
+{
+    OK,             // 써도 됨
+    NO_RESERVATION, // 예약 없음 (시간 초과 / 중단)
+    OVER_RESERVED   // 이 청크를 쓰면 예약량 초과
+};
+
+struct QuotaStats
+{
+    uint64_t reservations = 0;       // 현재 진행 중인 예약 수
+    uint64_t commits = 0;            // 확정된 업로드 수
+    uint64_t aborts = 0;             // 끊김/시간 초과로 해제된 예약 수
+    uint64_t flushes = 0;            // storage_used 반영 트랜잭션 수
+    uint64_t flushed_rows = 0;       // 반영한 UPDATE 수
+};
+
+// 확정 사용량 (처음이면 users.storage_used 로드, 실패 시 -1)
+int64_t quota_used(Storage &db, uint32_t uno);
+
+// limit 안에서 bytes 예약. remaining_out 에는 예약 전 남은 용량 기록
+QuotaResult quota_reserve(Storage &db, uint32_t uno, int64_t limit, int64_t bytes,
+                          const std::string &key, int sock, int64_t *remaining_out);
+
+// 청크를 디스크에 쓰기 전 호출 (시간 초과 연장 + 지금까지 쓴 양에 bytes 더함)
+// first 면 (첫 청크, 파일을 새로 씀) 쓴 양을 0 부터 다시 셈
+QuotaWrite quota_touch(const std::string &key, int64_t bytes, bool first);
+
+// 마지막 청크 저장 완료 → 디스크 크기 bytes 를 확정 사용량으로, 예약은 해제
+// 예약이 없거나 bytes 가 예약량보다 크면 아무것도 하지 않고 false (예약 해제 / 파일 정리는 호출자)
+bool quota_commit(const std::string &key, int64_t bytes);
+
+// 업로드 실패/중단 → 예약 해제 (조각 파일은 호출자가 정리)
+void quota_release(const std::string &key);
+
+// 소켓 종료 시 그 소켓의 예약 모두 해제 + 조각 파일 삭제
+void quota_release_sock(int sock);
+
+// 파일 삭제 → 사용량 차감
+void quota_credit(Storage &db, uint32_t uno, int64_t bytes);
+
+// 주기 반영 스레드 (main 에서 저장소 start 후 시작, worker join 후 정지 → 남은 변경분 반영)
+void quota_ledger_start(StorageBackend &backend, std::chrono::seconds flush_interval);
+void quota_ledger_stop();
+
+QuotaStats quota_ledger_stats();
@@ -0,0 +1,66 @@
+// ============================================================================
+// 파일명: request_context.h
+// 목적: 요청 하나를 처리하는 동안의 호출자 정보 (핸들러 공용 인자)
+//
+// - 로그인 / 토큰 인증 때 소켓별 SessionIdentity 를 세션 맵(g_socket_users)에 기록
+// - worker 가 요청마다 한 번 복사해서 RequestContext 를 만들고 모든 핸들러에 넘김
+//   → 핸들러는 세션 맵(g_login_m) / DB 로 "누가 보냈는지" 를 다시 찾지 않음
+//   → 클라이언트가 보낸 최상위 user_no 는 쓰지 않음 (세션의 user_no 만 신뢰)
+// - 묶음 요청 안에서 로그인 / 로그아웃이 있으면 다음 하위 요청 전에 다시 만듦
+// - 이메일 / 등급을 바꾸면 session_identity_update() 로 세션 맵과 토큰 표도 갱신
+//   (atomic 묶음 안이면 after_commit() 으로 commit 될 때까지 미룸)
+// - 계정을 정지하면 session_revoke_user() 로 그 유저의 세션과 토큰을 바로 폐기
+//
+// 사용 예 (핸들러):
+//   if (!ctx.logged_in) { ... VALUE_ERR_SESSION ... }
+//   db.list_files(ctx.user_no, prefix);
+// ============================================================================
+#pragma once
+
+#include "credential_pool.h" // PwResume
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class Storage;
+
+// 로그인 시점에 확정되는 세션 정보
+struct SessionIdentity
+{
+    uint32_t user_no = 0;
+    std::string email;
+    int grade = 0;
+    std::string token; // 로그인 응답으로 준 세션 토큰 (토큰 인증 소켓이면 그 토큰)
+};
+
+struct RequestContext
+{
+    int sock = -1;          // 요청이 들어온 소켓
+    bool logged_in = false; // 세션이 있으면 true (아래 값은 logged_in 일 때만 의미 있음)
+    uint32_t user_no = 0;
+    std::string email;
+    int grade = 0;
+    std::string token;
+
+    // 요청을 처음부터 다시 큐에 넣는 콜백을 만듦 (credential_pool 이 풀에 넣을 때만 호출)
+    // 이미 한 번 다시 들어온 요청 / 묶음 요청의 하위 요청이면 비어 있음
+    PwResume resume;
+
+    // 관리자 계정 (users.no 1~4, 클라이언트 관리자 메뉴와 같은 기준)
+    bool is_admin() const { return logged_in && user_no >= 1 && user_no <= 4; }
+};
+
+// 세션 맵에서 sock 의 정보를 복사해 만듦 (skeleton_server.cpp)
+RequestContext request_context_for(int sock);
+
+// 이메일 / 등급 변경 후 그 유저의 세션 맵 항목과 세션 토큰 갱신 (skeleton_server.cpp)
+void session_identity_update(uint32_t user_no, const std::string &email, int grade);
+
+// 계정 정지 후 그 유저의 세션 맵 항목 (로그인 소켓 / 토큰 소켓) 과 세션 토큰 모두 폐기 (skeleton_server.cpp)
+void session_revoke_user(const std::string &email);
+
+// DB 변경이 확정된 뒤에 할 일 (캐시 무효화 / 세션 맵 갱신 등, skeleton_server.cpp)
+// - db 가 atomic 묶음 트랜잭션 안이면 commit 때 실행, rollback 이면 버림
+// - 트랜잭션 밖이면 (변경이 이미 확정됐으므로) 바로 실행
+void after_commit(Storage &db, std::function<void()> fn);
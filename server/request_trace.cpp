@@ -0,0 +1,87 @@
+// ============================================================================
+// 파일명: request_trace.cpp
+// 목적: 느린 요청 로그 구현 (request_trace.h 설명 참고)
+// ============================================================================
+#include "request_trace.h"
+#include "logger.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+static constexpr uint64_t SLOW_REQUEST_MS = 500;     // 기본 느린 요청 기준
+static constexpr uint64_t TRACE_SAMPLE_EVERY = 1000; // 기본 표본 간격
+
+namespace
+{
+std::atomic<uint64_t> g_slow_us{SLOW_REQUEST_MS * 1000};
+std::atomic<uint64_t> g_sample_every{TRACE_SAMPLE_EVERY};
+
+std::atomic<uint64_t> g_finished{0};
+std::atomic<uint64_t> g_slow{0};
+std::atomic<uint64_t> g_sampled{0};
+
+// 두 시각 사이 (us). 어느 한쪽이라도 안 찍혔으면 0
+uint64_t span_us(RequestTrace::Clock::time_point from, RequestTrace::Clock::time_point to)
+{
+    if (from == RequestTrace::Clock::time_point{} || to == RequestTrace::Clock::time_point{} || to < from)
+        return 0;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+}
+
+// "type=0x0011 fd=12 total_us=.. queue=.. worker=.. db=.. resp_q=.. flush=.."
+std::string breakdown(const RequestTrace &t, uint64_t total_us)
+{
+    uint64_t db = span_us(t.db_start, t.db_end);
+    // worker: 꺼낸 뒤 응답을 넣을 때까지 중 DB 를 뺀 나머지 (파싱, 핸들러 로직, 청크 디스크 쓰기 등)
+    uint64_t handled = span_us(t.dequeued, t.enqueued);
+    uint64_t worker = handled > db ? handled - db : 0;
+
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "type=0x%04x fd=%d total_us=%llu queue=%llu worker=%llu db=%llu resp_q=%llu flush=%llu%s",
+                  t.type, t.sock, static_cast<unsigned long long>(total_us),
+                  static_cast<unsigned long long>(span_us(t.framed, t.dequeued)),
+                  static_cast<unsigned long long>(worker), static_cast<unsigned long long>(db),
+                  static_cast<unsigned long long>(span_us(t.enqueued, t.appended)),
+                  static_cast<unsigned long long>(span_us(t.appended, t.flushed)), t.resumed ? " resumed" : "");
+    return buf;
+}
+} // namespace
+
+void request_trace_init()
+{
+    if (const char *v = std::getenv("LOUD_SLOW_MS"))
+        g_slow_us = std::strtoull(v, nullptr, 10) * 1000;
+    if (const char *v = std::getenv("LOUD_TRACE_SAMPLE"))
+        g_sample_every = std::strtoull(v, nullptr, 10);
+}
+
+void request_trace_finish(const RequestTrace &trace)
+{
+    uint64_t n = ++g_finished;
+    uint64_t total_us = span_us(trace.framed, trace.flushed);
+    if (total_us >= g_slow_us.load(std::memory_order_relaxed))
+    {
+        g_slow++;
+        LOG_WARN("[Slow] " << breakdown(trace, total_us));
+        return;
+    }
+    uint64_t every = g_sample_every.load(std::memory_order_relaxed);
+    if (every > 0 && n % every == 0)
+    {
+        g_sampled++;
+        LOG_INFO("[Trace] " << breakdown(trace, total_us));
+    }
+}
+
+RequestTraceStats request_trace_stats()
+{
+    RequestTraceStats st;
+    st.finished = g_finished.load();
+    st.slow = g_slow.load();
+    st.sampled = g_sampled.load();
+    st.slow_ms = g_slow_us.load() / 1000;
+    return st;
+}
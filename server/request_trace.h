@@ -0,0 +1,60 @@
+// ============================================================================
+// 파일명: request_trace.h
+// 목적: 요청 하나가 단계마다 보낸 시간 기록 + 느린 요청 로그
+//
+// - Task 에 RequestTrace 를 붙여 다니며 단계마다 steady_clock 시각을 찍음
+//     framed   reactor 가 프레임을 다 받아 g_req_q 에 넣음
+//     dequeued worker 가 꺼냄
+//     db_*     저장소 세션 대여 시작 / 핸들러가 끝나 반납
+//     enqueued 응답 큐(g_res_q)에 넣음
+//     appended reactor 가 write_buf 에 붙임
+//     flushed  응답 마지막 바이트를 소켓에 씀
+// - flushed 를 찍을 때 request_trace_finish() → 전체 시간이 기준 이상이면 [Slow] 로그,
+//   아니면 N 건에 한 건만 [Trace] 로그 (평소 분포 확인용)
+// - 응답을 다른 스레드가 나중에 보내는 요청 (long poll 등) 은 기록 안 함
+// - 설정 (환경변수):
+//     LOUD_SLOW_MS        느린 요청 기준 (ms, 기본 500)
+//     LOUD_TRACE_SAMPLE   평소 요청 N 건에 한 건 로그 (기본 1000, 0 이면 안 남김)
+//
+// 사용 예:
+//   task.trace.dequeued = RequestTrace::Clock::now();
+//   ...
+//   trace.flushed = RequestTrace::Clock::now();
+//   request_trace_finish(trace);
+// ============================================================================
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+struct RequestTrace
+{
+    using Clock = std::chrono::steady_clock;
+
+    int type = 0;
+    int sock = -1;
+    bool resumed = false; // 비밀번호 해시 계산 후 다시 들어온 요청 (framed 는 처음 받은 시각)
+    Clock::time_point framed = Clock::now();
+    Clock::time_point dequeued;
+    Clock::time_point db_start;
+    Clock::time_point db_end;
+    Clock::time_point enqueued;
+    Clock::time_point appended;
+    Clock::time_point flushed;
+};
+
+struct RequestTraceStats
+{
+    uint64_t finished = 0; // flushed 까지 기록된 요청 수
+    uint64_t slow = 0;     // 기준 이상 ([Slow] 로그)
+    uint64_t sampled = 0;  // 표본 ([Trace] 로그)
+    uint64_t slow_ms = 0;  // 현재 기준
+};
+
+// main 시작 때 (환경변수 읽기)
+void request_trace_init();
+
+// 응답을 다 보낸 요청 (reactor 스레드)
+void request_trace_finish(const RequestTrace &trace);
+
+RequestTraceStats request_trace_stats();
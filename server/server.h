@@ -18,6 +18,8 @@
 #include <regex>
 #include <cstdlib>
 #include <ctime>
+#include <unordered_map>
+#include "request_context.h"
 
 #ifndef SERVER_H
 #define SERVER_H
@@ -33,14 +35,14 @@ struct PendingInfo //  대기중인 가입 정보 구조체
     std::string code;     // 인증번호
     time_t created_at;    // 생성 시간 (만료 체크용, 선택사항)
     time_t timestamp;
+    uint64_t outbox_id = 0; // 인증 메일의 outbox 기록 (이 정보도 meta 로 같이 남김, 지울 때 email_forget)
 };
 
 static std::map<std::string, PendingInfo> g_pending_map; // Key: Email
 static std::mutex g_pending_m;                           // Mutex
 extern std::unordered_map<std::string, int> g_login_users;
-extern std::unordered_map<int, std::string> g_socket_users;
+extern std::unordered_map<int, SessionIdentity> g_socket_users;
 extern std::mutex g_login_m;
-extern thread_local int g_current_sock;
 
 // [유틸] 이메일 유효성 검사
 static bool isValidEmail(const std::string &email)
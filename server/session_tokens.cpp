@@ -0,0 +1,171 @@
+// ============================================================================
+// 파일명: session_tokens.cpp
+// 목적: 세션 토큰 표 구현 (session_tokens.h 설명 참고)
+// ============================================================================
+#include "session_tokens.h"
+
+#include <openssl/rand.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr size_t SESSION_TOKEN_SHARDS = 16;              // 샤드 수
+static constexpr size_t SESSION_TOKEN_BYTES = 32;               // 난수 바이트 수 (hex 64자)
+static constexpr std::chrono::minutes SESSION_TOKEN_IDLE{30};   // 안 쓰이면 만료되는 시간
+
+namespace
+{
+struct Entry
+{
+    TokenSession session;
+    Clock::time_point expires;
+};
+
+struct Shard
+{
+    std::mutex m;
+    std::unordered_map<std::string, Entry> by_token;
+};
+
+Shard g_shards[SESSION_TOKEN_SHARDS];
+
+std::atomic<uint64_t> g_issued{0};
+std::atomic<uint64_t> g_hits{0};
+std::atomic<uint64_t> g_misses{0};
+std::atomic<uint64_t> g_revoked{0};
+
+Shard &shard_of(const std::string &token) { return g_shards[std::hash<std::string>{}(token) % SESSION_TOKEN_SHARDS]; }
+
+std::string to_hex(const unsigned char *p, size_t n)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string s;
+    s.reserve(n * 2);
+    for (size_t i = 0; i < n; ++i)
+    {
+        s += digits[p[i] >> 4];
+        s += digits[p[i] & 0x0f];
+    }
+    return s;
+}
+} // namespace
+
+std::string session_token_issue(const std::string &email, uint32_t user_no, int grade)
+{
+    unsigned char buf[SESSION_TOKEN_BYTES];
+    if (RAND_bytes(buf, sizeof(buf)) != 1)
+        return "";
+    std::string token = to_hex(buf, sizeof(buf));
+
+    Shard &sh = shard_of(token);
+    std::lock_guard<std::mutex> lk(sh.m);
+    sh.by_token[token] = Entry{TokenSession{email, user_no, grade}, Clock::now() + SESSION_TOKEN_IDLE};
+    g_issued++;
+    return token;
+}
+
+bool session_token_check(const std::string &token, TokenSession &out)
+{
+    if (token.size() != SESSION_TOKEN_BYTES * 2)
+    {
+        g_misses++;
+        return false;
+    }
+
+    Shard &sh = shard_of(token);
+    std::lock_guard<std::mutex> lk(sh.m);
+    auto it = sh.by_token.find(token);
+    if (it == sh.by_token.end())
+    {
+        g_misses++;
+        return false;
+    }
+    Clock::time_point now = Clock::now();
+    if (now > it->second.expires)
+    {
+        sh.by_token.erase(it);
+        g_revoked++;
+        g_misses++;
+        return false;
+    }
+    it->second.expires = now + SESSION_TOKEN_IDLE;
+    out = it->second.session;
+    g_hits++;
+    return true;
+}
+
+void session_token_update_user(uint32_t user_no, const std::string &email, int grade)
+{
+    for (auto &sh : g_shards)
+    {
+        std::lock_guard<std::mutex> lk(sh.m);
+        for (auto &kv : sh.by_token)
+        {
+            if (kv.second.session.user_no != user_no)
+                continue;
+            kv.second.session.email = email;
+            kv.second.session.grade = grade;
+        }
+    }
+}
+
+void session_token_revoke_email(const std::string &email)
+{
+    for (auto &sh : g_shards)
+    {
+        std::lock_guard<std::mutex> lk(sh.m);
+        for (auto it = sh.by_token.begin(); it != sh.by_token.end();)
+        {
+            if (it->second.session.email == email)
+            {
+                it = sh.by_token.erase(it);
+                g_revoked++;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+}
+
+void session_token_sweep()
+{
+    Clock::time_point now = Clock::now();
+    for (auto &sh : g_shards)
+    {
+        std::lock_guard<std::mutex> lk(sh.m);
+        for (auto it = sh.by_token.begin(); it != sh.by_token.end();)
+        {
+            if (now > it->second.expires)
+            {
+                it = sh.by_token.erase(it);
+                g_revoked++;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+}
+
+SessionTokenStats session_token_stats()
+{
+    SessionTokenStats st;
+    st.issued = g_issued.load();
+    st.hits = g_hits.load();
+    st.misses = g_misses.load();
+    st.revoked = g_revoked.load();
+    for (auto &sh : g_shards)
+    {
+        std::lock_guard<std::mutex> lk(sh.m);
+        st.live += sh.by_token.size();
+    }
+    return st;
+}
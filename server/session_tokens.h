@@ -0,0 +1,53 @@
+// ============================================================================
+// 파일명: session_tokens.h
+// 목적: 로그인 시 발급하는 세션 토큰 표 (메모리, 샤딩)
+//
+// - 로그인 성공 응답에 token(불투명 문자열, OpenSSL RAND_bytes 32바이트 hex) 포함
+// - 클라이언트는 모든 소켓(메인 / 폴링 / 업로드 / 다운로드)의 요청 최상위에 "token" 을 붙임
+//   → worker 가 해시 조회 한 번으로 그 소켓을 토큰 주인 세션에 묶음 (DB / pw_hash 비교 없음)
+// - 조회할 때마다 만료 시각 연장 (SESSION_TOKEN_IDLE 동안 안 쓰이면 만료)
+// - 로그아웃(로그인 소켓 종료) / 계정 정지 시 그 유저 토큰 모두 폐기
+// - 서버 재시작 시 모두 사라짐 (클라이언트는 다시 로그인)
+//
+// 사용 예:
+//   std::string token = session_token_issue(email, user_no, grade);   // 로그인 성공 시
+//   TokenSession ts;
+//   if (session_token_check(req.value("token", ""), ts)) { ... ts.email ... }
+// ============================================================================
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct TokenSession
+{
+    std::string email;
+    uint32_t user_no = 0;
+    int grade = 0;
+};
+
+struct SessionTokenStats
+{
+    uint64_t issued = 0;  // 발급 수
+    uint64_t hits = 0;    // 유효한 토큰 조회
+    uint64_t misses = 0;  // 없거나 만료된 토큰 조회
+    uint64_t revoked = 0; // 폐기 / 만료 정리된 수
+    size_t live = 0;      // 현재 유효한 토큰 수
+};
+
+// 새 토큰 발급 (난수 생성 실패 시 빈 문자열 → 토큰 없이 로그인 소켓만 사용)
+std::string session_token_issue(const std::string &email, uint32_t user_no, int grade);
+
+// 유효하면 true + out 채움 (만료 시각 연장)
+bool session_token_check(const std::string &token, TokenSession &out);
+
+// 그 유저(user_no) 토큰의 email / grade 갱신 (설정에서 이메일 / 등급 변경 시)
+void session_token_update_user(uint32_t user_no, const std::string &email, int grade);
+
+// 그 유저의 토큰 모두 폐기
+void session_token_revoke_email(const std::string &email);
+
+// 만료된 토큰 정리 (main 루프에서 주기적으로 호출)
+void session_token_sweep();
+
+SessionTokenStats session_token_stats();
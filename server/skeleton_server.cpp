@@ -11,11 +11,18 @@
 #include <unordered_map>       // 세션 맵 사용
 #include <unordered_set>       // 스트리밍 소켓 집합
 #include <queue>               // 큐 사용
+#include <deque>               // 세션별 응답 추적 목록
+#include <optional>            // 응답에 붙는 요청 추적
+#include <memory>              // 해시 계산으로 미룬 요청 상태 (shared_ptr)
 #include <mutex>               // mutex 사용
 #include <condition_variable>  // condition_variable 사용
 #include <thread>              // thread 사용
 #include <atomic>              // atomic 사용
+#include <chrono>              // 처리 시간 측정
+#include <sstream>             // 여러 줄 통계 로그
 #include <cstring>             // memset, memcpy 사용
+#include <cstdint>             // INT32_MIN / INT32_MAX
+#include <cstdlib>             // getenv, atoi 사용
 #include <cerrno>              // errno 사용
 #include <csignal>             // signal 사용
 #include <unistd.h>            // close, read, write 사용
@@ -26,7 +33,6 @@
 #include <sys/epoll.h>         // epoll
 #include <sys/eventfd.h>       // eventfd
 #include <nlohmann/json.hpp>   // JSON 라이브러리 사용
-#include <mariadb/conncpp.hpp> // MariaDB C++ Connector 사용
 #include <curl/curl.h>         // libcurl 헤더(이메일)
 #include <ctime>               // time() 함수 사용을 위해 필요
 #include "server.h"
@@ -36,6 +42,20 @@
 #include "profile_handler.hpp"
 #include "blacklisthandler.hpp"
 #include "admin_handler.hpp"
+#include "storage.h"
+#include "stmt_cache.h" // 요청별 DB 왕복 계측 (mariadb 백엔드)
+#include "user_cache.h"
+#include "blacklist_cache.h"
+#include "grade_table.h"
+#include "quota_ledger.h"
+#include "message_writer.h"
+#include "unread_counter.h"
+#include "session_tokens.h"
+#include "login_limiter.h"
+#include "credential_pool.h"
+#include "logger.h"
+#include "metrics.h"
+#include "request_trace.h"
 
 extern "C"
 {                   // C 모듈을 C 링크로 사용
@@ -51,9 +71,17 @@ static constexpr int EPOLL_MAX_EVENTS = 128;             // epoll 이벤트 배
 static constexpr int MAX_PACKET_SIZE = 10 * 1024 * 1024; // 최대 패킷 크기 제한(10MB)
 static constexpr int DEFAULT_PORT = 5012;                // 기본 포트
 static constexpr int LISTEN_BACKLOG = 64;                // listen backlog
+static constexpr size_t DB_POOL_SIZE = 4;                // DB 커넥션 풀 크기 (worker 수와 별개)
+static constexpr int POOL_STATS_INTERVAL = 60;           // 커넥션 풀 통계 로그 주기(초)
+static constexpr int GRADE_RELOAD_INTERVAL = 300;        // grades 스냅샷 재로딩 주기(초), SIGHUP 시 즉시
+static constexpr int QUOTA_FLUSH_INTERVAL = 5;           // 사용량 변경분 DB 반영 주기(초)
+static constexpr size_t MSG_WRITER_MAX_ROWS = 64;        // 메시지 INSERT 묶음 최대 행 수
+static constexpr int MSG_WRITER_MAX_DELAY_MS = 2;        // 첫 메시지 후 묶음을 모으는 최대 시간(ms)
+static constexpr size_t CRED_POOL_THREADS = 2;           // 비밀번호 해싱 전용 스레드 수
+static constexpr size_t CRED_POOL_QUEUE_MAX = 256;       // 해싱 대기 최대 개수 (넘으면 잠시 후 재시도 응답)
+static constexpr int METRICS_PORT = 9112;                // 지표(Prometheus) 포트, 127.0.0.1 만 (LOUD_METRICS_PORT, 0 이면 끔)
 // [추가] Worker가 Main을 깨우기 위해 사용할 전역 파일 디스크립터
 int g_wake_fd = -1;
-thread_local int g_current_sock = -1; // 워커 스레드별 현재 처리 소켓 저장
 // 전역 맵과 뮤텍스 정의
 
 // 세션 구조체: epoll 스레드에서만 접근/수정하는 것을 기본 원칙으로 둠
@@ -67,6 +95,11 @@ struct Session
     uint16_t peer_port = 0; // 클라이언트 포트
     std::string write_buf;  // 전송 대기 버퍼
     std::string read_buf;
+    uint64_t conn_id = 0;   // 접속 번호 (fd 재사용과 구분)
+    std::chrono::steady_clock::time_point flush_since; // write_buf 가 비어 있다가 찬 시각 (flush 시간 지표)
+    uint64_t out_queued = 0; // write_buf 에 붙인 바이트 누계
+    uint64_t out_sent = 0;   // 소켓에 쓴 바이트 누계
+    std::deque<std::pair<uint64_t, RequestTrace>> traces; // (응답 끝 위치 누계, 추적) → out_sent 가 넘으면 완료
 }; // 세션 구조체 끝
 
 // ============================================================================
@@ -77,12 +110,17 @@ struct Task
 {                        // 작업 요청 구조체 시작
     int sock = -1;       // 요청이 온 소켓
     std::string payload; // JSON 문자열 payload
+    uint64_t conn_id = 0; // 요청이 온 접속 번호
+    bool resumed = false; // 비밀번호 해시 계산 후 다시 들어온 요청
+    std::chrono::steady_clock::time_point queued_at = std::chrono::steady_clock::now(); // 큐 대기 시간 지표
+    RequestTrace trace;   // 단계별 시각 (느린 요청 로그)
 }; // 작업 요청 구조체 끝
 
 struct ResponseTask
 {                        // 응답 작업 구조체 시작
     int sock = -1;       // 응답 보낼 소켓
     std::string payload; // JSON 문자열 payload
+    std::optional<RequestTrace> trace; // worker 가 처리한 요청의 최종 응답이면 있음
 }; // 응답 작업 구조체 끝
 
 // ============================================================================
@@ -97,12 +135,49 @@ static std::condition_variable g_req_cv;  // worker를 깨우는 CV
 static std::atomic<bool> g_running(true); // 서버 실행 플래그(원자)
 // [추가] 접속 중인 유저 관리 (중복 로그인 방지용)
 std::unordered_map<std::string, int> g_login_users;  // Email -> Socket
-std::unordered_map<int, std::string> g_socket_users; // Socket -> Email (연결 종료 시 빠른 삭제용)
+std::unordered_map<int, SessionIdentity> g_socket_users; // Socket -> 세션 정보 (요청마다 RequestContext 로 복사)
 std::mutex g_login_m;                                // 위 맵들을 보호할 Mutex
 // [추가] 로그인 실패 횟수 관리
 std::map<std::string, int> g_fail_counts; // 이메일 -> 실패횟수
 std::mutex g_fail_m;                      // 실패횟수 맵 보호용
 
+// 접속 번호: 해시 계산 동안 소켓이 닫히고 같은 fd 로 새 접속이 오면
+// 다시 들어온 요청(로그인 등)이 새 접속에 적용되지 않도록 확인
+static std::mutex g_conn_m;
+static std::unordered_map<int, uint64_t> g_conn_ids; // fd -> 접속 번호 (accept 때 부여, close 때 제거)
+static uint64_t g_conn_seq = 0;
+
+static uint64_t conn_open(int fd)
+{
+    std::lock_guard<std::mutex> lk(g_conn_m);
+    return g_conn_ids[fd] = ++g_conn_seq;
+}
+
+static void conn_close(int fd)
+{
+    std::lock_guard<std::mutex> lk(g_conn_m);
+    g_conn_ids.erase(fd);
+}
+
+static bool conn_alive(int fd, uint64_t conn_id)
+{
+    std::lock_guard<std::mutex> lk(g_conn_m);
+    auto it = g_conn_ids.find(fd);
+    return it != g_conn_ids.end() && it->second == conn_id;
+}
+
+// 패킷 type 별 DB 왕복 누적 (statement 캐시 효과 측정용, 풀 통계와 함께 로그)
+// LOUD_STMT_CACHE=0 으로 띄운 서버와 비교하면 캐시 전/후 왕복 수 차이를 볼 수 있음
+struct TypeRoundTrips
+{
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> prepares{0};
+    std::atomic<uint64_t> executes{0};
+    std::atomic<uint64_t> round_trips{0}; // 서버 prepare + 실행 + 트랜잭션 제어 (stmt_cache.h 참고)
+};
+static constexpr int MAX_PACKET_TYPE = 0x100;
+static TypeRoundTrips g_type_rt[MAX_PACKET_TYPE];
+
 // 다운로드 스트리밍 중인 소켓 집합
 // worker가 직접 packet_send로 청크를 보내는 동안
 // epoll 메인 스레드가 같은 소켓에 write_buf를 flush하는 경쟁을 막음
@@ -144,6 +219,41 @@ static void safe_close(int fd)
     }
 } // 함수 끝
 
+// ============================================================================
+// 유틸: outbox 에 남아 있던 가입 대기 정보 복원 (email_init 이 재시작 때 호출)
+// - meta 는 handle_auth_signup_req 가 인증 메일과 함께 남긴 JSON
+// - 같은 이메일이 여러 번 남아 있으면 가장 최근 것만 (나머지 기록은 삭제)
+// ============================================================================
+static void restore_pending_signup(const std::string &meta, uint64_t outbox_id)
+{
+    json m = json::parse(meta, nullptr, false);
+    if (!m.is_object() || m.value("email", "").empty())
+    {
+        email_forget(outbox_id);
+        return;
+    }
+    PendingInfo info;
+    info.pw = m.value("pw", "");
+    info.nickname = m.value("nickname", "");
+    info.code = m.value("code", "");
+    info.timestamp = static_cast<time_t>(m.value("timestamp", static_cast<int64_t>(0)));
+    info.created_at = info.timestamp;
+    info.outbox_id = outbox_id;
+
+    std::lock_guard<std::mutex> lock(g_pending_m);
+    auto it = g_pending_map.find(m.value("email", ""));
+    if (it != g_pending_map.end())
+    {
+        if (it->second.timestamp > info.timestamp)
+        {
+            email_forget(outbox_id);
+            return;
+        }
+        email_forget(it->second.outbox_id);
+    }
+    g_pending_map[m.value("email", "")] = info;
+}
+
 // ============================================================================
 // 유틸: 만료된 인증정보 처리 (메모리 누수 해결)
 // ============================================================================
@@ -162,7 +272,8 @@ static void cleanup_pending_map()
 
         if (diff > 90)
         { // 90초를 넘기면 삭제
-            std::cout << ">> [삭제됨] 인증시간 만료로 삭제: " << it->first << std::endl;
+            LOG_INFO(">> [삭제됨] 인증시간 만료로 삭제: " << it->first);
+            email_forget(it->second.outbox_id); // 재시작해도 되살리지 않음
             it = g_pending_map.erase(it);
         }
         else
@@ -173,35 +284,168 @@ static void cleanup_pending_map()
 }
 
 // 중복 로그인 방지용:유저 로그인 등록 (성공 시 true, 중복이면 false 반환)
-static bool try_login_register(int sock, const std::string &email)
+static bool try_login_register(int sock, SessionIdentity id)
 {
     std::lock_guard<std::mutex> lock(g_login_m);
 
     // 이미 접속 중인 이메일인지 확인
-    if (g_login_users.find(email) != g_login_users.end())
+    if (g_login_users.find(id.email) != g_login_users.end())
     {
         return false; // 중복 로그인
     }
 
     // 맵에 등록
-    g_login_users[email] = sock;
-    g_socket_users[sock] = email;
+    g_login_users[id.email] = sock;
+    g_socket_users[sock] = std::move(id);
     return true;
 }
 
 // 중복 로그인 방지용:유저 로그아웃 처리 (연결 종료 시 호출)
+// - 토큰으로 묶인 보조 소켓(폴링/업로드/다운로드)이면 그 소켓 세션만 해제
+// - 로그인 소켓이면 같은 유저의 보조 소켓 세션과 발급한 토큰도 모두 폐기
 static void logout_unregister(int sock)
 {
-    std::lock_guard<std::mutex> lock(g_login_m);
+    std::string email;
+    {
+        std::lock_guard<std::mutex> lock(g_login_m);
+
+        auto it = g_socket_users.find(sock);
+        if (it == g_socket_users.end())
+            return;
+        email = it->second.email;
+        g_socket_users.erase(it); // 소켓 맵에서 삭제
+
+        auto lu = g_login_users.find(email);
+        if (lu == g_login_users.end() || lu->second != sock)
+            return; // 보조 소켓
+        g_login_users.erase(lu); // 이메일 맵에서 삭제
+
+        for (auto s = g_socket_users.begin(); s != g_socket_users.end();)
+        {
+            if (s->second.email == email)
+                s = g_socket_users.erase(s);
+            else
+                ++s;
+        }
+        LOG_INFO("[Info] User " << email << " 로그아웃 (socket " << sock << " closed).");
+    }
+    session_token_revoke_email(email);
+}
+
+// 요청 최상위 "token" 으로 이 소켓을 토큰 주인 세션에 묶음 (해시 조회 한 번, DB 없음)
+// - 로그인 소켓이면 그대로 (토큰 만료 시각만 연장)
+// - 토큰이 무효(폐기 / 만료)면 보조 소켓 세션 해제 → 핸들러가 세션 오류로 응답
+static void attach_token_session(int sock, const json &req)
+{
+    auto tok = req.find("token");
+    if (tok == req.end() || !tok->is_string())
+        return;
+
+    const std::string &token = tok->get_ref<const std::string &>();
+    TokenSession ts;
+    bool ok = session_token_check(token, ts);
 
+    std::lock_guard<std::mutex> lock(g_login_m);
     auto it = g_socket_users.find(sock);
     if (it != g_socket_users.end())
     {
-        std::string email = it->second;
-        g_login_users.erase(email); // 이메일 맵에서 삭제
-        g_socket_users.erase(it);   // 소켓 맵에서 삭제
-        std::cout << "[Info] User " << email << " 로그아웃 (socket " << sock << " closed).\n";
+        auto lu = g_login_users.find(it->second.email);
+        if (lu != g_login_users.end() && lu->second == sock)
+            return; // 로그인 소켓
+        if (!ok)
+        {
+            g_socket_users.erase(it);
+            return;
+        }
     }
+    if (ok)
+        g_socket_users[sock] = SessionIdentity{ts.user_no, ts.email, ts.grade, token};
+}
+
+// 세션 맵에서 이 소켓의 정보를 한 번 복사 (요청마다 worker 가 호출, DB 없음)
+RequestContext request_context_for(int sock)
+{
+    RequestContext ctx;
+    ctx.sock = sock;
+
+    std::lock_guard<std::mutex> lock(g_login_m);
+    auto it = g_socket_users.find(sock);
+    if (it == g_socket_users.end())
+        return ctx;
+    ctx.logged_in = true;
+    ctx.user_no = it->second.user_no;
+    ctx.email = it->second.email;
+    ctx.grade = it->second.grade;
+    ctx.token = it->second.token;
+    return ctx;
+}
+
+// 설정에서 이메일 / 등급을 바꾼 뒤 호출 → 그 유저의 모든 소켓 세션과 토큰에 반영
+// (로그인 소켓이면 중복 로그인 맵의 키도 새 이메일로)
+void session_identity_update(uint32_t user_no, const std::string &email, int grade)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_login_m);
+        for (auto &kv : g_socket_users)
+        {
+            SessionIdentity &id = kv.second;
+            if (id.user_no != user_no)
+                continue;
+            if (id.email != email)
+            {
+                auto lu = g_login_users.find(id.email);
+                if (lu != g_login_users.end() && lu->second == kv.first)
+                {
+                    g_login_users.erase(lu);
+                    g_login_users[email] = kv.first;
+                }
+                id.email = email;
+            }
+            id.grade = grade;
+        }
+    }
+    session_token_update_user(user_no, email, grade);
+}
+
+// 계정 정지 후 호출 → 로그아웃과 같은 정리 (소켓은 열어 둠, 다음 요청부터 세션 오류)
+// 토큰 조회가 만료를 연장하므로 폐기하지 않으면 폴링 소켓이 정지 뒤에도 계속 인증됨
+void session_revoke_user(const std::string &email)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_login_m);
+        g_login_users.erase(email);
+        for (auto s = g_socket_users.begin(); s != g_socket_users.end();)
+        {
+            if (s->second.email == email)
+                s = g_socket_users.erase(s);
+            else
+                ++s;
+        }
+    }
+    session_token_revoke_email(email);
+    LOG_INFO("[Info] User " << email << " 세션 폐기 (계정 정지).");
+}
+
+// atomic 묶음 트랜잭션이 끝날 때 실행할 일 (handle_batch 가 commit 이면 실행, rollback 이면 버림)
+static thread_local std::vector<std::function<void()>> t_after_commit;
+
+void after_commit(Storage &db, std::function<void()> fn)
+{
+    if (db.in_transaction())
+        t_after_commit.push_back(std::move(fn));
+    else
+        fn();
+}
+
+// 보류해 둔 일 실행 / 폐기 (unread_counter_txn_end 와 같은 자리에서 호출)
+static void after_commit_txn_end(bool committed)
+{
+    std::vector<std::function<void()>> pending;
+    pending.swap(t_after_commit);
+    if (!committed)
+        return;
+    for (auto &fn : pending)
+        fn();
 }
 
 // // ============================================================================
@@ -210,7 +454,7 @@ static void logout_unregister(int sock)
 // // ============================================================================
 
 // [핸들러] 1단계: 회원가입 요청 (인증번호 발송)
-static std::string handle_auth_signup_req(const json &req, sql::Connection &db)
+static std::string handle_auth_signup_req(const RequestContext &ctx, const json &req, Storage &db)
 {
     json payload;
     try
@@ -244,30 +488,24 @@ static std::string handle_auth_signup_req(const json &req, sql::Connection &db)
     try
     {
         // 이메일 중복 확인
-        std::unique_ptr<sql::PreparedStatement> st(db.prepareStatement("SELECT 1 FROM users WHERE email = ?"));
-        st->setString(1, email);
-        std::unique_ptr<sql::ResultSet> res(st->executeQuery());
-        if (res->next())
+        if (db.email_exists(email))
         {
             return make_resp(PKT_AUTH_REGISTER_REQ, VALUE_ERR_ID_DUPLICATE, "이미 가입된 이메일입니다.", json::object()).dump();
         }
 
         // 닉네임 중복 확인
-        std::unique_ptr<sql::PreparedStatement> st_nick(db.prepareStatement("SELECT 1 FROM users WHERE nickname = ?"));
-        st_nick->setString(1, nickname);
-        std::unique_ptr<sql::ResultSet> res_nick(st_nick->executeQuery());
-        if (res_nick->next())
+        if (db.nickname_exists(nickname))
         {
             return make_resp(PKT_AUTH_REGISTER_REQ, VALUE_ERR_NAME_DUPLICATE, "이미 사용 중인 닉네임입니다.", json::object()).dump();
         }
     }
-    catch (sql::SQLException &e)
+    catch (StorageError &e)
     {
-        std::cerr << "[DB Error] Signup Check: " << e.what() << std::endl;
+        LOG_ERROR("[DB Error] Signup Check: " << e.what());
         return make_resp(PKT_AUTH_REGISTER_REQ, VALUE_ERR_DB, "서버 DB 오류입니다.", json::object()).dump();
     }
 
-    // 3. 인증 정보 메모리 저장
+    // 3. 인증 정보 준비 (메일이 발송 큐에 들어가면 메모리에 저장)
     std::string v_code = generate_verification_code(); // 함수 있다고 가정
     // PendingInfo 구조체 정의
     PendingInfo info;
@@ -276,21 +514,33 @@ static std::string handle_auth_signup_req(const json &req, sql::Connection &db)
     info.code = v_code;          // 인증번호
     info.timestamp = time(NULL); // ★ 현재 시간을 확실하게 저장
 
+    // 4. 메일 발송
+    LOG_INFO("[Auth] Code " << v_code << " generated for " << email);
+    // email_send 함수 호출 (발송 스레드 풀 큐에 넣기만 함, 가득 차면 재시도 안내)
+    // 대기 정보도 outbox 에 같이 남김 → 재시작 후 다시 보낸 인증번호로 가입을 마칠 수 있음
+    json meta = {{"email", email}, {"pw", pw}, {"nickname", nickname}, {"code", v_code},
+                 {"timestamp", static_cast<int64_t>(info.timestamp)}};
+    if (!email_send(email, "[3LOUD] 인증번호 안내", "인증번호: " + v_code, meta.dump(), &info.outbox_id))
+    {
+        return make_resp(PKT_AUTH_REGISTER_REQ, VALUE_ERR_RATE_LIMITED, "가입 요청이 많습니다. 잠시 후 다시 시도해주세요.",
+                         json{{"retry_after", 5}})
+            .dump();
+    }
+
+    // 발송 큐에 들어간 뒤에만 대기 목록에 기록 (거절된 요청의 인증번호는 남기지 않음)
     {
         std::lock_guard<std::mutex> lock(g_pending_m); // extern 혹은 static 정의 필요
+        auto it = g_pending_map.find(email);
+        if (it != g_pending_map.end())
+            email_forget(it->second.outbox_id); // 다시 가입 요청 → 이전 인증번호는 폐기
         g_pending_map[email] = info;
     }
 
-    // 4. 메일 발송
-    std::cout << "[Auth] Code " << v_code << " generated for " << email << std::endl;
-    // email_send 함수 호출 (비동기 권장)
-    email_send(email, "[3LOUD] 인증번호 안내", "인증번호: " + v_code);
-
     return make_resp(PKT_AUTH_REGISTER_REQ, VALUE_SUCCESS, "인증번호가 발송되었습니다.", json::object()).dump();
 }
 
 // [핸들러] 2단계: 인증번호 검증 및 가입 완료
-static std::string handle_auth_verify_req(const json &req, sql::Connection &db)
+static std::string handle_auth_verify_req(const RequestContext &ctx, const json &req, Storage &db)
 {
     json payload;
     try
@@ -336,6 +586,7 @@ static std::string handle_auth_verify_req(const json &req, sql::Connection &db)
             std::lock_guard<std::mutex> lock(g_pending_m);
             g_pending_map.erase(email);
         }
+        email_forget(info.outbox_id);
         return make_resp(PKT_AUTH_VERIFY_REQ, VALUE_ERR_SESSION, "인증 시간이 초과되었습니다. 다시 가입해주세요.", json::object()).dump();
     }
 
@@ -345,33 +596,46 @@ static std::string handle_auth_verify_req(const json &req, sql::Connection &db)
         return make_resp(PKT_AUTH_VERIFY_REQ, VALUE_ERR_EMAIL_VERIFY, "인증번호가 일치하지 않습니다.", json::object()).dump();
     }
 
-    // 4. DB 저장
+    // 4. 비밀번호 저장 형식 (해싱 풀에서 계산, 끝나면 요청이 다시 들어와 여기까지 다시 확인)
+    std::string pw_hash;
+    switch (pw_hash_new("verify:" + email, info.pw, ctx.resume, &pw_hash))
+    {
+    case PwCheck::PENDING:
+        return "";
+    case PwCheck::BUSY:
+        return make_resp(PKT_AUTH_VERIFY_REQ, VALUE_ERR_RATE_LIMITED, "요청이 많습니다. 잠시 후 다시 시도해주세요.",
+                         json{{"retry_after", 1}})
+            .dump();
+    default:
+        break;
+    }
+
+    // 5. DB 저장
     try
     {
-        std::unique_ptr<sql::PreparedStatement> st(db.prepareStatement(
-            "INSERT INTO users (email, pw_hash, nickname, grade, is_active) VALUES (?, ?, ?, 1, 1)"));
-        st->setString(1, email);
-        st->setString(2, info.pw);
-        st->setString(3, info.nickname);
-        st->executeUpdate();
+        if (pw_hash.empty())
+            return make_resp(PKT_AUTH_VERIFY_REQ, VALUE_ERR_UNKNOWN, "비밀번호 처리 실패", json::object()).dump();
+        db.create_user(email, pw_hash, info.nickname);
 
         {
             std::lock_guard<std::mutex> lock(g_pending_m);
             g_pending_map.erase(email);
         }
+        email_forget(info.outbox_id);
         // [디버그 출력] 이게 핵심입니다.
-        std::cout << "[DEBUG] 회원가입 완료 " << email << std::endl;
+        LOG_DEBUG("[DEBUG] 회원가입 완료 " << email);
         return make_resp(PKT_AUTH_VERIFY_REQ, VALUE_SUCCESS, "회원가입 완료! 로그인해주세요.", json::object()).dump();
     }
-    catch (sql::SQLException &e)
+    catch (StorageError &e)
     {
         return make_resp(PKT_AUTH_VERIFY_REQ, VALUE_ERR_DB, "계정 생성 중 오류 발생.", json::object()).dump();
     }
 }
 
 // [핸들러] 로그인 요청 처리
-static std::string handle_auth_login(int client_sock, const json &req, sql::Connection &db)
+static std::string handle_auth_login(const RequestContext &ctx, const json &req, Storage &db)
 {
+    const int client_sock = ctx.sock;
     json payload;
     try
     {
@@ -392,19 +656,16 @@ static std::string handle_auth_login(int client_sock, const json &req, sql::Conn
 
     try
     {
-        std::unique_ptr<sql::PreparedStatement> st(db.prepareStatement(
-            "SELECT no,pw_hash, nickname, grade, is_active FROM users WHERE email = ?"));
-        st->setString(1, email);
-        std::unique_ptr<sql::ResultSet> res(st->executeQuery());
+        // 유저 캐시 조회 (정지/설정 변경 시 무효화되므로 항상 최신 상태)
+        UserPtr user = user_cache_by_email(db, email);
 
-        if (res->next())
+        if (user)
         {
-            // .c_str()을 사용하여 std::string 변환
-            int user_no = res->getInt("no"); // 넘버 받아서 로그인 여부 확인
-            std::string db_pw_hash = res->getString("pw_hash").c_str();
-            std::string nickname = res->getString("nickname").c_str();
-            int is_active = res->getInt("is_active");
-            int grade = res->getInt("grade");
+            int user_no = static_cast<int>(user->no); // 넘버 받아서 로그인 여부 확인
+            std::string db_pw_hash = user->pw_hash;
+            std::string nickname = user->nickname;
+            int is_active = user->is_active ? 1 : 0;
+            int grade = user->grade;
 
             // 1. 계정 정지 체크
             if (is_active == 0)
@@ -412,10 +673,34 @@ static std::string handle_auth_login(int client_sock, const json &req, sql::Conn
                 return make_resp(PKT_AUTH_LOGIN_REQ, VALUE_ERR_PERMISSION, "비밀번호 5회 오류로 정지된 계정입니다. 관리자에게 문의하세요.", json::object()).dump();
             }
 
-            // 2. 비밀번호 체크
-            if (db_pw_hash == client_pw_hash)
-            { // 중복 로그인 체크
-                if (!try_login_register(client_sock, email))
+            // 2. 비밀번호 체크 (해싱 풀, 결과 캐시 miss 면 계산 후 요청이 다시 들어옴)
+            std::string upgrade;
+            PwCheck pc = pw_check(db_pw_hash, client_pw_hash, ctx.resume, &upgrade);
+            if (pc == PwCheck::PENDING)
+                return "";
+            if (pc == PwCheck::BUSY)
+            {
+                return make_resp(PKT_AUTH_LOGIN_REQ, VALUE_ERR_RATE_LIMITED, "로그인 요청이 많습니다. 잠시 후 다시 시도해주세요.",
+                                 json{{"retry_after", 1}})
+                    .dump();
+            }
+            if (pc == PwCheck::OK)
+            {
+                if (!upgrade.empty())
+                {
+                    // 예전 형식 / 낮은 반복 수 → 새 해시로 교체 (실패해도 로그인은 진행)
+                    try
+                    {
+                        db.update_user_field(user->no, UserField::PW_HASH, upgrade);
+                        user_cache_invalidate(user->no);
+                    }
+                    catch (StorageError &e)
+                    {
+                        LOG_ERROR("[DB Error] pw_hash upgrade: " << e.what());
+                    }
+                }
+                // 중복 로그인 체크
+                if (!try_login_register(client_sock, SessionIdentity{user->no, email, grade, ""}))
                 {
                     return make_resp(PKT_AUTH_LOGIN_REQ, VALUE_ERR_LOGIN_ID, "이미 접속 중인 계정입니다.", json::object()).dump();
                 }
@@ -430,8 +715,17 @@ static std::string handle_auth_login(int client_sock, const json &req, sql::Conn
                 out_payload["nickname"] = nickname;
                 out_payload["grade"] = grade;
                 out_payload["user_no"] = user_no;
+                // 보조 소켓(폴링/업로드/다운로드)은 pw_hash 대신 이 토큰으로 인증
+                std::string token = session_token_issue(email, user->no, grade);
+                out_payload["token"] = token;
+                {
+                    std::lock_guard<std::mutex> lock(g_login_m);
+                    auto it = g_socket_users.find(client_sock);
+                    if (it != g_socket_users.end())
+                        it->second.token = token;
+                }
 
-                std::cout << "[Info] User " << email << " 로그인 (socket " << client_sock << " connect).\n";
+                LOG_INFO("[Info] User " << email << " 로그인 (socket " << client_sock << " connect).");
                 return make_resp(PKT_AUTH_LOGIN_REQ, VALUE_SUCCESS, "로그인 성공", out_payload).dump();
             }
             else
@@ -446,10 +740,11 @@ static std::string handle_auth_login(int client_sock, const json &req, sql::Conn
                 // 3-3. ★ 5회 도달 시 DB 업데이트 (계정 비활성화)
                 if (current_fail >= 5)
                 {
-                    std::unique_ptr<sql::PreparedStatement> lock_st(db.prepareStatement(
-                        "UPDATE users SET is_active = 0 WHERE email = ?"));
-                    lock_st->setString(1, email);
-                    lock_st->executeUpdate();
+                    db.deactivate_user_by_email(email);
+                    after_commit(db, [email] {
+                        user_cache_invalidate_email(email); // 정지 상태 즉시 반영
+                        session_revoke_user(email);         // 다른 소켓의 세션 / 토큰도 폐기
+                    });
 
                     // 메모리 맵에서도 지워줌 (이미 DB에서 막히므로 관리 불필요)
                     {
@@ -457,7 +752,7 @@ static std::string handle_auth_login(int client_sock, const json &req, sql::Conn
                         g_fail_counts.erase(email);
                     }
 
-                    std::cout << ">> [계정 정지] " << email << " (비밀번호 5회 오류)\n";
+                    LOG_WARN(">> [계정 정지] " << email << " (비밀번호 5회 오류)");
                     return make_resp(PKT_AUTH_LOGIN_REQ, VALUE_ERR_PERMISSION,
                                      "비밀번호 5회 오류로 계정이 비활성화되었습니다.", json::object())
                         .dump();
@@ -473,14 +768,14 @@ static std::string handle_auth_login(int client_sock, const json &req, sql::Conn
             return make_resp(PKT_AUTH_LOGIN_REQ, VALUE_ERR_LOGIN_ID, "존재하지 않는 계정입니다.", json::object()).dump();
         }
     }
-    catch (sql::SQLException &e)
+    catch (StorageError &e)
     {
-        std::cout << "[DB Error] " << e.what() << std::endl;
+        LOG_ERROR("[DB Error] " << e.what());
         return make_resp(PKT_AUTH_LOGIN_REQ, VALUE_ERR_DB, "DB 조회 중 오류 발생", json::object()).dump();
     }
 }
 
-// static std::string handle_msg_send(const json &req, sql::Connection &db)
+// static std::string handle_msg_send(const json &req, Storage &db)
 // {                                                        // 메시지 전송 핸들
 //     json payload = req.value("payload", json::object()); // payload
 //     std::string to = payload.value("to", "");            // 받는 사람
@@ -494,31 +789,818 @@ static std::string handle_auth_login(int client_sock, const json &req, sql::Conn
 // } // 함수 끝
 
 // ============================================================================
-// Worker Thread: 요청 처리 담당 (DB 연결은 여기서 생성해서 전용으로 사용)
+// 요청 분기: type 별 핸들러 호출 (worker_loop / 묶음 요청 공용)
 // ============================================================================
 
-static void worker_loop(std::string db_url, std::string db_user, std::string db_pw)
-{                                          // 워커 루프
-    sql::Driver *driver = nullptr;         // 드라이버 포인터
-    std::unique_ptr<sql::Connection> conn; // DB 커넥션
+static std::string handle_batch(const RequestContext &ctx, const json &req, Storage &db);
+static void enqueue_response(int sock, int type, std::string out_payload, RequestTrace *trace = nullptr);
+
+// 묶음 요청 처리 중이면 true → 하위 응답을 먼저 내보내는 스트리밍 핸들러는 한 응답으로 모음
+static thread_local bool t_in_batch = false;
+// 지금 처리 중인 요청의 추적 (run_with_db 가 DB 시작 / 끝을 찍음)
+static thread_local RequestTrace *t_trace = nullptr;
+// 핸들러가 응답을 나중에 (다른 스레드에서) 보내기로 했으면 true → worker 는 응답을 넣지 않음
+static thread_local bool t_response_deferred = false;
+
+// 비밀번호 확인이 해싱 풀로 넘어가 빈 응답이면 응답 보류 (ctx.resume 으로 요청이 다시 들어옴)
+static std::string defer_if_empty(std::string out)
+{
+    if (out.empty() && !t_in_batch)
+        t_response_deferred = true;
+    return out;
+}
+
+static std::string dispatch_request(const RequestContext &ctx, int type, const json &req, Storage &db)
+{
+    const int sock = ctx.sock;
+    switch (type)
+    {
+    case PKT_AUTH_REGISTER_REQ:
+        return handle_auth_signup_req(ctx, req, db);
+
+    case PKT_AUTH_VERIFY_REQ:
+        return defer_if_empty(handle_auth_verify_req(ctx, req, db));
+
+    case PKT_AUTH_LOGIN_REQ:
+        return defer_if_empty(handle_auth_login(ctx, req, db));
+
+    case PKT_MSG_POLL_REQ:
+        return defer_if_empty(handle_msg_poll(ctx, req, db));
+
+    case PKT_MSG_SEND_REQ:
+    {
+        // 묶음 요청 안에서는 트랜잭션/응답 순서를 지키기 위해 바로 INSERT
+        if (t_in_batch)
+            return handle_msg_send(ctx, req, db, nullptr);
+        std::string out = handle_msg_send(ctx, req, db, [sock](std::string res) {
+            enqueue_response(sock, PKT_MSG_SEND_REQ, std::move(res));
+        });
+        if (out.empty())
+            t_response_deferred = true; // message_writer 가 commit 후 응답
+        return out;
+    }
+
+    case PKT_FILE_UPLOAD_REQ:
+        return handle_file_upload_req(ctx, req, db);
+
+    case PKT_FILE_CHUNK:
+        return handle_file_chunk(ctx, req, db);
+
+    case PKT_FILE_DOWNLOAD_REQ:
+    {
+        // 다운로드는 worker가 소켓에 직접 packet_send로 청크를 쏨.
+        // ① 소켓을 blocking으로 전환 (non-blocking이면 EAGAIN 발생)
+        // ② g_streaming_socks에 등록 → epoll이 이 소켓엔 write_buf flush 안 함
+        // ③ 완료 후 복구 + write_buf에 남은 DONE 패킷 flush를 위해 EPOLLOUT 트리거
+        set_blocking(sock);
+        { std::lock_guard<std::mutex> lk(g_streaming_m);
+          g_streaming_socks.insert(sock); }
+        std::string out = handle_file_download_req(ctx, req, db);
+        { std::lock_guard<std::mutex> lk(g_streaming_m);
+          g_streaming_socks.erase(sock); }
+        set_nonblocking(sock);
+        // wake_fd를 한 번 더 써서 epoll이 write_buf(DONE 패킷)를 flush하게 함
+        { uint64_t u = 1; if (g_wake_fd != -1) write(g_wake_fd, &u, sizeof(u)); }
+        return out;
+    }
+
+    case PKT_FILE_DELETE_REQ:
+        return handle_file_delete_req(ctx, req, db);
+
+    case PKT_FILE_LIST_REQ:
+        return handle_file_list_req(ctx, req, db);
+
+    case PKT_SETTINGS_GET_REQ:
+        return handle_settings_get(ctx, req, db);
+
+    case PKT_SETTINGS_SET_REQ:
+        return defer_if_empty(handle_settings_set(ctx, req, db));
+
+    case PKT_MSG_LIST_REQ:
+        return handle_msg_list(ctx, req, db);
+
+    case PKT_MSG_DELETE_REQ:
+        return handle_msg_delete(ctx, req, db);
+
+    case PKT_MSG_READ_REQ:
+        return handle_msg_read(ctx, req, db);
+
+    case PKT_MSG_SETTING_GET_REQ:
+        return handle_msg_setting_get(ctx, req, db);
+
+    case PKT_SETTINGS_VERIFY_REQ:
+        return defer_if_empty(handle_settings_verify_req(ctx, req, db));
+
+    case PKT_BLACKLIST_REQ:
+        return handle_server_blacklist_process(ctx, req, db);
+
+    case PKT_MSG_SETTING_UPDATE_REQ:
+        return handle_msg_setting_update(ctx, req, db);
+
+    case PKT_AUTH_LOGOUT_REQ:
+        logout_unregister(sock);
+        return make_resp(PKT_AUTH_LOGOUT_REQ, VALUE_SUCCESS, "Logged out", json::object()).dump();
+
+    case PKT_ADMIN_USER_LIST_REQ:
+    {
+        FrameSink emit;
+        if (!t_in_batch)
+            emit = [sock](std::string frame) { enqueue_response(sock, PKT_ADMIN_USER_LIST_REQ, std::move(frame)); };
+        return handle_admin_user_list(ctx, req, db, emit);
+    }
+
+    case PKT_ADMIN_USER_INFO_REQ:
+        return handle_admin_user_info(ctx, req, db);
+
+    case PKT_ADMIN_STATE_CHANGE_REQ:
+        return handle_admin_state_change(ctx, req, db);
+
+    case PKT_ADMIN_STATS_REQ:
+        return handle_admin_stats(ctx, req);
+
+    case PKT_BATCH:
+        return defer_if_empty(handle_batch(ctx, req, db));
+
+    default:
+        return make_resp(type, VALUE_ERR_UNKNOWN, "Unknown type", json::object()).dump();
+    }
+}
+
+// ============================================================================
+// [핸들러] 묶음 요청 (PKT_BATCH = 0x0050)
+//
+// 요청 payload:
+//   { "requests": [ {type, payload, ...}, ... ],   ← 최대 BATCH_MAX_REQUESTS 개
+//     "atomic": false }                            ← true면 하나의 DB 트랜잭션
+//
+// 응답 payload:
+//   { "responses": [ 하위 응답 JSON, ... ] }        ← 요청 순서 그대로
+//
+// - 하위 요청은 같은 worker가 같은 DB 커넥션으로 순서대로 처리
+//   (로그인 → 설정 조회 → 목록 조회 처럼 앞 요청의 세션 결과를 뒤 요청이 그대로 사용,
+//    로그인 / 로그아웃 하위 요청 뒤에는 RequestContext 를 다시 만듦)
+// - atomic=true 이면 하위 응답 중 하나라도 실패 시 전체 rollback
+//   rollback 은 DB 변경만 되돌리므로 트랜잭션 밖에 흔적을 남기는 하위 요청은
+//   atomic 묶음에 넣을 수 없음 (atomic_batch_allows, 하나라도 있으면 아무것도 실행하지 않고 거절)
+// - 다운로드(소켓 직접 스트리밍)와 중첩 묶음은 허용하지 않음
+// ============================================================================
+static constexpr size_t BATCH_MAX_REQUESTS = 32; // 묶음 1개당 하위 요청 최대 개수
+
+// atomic 묶음에 넣을 수 있는 하위 요청인지
+// 아래는 rollback 으로 되돌릴 수 없는 변경이 있어 거절
+//   파일 업로드 / 청크 / 삭제        디스크 파일, 사용량 장부 (quota_reserve / commit / credit)
+//   가입 / 인증번호 확인             인증 대기 목록, 메일 발송
+//   로그인 / 로그아웃 / 비밀번호 확인  세션 맵, 실패 횟수 / 계정 잠금
+//   폴더 생성 / 삭제                 디스크 폴더
+static bool atomic_batch_allows(int type, const json &sub)
+{
+    switch (type)
+    {
+    case PKT_FILE_UPLOAD_REQ:
+    case PKT_FILE_CHUNK:
+    case PKT_FILE_DELETE_REQ:
+    case PKT_FILE_DOWNLOAD_REQ:
+    case PKT_AUTH_REGISTER_REQ:
+    case PKT_AUTH_VERIFY_REQ:
+    case PKT_AUTH_LOGIN_REQ:
+    case PKT_AUTH_LOGOUT_REQ:
+    case PKT_SETTINGS_VERIFY_REQ:
+    case PKT_BATCH:
+        return false;
+    case PKT_SETTINGS_SET_REQ:
+    {
+        // 개인정보 변경 (DB 만) / 폴더 목록 조회만
+        json pl = sub.value("payload", json::object());
+        if (!pl.is_object())
+            return false;
+        return !pl.value("update_type", "").empty() || pl.value("action", "") == "list_folders";
+    }
+    default:
+        return true;
+    }
+}
+
+// 하위 로그인 / 비밀번호 확인 / 가입 인증 / 비밀번호 변경의 해시 계산을 묶음 처리 전에
+// 해싱 풀로 미리 넘김 (하위 요청은 응답을 보류할 수 없으므로) → 하나라도 PENDING 이면
+// 묶음 전체를 보류했다가 다시 들어왔을 때 캐시 적중으로 처리. 세션이 필요한 요청은 현재 세션 기준만
+static PwCheck prefetch_password_checks(const RequestContext &ctx, const json &subs, Storage &db)
+{
+    PwCheck result = PwCheck::OK;
+    for (const auto &sub : subs)
+    {
+        if (!sub.is_object())
+            continue;
+        int sub_type = sub.value("type", 0);
+        if (sub_type != PKT_AUTH_LOGIN_REQ && sub_type != PKT_SETTINGS_VERIFY_REQ &&
+            sub_type != PKT_AUTH_VERIFY_REQ && sub_type != PKT_SETTINGS_SET_REQ)
+            continue;
+        json pl = sub.value("payload", json::object());
+        if (!pl.is_object())
+            continue;
+
+        PwCheck pc = PwCheck::OK;
+        if (sub_type == PKT_AUTH_VERIFY_REQ)
+        {
+            // 인증번호가 맞는 대기 항목만 (틀린 번호로 해시 계산을 시키지 않음)
+            std::string email = pl.value("email", "");
+            std::string code = pl.value("code", "");
+            std::string pw;
+            {
+                std::lock_guard<std::mutex> lock(g_pending_m);
+                auto it = g_pending_map.find(email);
+                if (it != g_pending_map.end() && !code.empty() && it->second.code == code)
+                    pw = it->second.pw;
+            }
+            if (pw.empty())
+                continue;
+            pc = pw_hash_new("verify:" + email, pw, ctx.resume, nullptr);
+        }
+        else if (sub_type == PKT_SETTINGS_SET_REQ)
+        {
+            std::string value = pl.value("value", "");
+            if (!ctx.logged_in || pl.value("update_type", "") != "pw" || value.empty())
+                continue;
+            pc = pw_hash_new("user:" + std::to_string(ctx.user_no), value, ctx.resume, nullptr);
+        }
+        else
+        {
+            std::string pw = pl.value("pw_hash", "");
+            if (pw.empty())
+                continue;
+
+            UserPtr user;
+            if (sub_type == PKT_AUTH_LOGIN_REQ)
+                user = user_cache_by_email(db, pl.value("email", ""));
+            else if (ctx.logged_in)
+                user = user_cache_by_no(db, ctx.user_no);
+            if (!user || !user->is_active)
+                continue;
+
+            pc = pw_check(user->pw_hash, pw, ctx.resume, nullptr);
+        }
+        if (pc == PwCheck::BUSY)
+            return PwCheck::BUSY;
+        if (pc == PwCheck::PENDING)
+            result = PwCheck::PENDING; // 나머지도 같이 넘겨 두고 한 번에 다시 처리
+    }
+    return result;
+}
+
+static std::string handle_batch(const RequestContext &ctx, const json &req, Storage &db)
+{
+    json payload = req.value("payload", json::object());
+    if (!payload.contains("requests") || !payload["requests"].is_array() || payload["requests"].empty())
+    {
+        return make_resp(PKT_BATCH, VALUE_ERR_INVALID_PACKET, "requests 필드 누락 또는 비어 있음", json::object()).dump();
+    }
+
+    const json &subs = payload["requests"];
+    if (subs.size() > BATCH_MAX_REQUESTS)
+    {
+        return make_resp(PKT_BATCH, VALUE_ERR_INVALID_PACKET,
+                         "한 번에 최대 " + std::to_string(BATCH_MAX_REQUESTS) + "개까지 묶을 수 있음", json::object())
+            .dump();
+    }
+
+    bool atomic = payload.value("atomic", false);
+    if (atomic)
+    {
+        for (size_t i = 0; i < subs.size(); ++i)
+        {
+            int sub_type = subs[i].is_object() ? subs[i].value("type", 0) : 0;
+            if (!atomic_batch_allows(sub_type, subs[i]))
+            {
+                json ep = {{"index", i}, {"type", sub_type}};
+                return make_resp(PKT_BATCH, VALUE_ERR_INVALID_PACKET,
+                                 "atomic 묶음에서 되돌릴 수 없는 요청은 허용되지 않음", ep)
+                    .dump();
+            }
+        }
+    }
+
+    if (ctx.resume)
+    {
+        PwCheck pc = prefetch_password_checks(ctx, subs, db);
+        if (pc == PwCheck::PENDING)
+            return "";
+        if (pc == PwCheck::BUSY)
+        {
+            return make_resp(PKT_BATCH, VALUE_ERR_RATE_LIMITED, "로그인 요청이 많습니다. 잠시 후 다시 시도해주세요.",
+                             json{{"retry_after", 1}})
+                .dump();
+        }
+    }
+
+    if (atomic)
+        db.begin(); // 하위 요청 전체를 하나의 트랜잭션으로
+
+    json responses = json::array();
+    bool all_ok = true;
+    std::string blacklist_owner; // rollback 시 블랙리스트 메모리 색인도 되돌려야 함
+    RequestContext cur = ctx;    // 하위 요청용 (로그인 / 로그아웃 뒤 갱신)
+    cur.resume = nullptr;        // 하위 요청의 해시 계산은 위에서 미리 / 캐시 밖이면 이 스레드에서
+    t_in_batch = true;
+
+    for (const auto &sub : subs)
+    {
+        int sub_type = sub.is_object() ? sub.value("type", 0) : 0;
+        std::string sub_out;
+        if (sub_type == PKT_BLACKLIST_REQ && cur.logged_in)
+            blacklist_owner = cur.email;
+
+        if (sub_type == PKT_BATCH || sub_type == PKT_FILE_DOWNLOAD_REQ)
+        {
+            sub_out = make_resp(sub_type, VALUE_ERR_INVALID_PACKET, "묶음 요청에서 허용되지 않는 type", json::object()).dump();
+        }
+        else
+        {
+            try
+            {
+                sub_out = dispatch_request(cur, sub_type, sub, db);
+            }
+            catch (const std::exception &e)
+            {
+                sub_out = make_resp(sub_type, VALUE_ERR_UNKNOWN, std::string("Exception: ") + e.what(), json::object()).dump();
+            }
+        }
+
+        if (sub_type == PKT_AUTH_LOGIN_REQ || sub_type == PKT_AUTH_LOGOUT_REQ)
+            cur = request_context_for(ctx.sock); // resume 은 비어 있음
+
+        json sub_res = json::parse(sub_out, nullptr, false);
+        if (sub_res.is_discarded())
+            sub_res = make_resp(sub_type, VALUE_ERR_UNKNOWN, "empty response", json::object());
+
+        // code 위치는 핸들러마다 다름 (최상위 code / payload.code)
+        int code = sub_res.value("code", sub_res.value("payload", json::object()).value("code", VALUE_SUCCESS));
+        if (code != VALUE_SUCCESS)
+            all_ok = false;
+
+        responses.push_back(std::move(sub_res));
+    }
+    t_in_batch = false;
+
+    if (atomic)
+    {
+        try
+        {
+            if (all_ok)
+                db.commit();
+            else
+                db.rollback();
+        }
+        catch (const StorageError &e)
+        {
+            LOG_ERROR("[Batch] 트랜잭션 종료 실패: " << e.what());
+            all_ok = false;
+        }
+        unread_counter_txn_end(all_ok); // 보류해 둔 안읽은 수 변화량 반영 / 폐기
+        after_commit_txn_end(all_ok);   // 보류해 둔 캐시 무효화 / 세션 갱신 실행 / 폐기
+        if (!all_ok && !blacklist_owner.empty())
+            blacklist_cache_forget(blacklist_owner); // 다음 조회 때 DB 에서 다시 읽음
+    }
+
+    json out_payload;
+    out_payload["responses"] = std::move(responses);
+    out_payload["committed"] = !atomic || all_ok;
+    return make_resp(PKT_BATCH, VALUE_SUCCESS, "묶음 처리 완료", out_payload).dump();
+}
+
+// ============================================================================
+// 응답 전달: 응답 큐에 넣고 epoll 스레드 깨우기 (worker / 로그인 제한 공용)
+// ============================================================================
+
+static void enqueue_response(int sock, int type, std::string out_payload, RequestTrace *trace)
+{
+    // 응답 페이로드 비어있으면 에러 응답으로 대체
+    if (out_payload.empty())
+    {
+        out_payload = make_resp(type, VALUE_ERR_UNKNOWN, "empty response", json::object()).dump();
+    }
+    // type=17(PKT_MSG_POLL_REQ)은 폴링 전용, 청크는 개수가 많아서 로그 생략
+    if (type != PKT_MSG_POLL_REQ && type != PKT_FILE_CHUNK)
+        LOG_DEBUG("[DEBUG] response type=" << type
+                  << " len=" << out_payload.size()
+                  << " payload=" << out_payload.substr(0, 120));
+
+    {                                                                  // 응답 큐 lock 블록
+        std::lock_guard<std::mutex> lk(g_res_m);                       // 응답 큐 lock
+        std::optional<RequestTrace> traced;
+        if (trace)
+        {
+            trace->enqueued = RequestTrace::Clock::now();
+            traced = *trace;
+        }
+        g_res_q.push(ResponseTask{sock, std::move(out_payload), std::move(traced)}); // 응답 작업 push
+    } // lock 블록 끝
+    uint64_t u = 1;
+    if (g_wake_fd != -1)
+    {
+        write(g_wake_fd, &u, sizeof(u));
+    }
+}
+
+// ============================================================================
+// 로그인 시도 제한 (epoll 스레드, 요청 큐에 넣기 전)
+// - 로그인 / 비밀번호 확인 요청만 IP / 계정 token bucket 에서 한 개씩 꺼냄 (login_limiter)
+//   둘 다 pw_hash 가 없으면 DB 조회 전에 끝나므로 "pw_hash" 도 \u escape 도 없는 요청은
+//   파싱 없이 통과 (파일 청크 / 폴링 등 나머지 요청은 문자열 검색 두 번)
+// - 걸린 요청도 json 트리를 만들지 않고 SAX 로 type / email 만 뽑음 (epoll 스레드 보호)
+// - 묶음 요청 안의 로그인 / 비밀번호 확인도 하나씩 셈
+// - 막히면 worker / DB 를 거치지 않고 응답 큐로 바로 거절 (묶음이면 하위 응답 모두 거절)
+// ============================================================================
+
+// 시도 제한에 쓰는 값만 모음
+// - 최상위 type / payload.email
+// - 묶음이면 payload.requests[i] 마다 type / payload.email (객체가 아닌 항목은 type 0)
+struct CredentialKeys : nlohmann::json_sax<json>
+{
+    struct Req
+    {
+        int type = 0;
+        std::string email;
+    };
+    Req top;
+    std::vector<Req> subs;
+
+  private:
+    struct Frame
+    {
+        bool is_array;
+        std::string key; // 객체일 때 마지막으로 읽은 key
+    };
+    std::vector<Frame> path_;
+
+    // 지금 값이 놓일 위치가 p 인지 ("[]" 는 배열 원소)
+    bool at(std::initializer_list<const char *> p) const
+    {
+        if (path_.size() != p.size())
+            return false;
+        size_t i = 0;
+        for (const char *k : p)
+        {
+            const Frame &f = path_[i++];
+            if (f.is_array ? std::strcmp(k, "[]") != 0 : f.key != k)
+                return false;
+        }
+        return true;
+    }
+    // payload.requests 의 원소 하나가 시작됨
+    void element()
+    {
+        if (at({"payload", "requests", "[]"}))
+            subs.emplace_back();
+    }
+    bool number(int64_t v)
+    {
+        element();
+        int t = static_cast<int>(v);
+        if (at({"type"}))
+            top.type = t;
+        else if (!subs.empty() && at({"payload", "requests", "[]", "type"}))
+            subs.back().type = t;
+        return true;
+    }
+
+  public:
+    bool null() override { return element(), true; }
+    // worker 의 value("type", 0) 처럼 bool / 실수도 int 로 바꿔 기록 (3.0 / 80.5 로 우회 방지)
+    bool boolean(bool v) override { return number(v ? 1 : 0); }
+    bool number_integer(number_integer_t v) override { return number(v); }
+    bool number_unsigned(number_unsigned_t v) override { return number(static_cast<int64_t>(v)); }
+    bool number_float(number_float_t v, const string_t &) override
+    {
+        if (!(v > INT32_MIN - 1.0 && v < INT32_MAX + 1.0))
+            return element(), true; // int 범위 밖 (NaN 포함) 은 어떤 type 과도 안 맞음
+        return number(static_cast<int64_t>(v));
+    }
+    bool binary(binary_t &) override { return element(), true; }
+    bool string(string_t &v) override
+    {
+        element();
+        if (at({"payload", "email"}))
+            top.email = v;
+        else if (!subs.empty() && at({"payload", "requests", "[]", "payload", "email"}))
+            subs.back().email = v;
+        return true;
+    }
+    bool start_object(std::size_t) override
+    {
+        element();
+        path_.push_back({false, {}});
+        return true;
+    }
+    bool key(string_t &k) override
+    {
+        path_.back().key = k;
+        return true;
+    }
+    bool end_object() override
+    {
+        path_.pop_back();
+        return true;
+    }
+    bool start_array(std::size_t) override
+    {
+        element();
+        path_.push_back({true, {}});
+        return true;
+    }
+    bool end_array() override
+    {
+        path_.pop_back();
+        return true;
+    }
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &) override { return false; }
+};
+
+static bool throttle_credential_attempt(int sock, const std::string &peer_ip, const std::string &payload)
+{
+    // key 이름은 \u escape 로만 글자를 숨길 수 있음
+    if (payload.find("pw_hash") == std::string::npos && payload.find("\\u") == std::string::npos)
+        return false;
+
+    try
+    {
+        CredentialKeys req;
+        if (!json::sax_parse(payload, &req))
+            return false; // 형식이 이상한 요청은 worker 가 오류로 응답
+        int type = req.top.type;
+
+        std::string session_email; // 비밀번호 확인은 세션 유저 기준
+        bool session_loaded = false;
+        int retry = 0;
+        auto check = [&](const CredentialKeys::Req &r) {
+            if (retry != 0)
+                return;
+            std::string account;
+            if (r.type == PKT_AUTH_LOGIN_REQ)
+            {
+                account = r.email;
+            }
+            else if (r.type == PKT_SETTINGS_VERIFY_REQ)
+            {
+                if (!session_loaded)
+                {
+                    std::lock_guard<std::mutex> lock(g_login_m);
+                    auto it = g_socket_users.find(sock);
+                    if (it != g_socket_users.end())
+                        session_email = it->second.email;
+                    session_loaded = true;
+                }
+                account = session_email;
+            }
+            else
+            {
+                return;
+            }
+            retry = login_limiter_take(peer_ip, account);
+        };
+
+        if (type == PKT_BATCH)
+        {
+            for (const auto &sub : req.subs)
+                check(sub);
+        }
+        else
+        {
+            check(req.top);
+        }
+        if (retry == 0)
+            return false;
+
+        std::string msg = "로그인 시도가 너무 많습니다. " + std::to_string(retry) + "초 후 다시 시도하세요.";
+        json ep = {{"retry_after", retry}};
+        if (type == PKT_BATCH)
+        {
+            json responses = json::array();
+            for (const auto &sub : req.subs)
+                responses.push_back(make_resp(sub.type, VALUE_ERR_RATE_LIMITED, msg, ep));
+            json out_payload;
+            out_payload["responses"] = std::move(responses);
+            out_payload["committed"] = false;
+            enqueue_response(sock, PKT_BATCH, make_resp(PKT_BATCH, VALUE_SUCCESS, "묶음 처리 안 함 (시도 제한)", out_payload).dump());
+        }
+        else
+        {
+            enqueue_response(sock, type, make_resp(type, VALUE_ERR_RATE_LIMITED, msg, ep).dump());
+        }
+        return true;
+    }
+    catch (const std::exception &)
+    {
+        return false; // 형식이 이상한 요청은 worker 가 오류로 응답
+    }
+}
+
+// ============================================================================
+// 읽기 요청 분산 (복제본) + read-your-writes
+// - 아래 type 은 핸들러가 저장소에 쓰지 않으므로 복제본 세션으로 처리 가능
+// - 한 유저가 쓰기 요청을 보낸 뒤 g_ryw_window 동안은 그 유저의 읽기도 주 DB 로
+//   (방금 보낸 메시지 / 올린 파일 / 바꾼 설정이 목록에 바로 보이도록)
+//   업로드 전용 소켓처럼 같은 유저가 소켓을 여러 개 쓰므로 user_no 기준,
+//   로그인 전 소켓만 fd 기준 (소켓이 닫히면 그 기록 삭제, fd 재사용 대비)
+// - MSG_POLL 은 안읽은 수 조회라 쓰기로 치지 않음 (주기적으로 와서 창이 계속 열려 있게 됨)
+// ============================================================================
+
+static bool is_read_only_type(int type)
+{
+    switch (type)
+    {
+    case PKT_MSG_LIST_REQ:
+    case PKT_MSG_SETTING_GET_REQ:
+    case PKT_FILE_LIST_REQ:
+    case PKT_SETTINGS_GET_REQ:
+    case PKT_ADMIN_USER_LIST_REQ:
+    case PKT_ADMIN_USER_INFO_REQ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static constexpr size_t RYW_SWEEP_SIZE = 4096; // 기록이 이만큼 쌓이면 만료된 항목 정리
+
+static std::chrono::milliseconds g_ryw_window{2000}; // main 에서 설정값으로 덮어씀
+static std::mutex g_ryw_m;
+static std::unordered_map<int64_t, std::chrono::steady_clock::time_point> g_last_write; // ryw_key -> 마지막 쓰기
+static std::atomic<uint64_t> g_ryw_pinned{0}; // 최근 쓰기 때문에 주 DB 로 보낸 읽기 수
+
+// 로그인했으면 user_no (0 이상), 아니면 -1 - fd (음수라 user_no 와 겹치지 않음)
+static int64_t ryw_key(const RequestContext &ctx)
+{
+    return ctx.logged_in ? static_cast<int64_t>(ctx.user_no) : -1 - static_cast<int64_t>(ctx.sock);
+}
+
+static bool wrote_recently(int64_t key)
+{
+    std::lock_guard<std::mutex> lk(g_ryw_m);
+    auto it = g_last_write.find(key);
+    if (it == g_last_write.end())
+        return false;
+    if (std::chrono::steady_clock::now() - it->second > g_ryw_window)
+    {
+        g_last_write.erase(it);
+        return false;
+    }
+    return true;
+}
+
+static void note_write(int64_t key)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(g_ryw_m);
+    if (g_last_write.size() >= RYW_SWEEP_SIZE) // 다시 안 읽은 유저 기록은 여기서만 지워짐
+    {
+        for (auto it = g_last_write.begin(); it != g_last_write.end();)
+            it = (now - it->second > g_ryw_window) ? g_last_write.erase(it) : std::next(it);
+    }
+    g_last_write[key] = now;
+}
+
+// 소켓이 닫힐 때: 로그인 전 fd 기록만 삭제 (유저 기록은 다른 소켓이 이어 쓸 수 있음)
+static void forget_writes(int sock)
+{
+    std::lock_guard<std::mutex> lk(g_ryw_m);
+    g_last_write.erase(-1 - static_cast<int64_t>(sock));
+}
+
+// ============================================================================
+// 접속 종료 정리 (epoll 스레드, 모든 종료 경로 공용)
+// - 로그인 / 토큰 세션 해제, 진행 중이던 업로드 예약과 조각 파일 해제, 로그인 전 쓰기 기록 삭제
+// - 호출 뒤에는 sessions 의 그 항목 (Session 참조) 을 더 쓰지 않음
+// ============================================================================
+static void close_session(std::unordered_map<int, Session> &sessions, int sock)
+{
+    logout_unregister(sock);
+    quota_release_sock(sock);
+    forget_writes(sock);
+    safe_close(sock);
+    conn_close(sock);
+    sessions.erase(sock);
+}
+
+// ============================================================================
+// 저장소 세션을 열고 핸들러 실행
+// - 세션(mariadb: 커넥션)은 DB가 필요한 요청에서만, 핸들러 실행 동안만 대여
+// - 연결이 없으면 서버를 내리지 않고 이 요청만 DB 오류 응답
+// ============================================================================
+
+static std::string run_with_db(StorageBackend &backend, const RequestContext &ctx, int type, const json &req)
+{
+    bool read_only = is_read_only_type(type);
+    bool pinned = read_only && wrote_recently(ryw_key(ctx));
+    if (pinned)
+        g_ryw_pinned++;
+    if (!read_only && type != PKT_MSG_POLL_REQ)
+        note_write(ryw_key(ctx)); // 실패한 쓰기 요청이어도 창은 연다 (일부만 반영됐을 수 있음)
+
+    t_db_round_trips = DbRoundTrips{};
+    auto acquire_t0 = std::chrono::steady_clock::now();
+    if (t_trace)
+        t_trace->db_start = acquire_t0;
+    struct DbEndStamp
+    {
+        ~DbEndStamp()
+        {
+            if (t_trace)
+                t_trace->db_end = RequestTrace::Clock::now(); // 세션 반납 후 (대여 실패 / 예외여도)
+        }
+    } db_end_stamp;
+    std::unique_ptr<Storage> db = (read_only && !pinned) ? backend.open_read() : backend.open();
+    uint64_t acquire_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - acquire_t0).count());
+    metrics_observe_stage(METRIC_DB_ACQUIRE, acquire_us);
+    t_db_round_trips.db_us += acquire_us; // type 별 DB 시간 = 대여 + statement (worker 가 집계)
+    if (!db)
+    {
+        return make_resp(type, VALUE_ERR_DB, "DB 연결 불가", json::object()).dump();
+    }
+
     try
-    {                                                                    // try 시작
-        driver = sql::mariadb::get_driver_instance();                    // 드라이버 인스턴스 획득
-        sql::Properties props({{"user", db_user}, {"password", db_pw}}); // 접속 속성 생성
-        conn.reset(driver->connect(db_url, props));                      // DB 연결 생성
-        {                                                                // 블록 시작
-            std::unique_ptr<sql::Statement> st(conn->createStatement()); // statement 생성
-            st->execute("SET NAMES 'utf8mb4'");                          // 인코딩 설정
-        } // 블록 끝
-        std::cout << "[Worker] DB connected\n"; // 로그 출력
-    }
-    catch (const sql::SQLException &e)
-    {                                                                    // SQL 예외 처리
-        std::cerr << "[Worker] DB connect failed: " << e.what() << "\n"; // 오류 출력
-        g_running = false;                                               // 서버 종료 플래그
-        return;                                                          // 워커 종료
-    } // try-catch 끝
+    {
+        std::string out = dispatch_request(ctx, type, req, *db);
+        if (type > 0 && type < MAX_PACKET_TYPE)
+        {
+            TypeRoundTrips &rt = g_type_rt[type];
+            rt.requests++;
+            rt.prepares += t_db_round_trips.prepares;
+            rt.executes += t_db_round_trips.executes;
+            rt.round_trips += t_db_round_trips.round_trips;
+        }
+        return out;
+    }
+    catch (const StorageError &e)
+    {
+        db->discard(); // 핸들러가 못 잡은 DB 예외 → 이 커넥션은 버리고 재연결
+        return make_resp(type, VALUE_ERR_DB, std::string("DB 오류: ") + e.what(), json::object()).dump();
+    }
+}
+
+// worker 처리량 (풀 통계와 함께 로그)
+struct WorkerStats
+{
+    std::atomic<uint64_t> db_done{0}; // DB worker가 응답한 요청 수
+    std::atomic<uint64_t> db_free{0}; // 커넥션 대여 없이 처리한 요청 수
+};
+static WorkerStats g_worker_stats;
+
+static std::atomic<size_t> g_active_sessions{0}; // 열린 클라이언트 소켓 수 (reactor 가 루프마다 갱신, 지표용)
+
+// ============================================================================
+// Worker Thread: 요청 처리 담당 (DB 커넥션은 필요한 요청만 풀에서 대여)
+// ============================================================================
+
+// 비밀번호 해시 계산이 필요할 수 있는 type (ctx.resume 을 채움)
+static bool may_check_password(int type)
+{
+    return type == PKT_AUTH_LOGIN_REQ || type == PKT_SETTINGS_VERIFY_REQ || type == PKT_MSG_POLL_REQ ||
+           type == PKT_AUTH_VERIFY_REQ || type == PKT_SETTINGS_SET_REQ || type == PKT_BATCH;
+}
+
+// 해싱 풀 스레드가 호출: 요청을 원래 순서와 관계없이 큐 뒤에 다시 넣음
+static void requeue_task(Task task)
+{
+    task.queued_at = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lk(g_req_m);
+        g_req_q.push(std::move(task));
+    }
+    g_req_cv.notify_one();
+}
+
+// 해시 계산으로 미룬 요청 하나 (묶음 요청은 계산 여러 개가 같은 상태를 나눠 가짐)
+struct ResumeState
+{
+    Task task;                        // 다시 넣을 요청
+    std::atomic<int> outstanding{0};  // 아직 안 끝난 계산 수
+    std::atomic<bool> requeued{false}; // 한 번만 다시 넣음
+};
+
+// credential_pool 이 풀에 넣을 때만 호출 (worker 스레드, task 가 살아 있는 동안)
+// - 첫 호출에서 payload 를 옮겨 다시 넣을 Task 를 만듦 (worker 는 파싱 후 payload 를 쓰지 않음)
+// - 마지막 계산이 끝날 때 한 번만 다시 넣음 (묶음 요청이 여러 번 처리되지 않도록)
+static std::function<void()> resume_callback(Task &task, std::shared_ptr<ResumeState> &state)
+{
+    if (!state)
+    {
+        state = std::make_shared<ResumeState>();
+        state->task.sock = task.sock;
+        state->task.payload = std::move(task.payload);
+        state->task.conn_id = task.conn_id;
+        state->task.resumed = true;
+        state->task.trace.framed = task.trace.framed; // 느린 요청 로그는 처음 받은 때부터
+        state->task.trace.resumed = true;
+    }
+    state->outstanding++;
+    return [state] {
+        if (--state->outstanding == 0 && !state->requeued.exchange(true))
+            requeue_task(std::move(state->task));
+    };
+}
 
+static void worker_loop(StorageBackend &backend)
+{                                          // 워커 루프
     while (g_running.load())
     {                                                         // 서버 실행 중 반복
         Task task;                                            // 꺼낼 작업
@@ -529,13 +1611,21 @@ static void worker_loop(std::string db_url, std::string db_user, std::string db_
             });                                               // wait 끝
             if (!g_running.load())
                 break;                  // 종료면 탈출
-            task = g_req_q.front();     // 큐 front 복사
+            task = std::move(g_req_q.front()); // 큐 front 꺼냄 (payload 복사 없음)
             g_req_q.pop();              // 큐 pop
-            g_current_sock = task.sock; // ★ 현재 요청 처리 소켓 등록
         } // lock 블록 끝
+        auto picked_at = std::chrono::steady_clock::now();
+        task.trace.dequeued = picked_at;
+        task.trace.sock = task.sock;
+        metrics_observe_stage(METRIC_QUEUE_WAIT, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(picked_at - task.queued_at).count()));
+        if (task.resumed && !conn_alive(task.sock, task.conn_id))
+            continue; // 해시 계산 동안 접속이 끊김
 
         std::string out_payload; // 응답 payload 문자열
         int type = 0;
+        t_db_round_trips = DbRoundTrips{}; // DB 를 쓰지 않는 요청이면 DB 시간 0
+        std::shared_ptr<ResumeState> resume_state; // 해시 계산으로 미뤘을 때만 생김
 
         try
         { // try 시작
@@ -556,136 +1646,40 @@ static void worker_loop(std::string db_url, std::string db_user, std::string db_
                 ).dump();
             } // 실패 처리 끝
             else
-            { // 파싱 성공 시 기존 로직 그대로
-
+            { // 파싱 성공 시 type 별 핸들러로 분기
                 type = req.value("type", 0); // type 방어 파싱
-
-                switch (type)
-                { // 기존 switch 그대로 유지
-
-                case PKT_AUTH_REGISTER_REQ:
-                    out_payload = handle_auth_signup_req(req, *conn);
-                    break;
-
-                case PKT_AUTH_VERIFY_REQ:
-                    out_payload = handle_auth_verify_req(req, *conn);
-                    break;
-
-                case PKT_AUTH_LOGIN_REQ:
-                    out_payload = handle_auth_login(task.sock, req, *conn);
-                    break;
-
-                case PKT_MSG_POLL_REQ:
-                    out_payload = handle_msg_poll(req, *conn);
-                    break;
-
-                case PKT_MSG_SEND_REQ:
-                    out_payload = handle_msg_send(req, *conn);
-                    break;
-
-                case PKT_FILE_UPLOAD_REQ:
-                    out_payload = handle_file_upload_req(req, *conn);
-                    break;
-
-                case PKT_FILE_CHUNK:
-                    out_payload = handle_file_chunk(req, *conn);
-                    break;
-
-                case PKT_FILE_DOWNLOAD_REQ:
-                    // 다운로드는 worker가 소켓에 직접 packet_send로 청크를 쏨.
-                    // ① 소켓을 blocking으로 전환 (non-blocking이면 EAGAIN 발생)
-                    // ② g_streaming_socks에 등록 → epoll이 이 소켓엔 write_buf flush 안 함
-                    // ③ 완료 후 복구 + write_buf에 남은 DONE 패킷 flush를 위해 EPOLLOUT 트리거
-                    set_blocking(task.sock);
-                    { std::lock_guard<std::mutex> lk(g_streaming_m);
-                      g_streaming_socks.insert(task.sock); }
-                    out_payload = handle_file_download_req(task.sock, req, *conn);
-                    { std::lock_guard<std::mutex> lk(g_streaming_m);
-                      g_streaming_socks.erase(task.sock); }
-                    set_nonblocking(task.sock);
-                    // wake_fd를 한 번 더 써서 epoll이 write_buf(DONE 패킷)를 flush하게 함
-                    { uint64_t u = 1; if (g_wake_fd != -1) write(g_wake_fd, &u, sizeof(u)); }
-                    break;
-
-                case PKT_FILE_DELETE_REQ:
-                    out_payload = handle_file_delete_req(req, *conn);
-                    break;
-
-                case PKT_FILE_LIST_REQ:
-                    out_payload = handle_file_list_req(req, *conn);
-                    break;
-
-                case PKT_SETTINGS_GET_REQ:
-                    out_payload = handle_settings_get(req, *conn);
-                    break;
-
-                case PKT_SETTINGS_SET_REQ:
-                    out_payload = handle_settings_set(req, *conn);
-                    break;
-
-                case PKT_MSG_LIST_REQ:
-                    out_payload = handle_msg_list(req, *conn);
-                    break;
-
-                case PKT_MSG_DELETE_REQ:
-                    out_payload = handle_msg_delete(req, *conn);
-                    break;
-
-                case PKT_MSG_READ_REQ:
-                    out_payload = handle_msg_read(req, *conn);
-                    break;
-
-                case PKT_MSG_SETTING_GET_REQ:
-                    out_payload = handle_msg_setting_get(req, *conn);
-                    break;
-
-                case PKT_SETTINGS_VERIFY_REQ:
-                    out_payload = handle_settings_verify_req(req, *conn);
-                    break;
-
-                case PKT_BLACKLIST_REQ:
-                    out_payload = handle_server_blacklist_process(req, *conn);
-                    break;
-
-                case PKT_MSG_SETTING_UPDATE_REQ:
-                    out_payload = handle_msg_setting_update(req, *conn);
-                    break;
-
-                case PKT_AUTH_LOGOUT_REQ:
+                task.trace.type = type;
+                attach_token_session(task.sock, req);
+                RequestContext ctx = request_context_for(task.sock); // 세션 맵 조회는 요청당 한 번
+                if (!task.resumed && may_check_password(type))
+                    ctx.resume = [&task, &resume_state] { return resume_callback(task, resume_state); };
+
+                t_trace = &task.trace;
+                if (type == PKT_AUTH_LOGOUT_REQ)
                 {
+                    // 세션 맵만 정리 → DB 커넥션 불필요
                     logout_unregister(task.sock);
-                    out_payload = make_resp(
-                        PKT_AUTH_LOGOUT_REQ,
-                        VALUE_SUCCESS,
-                        "Logged out",
-                        json::object()
-                    ).dump();
-                    break;
+                    out_payload = make_resp(PKT_AUTH_LOGOUT_REQ, VALUE_SUCCESS, "Logged out", json::object()).dump();
+                    g_worker_stats.db_free++;
+                }
+                else if (type == PKT_ADMIN_STATS_REQ)
+                {
+                    out_payload = handle_admin_stats(ctx, req); // 지표만 읽음 → DB 커넥션 불필요
+                    g_worker_stats.db_free++;
+                }
+                else if (type == PKT_MSG_POLL_REQ && !(out_payload = handle_msg_poll_cached(ctx)).empty())
+                {
+                    g_worker_stats.db_free++; // 로그인 세션의 폴링이 안읽은 수 캐시에 적중 → DB 커넥션 불필요
+                }
+                else if (type == PKT_FILE_CHUNK && !file_chunk_is_last(req))
+                {
+                    out_payload = handle_file_chunk_data(ctx, req); // 중간 청크는 디스크 쓰기만 → DB 커넥션 불필요
+                    g_worker_stats.db_free++;
+                }
+                else
+                {
+                    out_payload = run_with_db(backend, ctx, type, req);
                 }
-
-                case PKT_ADMIN_USER_LIST_REQ:
-                    out_payload = handle_admin_user_list(req, *conn);
-                    break;
-
-                case PKT_ADMIN_USER_INFO_REQ:
-                    out_payload = handle_admin_user_info(req, *conn);
-                    break;
-
-                case PKT_ADMIN_STATE_CHANGE_REQ:
-                    out_payload = handle_admin_state_change(req, *conn);
-                    break;
-
-                default:
-                    out_payload = make_resp(
-                        type,
-                        VALUE_ERR_UNKNOWN,
-                        "Unknown type",
-                        json::object()
-                    ).dump();
-                    break;
-
-                } // switch 끝
-
             } // 성공 처리 끝
         }
         catch (const std::exception &e)
@@ -696,33 +1690,20 @@ static void worker_loop(std::string db_url, std::string db_user, std::string db_
                 std::string("Exception: ") + e.what(),
                 json::object()
             ).dump();
-        }
-                catch (const std::exception &e)
-        {
-            out_payload = make_resp(VALUE_ERR_UNKNOWN, -1, std::string("Exception: ") + e.what(), json::object()).dump(); // 에러 응답
         } // try-catch 끝
 
-        // 응답 페이로드 비어있으면 에러 응답으로 대체
-        if (out_payload.empty())
-        {
-            out_payload = make_resp(type, VALUE_ERR_UNKNOWN, "empty response", json::object()).dump();
-        }
-        // type=17(PKT_MSG_POLL_REQ)은 폴링 전용 - 로그 생략
-        if (type != PKT_MSG_POLL_REQ)
-            std::cout << "[DEBUG] response type=" << type
-                      << " len=" << out_payload.size()
-                      << " payload=" << out_payload.substr(0, 120) << std::endl;
-
-        {                                                       // 응답 큐 lock 블록
-            std::lock_guard<std::mutex> lk(g_res_m);            // 응답 큐 lock
-            g_res_q.push(ResponseTask{task.sock, out_payload}); // 응답 작업 push
-
-        } // lock 블록 끝
-        uint64_t u = 1;
-        if (g_wake_fd != -1)
+        t_trace = nullptr;
+        g_worker_stats.db_done++;
+        // 해시 계산으로 미뤄진 요청은 재개될 때 한 번 더 집계됨 (worker 를 두 번 쓰므로)
+        metrics_observe_request(type, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                          std::chrono::steady_clock::now() - picked_at).count()),
+                                t_db_round_trips.db_us);
+        if (t_response_deferred)
         {
-            write(g_wake_fd, &u, sizeof(u));
+            t_response_deferred = false; // 응답은 핸들러가 넘긴 콜백이 보냄
+            continue;
         }
+        enqueue_response(task.sock, type, std::move(out_payload), &task.trace);
     } 
 } 
 
@@ -731,25 +1712,40 @@ static void worker_loop(std::string db_url, std::string db_user, std::string db_
 // ============================================================================
 int main(int argc, char **argv)
 { // main 시작
+    log_start(); // 이후 로그는 writer 스레드가 출력
+    request_trace_init(); // 느린 요청 기준 / 표본 간격 (LOUD_SLOW_MS, LOUD_TRACE_SAMPLE)
     srand(static_cast<unsigned int>(time(NULL)));
-    email_init();
+    email_init(restore_pending_signup); // 지난 실행의 가입 대기 정보부터 복원
     file_handler_init("./cloud_storage");
     // 초기화
     signal(SIGPIPE, SIG_IGN); // SIGPIPE 무시(끊긴 소켓 send 방지)
+    signal(SIGHUP, [](int) { grade_table_request_reload(); }); // SIGHUP → grades 재로딩
     int port = DEFAULT_PORT;  // 포트 기본값
-    if (argc >= 2)
-    {                              // 인자 있으면
-        port = std::stoi(argv[1]); // 포트 파싱
+    for (int i = 1; i < argc; ++i)
+    {                                  // --db=... 가 아닌 첫 인자가 포트
+        if (std::strncmp(argv[i], "--", 2) == 0)
+            continue;
+        port = std::stoi(argv[i]); // 포트 파싱
+        break;
     }
 
-    std::string db_url = "jdbc:mariadb://10.10.20.108/3loud"; // DB URL 예시
-    std::string db_user = "gm_3loud";                         // DB 유저 예시
-    std::string db_pw = "1234";                               // DB 비번 예시
+    // 저장소: 기본 mariadb, 접속 정보는 환경변수 / --db-url 등으로 (storage.h 참고)
+    // mariadb 는 worker 수와 무관한 크기의 커넥션 풀, 연결은 백그라운드에서 병렬로 진행
+    // (아래 소켓/epoll 준비와 DB 연결이 겹쳐서 진행됨)
+    StorageConfig db_cfg = storage_config_load(argc, argv);
+    db_cfg.pool_size = DB_POOL_SIZE;
+    g_ryw_window = std::chrono::milliseconds(db_cfg.read_your_writes_ms);
+    std::unique_ptr<StorageBackend> storage = make_storage_backend(db_cfg);
+    LOG_INFO("[Storage] backend=" << storage->name());
+    storage->start();
+    grade_table_start_reloader(*storage, std::chrono::seconds(GRADE_RELOAD_INTERVAL)); // 첫 로드도 여기서
+    quota_ledger_start(*storage, std::chrono::seconds(QUOTA_FLUSH_INTERVAL));
+    message_writer_start(*storage, MSG_WRITER_MAX_ROWS, std::chrono::milliseconds(MSG_WRITER_MAX_DELAY_MS));
 
     int listen_fd = socket(AF_INET, SOCK_STREAM, 0); // 리슨 소켓 생성
     if (listen_fd < 0)
     {                                                              // 실패 검사
-        std::cerr << "socket failed: " << strerror(errno) << "\n"; // 로그
+        LOG_ERROR("socket failed: " << strerror(errno)); // 로그
         return 1;                                                  // 종료
     }
 
@@ -764,21 +1760,21 @@ int main(int argc, char **argv)
 
     if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
     {                                                            // 바인드
-        std::cerr << "bind failed: " << strerror(errno) << "\n"; // 로그
+        LOG_ERROR("bind failed: " << strerror(errno)); // 로그
         safe_close(listen_fd);                                   // close
         return 1;                                                // 종료
     }
 
     if (listen(listen_fd, LISTEN_BACKLOG) < 0)
     {                                                              // 리슨
-        std::cerr << "listen failed: " << strerror(errno) << "\n"; // 로그
+        LOG_ERROR("listen failed: " << strerror(errno)); // 로그
         safe_close(listen_fd);                                     // close
         return 1;                                                  // 종료
     }
 
     if (!set_nonblocking(listen_fd))
     {                                                  // 논블로킹 설정
-        std::cerr << "listen_fd nonblocking failed\n"; // 로그
+        LOG_ERROR("listen_fd nonblocking failed"); // 로그
         safe_close(listen_fd);                         // close
         return 1;                                      // 종료
     }
@@ -786,7 +1782,7 @@ int main(int argc, char **argv)
     int epfd = epoll_create1(0); // epoll fd 생성
     if (epfd < 0)
     {                                                                     // 실패 검사
-        std::cerr << "epoll_create1 failed: " << strerror(errno) << "\n"; // 로그
+        LOG_ERROR("epoll_create1 failed: " << strerror(errno)); // 로그
         safe_close(listen_fd);                                            // close
         return 1;                                                         // 종료
     }
@@ -794,7 +1790,7 @@ int main(int argc, char **argv)
     g_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC); // worker->epoll 깨우기용 eventfd
     if (g_wake_fd < 0)
     {                                                               // 실패 검사
-        std::cerr << "eventfd failed: " << strerror(errno) << "\n"; // 로그
+        LOG_ERROR("eventfd failed: " << strerror(errno)); // 로그
         safe_close(epfd);                                           // close
         safe_close(listen_fd);                                      // close
         return 1;                                                   // 종료
@@ -818,18 +1814,45 @@ int main(int argc, char **argv)
 
     std::vector<std::thread> workers;
 
+    credential_pool_start(CRED_POOL_THREADS, CRED_POOL_QUEUE_MAX); // worker 가 넘기는 비밀번호 해싱
+
     for (int i = 0; i < WORKER_COUNT; ++i)
     {
-        workers.emplace_back(worker_loop, db_url, db_user, db_pw);
+        workers.emplace_back(worker_loop, std::ref(*storage));
     }
 
-    std::cout << "[Server] started port=" << port << "\n"; // 서버 시작 로그
+    // 지표: 읽을 때 현재 값을 가져오는 gauge + 127.0.0.1 Prometheus 포트
+    metrics_register_gauge("loud_sessions_active", "Open client sockets.",
+                           [] { return static_cast<double>(g_active_sessions.load()); });
+    metrics_register_gauge("loud_sessions_logged_in", "Logged-in client sessions.", [] {
+        std::lock_guard<std::mutex> lk(g_login_m);
+        return static_cast<double>(g_login_users.size());
+    });
+    metrics_register_gauge("loud_request_queue_depth", "Requests waiting in g_req_q.", [] {
+        std::lock_guard<std::mutex> lk(g_req_m);
+        return static_cast<double>(g_req_q.size());
+    });
+    // DB 왕복 누적 (message writer 등 요청 밖의 DB 사용 포함) — tests/stmt_cache_round_trips 가 읽음
+    metrics_register_gauge("loud_db_prepares_total", "Statements prepared (cache misses / uncached).",
+                           [] { return static_cast<double>(db_round_trip_totals().prepares); });
+    metrics_register_gauge("loud_db_executes_total", "Statement executions.",
+                           [] { return static_cast<double>(db_round_trip_totals().executes); });
+    metrics_register_gauge("loud_db_round_trips_total", "DB server round trips (prepare + execute + txn control).",
+                           [] { return static_cast<double>(db_round_trip_totals().round_trips); });
+    metrics_register_gauge("loud_db_workers", "DB worker threads.", [] { return static_cast<double>(WORKER_COUNT); });
+    int metrics_port = METRICS_PORT;
+    if (const char *mp = std::getenv("LOUD_METRICS_PORT"))
+        metrics_port = std::atoi(mp);
+    metrics_http_start(metrics_port);
+
+    LOG_INFO("[Server] started port=" << port); // 서버 시작 로그
 
     epoll_event events[EPOLL_MAX_EVENTS]; // 이벤트 배열
 
     // 인증 정보 청소 주기 관리를 위한 변수 선언 (메인 루프 진입 전)
     time_t last_cleanup_time = time(NULL);
     const int CLEANUP_INTERVAL = 10; // 10초마다 청소
+    time_t last_pool_stats_time = last_cleanup_time;
 
     while (g_running.load())
     {                                                             // 메인 루프
@@ -838,17 +1861,110 @@ int main(int argc, char **argv)
         if (now - last_cleanup_time >= CLEANUP_INTERVAL)
         {
             cleanup_pending_map();   // 만료된 데이터 삭제 함수 호출
+            session_token_sweep();   // 만료된 세션 토큰 삭제
             last_cleanup_time = now; // 시간 갱신
             // std::cout << "[System] Cleanup check done.\n"; // (디버깅용 로그)
         }
+        if (now - last_pool_stats_time >= POOL_STATS_INTERVAL)
+        {
+            QuotaStats qs = quota_ledger_stats();
+            LOG_INFO("[Quota] uploading=" << qs.reservations
+                     << " commits=" << qs.commits
+                     << " aborts=" << qs.aborts
+                     << " flushes=" << qs.flushes
+                     << " flushed_rows=" << qs.flushed_rows);
+            MessageWriterStats ms = message_writer_stats();
+            LOG_INFO("[MsgWriter] rows=" << ms.rows
+                     << " batches=" << ms.batches
+                     << " rows/batch=" << (ms.batches ? (double)ms.rows / ms.batches : 0.0)
+                     << " max_batch=" << ms.max_rows
+                     << " queued=" << ms.queued
+                     << " retries=" << ms.retries
+                     << " failed=" << ms.failed);
+            UserCacheStats us = user_cache_stats();
+            LOG_INFO("[UserCache] size=" << us.size
+                     << " hits=" << us.hits
+                     << " misses=" << us.misses
+                     << " invalidations=" << us.invalidations);
+            SessionTokenStats ts = session_token_stats();
+            LOG_INFO("[Tokens] live=" << ts.live
+                     << " issued=" << ts.issued
+                     << " hits=" << ts.hits
+                     << " misses=" << ts.misses
+                     << " revoked=" << ts.revoked);
+            LoginLimiterStats ls = login_limiter_stats();
+            LOG_INFO("[LoginLimit] allowed=" << ls.allowed
+                     << " throttled_ip=" << ls.throttled_ip
+                     << " throttled_account=" << ls.throttled_account
+                     << " table_full=" << ls.table_full);
+            CredentialPoolStats cs = credential_pool_stats();
+            LOG_INFO("[Crypto] hashes=" << cs.hashes
+                     << " avg_us=" << (cs.hashes ? cs.hash_us / cs.hashes : 0)
+                     << " max_us=" << cs.hash_us_max
+                     << " queued=" << cs.queued
+                     << " queued_max=" << cs.queued_max
+                     << " submitted=" << cs.submitted
+                     << " inline=" << cs.inline_runs
+                     << " rejected=" << cs.rejected
+                     << " cache_hits=" << cs.cache_hits
+                     << " cache_misses=" << cs.cache_misses);
+            EmailStats es = email_stats();
+            LOG_INFO("[Email] sent=" << es.sent
+                     << " avg_ms=" << (es.sent ? es.latency_ms / es.sent : 0)
+                     << " max_ms=" << es.latency_ms_max
+                     << " connects=" << es.connects
+                     << " retries=" << es.retries
+                     << " failed=" << es.failed
+                     << " rejected=" << es.rejected
+                     << " queued=" << es.queued);
+            UnreadCounterStats uc = unread_counter_stats();
+            LOG_INFO("[Unread] size=" << uc.size
+                     << " hits=" << uc.hits
+                     << " misses=" << uc.misses);
+            std::ostringstream storage_stats; // 여러 줄 → 로그 한 건 (호출 위치별 빈도 제한에 안 걸리도록)
+            storage->log_stats(storage_stats);
+            for (int t = 1; t < MAX_PACKET_TYPE; ++t)
+            {
+                uint64_t reqs = g_type_rt[t].requests.load();
+                if (reqs == 0)
+                    continue;
+                storage_stats << "[DbRT] type=0x" << std::hex << t << std::dec
+                              << " requests=" << reqs
+                              << " prepares/req=" << (double)g_type_rt[t].prepares.load() / reqs
+                              << " executes/req=" << (double)g_type_rt[t].executes.load() / reqs
+                              << " round_trips/req=" << (double)g_type_rt[t].round_trips.load() / reqs
+                              << (stmt_cache_enabled() ? " (stmt cache on)" : " (stmt cache off)") << "\n";
+            }
+            std::string storage_lines = storage_stats.str();
+            if (!storage_lines.empty() && storage_lines.back() == '\n')
+                storage_lines.pop_back();
+            if (!storage_lines.empty())
+                LOG_INFO(storage_lines);
+            LoggerStats lg = logger_stats();
+            LOG_INFO("[Log] written=" << lg.written
+                     << " flushes=" << lg.flushes
+                     << " dropped=" << lg.dropped
+                     << " suppressed=" << lg.suppressed
+                     << " threads=" << lg.threads);
+            RequestTraceStats rs = request_trace_stats();
+            LOG_INFO("[Trace] finished=" << rs.finished
+                     << " slow=" << rs.slow
+                     << " slow_ms=" << rs.slow_ms
+                     << " sampled=" << rs.sampled);
+            LOG_INFO("[Route] ryw_pinned_reads=" << g_ryw_pinned.load());
+            LOG_INFO("[Workers] db_done=" << g_worker_stats.db_done.load()
+                     << " db_free=" << g_worker_stats.db_free.load());
+            last_pool_stats_time = now;
+        }
         if (n < 0)
         { // 실패
             if (errno == EINTR)
                 continue;                                                  // 시그널이면 재시도
-            std::cerr << "epoll_wait failed: " << strerror(errno) << "\n"; // 로그
+            LOG_ERROR("epoll_wait failed: " << strerror(errno)); // 로그
             break;                                                         // 탈출
         }
 
+        auto loop_t0 = std::chrono::steady_clock::now(); // 이벤트 처리 시간 (epoll_wait 대기 제외)
         for (int i = 0; i < n; ++i)
         {                               // 이벤트 순회
             int fd = events[i].data.fd; // 이벤트 fd
@@ -866,7 +1982,7 @@ int main(int argc, char **argv)
 
                 while (!local.empty())
                 {                                     // 로컬 큐 처리
-                    ResponseTask rt = local.front();  // front
+                    ResponseTask rt = std::move(local.front()); // front
                     local.pop();                      // pop
                     auto it = sessions.find(rt.sock); // 세션 찾기
                     if (it == sessions.end())
@@ -875,15 +1991,22 @@ int main(int argc, char **argv)
 
                     uint32_t len = static_cast<uint32_t>(rt.payload.size()); // payload 길이
                     if (len > static_cast<uint32_t>(MAX_PACKET_SIZE))
-                    {                            // 너무 크면
-                        safe_close(s.sock);      // close
-                        sessions.erase(rt.sock); // 세션 제거
-                        continue;                // 다음
+                    {                                   // 너무 크면
+                        close_session(sessions, rt.sock); // 세션 제거
+                        continue;                       // 다음
                     }
 
+                    if (s.write_buf.empty())
+                        s.flush_since = std::chrono::steady_clock::now(); // 여기서부터 다 보낼 때까지가 flush 시간
                     uint32_t net_len = htonl(len);                                           // 네트워크 바이트 변환
                     s.write_buf.append(reinterpret_cast<char *>(&net_len), sizeof(net_len)); // 길이 추가
                     s.write_buf.append(rt.payload);                                          // payload 추가
+                    s.out_queued += sizeof(net_len) + len;
+                    if (rt.trace)
+                    {
+                        rt.trace->appended = RequestTrace::Clock::now();
+                        s.traces.emplace_back(s.out_queued, std::move(*rt.trace)); // 여기까지 보내지면 완료
+                    }
 
                     // 스트리밍(다운로드) 중인 소켓은 EPOLLOUT 등록 안 함
                     // (worker가 blocking send 완료 후 set_nonblocking 복구 시 자동 처리됨)
@@ -913,7 +2036,7 @@ int main(int argc, char **argv)
                     { // 실패면
                         if (errno == EAGAIN || errno == EWOULDBLOCK)
                             break;                                                 // 더 이상 없음
-                        std::cerr << "accept failed: " << strerror(errno) << "\n"; // 로그
+                        LOG_ERROR("accept failed: " << strerror(errno)); // 로그
                         break;                                                     // 탈출
                     }
 
@@ -926,6 +2049,7 @@ int main(int argc, char **argv)
                     s.sock = cfd;                        // 소켓 저장
                     s.peer_ip = ipbuf;                   // IP 저장
                     s.peer_port = ntohs(caddr.sin_port); // 포트 저장
+                    s.conn_id = conn_open(cfd);          // 접속 번호
 
                     sessions.emplace(cfd, std::move(s)); // 맵에 세션 등록
 
@@ -935,7 +2059,7 @@ int main(int argc, char **argv)
                     add.data.fd = cfd;                         // 클라 fd
                     epoll_ctl(epfd, EPOLL_CTL_ADD, cfd, &add); // epoll add
 
-                    std::cout << "[Accept] fd=" << cfd << " ip=" << ipbuf << "\n"; // 로그
+                    LOG_INFO("[Accept] fd=" << cfd << " ip=" << ipbuf); // 로그
                 } // accept while 끝
                 continue; // 다음 이벤트
             } // listen_fd 처리 끝
@@ -951,6 +2075,7 @@ int main(int argc, char **argv)
             if (events[i].events & EPOLLIN)
             {
                 char buffer[4096]; // 임시 수신 버퍼
+                bool closed = false; // 접속 종료 → 이 fd 의 나머지 처리 건너뜀 (s 는 이미 지워짐)
 
                 // ===============================
                 // 1️⃣ 수신 누적
@@ -962,12 +2087,12 @@ int main(int argc, char **argv)
                     if (n > 0)
                     {
                         s.read_buf.append(buffer, n); // 세션 read_buf에 누적
+                        metrics_add_bytes_in(static_cast<uint64_t>(n));
                     }
                     else if (n == 0)
                     {
-                        logout_unregister(fd); // 로그아웃 처리
-                        safe_close(fd);
-                        sessions.erase(fd);
+                        close_session(sessions, fd); // 로그아웃 / 업로드 예약 해제 포함
+                        closed = true;
                         break;
                     }
                     else
@@ -975,11 +2100,13 @@ int main(int argc, char **argv)
                         if (errno == EAGAIN || errno == EWOULDBLOCK)
                             break;
 
-                        safe_close(fd);
-                        sessions.erase(fd);
+                        close_session(sessions, fd);
+                        closed = true;
                         break;
                     }
                 }
+                if (closed)
+                    continue;
 
                 // ===============================
                 // 2️⃣ 프레이밍 (length-prefix 복원)
@@ -996,8 +2123,8 @@ int main(int argc, char **argv)
 
                     if (len > MAX_PACKET_SIZE)
                     {
-                        safe_close(fd);
-                        sessions.erase(fd);
+                        close_session(sessions, fd);
+                        closed = true;
                         break;
                     }
 
@@ -1008,13 +2135,18 @@ int main(int argc, char **argv)
 
                     s.read_buf.erase(0, 4 + len);
 
+                    if (throttle_credential_attempt(fd, s.peer_ip, payload))
+                        continue; // 거절 응답은 이미 응답 큐에
+
                     {
                         std::lock_guard<std::mutex> lk(g_req_m);
-                        g_req_q.push(Task{fd, payload});
+                        g_req_q.push(Task{fd, payload, s.conn_id, false});
                     }
 
                     g_req_cv.notify_one();
                 }
+                if (closed)
+                    continue;
             } // EPOLLIN 처리 끝
 
             if (events[i].events & EPOLLOUT)
@@ -1031,21 +2163,31 @@ int main(int argc, char **argv)
                     if (n3 > 0)
                     {                                                  // 보냈으면
                         s.write_buf.erase(0, static_cast<size_t>(n3)); // 보낸만큼 제거
+                        metrics_add_bytes_out(static_cast<uint64_t>(n3));
+                        s.out_sent += static_cast<uint64_t>(n3);
+                        while (!s.traces.empty() && s.traces.front().first <= s.out_sent)
+                        {
+                            RequestTrace &done = s.traces.front().second;
+                            done.flushed = RequestTrace::Clock::now();
+                            request_trace_finish(done);
+                            s.traces.pop_front();
+                        }
+                        if (s.write_buf.empty())
+                            metrics_observe_stage(METRIC_RESPONSE_FLUSH, static_cast<uint64_t>(
+                                std::chrono::duration_cast<std::chrono::microseconds>(
+                                    std::chrono::steady_clock::now() - s.flush_since).count()));
                     }
                     else if (n3 == 0)
                     {
-                        logout_unregister(fd); // 로그아웃 처리
-                        safe_close(fd);        // close
-                        sessions.erase(fd);    // 제거
-                        continue;              // 다음
+                        close_session(sessions, fd); // 제거
+                        continue;                    // 다음
                     }
                     else
                     { // n3 < 0
                         if (errno != EAGAIN && errno != EWOULDBLOCK)
-                        {                       // 진짜 에러면
-                            safe_close(fd);     // close
-                            sessions.erase(fd); // 제거
-                            continue;           // 다음
+                        {                                // 진짜 에러면
+                            close_session(sessions, fd); // 제거
+                            continue;                    // 다음
                         }
                     } // else 끝
                 }
@@ -1060,6 +2202,10 @@ int main(int argc, char **argv)
                 }
             } // EPOLLOUT 처리 끝
         } // for 끝
+        if (n > 0)
+            metrics_observe_stage(METRIC_REACTOR_LOOP, static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loop_t0).count()));
+        g_active_sessions.store(sessions.size(), std::memory_order_relaxed);
     } // while 끝
 
     g_running = false;     // 종료 플래그 내리기
@@ -1072,6 +2218,13 @@ int main(int argc, char **argv)
             th.join(); // 스레드 join
         }
     }
+    metrics_http_stop();
+    email_shutdown();       // 대기 중인 인증 메일 발송 후 종료
+    credential_pool_stop(); // worker 종료 후 (남은 해시 계산은 끝내고, 다시 넣은 요청은 버림)
+    grade_table_stop_reloader();
+    message_writer_stop(); // 큐에 남은 메시지 기록 후 종료
+    quota_ledger_stop(); // 남은 사용량 변경분 반영 후 종료
+    storage->stop(); // worker가 모두 반납한 뒤 커넥션 정리
     for (auto &kv : sessions)
     {                               // 남은 세션 정리
         safe_close(kv.second.sock); // close
@@ -1081,6 +2234,7 @@ int main(int argc, char **argv)
     safe_close(epfd);      // epoll close
     safe_close(listen_fd); // listen close
 
-    std::cout << "[Server] stopped\n"; // 종료 로그
+    LOG_INFO("[Server] stopped"); // 종료 로그
+    log_stop();                   // 남은 로그 출력 후 writer 종료
     return 0;                          // main 종료
 } // main 끝
\ No newline at end of file
@@ -0,0 +1,135 @@
+// ============================================================================
+// 파일명: stmt_cache.cpp
+// 목적: StatementCache / db_prepare 구현 (stmt_cache.h 설명 참고)
+// ============================================================================
+#include "stmt_cache.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+thread_local DbRoundTrips t_db_round_trips;
+
+// 프로세스 누적 (지표 / 테스트용)
+static std::atomic<uint64_t> g_prepares{0};
+static std::atomic<uint64_t> g_executes{0};
+static std::atomic<uint64_t> g_round_trips{0};
+
+// 현재 스레드가 대여 중인 커넥션과 그 캐시
+static thread_local sql::Connection *t_bound_conn = nullptr;
+static thread_local StatementCache *t_bound_cache = nullptr;
+
+bool stmt_cache_enabled()
+{
+    static const bool enabled = [] {
+        const char *v = std::getenv("LOUD_STMT_CACHE");
+        return !(v && std::strcmp(v, "0") == 0);
+    }();
+    return enabled;
+}
+
+void db_count_round_trip()
+{
+    t_db_round_trips.round_trips++;
+    g_round_trips.fetch_add(1, std::memory_order_relaxed);
+}
+
+void db_count_prepare()
+{
+    t_db_round_trips.prepares++;
+    g_prepares.fetch_add(1, std::memory_order_relaxed);
+    if (stmt_cache_enabled()) // useServerPrepStmts=true 일 때만 prepare 가 서버까지 감
+        db_count_round_trip();
+}
+
+void db_count_execute()
+{
+    t_db_round_trips.executes++;
+    g_executes.fetch_add(1, std::memory_order_relaxed);
+    db_count_round_trip();
+}
+
+DbRoundTrips db_round_trip_totals()
+{
+    DbRoundTrips t;
+    t.prepares = g_prepares.load(std::memory_order_relaxed);
+    t.executes = g_executes.load(std::memory_order_relaxed);
+    t.round_trips = g_round_trips.load(std::memory_order_relaxed);
+    return t;
+}
+
+StatementCache::Entry *StatementCache::acquire(sql::Connection &conn, const std::string &sql)
+{
+    auto it = map_.find(sql);
+    if (it != map_.end())
+    {
+        Entry &e = it->second;
+        if (e.in_use)
+            return nullptr; // 같은 SQL 을 겹쳐 쓰는 중 → 바인딩 값이 섞이지 않게 따로 prepare
+        lru_.splice(lru_.begin(), lru_, e.lru);
+        e.in_use = true;
+        return &e;
+    }
+
+    if (map_.size() >= MAX_ENTRIES)
+    {
+        // 빌려 가지 않은 항목 중 가장 오래 안 쓴 것 하나만 비움 (정상 운영에서는 도달하지 않음)
+        auto victim = lru_.end();
+        for (auto r = lru_.rbegin(); r != lru_.rend(); ++r)
+        {
+            if (!map_.at(*r).in_use)
+            {
+                victim = std::prev(r.base());
+                break;
+            }
+        }
+        if (victim == lru_.end())
+            return nullptr;
+        map_.erase(*victim);
+        lru_.erase(victim);
+    }
+
+    std::unique_ptr<sql::PreparedStatement> ps(conn.prepareStatement(sql));
+    db_count_prepare();
+    lru_.push_front(sql);
+    Entry &e = map_[sql];
+    e.ps = std::move(ps);
+    e.lru = lru_.begin();
+    e.in_use = true;
+    return &e;
+}
+
+void stmt_cache_bind(sql::Connection *conn, StatementCache *cache)
+{
+    t_bound_conn = conn;
+    t_bound_cache = cache;
+}
+
+void stmt_cache_unbind(sql::Connection *conn)
+{
+    if (t_bound_conn == conn)
+    {
+        t_bound_conn = nullptr;
+        t_bound_cache = nullptr;
+    }
+}
+
+StmtRef db_prepare(sql::Connection &db, const std::string &sql)
+{
+    auto started = std::chrono::steady_clock::now();
+
+    if (stmt_cache_enabled() && t_bound_cache && t_bound_conn == &db)
+    {
+        if (StatementCache::Entry *e = t_bound_cache->acquire(db, sql))
+        {
+            StmtRef ref(e, started); // 먼저 감싸야 예외가 나도 반납됨
+            ref->clearParameters();  // 이전 요청의 바인딩 값 제거
+            return ref;
+        }
+    }
+
+    std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(sql));
+    db_count_prepare();
+    return StmtRef(std::move(ps), started);
+}
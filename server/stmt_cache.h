@@ -0,0 +1,142 @@
+// ============================================================================
+// 파일명: stmt_cache.h
+// 목적: DB 커넥션별 PreparedStatement 캐시 + DB 왕복 횟수 계측
+//
+// - 캐시는 커넥션 풀 슬롯(DbPool::Slot)이 소유 → 커넥션과 수명이 같음
+// - 커넥션을 대여한 스레드에 캐시가 바인딩되고, 핸들러는 db_prepare()로
+//   이미 준비된 statement를 빌려 씀 (SQL 문자열이 키, 빌릴 때 파라미터 초기화)
+// - 상한(128)에 닿으면 빌려 가지 않은 항목 중 가장 오래 안 쓴 것 하나만 비움
+//   (살아 있는 StmtRef 가 가리키는 statement 는 지우지 않음)
+// - 바인딩되지 않은 커넥션이면 기존처럼 매번 prepare 한 statement를 소유해서 반환
+//
+// 사용 예 (기존 std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(...)) 대체):
+//   StmtRef ps = db_prepare(db, "SELECT no FROM users WHERE email = ? LIMIT 1");
+//   ps->setString(1, email);
+//   std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
+//
+// 캐시 on/off 비교: 환경변수 LOUD_STMT_CACHE=0 이면 캐시 미사용 (측정 기준선)
+//   캐시 on  → 서버 측 prepare (miss 마다 prepare 왕복 1 + 실행 왕복 1, hit 이면 실행 왕복 1)
+//   캐시 off → 클라이언트 측 prepare (prepare 왕복 없음, 실행 왕복 1 — 대신 서버가 매번 SQL 파싱)
+// 실행은 StmtRef::executeQuery/executeUpdate/execute 로 해야 왕복 수에 잡힘
+// ============================================================================
+#pragma once
+
+#include <mariadb/conncpp.hpp>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// 스레드별 DB 왕복 카운터 (worker가 요청 단위로 초기화/집계)
+struct DbRoundTrips
+{
+    uint64_t prepares = 0;    // prepareStatement 호출 횟수 (캐시 miss / 캐시 미사용)
+    uint64_t executes = 0;    // statement 실행 횟수 (executeQuery/executeUpdate/execute)
+    uint64_t round_trips = 0; // 서버 왕복 수 (서버 측 prepare + 실행 + 트랜잭션 제어)
+    uint64_t db_us = 0;       // statement 를 빌려 쓴 시간 합 (prepare + 실행 + 결과 읽기, 지표용)
+};
+
+extern thread_local DbRoundTrips t_db_round_trips;
+
+// 카운터 증가 (스레드별 t_db_round_trips + 프로세스 누적 둘 다)
+void db_count_prepare(); // 캐시 사용 중이면 서버 측 prepare → 왕복 1
+void db_count_execute(); // 실행 1 = 왕복 1
+void db_count_round_trip(); // statement 밖의 왕복 (setAutoCommit / commit / rollback)
+
+// 프로세스 누적 (모든 스레드 합 — message writer 처럼 요청 밖에서 쓰는 것도 포함, db_us 는 0)
+DbRoundTrips db_round_trip_totals();
+
+class StatementCache
+{
+public:
+    struct Entry
+    {
+        std::unique_ptr<sql::PreparedStatement> ps;
+        std::list<std::string>::iterator lru; // lru_ 안의 위치
+        bool in_use = false;                  // StmtRef 가 빌려 가는 중 (비우기 대상 아님)
+    };
+
+    // 캐시된 statement 를 빌림 (없으면 prepare 후 저장, 반납은 StmtRef 소멸 시)
+    // 같은 SQL 을 이미 빌려 쓰는 중이거나, 상한에서 비울 수 있는 항목이 없으면 nullptr
+    // (호출자가 따로 prepare 해서 소유)
+    Entry *acquire(sql::Connection &conn, const std::string &sql);
+    // 커넥션을 닫기 전에 반드시 호출 (statement가 커넥션보다 먼저 정리되어야 함)
+    void clear()
+    {
+        map_.clear();
+        lru_.clear();
+    }
+    size_t size() const { return map_.size(); }
+
+private:
+    static constexpr size_t MAX_ENTRIES = 128; // 동적 SQL 폭주 방지용 상한
+    std::unordered_map<std::string, Entry> map_;
+    std::list<std::string> lru_; // 앞쪽이 최근에 빌린 SQL (상한 도달 시 뒤쪽부터 비움)
+};
+
+// 빌린 statement (캐시 것이면 빌리기만, 아니면 소유)
+// 캐시 것은 소멸 시 반납 (그 전에는 캐시가 비우지 않음)
+// db_prepare 부터 소멸까지의 시간을 t_db_round_trips.db_us 에 더함
+class StmtRef
+{
+public:
+    StmtRef(StatementCache::Entry *borrowed, std::chrono::steady_clock::time_point started)
+        : ptr_(borrowed->ps.get()), entry_(borrowed), started_(started) {}
+    StmtRef(std::unique_ptr<sql::PreparedStatement> owned, std::chrono::steady_clock::time_point started)
+        : ptr_(owned.get()), owned_(std::move(owned)), started_(started) {}
+    StmtRef(StmtRef &&o) noexcept
+        : ptr_(o.ptr_), owned_(std::move(o.owned_)), entry_(o.entry_), started_(o.started_), timed_(o.timed_)
+    {
+        o.entry_ = nullptr;
+        o.timed_ = false;
+    }
+    StmtRef &operator=(StmtRef &&) = delete;
+    ~StmtRef()
+    {
+        if (entry_)
+            entry_->in_use = false;
+        if (timed_)
+            t_db_round_trips.db_us += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - started_).count());
+    }
+
+    sql::PreparedStatement *operator->() const { return ptr_; }
+    sql::PreparedStatement &operator*() const { return *ptr_; }
+    sql::PreparedStatement *get() const { return ptr_; }
+
+    // 실행은 여기로 (왕복 수 집계)
+    sql::ResultSet *executeQuery()
+    {
+        db_count_execute();
+        return ptr_->executeQuery();
+    }
+    int executeUpdate()
+    {
+        db_count_execute();
+        return ptr_->executeUpdate();
+    }
+    bool execute()
+    {
+        db_count_execute();
+        return ptr_->execute();
+    }
+
+private:
+    sql::PreparedStatement *ptr_ = nullptr;
+    std::unique_ptr<sql::PreparedStatement> owned_;
+    StatementCache::Entry *entry_ = nullptr; // 캐시에서 빌린 항목 (소유 statement 면 nullptr)
+    std::chrono::steady_clock::time_point started_;
+    bool timed_ = true;
+};
+
+// 현재 스레드에 (커넥션, 캐시) 바인딩 — DbPool::Lease 가 대여/반납 시 호출
+void stmt_cache_bind(sql::Connection *conn, StatementCache *cache);
+void stmt_cache_unbind(sql::Connection *conn);
+
+// 캐시 사용 여부 (LOUD_STMT_CACHE=0 이면 false)
+bool stmt_cache_enabled();
+
+// statement 빌리기
+StmtRef db_prepare(sql::Connection &db, const std::string &sql);
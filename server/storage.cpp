@@ -0,0 +1,77 @@
+// ============================================================================
+// 파일명: storage.cpp
+// 목적: 저장소 설정 로드 + 백엔드 선택 (storage.h 설명 참고)
+// ============================================================================
+#include "storage.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// "a,b,c" → {a, b, c} (빈 항목 무시)
+static std::vector<std::string> split_list(const std::string &v)
+{
+    std::vector<std::string> out;
+    size_t pos = 0;
+    while (pos <= v.size())
+    {
+        size_t comma = v.find(',', pos);
+        if (comma == std::string::npos)
+            comma = v.size();
+        if (comma > pos)
+            out.push_back(v.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    return out;
+}
+
+static void env_override(const char *name, std::string &dst)
+{
+    const char *v = std::getenv(name);
+    if (v && *v)
+        dst = v;
+}
+
+StorageConfig storage_config_load(int argc, char **argv)
+{
+    StorageConfig cfg;
+    env_override("LOUD_DB", cfg.backend);
+    env_override("LOUD_DB_URL", cfg.url);
+    env_override("LOUD_DB_USER", cfg.user);
+    env_override("LOUD_DB_PASSWORD", cfg.pw);
+    if (const char *v = std::getenv("LOUD_MEM_SEED_USERS"))
+        cfg.seed_users = static_cast<size_t>(std::strtoul(v, nullptr, 10));
+    std::string replicas, ryw_ms;
+    env_override("LOUD_DB_REPLICAS", replicas);
+    env_override("LOUD_DB_RYW_MS", ryw_ms);
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        auto take = [&a](const char *key, std::string &dst) {
+            size_t n = std::strlen(key);
+            if (a.compare(0, n, key) != 0)
+                return false;
+            dst = a.substr(n);
+            return true;
+        };
+        if (take("--db=", cfg.backend) || take("--db-url=", cfg.url) ||
+            take("--db-user=", cfg.user) || take("--db-password=", cfg.pw) ||
+            take("--db-replicas=", replicas) || take("--db-ryw-ms=", ryw_ms))
+            continue;
+    }
+    cfg.replica_urls = split_list(replicas);
+    if (!ryw_ms.empty())
+        cfg.read_your_writes_ms = std::max(0, std::atoi(ryw_ms.c_str()));
+    return cfg;
+}
+
+std::unique_ptr<StorageBackend> make_storage_backend(const StorageConfig &cfg)
+{
+    if (cfg.backend == "memory")
+        return make_memory_backend(cfg);
+    if (cfg.backend != "mariadb")
+        LOG_ERROR("[Storage] unknown backend '" << cfg.backend << "', using mariadb");
+    return make_mariadb_backend(cfg);
+}
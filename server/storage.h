@@ -0,0 +1,286 @@
+// ============================================================================
+// 파일명: storage.h
+// 목적: 핸들러가 쓰는 저장소 인터페이스 (users / messages / blacklist / files / grades)
+//
+// - 핸들러와 캐시/장부/writer 는 Storage& 만 사용 (SQL 은 백엔드 구현 안에만)
+// - 백엔드
+//     mariadb : 커넥션 풀 + statement 캐시 (storage_mariadb.cpp, 운영용)
+//     memory  : 프로세스 메모리 (storage_memory.cpp, 외부 DB 없이 부하 측정/CI 용)
+//               트랜잭션은 한 번에 하나씩 (직렬화, 아래 begin() 설명)
+// - Storage 하나 = 요청 하나 동안 쓰는 세션 (mariadb 는 풀에서 대여한 커넥션 하나)
+// - 저장소 오류는 StorageError 로 통일 (백엔드 고유 예외는 밖으로 나오지 않음)
+//
+// 설정 (환경변수, main 인자 --db=... 가 우선):
+//   LOUD_DB          = mariadb(기본) | memory
+//   LOUD_DB_URL      = jdbc:mariadb://host/db
+//   LOUD_DB_USER / LOUD_DB_PASSWORD
+//   LOUD_MEM_SEED_USERS = N   memory 백엔드 시작 시 bench 유저 N명 생성
+//   LOUD_DB_REPLICAS = url1,url2   읽기 전용 복제본 (계정은 LOUD_DB_USER 와 같음, 없으면 주 DB 만)
+//   LOUD_DB_RYW_MS   = 2000        쓰기 후 이 시간 동안 그 유저의 읽기는 주 DB 로 (read-your-writes)
+//
+// 복제본 로컬 시험 예:
+//   LOUD_DB_URL=jdbc:mariadb://127.0.0.1:3306/3loud LOUD_DB_REPLICAS=jdbc:mariadb://127.0.0.1:3307/3loud ./server_app
+//   (3307 은 3306 의 replica 로 설정한 두 번째 mariadbd)
+//
+// 사용 예 (worker):
+//   std::unique_ptr<Storage> db = backend.open();
+//   if (!db) { ... VALUE_ERR_DB 응답 ... }
+//   handle_xxx(req, *db);
+// ============================================================================
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 저장소 오류 (mariadb 는 SQLException 을 감싸서 던짐)
+class StorageError : public std::runtime_error
+{
+public:
+    explicit StorageError(const std::string &what, int code = 0, bool duplicate = false)
+        : std::runtime_error(what), code_(code), duplicate_(duplicate) {}
+
+    int code() const { return code_; }             // 백엔드 오류 코드 (mariadb errno, 없으면 0)
+    bool duplicate() const { return duplicate_; }  // UNIQUE 제약 위반
+
+private:
+    int code_;
+    bool duplicate_;
+};
+
+// ── 행 타입 ──────────────────────────────────────────────────────────────────
+
+struct UserRow
+{
+    uint32_t no = 0;
+    std::string email;
+    std::string pw_hash;
+    std::string nickname;
+    int grade = 1;
+    bool is_active = true;
+    int64_t storage_used = 0;
+    std::string created_at;
+};
+
+// 설정 화면에서 바꿀 수 있는 users 컬럼
+enum class UserField
+{
+    EMAIL,
+    PW_HASH,
+    NICKNAME,
+    GRADE
+};
+
+// 관리자 목록 필터 (no 기준 seek)
+struct UserListFilter
+{
+    uint32_t after_no = 0; // 이 no 다음부터
+    int limit = 100;       // 최대 행 수
+    int active = -1;       // -1 전체, 0 비활성, 1 활성
+    std::string prefix;    // email 또는 nickname 접두어 (비어 있으면 조건 없음)
+    int grade = 0;         // 0 이면 전체
+};
+
+// 메시지 목록 커서 (sent_at 원본 정밀도 + msg_id)
+struct MessageCursor
+{
+    std::string sent_at;
+    uint32_t msg_id = 0;
+};
+
+struct MessageRow
+{
+    uint32_t msg_id = 0;
+    std::string from_email;
+    std::string content;
+    bool is_read = false;
+    std::string sent_at;     // 표시용 'YYYY-MM-DD HH:MM:SS'
+    std::string sent_at_key; // 커서용 원본 값
+};
+
+// 수신자 email -> 안읽은 메시지 수 변화량 (삭제로 줄어든 수 등)
+using UnreadDeltas = std::unordered_map<std::string, int>;
+
+struct NewMessage
+{
+    std::string from_email;
+    std::string to_email;
+    std::string content;
+};
+
+struct BlacklistRow
+{
+    std::string blocked_email;
+    std::string created_at;
+};
+
+struct FileRow
+{
+    int64_t file_id = 0;
+    std::string file_name;
+    int64_t file_size = 0;
+    std::string file_path;
+    std::string created_at;
+};
+
+// ── 저장소 인터페이스 ────────────────────────────────────────────────────────
+
+class UserRepo
+{
+public:
+    virtual ~UserRepo() = default;
+
+    // 조회 (없으면 false)
+    virtual bool user_by_email(const std::string &email, UserRow &out) = 0;
+    virtual bool user_by_no(uint32_t no, UserRow &out) = 0;
+    virtual bool email_exists(const std::string &email) = 0;
+    virtual bool nickname_exists(const std::string &nickname) = 0;
+
+    // 가입 (grade 1, 활성)
+    virtual void create_user(const std::string &email, const std::string &pw_hash,
+                             const std::string &nickname) = 0;
+
+    // 변경 (영향받은 행 수)
+    virtual int deactivate_user_by_email(const std::string &email) = 0;
+    virtual int set_user_active(uint32_t no, bool active) = 0;
+    virtual int update_user_field(uint32_t no, UserField field, const std::string &value) = 0;
+
+    // 메시지 기본 머리말/꼬리말 (유저 없으면 false)
+    virtual bool message_prefs(uint32_t no, std::string &prefix, std::string &suffix) = 0;
+    virtual int set_message_prefs(uint32_t no, const std::string &prefix, const std::string &suffix) = 0;
+
+    // 관리자 목록 (no 오름차순, 최대 filter.limit 행)
+    virtual std::vector<UserRow> list_users(const UserListFilter &filter) = 0;
+
+    // users.storage_used (유저 없으면 -1) / 변경분 반영 (delta, 0 아래로 내려가지 않음)
+    virtual int64_t storage_used(uint32_t no) = 0;
+    virtual void apply_storage_deltas(const std::vector<std::pair<uint32_t, int64_t>> &deltas) = 0;
+};
+
+class MessageRepo
+{
+public:
+    virtual ~MessageRepo() = default;
+
+    // users.unread_count 도 같은 트랜잭션에서 갱신 (아래 삭제 / 읽음 처리도 동일)
+    virtual void insert_messages(const std::vector<NewMessage> &msgs) = 0;
+
+    // users.unread_count (유저 없으면 -1)
+    virtual int64_t unread_count(const std::string &to_email) = 0;
+
+    // 수신함 (sent_at, msg_id) 내림차순
+    // after 가 있으면 그 다음부터 (offset 무시), exclude_from 은 보낸 사람 제외 목록
+    virtual std::vector<MessageRow> list_messages(const std::string &to_email, const MessageCursor *after,
+                                                  int offset, int limit,
+                                                  const std::vector<std::string> &exclude_from) = 0;
+
+    // 수신자 또는 송신자가 owner 인 메시지 삭제 → 실제 삭제된 id
+    // unread_removed 에는 안읽은 채 삭제된 메시지 수 (수신자별, 음수)
+    virtual std::vector<uint32_t> delete_messages(const std::string &owner_email,
+                                                  const std::vector<uint32_t> &ids,
+                                                  UnreadDeltas *unread_removed) = 0;
+
+    // 읽음 처리 (내 수신함에 있으면 1, changed 에는 새로 읽음 처리됐으면 1)
+    virtual int mark_read(const std::string &to_email, uint32_t msg_id, int *changed) = 0;
+    // ids 중 내 수신함에 있는 id 반환, changed 에는 새로 읽음 처리된 수
+    virtual std::vector<uint32_t> mark_read_many(const std::string &to_email,
+                                                 const std::vector<uint32_t> &ids, int *changed) = 0;
+    // 커서 행과 그보다 오래된 메시지 모두
+    virtual int mark_read_up_to(const std::string &to_email, const MessageCursor &upto) = 0;
+};
+
+class BlacklistRepo
+{
+public:
+    virtual ~BlacklistRepo() = default;
+
+    virtual std::vector<std::string> blocked_emails(const std::string &owner_email) = 0;
+    virtual std::vector<BlacklistRow> list_blacklist(const std::string &owner_email) = 0; // 최근순
+    virtual void add_block(const std::string &owner_email, const std::string &blocked_email) = 0; // 중복이면 duplicate
+    virtual int remove_block(const std::string &owner_email, const std::string &blocked_email) = 0;
+};
+
+class FileRepo
+{
+public:
+    virtual ~FileRepo() = default;
+
+    virtual int64_t insert_file(const std::string &name, int64_t size, const std::string &path, uint32_t owner_no) = 0;
+    virtual bool file_by_id(int64_t file_id, uint32_t owner_no, FileRow &out) = 0;
+    virtual int delete_file(int64_t file_id, uint32_t owner_no) = 0;
+    // path_prefix 로 시작하는 파일만 (비어 있으면 전체), 최근순
+    virtual std::vector<FileRow> list_files(uint32_t owner_no, const std::string &path_prefix) = 0;
+    virtual int count_files(uint32_t owner_no, const std::string &path_prefix) = 0;
+};
+
+class GradeRepo
+{
+public:
+    virtual ~GradeRepo() = default;
+
+    virtual std::unordered_map<int, int64_t> grade_limits() = 0; // grade -> max_filesize
+};
+
+// 요청 하나 동안 쓰는 저장소 세션
+class Storage : public UserRepo, public MessageRepo, public BlacklistRepo, public FileRepo, public GradeRepo
+{
+public:
+    // 여러 변경을 한 트랜잭션으로 (이미 트랜잭션 안이면 in_transaction() == true)
+    // memory 백엔드는 트랜잭션을 직렬화: begin 부터 commit/rollback 까지 다른 세션의 연산은 대기
+    // (트랜잭션 중인 세션을 연 스레드에서 다른 세션을 열어 쓰면 안 됨)
+    virtual void begin() = 0;
+    virtual void commit() = 0;
+    virtual void rollback() = 0;
+    virtual bool in_transaction() = 0;
+
+    // 처리 중 예상 못 한 저장소 오류 → 반납 시 세션 자원을 버림 (mariadb: 재연결)
+    virtual void discard() {}
+
+    // 복제본 세션이면 true (복제 지연이 있으므로 캐시/장부에 채워 넣지 않음)
+    virtual bool is_replica() const { return false; }
+};
+
+// ── 백엔드 ───────────────────────────────────────────────────────────────────
+
+struct StorageConfig
+{
+    std::string backend = "mariadb"; // mariadb | memory
+    std::string url = "jdbc:mariadb://10.10.20.108/3loud";
+    std::string user = "gm_3loud";
+    std::string pw = "1234";
+    size_t pool_size = 4;   // mariadb 커넥션 수
+    size_t seed_users = 0;  // memory: 시작 시 만들 bench 유저 수
+    std::vector<std::string> replica_urls; // mariadb: 읽기 전용 복제본
+    int read_your_writes_ms = 2000;        // 쓰기 후 주 DB 에 고정하는 시간
+};
+
+class StorageBackend
+{
+public:
+    virtual ~StorageBackend() = default;
+
+    virtual const char *name() const = 0;
+    virtual void start() = 0; // 즉시 반환 (연결은 백그라운드)
+    virtual void stop() = 0;  // 빌려준 세션이 모두 반납된 뒤 호출
+
+    // 세션 열기 (연결 불가 / 시간 초과면 nullptr)
+    virtual std::unique_ptr<Storage> open() = 0;
+
+    // 읽기 전용 요청용 세션 (복제본이 있으면 복제본, 없거나 모두 불가면 open() 과 같음)
+    virtual std::unique_ptr<Storage> open_read() { return open(); }
+
+    // 주기 통계 로그 한 줄 이상
+    virtual void log_stats(std::ostream &os) = 0;
+};
+
+// 기본값 ← 환경변수 ← 인자(--db=, --db-url=, --db-user=, --db-password=, --db-replicas=, --db-ryw-ms=) 순으로 덮어씀
+StorageConfig storage_config_load(int argc, char **argv);
+
+std::unique_ptr<StorageBackend> make_storage_backend(const StorageConfig &cfg);
+std::unique_ptr<StorageBackend> make_mariadb_backend(const StorageConfig &cfg);
+std::unique_ptr<StorageBackend> make_memory_backend(const StorageConfig &cfg);
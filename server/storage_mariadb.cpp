@@ -0,0 +1,865 @@
+// ============================================================================
+// 파일명: storage_mariadb.cpp
+// 목적: MariaDB 저장소 백엔드 (storage.h 설명 참고)
+//
+// - 세션 = DbPool 에서 대여한 커넥션 하나 (세션 소멸 시 반납)
+// - SQL 은 모두 db_prepare (커넥션별 statement 캐시) 사용
+// - sql::SQLException 은 StorageError 로 바꿔서 던짐 (1062 = UNIQUE 위반)
+// - users.unread_count 는 메시지를 바꾸는 문장과 같은 트랜잭션에서 갱신
+// - 복제본이 설정되면 open_read() 는 복제본 풀을 돌아가며 대여
+//   (복제본 대여 실패 시 주 DB 로, 복제본 커넥션은 READ ONLY 세션)
+// ============================================================================
+#include "storage.h"
+#include "db_pool.h"
+#include "stmt_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+static constexpr int MARIADB_ER_DUP_ENTRY = 1062;
+static constexpr size_t MSG_LIST_NOT_IN_MAX = 512;        // 넘으면 NOT IN 바인딩 대신 anti-join
+static constexpr size_t MSG_INSERT_MAX_ROWS = 64;         // INSERT 한 문장에 넣는 최대 행 수
+static constexpr std::chrono::milliseconds REPLICA_ACQUIRE_TIMEOUT{200}; // 넘으면 주 DB 로 읽기
+
+namespace
+{
+// "(?, ?, ...)" 자리수를 2의 거듭제곱으로 올림 → statement 캐시에 쌓이는 SQL 종류 제한
+size_t pow2_at_least(size_t n)
+{
+    size_t cnt = 1;
+    while (cnt < n)
+        cnt *= 2;
+    return cnt;
+}
+
+std::string placeholders(size_t n)
+{
+    std::string s = "(?";
+    for (size_t i = 1; i < n; ++i)
+        s += ", ?";
+    s += ")";
+    return s;
+}
+
+// 남는 자리는 마지막 값을 반복 (IN / NOT IN 결과에 영향 없음)
+int bind_ids(StmtRef &ps, int idx, const std::vector<uint32_t> &ids, size_t bind_count)
+{
+    for (size_t i = 0; i < bind_count; ++i)
+        ps->setUInt(idx++, ids[std::min(i, ids.size() - 1)]);
+    return idx;
+}
+
+std::vector<uint32_t> collect_ids(StmtRef &ps)
+{
+    std::vector<uint32_t> ids;
+    std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+    while (rs->next())
+        ids.push_back(rs->getUInt(1));
+    return ids;
+}
+
+UserRow read_user(sql::ResultSet &rs)
+{
+    UserRow u;
+    u.no = rs.getUInt("no");
+    u.email = rs.getString("email").c_str();
+    u.pw_hash = rs.getString("pw_hash").c_str();
+    u.nickname = rs.getString("nickname").c_str();
+    u.grade = rs.getInt("grade");
+    u.is_active = rs.getInt("is_active") != 0;
+    u.storage_used = rs.getInt64("storage_used");
+    u.created_at = rs.getString("created_at").c_str();
+    return u;
+}
+
+const char *const SELECT_USER =
+    "SELECT no, email, pw_hash, nickname, grade, is_active, storage_used, created_at FROM users ";
+
+// SQLException → StorageError
+template <typename F>
+auto guarded(F &&f) -> decltype(f())
+{
+    try
+    {
+        return f();
+    }
+    catch (const sql::SQLException &e)
+    {
+        throw StorageError(e.what(), e.getErrorCode(), e.getErrorCode() == MARIADB_ER_DUP_ENTRY);
+    }
+}
+
+class MariaStorage : public Storage
+{
+public:
+    MariaStorage(DbPool::Lease lease, bool replica)
+        : lease_(std::move(lease)), db_(*lease_), replica_(replica) {}
+
+    ~MariaStorage() override
+    {
+        if (in_txn_)
+        {
+            try
+            {
+                db_count_round_trip();
+                db_.rollback();
+                db_count_round_trip();
+                db_.setAutoCommit(true);
+            }
+            catch (...)
+            {
+                lease_.discard();
+            }
+        }
+    }
+
+    // ── 트랜잭션 ──
+    void begin() override
+    {
+        guarded([&] {
+            db_count_round_trip();
+            db_.setAutoCommit(false);
+        });
+        in_txn_ = true;
+    }
+    void commit() override
+    {
+        guarded([&] {
+            db_count_round_trip();
+            db_.commit();
+            db_count_round_trip();
+            db_.setAutoCommit(true);
+        });
+        in_txn_ = false;
+    }
+    void rollback() override
+    {
+        in_txn_ = false;
+        guarded([&] {
+            db_count_round_trip();
+            db_.rollback();
+            db_count_round_trip();
+            db_.setAutoCommit(true);
+        });
+    }
+    bool in_transaction() override { return in_txn_; }
+    void discard() override { lease_.discard(); }
+    bool is_replica() const override { return replica_; }
+
+    // ── users ──
+    bool user_by_email(const std::string &email, UserRow &out) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, std::string(SELECT_USER) + "WHERE email = ? LIMIT 1"));
+            ps->setString(1, email);
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            if (!rs->next())
+                return false;
+            out = read_user(*rs);
+            return true;
+        });
+    }
+
+    bool user_by_no(uint32_t no, UserRow &out) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, std::string(SELECT_USER) + "WHERE no = ? LIMIT 1"));
+            ps->setUInt(1, no);
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            if (!rs->next())
+                return false;
+            out = read_user(*rs);
+            return true;
+        });
+    }
+
+    bool email_exists(const std::string &email) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "SELECT 1 FROM users WHERE email = ?"));
+            ps->setString(1, email);
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            return rs->next();
+        });
+    }
+
+    bool nickname_exists(const std::string &nickname) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "SELECT 1 FROM users WHERE nickname = ?"));
+            ps->setString(1, nickname);
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            return rs->next();
+        });
+    }
+
+    void create_user(const std::string &email, const std::string &pw_hash, const std::string &nickname) override
+    {
+        guarded([&] {
+            StmtRef ps(db_prepare(db_,
+                "INSERT INTO users (email, pw_hash, nickname, grade, is_active) VALUES (?, ?, ?, 1, 1)"));
+            ps->setString(1, email);
+            ps->setString(2, pw_hash);
+            ps->setString(3, nickname);
+            ps.executeUpdate();
+        });
+    }
+
+    int deactivate_user_by_email(const std::string &email) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "UPDATE users SET is_active = 0 WHERE email = ?"));
+            ps->setString(1, email);
+            return ps.executeUpdate();
+        });
+    }
+
+    int set_user_active(uint32_t no, bool active) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "UPDATE users SET is_active = ? WHERE no = ?"));
+            ps->setInt(1, active ? 1 : 0);
+            ps->setUInt(2, no);
+            return ps.executeUpdate();
+        });
+    }
+
+    int update_user_field(uint32_t no, UserField field, const std::string &value) override
+    {
+        const char *sql_text = nullptr;
+        switch (field)
+        {
+        case UserField::EMAIL:
+            sql_text = "UPDATE users SET email = ? WHERE no = ?";
+            break;
+        case UserField::PW_HASH:
+            sql_text = "UPDATE users SET pw_hash = ? WHERE no = ?";
+            break;
+        case UserField::NICKNAME:
+            sql_text = "UPDATE users SET nickname = ? WHERE no = ?";
+            break;
+        case UserField::GRADE:
+            sql_text = "UPDATE users SET grade = ? WHERE no = ?";
+            break;
+        }
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, sql_text));
+            ps->setString(1, value); // grade 도 문자열로 바인딩 (MariaDB 가 형변환)
+            ps->setUInt(2, no);
+            return ps.executeUpdate();
+        });
+    }
+
+    bool message_prefs(uint32_t no, std::string &prefix, std::string &suffix) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "SELECT default_prefix, default_suffix FROM users WHERE no = ? LIMIT 1"));
+            ps->setUInt(1, no);
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            if (!rs->next())
+                return false;
+            prefix = rs->isNull("default_prefix") ? "" : rs->getString("default_prefix").c_str();
+            suffix = rs->isNull("default_suffix") ? "" : rs->getString("default_suffix").c_str();
+            return true;
+        });
+    }
+
+    int set_message_prefs(uint32_t no, const std::string &prefix, const std::string &suffix) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "UPDATE users SET default_prefix = ?, default_suffix = ? WHERE no = ?"));
+            ps->setString(1, prefix);
+            ps->setString(2, suffix);
+            ps->setUInt(3, no);
+            return ps.executeUpdate();
+        });
+    }
+
+    std::vector<UserRow> list_users(const UserListFilter &f) override
+    {
+        return guarded([&] {
+            std::string q = std::string(SELECT_USER) + "WHERE no > ?";
+            if (f.active >= 0)
+                q += " AND is_active = ?";
+            if (!f.prefix.empty())
+                q += " AND (email LIKE ? OR nickname LIKE ?)";
+            if (f.grade > 0)
+                q += " AND grade = ?";
+            q += " ORDER BY no LIMIT ?";
+
+            StmtRef ps(db_prepare(db_, q));
+            int idx = 1;
+            ps->setUInt(idx++, f.after_no);
+            if (f.active >= 0)
+                ps->setInt(idx++, f.active);
+            if (!f.prefix.empty())
+            {
+                // LIKE 와일드카드 이스케이프 후 접두어 매칭
+                std::string pat;
+                for (char c : f.prefix)
+                {
+                    if (c == '%' || c == '_' || c == '\\')
+                        pat += '\\';
+                    pat += c;
+                }
+                pat += '%';
+                ps->setString(idx++, pat);
+                ps->setString(idx++, pat);
+            }
+            if (f.grade > 0)
+                ps->setInt(idx++, f.grade);
+            ps->setInt(idx++, f.limit);
+
+            std::vector<UserRow> rows;
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            while (rs->next())
+                rows.push_back(read_user(*rs));
+            return rows;
+        });
+    }
+
+    int64_t storage_used(uint32_t no) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "SELECT storage_used FROM users WHERE no = ?"));
+            ps->setUInt(1, no);
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            return rs->next() ? static_cast<int64_t>(rs->getInt64(1)) : int64_t(-1);
+        });
+    }
+
+    void apply_storage_deltas(const std::vector<std::pair<uint32_t, int64_t>> &deltas) override
+    {
+        guarded([&] {
+            StmtRef ps(db_prepare(db_, "UPDATE users SET storage_used = GREATEST(0, storage_used + ?) WHERE no = ?"));
+            for (auto &d : deltas)
+            {
+                ps->setInt64(1, d.second);
+                ps->setUInt(2, d.first);
+                ps.executeUpdate();
+            }
+        });
+    }
+
+    // ── messages ──
+    void insert_messages(const std::vector<NewMessage> &msgs) override
+    {
+        if (msgs.empty())
+            return;
+        guarded([&] { atomically([&] {
+            size_t pos = 0;
+            while (pos < msgs.size())
+            {
+                size_t rows = 1; // 남은 수 이하의 가장 큰 2의 거듭제곱
+                while (rows * 2 <= msgs.size() - pos && rows * 2 <= MSG_INSERT_MAX_ROWS)
+                    rows *= 2;
+
+                std::string q = "INSERT INTO messages (from_email, to_email, content) VALUES (?, ?, ?)";
+                for (size_t i = 1; i < rows; ++i)
+                    q += ", (?, ?, ?)";
+                StmtRef ps(db_prepare(db_, q));
+                int idx = 1;
+                for (size_t i = pos; i < pos + rows; ++i)
+                {
+                    ps->setString(idx++, msgs[i].from_email);
+                    ps->setString(idx++, msgs[i].to_email);
+                    ps->setString(idx++, msgs[i].content);
+                }
+                ps.executeUpdate();
+                pos += rows;
+            }
+
+            UnreadDeltas added;
+            for (const auto &m : msgs)
+                added[m.to_email]++;
+            bump_unread(added);
+        }); });
+    }
+
+    int64_t unread_count(const std::string &to_email) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "SELECT unread_count FROM users WHERE email = ?"));
+            ps->setString(1, to_email);
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            return rs->next() ? static_cast<int64_t>(rs->getInt64(1)) : int64_t(-1);
+        });
+    }
+
+    std::vector<MessageRow> list_messages(const std::string &to_email, const MessageCursor *after,
+                                          int offset, int limit,
+                                          const std::vector<std::string> &exclude_from) override
+    {
+        return guarded([&] {
+            std::string q =
+                "SELECT msg_id, from_email, content, is_read, "
+                "DATE_FORMAT(sent_at, '%Y-%m-%d %H:%i:%s') AS sent_at, "
+                "sent_at AS sent_at_key "
+                "FROM messages m "
+                "WHERE m.to_email = ? ";
+            if (after)
+            {
+                // seek: 커서보다 오래된 행부터 (같은 시각이면 msg_id 로 구분)
+                q += "AND (m.sent_at < ? OR (m.sent_at = ? AND m.msg_id < ?)) ";
+            }
+            size_t bind_count = 0;
+            if (exclude_from.size() > MSG_LIST_NOT_IN_MAX)
+            {
+                // 아주 큰 차단 목록은 바인딩 대신 blacklist 와 anti-join
+                q += "AND m.from_email NOT IN (SELECT blocked_email FROM blacklist WHERE owner_email = ?) ";
+            }
+            else if (!exclude_from.empty())
+            {
+                bind_count = pow2_at_least(exclude_from.size());
+                q += "AND m.from_email NOT IN " + placeholders(bind_count) + " ";
+            }
+            q += "ORDER BY m.sent_at DESC, m.msg_id DESC ";
+            q += after ? "LIMIT ?" : "LIMIT ? OFFSET ?";
+
+            StmtRef ps(db_prepare(db_, q));
+            int idx = 1;
+            ps->setString(idx++, to_email);
+            if (after)
+            {
+                ps->setString(idx++, after->sent_at);
+                ps->setString(idx++, after->sent_at);
+                ps->setUInt(idx++, after->msg_id);
+            }
+            if (exclude_from.size() > MSG_LIST_NOT_IN_MAX)
+                ps->setString(idx++, to_email); // blacklist 주인 = 수신자
+            for (size_t i = 0; i < bind_count; ++i)
+                ps->setString(idx++, exclude_from[std::min(i, exclude_from.size() - 1)]);
+            ps->setInt(idx++, limit);
+            if (!after)
+                ps->setInt(idx++, offset);
+
+            std::vector<MessageRow> rows;
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            while (rs->next())
+            {
+                MessageRow r;
+                r.msg_id = rs->getUInt("msg_id");
+                r.from_email = rs->getString("from_email").c_str();
+                r.content = rs->getString("content").c_str();
+                r.is_read = rs->getInt("is_read") != 0;
+                r.sent_at = rs->getString("sent_at").c_str();
+                r.sent_at_key = rs->getString("sent_at_key").c_str();
+                rows.push_back(std::move(r));
+            }
+            return rows;
+        });
+    }
+
+    std::vector<uint32_t> delete_messages(const std::string &owner_email, const std::vector<uint32_t> &ids,
+                                          UnreadDeltas *unread_removed) override
+    {
+        if (ids.empty())
+            return {};
+        std::vector<uint32_t> deleted;
+        guarded([&] { atomically([&] {
+            // 한 문장 (RETURNING 으로 실제 삭제된 id 회수, MariaDB 10.0.5+)
+            size_t bind_count = pow2_at_least(ids.size());
+            StmtRef ps(db_prepare(db_,
+                "DELETE FROM messages WHERE msg_id IN " + placeholders(bind_count) +
+                " AND (to_email = ? OR from_email = ?) RETURNING msg_id, to_email, is_read"));
+            int idx = bind_ids(ps, 1, ids, bind_count);
+            ps->setString(idx++, owner_email);
+            ps->setString(idx++, owner_email);
+
+            UnreadDeltas removed;
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            while (rs->next())
+            {
+                deleted.push_back(rs->getUInt(1));
+                if (rs->getInt(3) == 0)
+                    removed[rs->getString(2).c_str()]--;
+            }
+            rs.reset();
+
+            bump_unread(removed);
+            if (unread_removed)
+                *unread_removed = std::move(removed);
+        }); });
+        return deleted;
+    }
+
+    int mark_read(const std::string &to_email, uint32_t msg_id, int *changed) override
+    {
+        int found = 0;
+        guarded([&] { atomically([&] {
+            StmtRef ps(db_prepare(db_, "UPDATE messages SET is_read = 1 WHERE msg_id = ? AND to_email = ? AND is_read = 0"));
+            ps->setUInt(1, msg_id);
+            ps->setString(2, to_email);
+            int n = ps.executeUpdate();
+            if (changed)
+                *changed = n;
+            if (n > 0)
+            {
+                bump_unread(to_email, -n);
+                found = 1;
+                return;
+            }
+
+            // 이미 읽은 메시지도 찾은 것으로 봄
+            StmtRef chk(db_prepare(db_, "SELECT 1 FROM messages WHERE msg_id = ? AND to_email = ?"));
+            chk->setUInt(1, msg_id);
+            chk->setString(2, to_email);
+            std::unique_ptr<sql::ResultSet> rs(chk.executeQuery());
+            found = rs->next() ? 1 : 0;
+        }); });
+        return found;
+    }
+
+    std::vector<uint32_t> mark_read_many(const std::string &to_email, const std::vector<uint32_t> &ids,
+                                         int *changed) override
+    {
+        if (ids.empty())
+            return {};
+        std::vector<uint32_t> found;
+        guarded([&] { atomically([&] {
+            size_t bind_count = pow2_at_least(ids.size());
+            std::string in = "msg_id IN " + placeholders(bind_count);
+
+            StmtRef upd(db_prepare(db_,
+                "UPDATE messages SET is_read = 1 WHERE " + in + " AND to_email = ? AND is_read = 0"));
+            int idx = bind_ids(upd, 1, ids, bind_count);
+            upd->setString(idx, to_email);
+            int n = upd.executeUpdate();
+            if (changed)
+                *changed = n;
+            bump_unread(to_email, -n);
+
+            // 이미 읽은 메시지도 성공으로 보므로 "내 수신함에 있는 id" 를 따로 확인
+            StmtRef chk(db_prepare(db_, "SELECT msg_id FROM messages WHERE " + in + " AND to_email = ?"));
+            idx = bind_ids(chk, 1, ids, bind_count);
+            chk->setString(idx, to_email);
+            found = collect_ids(chk);
+        }); });
+        return found;
+    }
+
+    int mark_read_up_to(const std::string &to_email, const MessageCursor &upto) override
+    {
+        int n = 0;
+        guarded([&] { atomically([&] {
+            StmtRef ps(db_prepare(db_,
+                "UPDATE messages SET is_read = 1 "
+                "WHERE to_email = ? AND is_read = 0 "
+                "AND (sent_at < ? OR (sent_at = ? AND msg_id <= ?))"));
+            ps->setString(1, to_email);
+            ps->setString(2, upto.sent_at);
+            ps->setString(3, upto.sent_at);
+            ps->setUInt(4, upto.msg_id);
+            n = ps.executeUpdate();
+            bump_unread(to_email, -n);
+        }); });
+        return n;
+    }
+
+    // ── blacklist ──
+    std::vector<std::string> blocked_emails(const std::string &owner_email) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "SELECT blocked_email FROM blacklist WHERE owner_email = ?"));
+            ps->setString(1, owner_email);
+            std::vector<std::string> out;
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            while (rs->next())
+                out.push_back(rs->getString(1).c_str());
+            return out;
+        });
+    }
+
+    std::vector<BlacklistRow> list_blacklist(const std::string &owner_email) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_,
+                "SELECT blocked_email, "
+                "DATE_FORMAT(created_at, '%Y-%m-%d %H:%i:%s') AS created_at "
+                "FROM blacklist "
+                "WHERE owner_email = ? "
+                "ORDER BY created_at DESC"));
+            ps->setString(1, owner_email);
+            std::vector<BlacklistRow> out;
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            while (rs->next())
+                out.push_back({rs->getString("blocked_email").c_str(), rs->getString("created_at").c_str()});
+            return out;
+        });
+    }
+
+    void add_block(const std::string &owner_email, const std::string &blocked_email) override
+    {
+        guarded([&] {
+            StmtRef ps(db_prepare(db_, "INSERT INTO blacklist (owner_email, blocked_email) VALUES (?, ?)"));
+            ps->setString(1, owner_email);
+            ps->setString(2, blocked_email);
+            ps.executeUpdate();
+        });
+    }
+
+    int remove_block(const std::string &owner_email, const std::string &blocked_email) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "DELETE FROM blacklist WHERE owner_email = ? AND blocked_email = ?"));
+            ps->setString(1, owner_email);
+            ps->setString(2, blocked_email);
+            return ps.executeUpdate();
+        });
+    }
+
+    // ── files ──
+    int64_t insert_file(const std::string &name, int64_t size, const std::string &path, uint32_t owner_no) override
+    {
+        return guarded([&] {
+            StmtRef ins(db_prepare(db_,
+                "INSERT INTO files (file_name, file_size, file_path, no) VALUES (?, ?, ?, ?)"));
+            ins->setString(1, name);
+            ins->setInt64(2, size);
+            ins->setString(3, path);
+            ins->setUInt(4, owner_no);
+            ins.executeUpdate();
+
+            StmtRef st(db_prepare(db_, "SELECT LAST_INSERT_ID()"));
+            std::unique_ptr<sql::ResultSet> rs(st.executeQuery());
+            return rs->next() ? static_cast<int64_t>(rs->getInt64(1)) : int64_t(-1);
+        });
+    }
+
+    bool file_by_id(int64_t file_id, uint32_t owner_no, FileRow &out) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_,
+                "SELECT file_id, file_name, file_size, file_path, created_at "
+                "FROM files WHERE file_id = ? AND no = ?"));
+            ps->setInt64(1, file_id);
+            ps->setUInt(2, owner_no);
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            if (!rs->next())
+                return false;
+            out = read_file(*rs);
+            return true;
+        });
+    }
+
+    int delete_file(int64_t file_id, uint32_t owner_no) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "DELETE FROM files WHERE file_id = ? AND no = ?"));
+            ps->setInt64(1, file_id);
+            ps->setUInt(2, owner_no);
+            return ps.executeUpdate();
+        });
+    }
+
+    std::vector<FileRow> list_files(uint32_t owner_no, const std::string &path_prefix) override
+    {
+        return guarded([&] {
+            std::string q =
+                "SELECT file_id, file_name, file_size, file_path, created_at "
+                "FROM files WHERE no = ? ";
+            if (!path_prefix.empty())
+                q += "AND file_path LIKE ? ";
+            q += "ORDER BY created_at DESC";
+
+            StmtRef ps(db_prepare(db_, q));
+            ps->setUInt(1, owner_no);
+            if (!path_prefix.empty())
+                ps->setString(2, path_prefix + "%");
+            std::vector<FileRow> out;
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            while (rs->next())
+                out.push_back(read_file(*rs));
+            return out;
+        });
+    }
+
+    int count_files(uint32_t owner_no, const std::string &path_prefix) override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "SELECT COUNT(*) FROM files WHERE no = ? AND file_path LIKE ?"));
+            ps->setUInt(1, owner_no);
+            ps->setString(2, path_prefix + "%");
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            return rs->next() ? rs->getInt(1) : 0;
+        });
+    }
+
+    // ── grades ──
+    std::unordered_map<int, int64_t> grade_limits() override
+    {
+        return guarded([&] {
+            StmtRef ps(db_prepare(db_, "SELECT grade, max_filesize FROM grades"));
+            std::unordered_map<int, int64_t> out;
+            std::unique_ptr<sql::ResultSet> rs(ps.executeQuery());
+            while (rs->next())
+                out[rs->getInt("grade")] = rs->getInt64("max_filesize");
+            return out;
+        });
+    }
+
+private:
+    // 트랜잭션 밖이면 f 전체를 한 트랜잭션으로 (메시지 변경 + unread_count 갱신이 같이 반영되도록)
+    template <typename F>
+    void atomically(F &&f)
+    {
+        if (in_txn_)
+        {
+            f();
+            return;
+        }
+        begin();
+        try
+        {
+            f();
+        }
+        catch (...)
+        {
+            try
+            {
+                rollback();
+            }
+            catch (...)
+            {
+            }
+            throw;
+        }
+        commit();
+    }
+
+    // users.unread_count += delta (0 아래로 내려가지 않음)
+    void bump_unread(const std::string &email, int delta)
+    {
+        if (delta == 0)
+            return;
+        StmtRef ps(db_prepare(db_, "UPDATE users SET unread_count = GREATEST(0, unread_count + ?) WHERE email = ?"));
+        ps->setInt(1, delta);
+        ps->setString(2, email);
+        ps.executeUpdate();
+    }
+
+    void bump_unread(const UnreadDeltas &deltas)
+    {
+        for (const auto &d : deltas)
+            bump_unread(d.first, d.second);
+    }
+
+    static FileRow read_file(sql::ResultSet &rs)
+    {
+        FileRow f;
+        f.file_id = rs.getInt64("file_id");
+        f.file_name = rs.getString("file_name").c_str();
+        f.file_size = rs.getInt64("file_size");
+        f.file_path = rs.getString("file_path").c_str();
+        f.created_at = rs.getString("created_at").c_str();
+        return f;
+    }
+
+    DbPool::Lease lease_;
+    sql::Connection &db_;
+    bool replica_;
+    bool in_txn_ = false;
+};
+
+class MariaBackend : public StorageBackend
+{
+public:
+    MariaBackend(const StorageConfig &cfg, DbPool::Options opt)
+        : pool_(DbConfig{cfg.url, cfg.user, cfg.pw}, opt)
+    {
+        DbPool::Options ro = opt;
+        ro.read_only = true;
+        ro.reconnect_on_acquire = false;
+        ro.acquire_timeout = REPLICA_ACQUIRE_TIMEOUT;
+        for (const auto &url : cfg.replica_urls)
+        {
+            replica_urls_.push_back(url);
+            replicas_.emplace_back(new DbPool(DbConfig{url, cfg.user, cfg.pw}, ro));
+        }
+    }
+
+    const char *name() const override { return "mariadb"; }
+
+    void start() override
+    {
+        pool_.start();
+        for (auto &r : replicas_)
+            r->start();
+    }
+
+    void stop() override
+    {
+        for (auto &r : replicas_)
+            r->stop();
+        pool_.stop();
+    }
+
+    std::unique_ptr<Storage> open() override
+    {
+        DbPool::Lease lease = pool_.acquire();
+        if (!lease)
+            return nullptr;
+        return std::unique_ptr<Storage>(new MariaStorage(std::move(lease), false));
+    }
+
+    std::unique_ptr<Storage> open_read() override
+    {
+        if (replicas_.empty())
+            return open();
+
+        // 복제본을 돌아가며 시도, 모두 불가면 주 DB
+        size_t first = next_replica_++;
+        for (size_t i = 0; i < replicas_.size(); ++i)
+        {
+            DbPool::Lease lease = replicas_[(first + i) % replicas_.size()]->acquire();
+            if (lease)
+            {
+                replica_reads_++;
+                return std::unique_ptr<Storage>(new MariaStorage(std::move(lease), true));
+            }
+        }
+        replica_fallbacks_++;
+        return open();
+    }
+
+    void log_stats(std::ostream &os) override
+    {
+        log_pool(os, "[DbPool]", pool_.stats());
+        for (size_t i = 0; i < replicas_.size(); ++i)
+            log_pool(os, ("[DbReplica] " + replica_urls_[i]).c_str(), replicas_[i]->stats());
+        if (!replicas_.empty())
+            os << "[DbReplica] reads=" << replica_reads_.load()
+               << " fallbacks=" << replica_fallbacks_.load() << "\n";
+    }
+
+private:
+    static void log_pool(std::ostream &os, const char *tag, const DbPoolStats &ps)
+    {
+        os << tag << " connected=" << ps.connected << "/" << ps.size
+           << " idle=" << ps.idle
+           << " acquires=" << ps.acquires
+           << " wait_avg_us=" << (ps.acquires ? ps.wait_us_total / ps.acquires : 0)
+           << " wait_max_us=" << ps.wait_us_max
+           << " timeouts=" << ps.timeouts
+           << " reconnects=" << ps.connects
+           << " connect_fails=" << ps.connect_fails
+           << " rotations=" << ps.rotations << "\n";
+    }
+
+    DbPool pool_;
+    std::vector<std::string> replica_urls_;
+    std::vector<std::unique_ptr<DbPool>> replicas_;
+    std::atomic<size_t> next_replica_{0};
+    std::atomic<uint64_t> replica_reads_{0};     // 복제본에서 처리한 읽기 세션
+    std::atomic<uint64_t> replica_fallbacks_{0}; // 복제본 모두 불가 → 주 DB
+};
+} // namespace
+
+std::unique_ptr<StorageBackend> make_mariadb_backend(const StorageConfig &cfg)
+{
+    DbPool::Options opt;
+    opt.size = cfg.pool_size;
+    return std::unique_ptr<StorageBackend>(new MariaBackend(cfg, opt));
+}
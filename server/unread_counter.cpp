@@ -0,0 +1,213 @@
+// ============================================================================
+// 파일명: unread_counter.cpp
+// 목적: 안읽은 메시지 수 캐시 구현 (unread_counter.h 설명 참고)
+// ============================================================================
+#include "unread_counter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr size_t UNREAD_COUNTER_SHARDS = 16;             // 샤드 수
+static constexpr std::chrono::seconds UNREAD_COUNTER_TTL{300};  // 항목 유효 시간
+
+namespace
+{
+struct Entry
+{
+    int64_t count = 0;
+    Clock::time_point loaded;
+};
+
+struct Shard
+{
+    std::mutex m;
+    std::unordered_map<std::string, Entry> by_email;
+    std::unordered_map<std::string, int> changing; // 변경 중인 유저 -> 진행 중인 변경 수
+    // 변경 시작 / 끝마다 증가.
+    // DB 조회 도중 바뀌었으면 읽어온 값이 변경 전후 어느 쪽인지 모르므로 캐시에 넣지 않음
+    uint64_t epoch = 0;
+};
+
+Shard g_shards[UNREAD_COUNTER_SHARDS];
+
+std::atomic<uint64_t> g_hits{0};
+std::atomic<uint64_t> g_misses{0};
+
+// 바깥 트랜잭션 안에서 끝난 변경 (표시 해제 / 반영을 commit 후로 미룸)
+struct Pending
+{
+    std::vector<std::string> keys;
+    std::vector<std::pair<std::string, int64_t>> deltas;
+};
+thread_local std::vector<Pending> t_pending;
+
+std::string key_of(const std::string &email)
+{
+    std::string k = email;
+    std::transform(k.begin(), k.end(), k.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return k;
+}
+
+Shard &shard_of(const std::string &key) { return g_shards[std::hash<std::string>{}(key) % UNREAD_COUNTER_SHARDS]; }
+
+void mark_changing(const std::string &key)
+{
+    Shard &sh = shard_of(key);
+    std::lock_guard<std::mutex> lk(sh.m);
+    sh.epoch++;
+    sh.changing[key]++;
+}
+
+void unmark_changing(Shard &sh, const std::string &key)
+{
+    sh.epoch++;
+    auto it = sh.changing.find(key);
+    if (it != sh.changing.end() && --it->second <= 0)
+        sh.changing.erase(it);
+}
+
+// commit 된 변경 마무리: 표시한 유저는 변화량 반영 후 해제, 표시 안 한 유저는 항목 제거
+// 변화량이 있는 유저는 항목 유무와 상관없이 진행 중인 채우기를 무효화
+void finish(const Pending &p, bool committed)
+{
+    for (const auto &d : p.deltas)
+    {
+        Shard &sh = shard_of(d.first);
+        std::lock_guard<std::mutex> lk(sh.m);
+        // 항목이 없어도 epoch 증가 → commit 전에 DB 를 읽고 있던 조회가 옛 값을 채우지 못함
+        sh.epoch++;
+        auto it = sh.by_email.find(d.first);
+        if (it == sh.by_email.end())
+            continue;
+        bool marked = std::find(p.keys.begin(), p.keys.end(), d.first) != p.keys.end();
+        if (committed && marked)
+            it->second.count = std::max<int64_t>(0, it->second.count + d.second);
+        else
+            sh.by_email.erase(it);
+    }
+    for (const auto &k : p.keys)
+    {
+        Shard &sh = shard_of(k);
+        std::lock_guard<std::mutex> lk(sh.m);
+        unmark_changing(sh, k);
+        if (!committed)
+            sh.by_email.erase(k);
+    }
+}
+} // namespace
+
+int64_t unread_counter_get(Storage &db, const std::string &email)
+{
+    std::string key = key_of(email);
+    Shard &sh = shard_of(key);
+    uint64_t epoch;
+    {
+        std::lock_guard<std::mutex> lk(sh.m);
+        auto it = sh.by_email.find(key);
+        if (it != sh.by_email.end())
+        {
+            if (Clock::now() - it->second.loaded <= UNREAD_COUNTER_TTL)
+            {
+                g_hits++;
+                return it->second.count;
+            }
+            sh.by_email.erase(it);
+        }
+        epoch = sh.epoch;
+    }
+
+    int64_t n = db.unread_count(email);
+    g_misses++;
+    if (n < 0 || db.is_replica())
+        return n;
+
+    std::lock_guard<std::mutex> lk(sh.m);
+    if (sh.epoch == epoch && !sh.changing.count(key))
+        sh.by_email[key] = Entry{n, Clock::now()};
+    return n;
+}
+
+bool unread_counter_peek(const std::string &email, int64_t &out)
+{
+    std::string key = key_of(email);
+    Shard &sh = shard_of(key);
+    std::lock_guard<std::mutex> lk(sh.m);
+    auto it = sh.by_email.find(key);
+    if (it == sh.by_email.end() || Clock::now() - it->second.loaded > UNREAD_COUNTER_TTL)
+        return false; // 만료된 항목은 다음 unread_counter_get 이 지움
+    g_hits++;
+    out = it->second.count;
+    return true;
+}
+
+UnreadChange::UnreadChange(Storage *db, std::vector<std::string> emails) : db_(db)
+{
+    for (const auto &e : emails)
+    {
+        std::string k = key_of(e);
+        if (std::find(keys_.begin(), keys_.end(), k) != keys_.end())
+            continue;
+        mark_changing(k);
+        keys_.push_back(std::move(k));
+    }
+}
+
+UnreadChange::~UnreadChange()
+{
+    Pending p{std::move(keys_), std::move(deltas_)};
+    if (db_ && db_->in_transaction())
+        t_pending.push_back(std::move(p));
+    else
+        finish(p, true);
+}
+
+void UnreadChange::add(const std::string &email, int64_t delta)
+{
+    if (delta != 0)
+        deltas_.emplace_back(key_of(email), delta);
+}
+
+void UnreadChange::add(const UnreadDeltas &deltas)
+{
+    for (const auto &d : deltas)
+        add(d.first, d.second);
+}
+
+void unread_counter_txn_end(bool committed)
+{
+    std::vector<Pending> pending;
+    pending.swap(t_pending);
+    for (const auto &p : pending)
+        finish(p, committed);
+}
+
+void unread_counter_forget(const std::string &email)
+{
+    std::string key = key_of(email);
+    Shard &sh = shard_of(key);
+    std::lock_guard<std::mutex> lk(sh.m);
+    sh.epoch++;
+    sh.by_email.erase(key);
+}
+
+UnreadCounterStats unread_counter_stats()
+{
+    UnreadCounterStats st;
+    st.hits = g_hits.load();
+    st.misses = g_misses.load();
+    for (auto &sh : g_shards)
+    {
+        std::lock_guard<std::mutex> lk(sh.m);
+        st.size += sh.by_email.size();
+    }
+    return st;
+}
@@ -0,0 +1,71 @@
+// ============================================================================
+// 파일명: unread_counter.h
+// 목적: 유저별 안읽은 메시지 수를 메모리에 보관 (users.unread_count 캐시)
+//
+// - 폴링(5초마다) / 메인 메뉴의 안읽음 표시는 여기서 답함 → 적중이면 DB 조회 0
+// - miss 면 users.unread_count 를 한 번 읽어 채움 (복제본 세션에서 읽은 값은 캐시하지 않음)
+// - 메시지를 바꾸는 코드는 저장소 호출을 UnreadChange 로 감쌈
+//     생성 시 대상 유저를 "변경 중" 으로 표시 → 그동안 DB 에서 읽은 값은 캐시하지 않음
+//       (commit 전 값인지 후 값인지 알 수 없으므로)
+//     소멸 시 add() 로 모은 변화량을 메모리 값에 더하고 표시 해제
+//     미리 표시하지 않은 유저의 변화량은 더하지 않고 항목을 지움 (다음 조회 때 DB 에서)
+// - DB 쪽 카운터는 저장소가 같은 트랜잭션에서 갱신, 여기는 메모리 값만
+// - 바깥 트랜잭션(atomic 묶음 요청) 안이면 반영을 unread_counter_txn_end() 까지 보류
+//   (commit 이면 반영, 아니면 해당 유저 항목 제거)
+// - 키는 소문자 email (users.email collation 과 동일하게 대소문자 무시)
+// - 서버 밖에서 DB 를 직접 고친 경우를 위해 항목은 UNREAD_COUNTER_TTL 후 만료
+//
+// 사용 예:
+//   int64_t n = unread_counter_get(db, email);       // 없는 유저면 -1
+//   if (unread_counter_peek(email, n)) { ... }       // DB 커넥션 없이 (적중일 때만)
+//
+//   UnreadChange uc(&db, {to_email});
+//   db.insert_messages(...);
+//   uc.add(to_email, +1);                            // 예외로 빠져나가면 변화량 없이 해제
+// ============================================================================
+#pragma once
+
+#include "storage.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct UnreadCounterStats
+{
+    uint64_t hits = 0;   // 메모리에서 답한 횟수
+    uint64_t misses = 0; // DB 에서 읽어 채운 횟수
+    size_t size = 0;     // 현재 보관 중인 유저 수
+};
+
+// 조회 (miss 면 DB 에서 읽어 채움). 없는 유저면 -1, StorageError 는 그대로 전달
+int64_t unread_counter_get(Storage &db, const std::string &email);
+
+// 메모리에 있을 때만 조회 (DB 를 쓰지 않음, 커넥션 대여 전에 확인용). 없으면 false
+bool unread_counter_peek(const std::string &email, int64_t &out);
+
+// 저장소 변경 한 번을 감싸는 guard
+// db 는 소멸 시점에 트랜잭션 안인지 확인용 (nullptr 이면 이미 commit 된 것으로 봄)
+class UnreadChange
+{
+public:
+    UnreadChange(Storage *db, std::vector<std::string> emails);
+    ~UnreadChange();
+    UnreadChange(const UnreadChange &) = delete;
+    UnreadChange &operator=(const UnreadChange &) = delete;
+
+    void add(const std::string &email, int64_t delta);
+    void add(const UnreadDeltas &deltas);
+
+private:
+    Storage *db_;
+    std::vector<std::string> keys_;                       // 변경 중으로 표시한 유저
+    std::vector<std::pair<std::string, int64_t>> deltas_; // 반영할 변화량
+};
+
+// 바깥 트랜잭션 종료 후 호출 (committed=false 면 보류분을 버리고 해당 항목 제거)
+void unread_counter_txn_end(bool committed);
+
+// 항목 제거 (다음 조회 때 DB 에서 다시 읽음)
+void unread_counter_forget(const std::string &email);
+
+UnreadCounterStats unread_counter_stats();
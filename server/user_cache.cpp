@@ -0,0 +1,184 @@
+// ============================================================================
+// 파일명: user_cache.cpp
+// 목적: users 조회 캐시 구현 (user_cache.h 설명 참고)
+// ============================================================================
+#include "user_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr size_t USER_CACHE_SHARDS = 16;                  // 샤드 수
+static constexpr std::chrono::seconds USER_CACHE_TTL{60};        // 항목 유효 시간
+
+namespace
+{
+struct Entry
+{
+    UserPtr user;
+    Clock::time_point loaded;
+};
+
+struct Shard
+{
+    std::mutex m;
+    std::unordered_map<uint32_t, Entry> by_no;
+    std::unordered_map<std::string, Entry> by_email;
+};
+
+Shard g_shards[USER_CACHE_SHARDS];
+
+// 무효화가 일어날 때마다 증가.
+// DB 조회 도중 무효화가 끼어들면 읽어온 값이 이미 낡았을 수 있으므로 캐시에 넣지 않음
+std::atomic<uint64_t> g_epoch{0};
+
+std::atomic<uint64_t> g_hits{0};
+std::atomic<uint64_t> g_misses{0};
+std::atomic<uint64_t> g_invalidations{0};
+
+Shard &shard_of(uint32_t no) { return g_shards[no % USER_CACHE_SHARDS]; }
+Shard &shard_of(const std::string &email) { return g_shards[std::hash<std::string>{}(email) % USER_CACHE_SHARDS]; }
+
+template <typename Map, typename Key>
+UserPtr lookup(Map Shard::*map, Shard &sh, const Key &key)
+{
+    std::lock_guard<std::mutex> lk(sh.m);
+    auto it = (sh.*map).find(key);
+    if (it == (sh.*map).end())
+        return nullptr;
+    if (Clock::now() - it->second.loaded > USER_CACHE_TTL)
+    {
+        (sh.*map).erase(it);
+        return nullptr;
+    }
+    return it->second.user;
+}
+
+void insert(const UserPtr &u, uint64_t epoch_before)
+{
+    if (g_epoch.load() != epoch_before)
+        return; // 조회 중에 무효화됨 → 다음 조회 때 다시 읽음
+
+    Entry e{u, Clock::now()};
+    {
+        Shard &sh = shard_of(u->no);
+        std::lock_guard<std::mutex> lk(sh.m);
+        sh.by_no[u->no] = e;
+    }
+    {
+        Shard &sh = shard_of(u->email);
+        std::lock_guard<std::mutex> lk(sh.m);
+        sh.by_email[u->email] = e;
+    }
+}
+
+UserPtr to_cached(const UserRow &r)
+{
+    auto u = std::make_shared<CachedUser>();
+    u->no = r.no;
+    u->email = r.email;
+    u->pw_hash = r.pw_hash;
+    u->nickname = r.nickname;
+    u->grade = r.grade;
+    u->is_active = r.is_active;
+    return u;
+}
+} // namespace
+
+UserPtr user_cache_by_email(Storage &db, const std::string &email)
+{
+    if (UserPtr u = lookup(&Shard::by_email, shard_of(email), email))
+    {
+        g_hits++;
+        return u;
+    }
+
+    uint64_t epoch = g_epoch.load();
+    UserRow row;
+    UserPtr u = db.user_by_email(email, row) ? to_cached(row) : nullptr;
+    g_misses++;
+    if (u && !db.is_replica() && !db.in_transaction())
+        insert(u, epoch);
+    return u;
+}
+
+UserPtr user_cache_by_no(Storage &db, uint32_t no)
+{
+    if (UserPtr u = lookup(&Shard::by_no, shard_of(no), no))
+    {
+        g_hits++;
+        return u;
+    }
+
+    uint64_t epoch = g_epoch.load();
+    UserRow row;
+    UserPtr u = db.user_by_no(no, row) ? to_cached(row) : nullptr;
+    g_misses++;
+    if (u && !db.is_replica() && !db.in_transaction())
+        insert(u, epoch);
+    return u;
+}
+
+void user_cache_invalidate(uint32_t no)
+{
+    g_epoch++;
+    g_invalidations++;
+
+    UserPtr old;
+    {
+        Shard &sh = shard_of(no);
+        std::lock_guard<std::mutex> lk(sh.m);
+        auto it = sh.by_no.find(no);
+        if (it == sh.by_no.end())
+            return;
+        old = it->second.user;
+        sh.by_no.erase(it);
+    }
+
+    Shard &sh = shard_of(old->email);
+    std::lock_guard<std::mutex> lk(sh.m);
+    auto it = sh.by_email.find(old->email);
+    if (it != sh.by_email.end() && it->second.user->no == no)
+        sh.by_email.erase(it);
+}
+
+void user_cache_invalidate_email(const std::string &email)
+{
+    g_epoch++;
+    g_invalidations++;
+
+    UserPtr old;
+    {
+        Shard &sh = shard_of(email);
+        std::lock_guard<std::mutex> lk(sh.m);
+        auto it = sh.by_email.find(email);
+        if (it == sh.by_email.end())
+            return;
+        old = it->second.user;
+        sh.by_email.erase(it);
+    }
+
+    Shard &sh = shard_of(old->no);
+    std::lock_guard<std::mutex> lk(sh.m);
+    auto it = sh.by_no.find(old->no);
+    if (it != sh.by_no.end() && it->second.user->email == email)
+        sh.by_no.erase(it);
+}
+
+UserCacheStats user_cache_stats()
+{
+    UserCacheStats st;
+    st.hits = g_hits.load();
+    st.misses = g_misses.load();
+    st.invalidations = g_invalidations.load();
+    for (auto &sh : g_shards)
+    {
+        std::lock_guard<std::mutex> lk(sh.m);
+        st.size += sh.by_no.size();
+    }
+    return st;
+}
@@ -0,0 +1,56 @@
+// ============================================================================
+// 파일명: user_cache.h
+// 목적: users 테이블 조회 결과를 메모리에 보관하는 샤딩 캐시
+//       (storage_used 는 사용량 장부 quota_ledger 가 관리)
+//
+// - email / no 양쪽으로 조회 가능 (같은 CachedUser 를 공유)
+// - 샤드마다 mutex 하나 → worker 끼리 서로 다른 유저를 조회할 때 경합 없음
+// - miss 면 DB 에서 한 번 읽어 채움, 없는 유저는 캐시하지 않음
+//   (복제본 세션에서 읽은 값은 지연됐을 수 있으므로 돌려주기만 하고 캐시하지 않음)
+//   (트랜잭션 안에서 읽은 값도 rollback 될 수 있으므로 캐시하지 않음)
+// - users 행을 바꾸는 코드는 바꾼 직후 user_cache_invalidate*() 호출
+//   (설정 변경 / 관리자 상태 변경 / 로그인·인증 잠금)
+//   atomic 묶음 안이면 after_commit() 으로 commit 뒤에 호출 (request_context.h)
+// - 서버 밖에서 DB 를 직접 고친 경우를 위해 항목은 USER_CACHE_TTL 후 만료
+//
+// 사용 예:
+//   UserPtr u = user_cache_by_email(db, email);
+//   if (!u) { ... 유저 없음 ... }
+//   if (u->pw_hash != pw_hash) { ... }
+// ============================================================================
+#pragma once
+
+#include "storage.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct CachedUser
+{
+    uint32_t no = 0;          // users.no
+    std::string email;        // users.email
+    std::string pw_hash;      // users.pw_hash
+    std::string nickname;     // users.nickname
+    int grade = 1;            // users.grade
+    bool is_active = true;    // users.is_active
+};
+
+using UserPtr = std::shared_ptr<const CachedUser>;
+
+struct UserCacheStats
+{
+    uint64_t hits = 0;          // 캐시 적중
+    uint64_t misses = 0;        // DB 조회로 채운 횟수
+    uint64_t invalidations = 0; // 무효화 호출 수
+    size_t size = 0;            // 현재 캐시된 유저 수
+};
+
+// 조회 (miss 면 DB 에서 읽어 채움). 없는 유저면 nullptr, StorageError 는 그대로 전달
+UserPtr user_cache_by_email(Storage &db, const std::string &email);
+UserPtr user_cache_by_no(Storage &db, uint32_t no);
+
+// users 행 변경 후 호출 (no / email 어느 쪽으로든 양쪽 색인 모두 제거)
+void user_cache_invalidate(uint32_t no);
+void user_cache_invalidate_email(const std::string &email);
+
+UserCacheStats user_cache_stats();
@@ -4,9 +4,14 @@
 #include "admin_handler.hpp"
 #include "protocol.h"
 #include "json_packet.hpp"
+#include "storage.h"
+#include "user_cache.h"
+#include "quota_ledger.h"
+#include "metrics.h"
 
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 // skeleton_server.cpp 에 정의된 전역 변수들을 여기서 사용하겠다고 명시
 extern std::mutex g_login_m;
@@ -14,80 +19,189 @@ extern std::unordered_map<std::string, int> g_login_users;
 
 using json = nlohmann::json;
 
-// [수정됨] inline 키워드 제거
-std::string handle_admin_user_list(const json &req, sql::Connection &db)
+// 목록 한 번 요청에 돌려주는 최대 유저 수 / 프레임 하나에 담는 유저 수
+static constexpr int ADMIN_LIST_DEFAULT_LIMIT = 100;
+static constexpr int ADMIN_LIST_MAX_LIMIT = 500;
+static constexpr size_t ADMIN_LIST_FRAME_ROWS = 50;
+
+// 관리자 세션이 아니면 권한 오류 응답, 맞으면 빈 문자열
+// (관리자 여부는 로그인 때 확정된 세션 user_no 기준 → 요청마다 DB 조회 없음)
+static std::string require_admin(const RequestContext &ctx, int type)
 {
+    if (ctx.is_admin())
+        return "";
+    json res = make_response(type, ctx.logged_in ? VALUE_ERR_PERMISSION : VALUE_ERR_SESSION);
+    res["msg"] = ctx.logged_in ? "관리자 권한 없음" : "로그인 세션 없음";
+    return res.dump();
+}
+
+// ============================================================
+// handle_admin_user_list  (PKT_ADMIN_USER_LIST_REQ = 0x0040)
+//
+// 요청 payload (모두 생략 가능):
+//   {
+//     "cursor": 0,            ← 이전 응답의 next_cursor (users.no), 0 이면 처음부터
+//     "limit": 100,           ← 최대 500
+//     "state": "all",         ← "all" / "active" / "inactive"
+//     "only_inactive": false, ← 구버전 호환 (true 면 state = "inactive")
+//     "prefix": "",           ← email 또는 nickname 접두어
+//     "grade": 0              ← 0 이면 전체
+//   }
+//
+// 응답 (프레임 여러 개, 같은 type):
+//   { code, payload: { users: [...], final: false } }                      ← 중간 프레임
+//   { code, payload: { users: [...], final: true, next_cursor: N|null } }  ← 마지막 프레임
+//
+// - 필터/정렬/페이징 모두 저장소에서 (no 기준 seek, OFFSET 없음)
+// - ADMIN_LIST_FRAME_ROWS 개마다 emit 으로 먼저 보냄 → 클라이언트는 final 까지 수신
+// - emit 이 비어 있으면 (묶음 요청 안) 한 응답에 모두 담음
+// ============================================================
+std::string handle_admin_user_list(const RequestContext &ctx, const json &req, Storage &db, const FrameSink &emit)
+{
+    std::string denied = require_admin(ctx, PKT_ADMIN_USER_LIST_REQ);
+    if (!denied.empty())
+        return denied;
+
     try
     {
-        bool only_inactive = req.value("payload", json::object()).value("only_inactive", false);
-        std::string query = "SELECT no, email, nickname, is_active FROM users";
-        if (only_inactive)
-            query += " WHERE is_active = 0";
+        json payload = req.value("payload", json::object());
 
-        std::unique_ptr<sql::PreparedStatement> pstmt(db.prepareStatement(query));
-        std::unique_ptr<sql::ResultSet> rs(pstmt->executeQuery());
+        unsigned int cursor = payload.value("cursor", 0u);
+        int limit = payload.value("limit", ADMIN_LIST_DEFAULT_LIMIT);
+        if (limit <= 0 || limit > ADMIN_LIST_MAX_LIMIT)
+            limit = limit <= 0 ? ADMIN_LIST_DEFAULT_LIMIT : ADMIN_LIST_MAX_LIMIT;
 
-        json user_list = json::array();
-        while (rs->next())
+        std::string state = payload.value("state", "all");
+        if (payload.value("only_inactive", false))
+            state = "inactive";
+        std::string prefix = payload.value("prefix", "");
+        int grade = payload.value("grade", 0);
+
+        UserListFilter filter;
+        filter.after_no = cursor;
+        filter.limit = limit + 1; // 한 행 더 읽어 다음 페이지 유무 판단
+        if (state == "active")
+            filter.active = 1;
+        else if (state == "inactive")
+            filter.active = 0;
+        filter.prefix = prefix;
+        filter.grade = grade;
+        std::vector<UserRow> rows = db.list_users(filter);
+
+        struct Row
         {
-            std::string email = rs->getString("email").c_str();
-            bool is_online = false;
+            unsigned int no;
+            std::string email;
+            std::string nickname;
+            int grade;
+            int is_active;
+        };
+        std::vector<Row> frame;
+        frame.reserve(ADMIN_LIST_FRAME_ROWS);
+
+        // 접속 여부는 프레임 단위로 한 번만 lock 잡고 확인
+        auto frame_json = [&frame]() {
+            json users = json::array();
+            std::lock_guard<std::mutex> lock(g_login_m);
+            for (auto &r : frame)
+            {
+                users.push_back({{"no", r.no},
+                                 {"email", r.email},
+                                 {"nickname", r.nickname},
+                                 {"grade", r.grade},
+                                 {"is_active", r.is_active},
+                                 {"is_online", g_login_users.count(r.email) != 0}});
+            }
+            return users;
+        };
 
-            // 접속 여부 확인
+        json users = json::array(); // emit 없을 때 누적
+        int count = 0;
+        bool has_more = false;
+        unsigned int last_no = 0;
+        for (const auto &u : rows)
+        {
+            if (count == limit)
             {
-                std::lock_guard<std::mutex> lock(g_login_m);
-                if (g_login_users.find(email) != g_login_users.end())
-                    is_online = true;
+                has_more = true;
+                break;
             }
+            ++count;
+            last_no = u.no;
+            frame.push_back({u.no, u.email, u.nickname, u.grade, u.is_active ? 1 : 0});
 
-            user_list.push_back({{"no", rs->getInt("no")},
-                                 {"email", email},
-                                 {"nickname", rs->getString("nickname").c_str()},
-                                 {"is_active", rs->getInt("is_active")},
-                                 {"is_online", is_online}});
+            if (frame.size() == ADMIN_LIST_FRAME_ROWS)
+            {
+                json part = frame_json();
+                frame.clear();
+                if (emit)
+                {
+                    json res = make_response(PKT_ADMIN_USER_LIST_REQ, VALUE_SUCCESS);
+                    res["payload"] = {{"users", std::move(part)}, {"final", false}};
+                    emit(res.dump());
+                }
+                else
+                {
+                    for (auto &u : part)
+                        users.push_back(std::move(u));
+                }
+            }
         }
 
+        for (auto &u : frame_json())
+            users.push_back(std::move(u));
+
         json res = make_response(PKT_ADMIN_USER_LIST_REQ, VALUE_SUCCESS);
-        res["payload"]["users"] = user_list;
+        res["payload"] = {{"users", std::move(users)},
+                          {"final", true},
+                          {"next_cursor", has_more ? json(last_no) : json(nullptr)}};
         return res.dump();
     }
-    catch (const sql::SQLException &e)
+    catch (const StorageError &e)
     {
         json res = make_response(PKT_ADMIN_USER_LIST_REQ, VALUE_ERR_DB);
         res["msg"] = e.what();
+        res["payload"] = {{"final", true}};
         return res.dump();
     }
 }
 
-// [수정됨] inline 키워드 제거
-std::string handle_admin_user_info(const json &req, sql::Connection &db)
+// ============================================================
+// handle_admin_user_info  (PKT_ADMIN_USER_INFO_REQ = 0x0041)
+//
+// - storage_used 는 사용량 장부(quota_ledger) 값 사용 (files 합계 조회 없음)
+//   장부 로드 실패 시 users.storage_used
+// ============================================================
+std::string handle_admin_user_info(const RequestContext &ctx, const json &req, Storage &db)
 {
+    std::string denied = require_admin(ctx, PKT_ADMIN_USER_INFO_REQ);
+    if (!denied.empty())
+        return denied;
+
     try
     {
         int target_no = req.value("payload", json::object()).value("target_no", 0);
 
-        std::unique_ptr<sql::PreparedStatement> pstmt(db.prepareStatement(
-            "SELECT u.no, u.email, u.nickname, u.created_at, u.grade, u.is_active, "
-            "IFNULL((SELECT SUM(file_size) FROM files f WHERE f.no = u.no), 0) AS storage_used "
-            "FROM users u WHERE u.no = ?"));
-        pstmt->setInt(1, target_no);
-        std::unique_ptr<sql::ResultSet> rs(pstmt->executeQuery());
-
-        if (!rs->next())
+        UserRow u;
+        if (target_no <= 0 || !db.user_by_no(static_cast<uint32_t>(target_no), u))
             return make_response(PKT_ADMIN_USER_INFO_REQ, VALUE_ERR_USER_NOT_FOUND).dump();
 
+        int64_t used = quota_used(db, u.no);
+        if (used < 0)
+            used = u.storage_used;
+
         json res = make_response(PKT_ADMIN_USER_INFO_REQ, VALUE_SUCCESS);
         res["payload"] = {
-            {"no", rs->getInt("no")},
-            {"email", rs->getString("email").c_str()},
-            {"nickname", rs->getString("nickname").c_str()},
-            {"created_at", rs->getString("created_at").c_str()},
-            {"grade", rs->getInt("grade")},
-            {"is_active", rs->getInt("is_active")},
-            {"storage_used", rs->getInt64("storage_used")}};
+            {"no", u.no},
+            {"email", u.email},
+            {"nickname", u.nickname},
+            {"created_at", u.created_at},
+            {"grade", u.grade},
+            {"is_active", u.is_active ? 1 : 0},
+            {"storage_used", used}};
         return res.dump();
     }
-    catch (const sql::SQLException &e)
+    catch (const StorageError &e)
     {
         json res = make_response(PKT_ADMIN_USER_INFO_REQ, VALUE_ERR_DB);
         res["msg"] = e.what();
@@ -96,26 +210,61 @@ std::string handle_admin_user_info(const json &req, sql::Connection &db)
 }
 
 // [수정됨] inline 키워드 제거
-std::string handle_admin_state_change(const json &req, sql::Connection &db)
+std::string handle_admin_state_change(const RequestContext &ctx, const json &req, Storage &db)
 {
+    std::string denied = require_admin(ctx, PKT_ADMIN_STATE_CHANGE_REQ);
+    if (!denied.empty())
+        return denied;
+
     try
     {
         json payload = req.value("payload", json::object());
         int target_no = payload.value("target_no", 0);
         int is_active = payload.value("is_active", 1);
 
-        std::unique_ptr<sql::PreparedStatement> pstmt(db.prepareStatement(
-            "UPDATE users SET is_active = ? WHERE no = ?"));
-        pstmt->setInt(1, is_active);
-        pstmt->setInt(2, target_no);
-        pstmt->executeUpdate();
+        uint32_t target = static_cast<uint32_t>(target_no);
+        std::string revoke_email; // 정지면 그 유저의 세션 / 토큰 폐기
+        if (is_active == 0)
+        {
+            if (UserPtr u = user_cache_by_no(db, target))
+                revoke_email = u->email;
+        }
+        db.set_user_active(target, is_active != 0);
+        after_commit(db, [target, revoke_email] {
+            user_cache_invalidate(target); // 정지/해제 즉시 반영 (atomic 묶음이면 commit 뒤에)
+            if (!revoke_email.empty())
+                session_revoke_user(revoke_email);
+        });
 
         return make_response(PKT_ADMIN_STATE_CHANGE_REQ, VALUE_SUCCESS).dump();
     }
-    catch (const sql::SQLException &e)
+    catch (const StorageError &e)
     {
         json res = make_response(PKT_ADMIN_STATE_CHANGE_REQ, VALUE_ERR_DB);
         res["msg"] = e.what();
         return res.dump();
     }
-}
\ No newline at end of file
+}
+
+// ============================================================
+// handle_admin_stats  (PKT_ADMIN_STATS_REQ = 0x0043)
+//
+// 응답 payload (metrics.h 참고):
+//   { uptime_s, bytes_in, bytes_out,
+//     gauges: { loud_sessions_active: N, ... },
+//     stages: { queue_wait: {count, avg_us, p50_us, p90_us, p99_us, max_us}, ... },
+//     types:  [ { type, handler: {...}, db: {...} }, ... ] }
+//
+// - 같은 내용을 127.0.0.1 지표 포트에서 Prometheus 텍스트로도 볼 수 있음
+// ============================================================
+std::string handle_admin_stats(const RequestContext &ctx, const json &req)
+{
+    (void)req;
+    std::string denied = require_admin(ctx, PKT_ADMIN_STATS_REQ);
+    if (!denied.empty())
+        return denied;
+
+    json res = make_response(PKT_ADMIN_STATS_REQ, VALUE_SUCCESS);
+    res["payload"] = metrics_snapshot_json();
+    return res.dump();
+}
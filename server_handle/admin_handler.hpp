@@ -1,15 +1,25 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 #include <nlohmann/json.hpp>
-#include <mariadb/conncpp.hpp>
+#include "storage.h"
+#include "request_context.h"
 
-// 1. 유저 목록 조회 (전체 또는 비활성)
-std::string handle_admin_user_list(const nlohmann::json &req, sql::Connection &db);
+// 응답 프레임을 먼저 보내는 콜백 (마지막 프레임은 핸들러 반환값)
+using FrameSink = std::function<void(std::string)>;
 
-// 2. 유저 상세 정보 조회 (용량 조인)
-std::string handle_admin_user_info(const nlohmann::json &req, sql::Connection &db);
+// 모두 관리자 세션(ctx.is_admin())만 허용, 아니면 VALUE_ERR_PERMISSION
+
+// 1. 유저 목록 조회 (커서 페이징 + 상태/접두어/등급 필터, 프레임 여러 개로 전송)
+std::string handle_admin_user_list(const RequestContext &ctx, const nlohmann::json &req, Storage &db, const FrameSink &emit);
+
+// 2. 유저 상세 정보 조회 (사용량은 장부 값)
+std::string handle_admin_user_info(const RequestContext &ctx, const nlohmann::json &req, Storage &db);
 
 // 3. 계정 상태 변경
-std::string handle_admin_state_change(const nlohmann::json &req, sql::Connection &db);
\ No newline at end of file
+std::string handle_admin_state_change(const RequestContext &ctx, const nlohmann::json &req, Storage &db);
+
+// 4. 서버 지표 요약 (저장소 사용 안 함)
+std::string handle_admin_stats(const RequestContext &ctx, const nlohmann::json &req);
\ No newline at end of file
@@ -2,10 +2,11 @@
 
 #include <string>
 #include <nlohmann/json.hpp>
-#include <mariadb/conncpp.hpp>
+#include "storage.h"
+#include "request_context.h"
 
 
-std::string handle_server_blacklist_process(const nlohmann::json& req, sql::Connection& db);
-std::string handle_server_blacklist_add(const nlohmann::json& req, sql::Connection& db);
-std::string handle_server_blacklist_remove(const nlohmann::json& req, sql::Connection& db);
-std::string handle_server_blacklist_list(const nlohmann::json& req, sql::Connection& db);
\ No newline at end of file
+std::string handle_server_blacklist_process(const RequestContext& ctx, const nlohmann::json& req, Storage& db);
+std::string handle_server_blacklist_add(const RequestContext& ctx, const nlohmann::json& req, Storage& db);
+std::string handle_server_blacklist_remove(const RequestContext& ctx, const nlohmann::json& req, Storage& db);
+std::string handle_server_blacklist_list(const RequestContext& ctx, const nlohmann::json& req, Storage& db);
\ No newline at end of file
@@ -12,7 +12,12 @@
 
 #include "file_handler.hpp"
 #include "protocol.h"
+#include "storage.h"
+#include "grade_table.h"
+#include "quota_ledger.h"
+#include "logger.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -28,6 +33,7 @@ extern "C" {
 namespace fs = std::filesystem;
 using json = nlohmann::json;
 
+
 // ─────────────────────────────────────────────────────────────────
 //  전역: 서버 파일 저장 루트
 // ─────────────────────────────────────────────────────────────────
@@ -130,56 +136,14 @@ static std::string resolve_filename(const std::string& dir,
 }
 
 // ─────────────────────────────────────────────────────────────────
-//  내부 유틸: 유저 no로 등급별 최대 파일 크기 조회 (grades 테이블)
+//  내부 유틸: 등급별 최대 파일 크기 조회
+//  (등급은 세션(RequestContext), 등급별 용량은 grades 스냅샷 → DB 조회 없음)
+//  등급 정보가 없으면 -1
 // ─────────────────────────────────────────────────────────────────
-static int64_t get_max_filesize(uint32_t user_no, sql::Connection& db)
+static int64_t get_max_filesize(int grade, Storage& db)
 {
     try {
-        std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(
-            "SELECT g.max_filesize "
-            "FROM users u JOIN grades g ON u.grade = g.grade "
-            "WHERE u.no = ?"));
-        ps->setInt(1, (int)user_no);
-        std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-        if (rs->next()) return rs->getInt64(1);
-    } catch (...) {}
-
-    // grades 테이블 없을 경우 fallback: 등급표 하드코딩
-    // 0=관리자 1=일반(100MB) 2=비지니스(200MB) 3=VIP(500MB) 4=VVIP(1GB)
-    try {
-        std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(
-            "SELECT grade FROM users WHERE no = ?"));
-        ps->setInt(1, (int)user_no);
-        std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-        if (rs->next()) {
-            static const int64_t limits[] = {
-                1073741824LL,   // 관리자 1GB
-                 104857600LL,   // 일반   100MB
-                 209715200LL,   // 비지니스 200MB
-                 524288000LL,   // VIP 500MB
-                1073741824LL    // VVIP 1GB
-            };
-            int g = rs->getInt(1);
-            if (g >= 0 && g <= 4) return limits[g];
-        }
-    } catch (...) {}
-
-    return 104857600LL; // 기본 100MB
-}
-
-// ─────────────────────────────────────────────────────────────────
-//  내부 유틸: 남은 클라우드 용량 = 등급 총 용량 - storage_used
-// ─────────────────────────────────────────────────────────────────
-static int64_t get_remaining_quota(uint32_t user_no, sql::Connection& db)
-{
-    try {
-        std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(
-            "SELECT g.max_filesize, u.storage_used "
-            "FROM users u JOIN grades g ON u.grade = g.grade "
-            "WHERE u.no = ?"));
-        ps->setInt(1, (int)user_no);
-        std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-        if (rs->next()) return rs->getInt64(1) - rs->getInt64(2);
+        return grade_max_filesize(db, grade);
     } catch (...) {}
     return -1;
 }
@@ -187,8 +151,8 @@ static int64_t get_remaining_quota(uint32_t user_no, sql::Connection& db)
 // ─────────────────────────────────────────────────────────────────
 //  0x0020  업로드 요청 핸들러
 //
-//  req payload: { "file_name": str, "file_size": int64, "folder": str,
-//                 "user_no": int }
+//  req payload: { "file_name": str, "file_size": int64, "folder": str }
+//  (유저는 세션 기준, 요청의 user_no 는 쓰지 않음)
 //
 //  응답 (code=0 성공):
 //    { "type": 0x0020, "code": 0, "msg": "ok",
@@ -196,19 +160,24 @@ static int64_t get_remaining_quota(uint32_t user_no, sql::Connection& db)
 //
 //  클라이언트는 READY 응답 수신 후 PKT_FILE_CHUNK를 total_chunks 번 전송
 // ─────────────────────────────────────────────────────────────────
-std::string handle_file_upload_req(const json& req, sql::Connection& db)
+std::string handle_file_upload_req(const RequestContext& ctx, const json& req, Storage& db)
 {
+    if (!ctx.logged_in)
+        return make_resp(PKT_FILE_UPLOAD_REQ, VALUE_ERR_SESSION, "로그인 세션 없음");
+
     json pl          = req.value("payload", json::object());
     std::string name = pl.value("file_name", "");
     int64_t     size = pl.value("file_size", (int64_t)0);
     std::string fold = pl.value("folder",    "");
-    uint32_t    uno  = req.value("user_no",  (uint32_t)0);
+    uint32_t    uno  = ctx.user_no;
 
-    if (name.empty() || size <= 0 || uno == 0)
+    if (name.empty() || size <= 0)
         return make_resp(PKT_FILE_UPLOAD_REQ, VALUE_ERR_INVALID_PACKET, "필수 필드 누락");
 
     // 등급별 파일 크기 제한
-    int64_t max_size = get_max_filesize(uno, db);
+    int64_t max_size = get_max_filesize(ctx.grade, db);
+    if (max_size < 0)
+        return make_resp(PKT_FILE_UPLOAD_REQ, VALUE_ERR_DB, "등급 정보 조회 실패");
     if (size > max_size) {
         json ep;
         ep["max_filesize"] = max_size;
@@ -217,18 +186,6 @@ std::string handle_file_upload_req(const json& req, sql::Connection& db)
                          "등급별 파일 크기 초과", ep);
     }
 
-    // 남은 용량 확인
-    int64_t remaining = get_remaining_quota(uno, db);
-    if (remaining < 0)
-        return make_resp(PKT_FILE_UPLOAD_REQ, VALUE_ERR_DB, "DB 오류");
-    if (size > remaining) {
-        json ep;
-        ep["remaining"] = remaining;
-        ep["file_size"] = size;
-        return make_resp(PKT_FILE_UPLOAD_REQ, VALUE_ERR_FILE_QUOTA_EXCEEDED,
-                         "클라우드 용량 초과", ep);
-    }
-
     // 저장 폴더 생성
     std::string save_dir = g_cloud_root + "/" + std::to_string(uno);
     if (!fold.empty()) save_dir += "/" + fold;
@@ -242,6 +199,27 @@ std::string handle_file_upload_req(const json& req, sql::Connection& db)
     // 중복 파일명 해소
     std::string resolved = resolve_filename(save_dir, name);
 
+    // 남은 용량 확인 + 예약 (동시에 여러 업로드가 시작돼도 합계가 용량을 넘지 않음)
+    // 예약은 마지막 청크에서 확정, 끊기거나 시간 초과면 해제
+    int64_t remaining = 0;
+    switch (quota_reserve(db, uno, max_size, size, save_dir + "/" + resolved,
+                          ctx.sock, &remaining)) {
+    case QuotaResult::OK:
+        break;
+    case QuotaResult::EXCEEDED: {
+        json ep;
+        ep["remaining"] = remaining;
+        ep["file_size"] = size;
+        return make_resp(PKT_FILE_UPLOAD_REQ, VALUE_ERR_FILE_QUOTA_EXCEEDED,
+                         "클라우드 용량 초과", ep);
+    }
+    case QuotaResult::BUSY:
+        return make_resp(PKT_FILE_UPLOAD_REQ, VALUE_ERR_UNKNOWN,
+                         "같은 이름의 파일이 업로드 중입니다");
+    case QuotaResult::ERROR:
+        return make_resp(PKT_FILE_UPLOAD_REQ, VALUE_ERR_DB, "DB 오류");
+    }
+
     // total_chunks 계산 (64KB 단위)
     static constexpr int64_t CHUNK = 65536;
     int64_t total_chunks = (size + CHUNK - 1) / CHUNK;
@@ -250,10 +228,10 @@ std::string handle_file_upload_req(const json& req, sql::Connection& db)
     ep["resolved_name"] = resolved;
     ep["total_chunks"]  = total_chunks;
 
-    std::cout << "[FileUpload] user=" << uno
-              << " file=" << resolved
-              << " size=" << size
-              << " chunks=" << total_chunks << "\n";
+    LOG_INFO("[FileUpload] user=" << uno
+             << " file=" << resolved
+             << " size=" << size
+             << " chunks=" << total_chunks);
 
     return make_resp(PKT_FILE_UPLOAD_REQ, VALUE_SUCCESS, "업로드 준비 완료", ep);
 }
@@ -263,26 +241,42 @@ std::string handle_file_upload_req(const json& req, sql::Connection& db)
 //
 //  req payload: { "file_name": str,  "folder": str,
 //                 "chunk_index": int, "total_chunks": int,
-//                 "data_b64": str,   "file_size": int64,
-//                 "user_no": int }
+//                 "data_b64": str,   "file_size": int64 }
+//  (file_size 는 참고용, 저장 / 사용량은 디스크에 쓴 크기 기준)
 //
 //  응답:
 //    중간 청크: { "code": 0, "payload": { "chunk_index": N } }
-//    마지막:   { "code": 0, "payload": { "file_id": N, "file_name": str } }
+//    마지막:   { "code": 0, "payload": { "file_id": N, "file_name": str, "file_size": N } }
 // ─────────────────────────────────────────────────────────────────
-std::string handle_file_chunk(const json& req, sql::Connection& db)
+// 청크 공통 처리: 필드 검사 + 디스크 쓰기 (DB 사용 안 함)
+// 실패 시 err 에 에러 응답을 담아 false 반환
+struct ChunkWrite {
+    std::string name;
+    std::string abs_path;
+    uint32_t    uno     = 0;
+    int         cidx    = 0;
+    bool        is_last = false;
+};
+
+static bool write_chunk(const RequestContext& ctx, const json& req, ChunkWrite& cw, std::string& err)
 {
+    if (!ctx.logged_in) {
+        err = make_resp(PKT_FILE_CHUNK, VALUE_ERR_SESSION, "로그인 세션 없음");
+        return false;
+    }
+
     json        pl      = req.value("payload", json::object());
     std::string name    = pl.value("file_name",    "");
     std::string fold    = pl.value("folder",       "");
     int         cidx    = pl.value("chunk_index",  0);
     int         ctotal  = pl.value("total_chunks", 1);
     std::string b64     = pl.value("data_b64",     "");
-    int64_t     fsize   = pl.value("file_size",    (int64_t)0);
-    uint32_t    uno     = req.value("user_no",     (uint32_t)0);
+    uint32_t    uno     = ctx.user_no;
 
-    if (name.empty() || b64.empty() || uno == 0)
-        return make_resp(PKT_FILE_CHUNK, VALUE_ERR_INVALID_PACKET, "청크 필수 필드 누락");
+    if (name.empty() || b64.empty()) {
+        err = make_resp(PKT_FILE_CHUNK, VALUE_ERR_INVALID_PACKET, "청크 필수 필드 누락");
+        return false;
+    }
 
     // 저장 경로
     std::string save_dir = g_cloud_root + "/" + std::to_string(uno);
@@ -292,63 +286,115 @@ std::string handle_file_chunk(const json& req, sql::Connection& db)
     // base64 디코딩
     std::vector<unsigned char> data = b64_decode(b64);
 
+    // 업로드 예약 확인 (시간 초과로 해제됐으면 조각 파일을 다시 만들지 않음)
+    // 예약량(업로드 요청의 file_size)을 넘겨 쓰는 청크는 업로드 전체를 중단
+    switch (quota_touch(abs_path, static_cast<int64_t>(data.size()), cidx == 0)) {
+    case QuotaWrite::OK:
+        break;
+    case QuotaWrite::NO_RESERVATION:
+        err = make_resp(PKT_FILE_CHUNK, VALUE_ERR_UNKNOWN,
+                        "업로드 예약 없음 (시간 초과 또는 중단됨)");
+        return false;
+    case QuotaWrite::OVER_RESERVED:
+        quota_release(abs_path);
+        { std::error_code ec; fs::remove(abs_path, ec); } // 조각 파일 정리
+        err = make_resp(PKT_FILE_CHUNK, VALUE_ERR_INVALID_PACKET,
+                        "업로드 요청한 파일 크기 초과");
+        return false;
+    }
+
     // 파일 쓰기: 첫 청크면 새로 생성, 이후 append
     std::ios::openmode mode = std::ios::binary | std::ios::app;
     if (cidx == 0) mode = std::ios::binary | std::ios::trunc;
 
     std::ofstream ofs(abs_path, mode);
-    if (!ofs.is_open())
-        return make_resp(PKT_FILE_CHUNK, VALUE_ERR_UNKNOWN,
-                         "파일 열기 실패: " + abs_path);
+    if (!ofs.is_open()) {
+        quota_release(abs_path);
+        err = make_resp(PKT_FILE_CHUNK, VALUE_ERR_UNKNOWN,
+                        "파일 열기 실패: " + abs_path);
+        return false;
+    }
 
     ofs.write(reinterpret_cast<const char*>(data.data()),
               static_cast<std::streamsize>(data.size()));
     ofs.close();
 
-    std::cout << "[FileChunk] user=" << uno
+    LOG_DEBUG("[FileChunk] user=" << uno
               << " file=" << name
-              << " [" << cidx + 1 << "/" << ctotal << "]\n";
+              << " [" << cidx + 1 << "/" << ctotal << "]");
+
+    cw.name     = name;
+    cw.abs_path = abs_path;
+    cw.uno      = uno;
+    cw.cidx     = cidx;
+    cw.is_last  = (cidx == ctotal - 1);
+    return true;
+}
+
+bool file_chunk_is_last(const json& req)
+{
+    json pl = req.value("payload", json::object());
+    return pl.value("chunk_index", 0) == pl.value("total_chunks", 1) - 1;
+}
+
+std::string handle_file_chunk_data(const RequestContext& ctx, const json& req)
+{
+    if (file_chunk_is_last(req))
+        return make_resp(PKT_FILE_CHUNK, VALUE_ERR_UNKNOWN, "마지막 청크는 DB 처리 필요");
+
+    ChunkWrite  cw;
+    std::string err;
+    if (!write_chunk(ctx, req, cw, err)) return err;
+
+    json ep;
+    ep["chunk_index"] = cw.cidx;
+    return make_resp(PKT_FILE_CHUNK, VALUE_SUCCESS, "청크 수신", ep);
+}
+
+std::string handle_file_chunk(const RequestContext& ctx, const json& req, Storage& db)
+{
+    ChunkWrite  cw;
+    std::string err;
+    if (!write_chunk(ctx, req, cw, err)) return err;
 
     // 마지막 청크: DB INSERT + storage_used 갱신
-    bool is_last = (cidx == ctotal - 1);
-    if (!is_last) {
+    if (!cw.is_last) {
         json ep;
-        ep["chunk_index"] = cidx;
+        ep["chunk_index"] = cw.cidx;
         return make_resp(PKT_FILE_CHUNK, VALUE_SUCCESS, "청크 수신", ep);
     }
 
+    const std::string& name     = cw.name;
+    const std::string& abs_path = cw.abs_path;
+    uint32_t           uno      = cw.uno;
+
+    // 디스크에 실제로 쓴 크기로 확정 (클라이언트가 보낸 file_size 는 믿지 않음)
+    std::error_code ec;
+    int64_t fsize = static_cast<int64_t>(fs::file_size(abs_path, ec));
+
+    // 예약 → 확정 사용량 (users.storage_used 는 장부가 모아서 반영)
+    if (ec || !quota_commit(abs_path, fsize)) {
+        quota_release(abs_path);
+        fs::remove(abs_path, ec);
+        return make_resp(PKT_FILE_CHUNK, VALUE_ERR_UNKNOWN,
+                         "업로드 확정 실패 (예약 없음 또는 크기 초과)");
+    }
+
     try {
         // files 테이블 INSERT
-        std::unique_ptr<sql::PreparedStatement> ins(db.prepareStatement(
-            "INSERT INTO files (file_name, file_size, file_path, no) "
-            "VALUES (?, ?, ?, ?)"));
-        ins->setString(1, std::string(name));
-        ins->setInt64 (2, fsize);
-        ins->setString(3, abs_path);
-        ins->setInt   (4, (int)uno);
-        ins->executeUpdate();
-
-        std::unique_ptr<sql::Statement> st(db.createStatement());
-        std::unique_ptr<sql::ResultSet> rs(st->executeQuery("SELECT LAST_INSERT_ID()"));
-        int64_t file_id = rs->next() ? rs->getInt64(1) : -1;
-
-        // storage_used 갱신
-        std::unique_ptr<sql::PreparedStatement> upd(db.prepareStatement(
-            "UPDATE users SET storage_used = storage_used + ? WHERE no = ?"));
-        upd->setInt64(1, fsize);
-        upd->setInt  (2, (int)uno);
-        upd->executeUpdate();
+        int64_t file_id = db.insert_file(name, fsize, abs_path, uno);
 
         json ep;
         ep["file_id"]   = file_id;
         ep["file_name"] = name;
         ep["file_size"] = fsize;
 
-        std::cout << "[FileChunk] 완료 file_id=" << file_id << "\n";
+        LOG_INFO("[FileChunk] 완료 file_id=" << file_id);
         return make_resp(PKT_FILE_CHUNK, VALUE_SUCCESS, "파일 업로드 완료", ep);
 
-    } catch (const sql::SQLException& e) {
-        fs::remove(abs_path); // 파일시스템 롤백
+    } catch (const StorageError& e) {
+        fs::remove(abs_path, ec);     // 파일시스템 롤백
+        quota_credit(db, uno, fsize); // 확정한 사용량 되돌림
         return make_resp(PKT_FILE_CHUNK, VALUE_ERR_DB,
                          std::string("DB 오류: ") + e.what());
     }
@@ -357,39 +403,38 @@ std::string handle_file_chunk(const json& req, sql::Connection& db)
 // ─────────────────────────────────────────────────────────────────
 //  0x0022  다운로드 요청 핸들러
 //
-//  req payload: { "file_id": int64, "user_no": int }
+//  req payload: { "file_id": int64 }
 //
 //  흐름:
 //    1) META 응답 → packet_send (sock)
 //    2) 청크 × total_chunks → packet_send (sock)
 //    3) DONE 응답 반환 (worker 루프가 마지막으로 보냄)
 // ─────────────────────────────────────────────────────────────────
-std::string handle_file_download_req(int sock, const json& req, sql::Connection& db)
+std::string handle_file_download_req(const RequestContext& ctx, const json& req, Storage& db)
 {
+    if (!ctx.logged_in)
+        return make_resp(PKT_FILE_DOWNLOAD_REQ, VALUE_ERR_SESSION, "로그인 세션 없음");
+
+    const int sock  = ctx.sock;
     json    pl      = req.value("payload", json::object());
     int64_t file_id = pl.value("file_id",  (int64_t)0);
-    uint32_t uno    = req.value("user_no", (uint32_t)0);
+    uint32_t uno    = ctx.user_no;
 
-    if (file_id <= 0 || uno == 0)
+    if (file_id <= 0)
         return make_resp(PKT_FILE_DOWNLOAD_REQ, VALUE_ERR_INVALID_PACKET, "file_id 누락");
 
     // DB에서 파일 메타 조회 (소유권 확인 포함)
     std::string file_name, abs_path;
     int64_t     file_size = 0;
     try {
-        std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(
-            "SELECT file_name, file_size, file_path "
-            "FROM files WHERE file_id = ? AND no = ?"));
-        ps->setInt64(1, file_id);
-        ps->setInt  (2, (int)uno);
-        std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-        if (!rs->next())
+        FileRow row;
+        if (!db.file_by_id(file_id, uno, row))
             return make_resp(PKT_FILE_DOWNLOAD_REQ, VALUE_ERR_FILE_NOT_FOUND,
                              "파일을 찾을 수 없습니다");
-        file_name = rs->getString("file_name").c_str();
-        file_size = rs->getInt64("file_size");
-        abs_path  = rs->getString("file_path").c_str();
-    } catch (const sql::SQLException& e) {
+        file_name = row.file_name;
+        file_size = row.file_size;
+        abs_path  = row.file_path;
+    } catch (const StorageError& e) {
         return make_resp(PKT_FILE_DOWNLOAD_REQ, VALUE_ERR_DB,
                          std::string("DB 오류: ") + e.what());
     }
@@ -432,13 +477,13 @@ std::string handle_file_download_req(int sock, const json& req, sql::Connection&
         chunk_pkt["payload"] = chunk_ep;
 
         if (!send_resp(sock, chunk_pkt.dump())) {
-            std::cerr << "[FileDownload] 소켓 오류 idx=" << idx << "\n";
+            LOG_ERROR("[FileDownload] 소켓 오류 idx=" << idx);
             return ""; // 소켓 끊김
         }
 
-        std::cout << "[FileDownload] user=" << uno
+        LOG_DEBUG("[FileDownload] user=" << uno
                   << " file=" << file_name
-                  << " [" << idx + 1 << "/" << total_chunks << "]\n";
+                  << " [" << idx + 1 << "/" << total_chunks << "]");
     }
 
     // ── 3) DONE 응답 반환 (worker 루프가 클라이언트에 마지막으로 전송) ─
@@ -451,32 +496,31 @@ std::string handle_file_download_req(int sock, const json& req, sql::Connection&
 // ─────────────────────────────────────────────────────────────────
 //  0x0023  파일 삭제 핸들러
 //
-//  req payload: { "file_id": int64, "user_no": int }
+//  req payload: { "file_id": int64 }
 // ─────────────────────────────────────────────────────────────────
-std::string handle_file_delete_req(const json& req, sql::Connection& db)
+std::string handle_file_delete_req(const RequestContext& ctx, const json& req, Storage& db)
 {
+    if (!ctx.logged_in)
+        return make_resp(PKT_FILE_DELETE_REQ, VALUE_ERR_SESSION, "로그인 세션 없음");
+
     json    pl      = req.value("payload", json::object());
     int64_t file_id = pl.value("file_id",  (int64_t)0);
-    uint32_t uno    = req.value("user_no", (uint32_t)0);
+    uint32_t uno    = ctx.user_no;
 
-    if (file_id <= 0 || uno == 0)
+    if (file_id <= 0)
         return make_resp(PKT_FILE_DELETE_REQ, VALUE_ERR_INVALID_PACKET, "file_id 누락");
 
     // DB에서 경로/크기 조회 (소유권 확인)
     std::string abs_path;
     int64_t     file_size = 0;
     try {
-        std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(
-            "SELECT file_path, file_size FROM files WHERE file_id = ? AND no = ?"));
-        ps->setInt64(1, file_id);
-        ps->setInt  (2, (int)uno);
-        std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-        if (!rs->next())
+        FileRow row;
+        if (!db.file_by_id(file_id, uno, row))
             return make_resp(PKT_FILE_DELETE_REQ, VALUE_ERR_FILE_NOT_FOUND,
                              "파일을 찾을 수 없습니다");
-        abs_path  = rs->getString("file_path").c_str();
-        file_size = rs->getInt64("file_size");
-    } catch (const sql::SQLException& e) {
+        abs_path  = row.file_path;
+        file_size = row.file_size;
+    } catch (const StorageError& e) {
         return make_resp(PKT_FILE_DELETE_REQ, VALUE_ERR_DB,
                          std::string("DB 오류: ") + e.what());
     }
@@ -485,78 +529,59 @@ std::string handle_file_delete_req(const json& req, sql::Connection& db)
     std::error_code ec;
     fs::remove(abs_path, ec);
 
-    // DB DELETE + storage_used 차감
+    // DB DELETE + 사용량 장부 차감 (users.storage_used 는 장부가 모아서 반영)
     try {
-        std::unique_ptr<sql::PreparedStatement> del(db.prepareStatement(
-            "DELETE FROM files WHERE file_id = ? AND no = ?"));
-        del->setInt64(1, file_id);
-        del->setInt  (2, (int)uno);
-        del->executeUpdate();
-
-        std::unique_ptr<sql::PreparedStatement> upd(db.prepareStatement(
-            "UPDATE users SET storage_used = GREATEST(0, storage_used - ?) WHERE no = ?"));
-        upd->setInt64(1, file_size);
-        upd->setInt  (2, (int)uno);
-        upd->executeUpdate();
-    } catch (const sql::SQLException& e) {
+        if (db.delete_file(file_id, uno) > 0)
+            quota_credit(db, uno, file_size);
+    } catch (const StorageError& e) {
         return make_resp(PKT_FILE_DELETE_REQ, VALUE_ERR_DB,
                          std::string("DB 삭제 오류: ") + e.what());
     }
 
     json ep;
     ep["file_id"] = file_id;
-    std::cout << "[FileDelete] user=" << uno << " file_id=" << file_id << "\n";
+    LOG_INFO("[FileDelete] user=" << uno << " file_id=" << file_id);
     return make_resp(PKT_FILE_DELETE_REQ, VALUE_SUCCESS, "파일 삭제 완료", ep);
 }
 
 // ─────────────────────────────────────────────────────────────────
 //  0x0024  파일 목록 핸들러
 //
-//  req payload: { "folder": str, "user_no": int }
+//  req payload: { "folder": str }
 //
 //  응답 payload:
 //    { "files": [ { file_id, file_name, file_size, created_at, folder } ],
 //      "storage_used": int64, "storage_total": int64 }
 // ─────────────────────────────────────────────────────────────────
-std::string handle_file_list_req(const json& req, sql::Connection& db)
+std::string handle_file_list_req(const RequestContext& ctx, const json& req, Storage& db)
 {
+    if (!ctx.logged_in)
+        return make_resp(PKT_FILE_LIST_REQ, VALUE_ERR_SESSION, "로그인 세션 없음");
+
     json        pl   = req.value("payload", json::object());
     std::string fold = pl.value("folder",   "");
-    uint32_t    uno  = req.value("user_no", (uint32_t)0);
-
-    if (uno == 0)
-        return make_resp(PKT_FILE_LIST_REQ, VALUE_ERR_INVALID_PACKET, "user_no 누락");
+    uint32_t    uno  = ctx.user_no;
 
     json    files_arr   = json::array();
     int64_t storage_used  = 0;
     int64_t storage_total = 0;
 
     try {
-        // 파일 목록 SELECT
-        // 폴더 필터: g_cloud_root/{uno}/{fold}/% 로 시작하는 경로만 매칭
+        // 파일 목록 조회
+        // 폴더 필터: g_cloud_root/{uno}/{fold}/ 로 시작하는 경로만 매칭
         // (기존 "%" + fold + "%" 방식은 이름이 포함된 모든 경로를 잘못 매칭함)
         std::string user_prefix = g_cloud_root + "/" + std::to_string(uno) + "/";
-        std::string sql_q =
-            "SELECT file_id, file_name, file_size, created_at, file_path "
-            "FROM files WHERE no = ? ";
-        if (!fold.empty()) sql_q += "AND file_path LIKE ? ";
-        sql_q += "ORDER BY created_at DESC";
-
-        std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(sql_q));
-        ps->setInt(1, (int)uno);
-        // 정확한 폴더 경로 prefix로 필터링 (예: /cloud/1/work/%)
-        if (!fold.empty()) ps->setString(2, user_prefix + fold + "/%");
-
-        std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-        while (rs->next()) {
+        std::string path_prefix = fold.empty() ? "" : user_prefix + fold + "/";
+
+        for (const FileRow& row : db.list_files(uno, path_prefix)) {
             json f;
-            f["file_id"]   = rs->getInt64("file_id");
-            f["file_name"] = rs->getString("file_name").c_str();
-            f["file_size"] = rs->getInt64("file_size");
-            f["created_at"]= rs->getString("created_at").c_str();
+            f["file_id"]   = row.file_id;
+            f["file_name"] = row.file_name;
+            f["file_size"] = row.file_size;
+            f["created_at"]= row.created_at;
 
             // file_path에서 folder 추출
-            std::string path = rs->getString("file_path").c_str();
+            const std::string& path = row.file_path;
             std::string prefix = g_cloud_root + "/" + std::to_string(uno) + "/";
             std::string rel = path;
             if (rel.rfind(prefix, 0) == 0) rel = rel.substr(prefix.size());
@@ -566,17 +591,10 @@ std::string handle_file_list_req(const json& req, sql::Connection& db)
             files_arr.push_back(f);
         }
 
-        // 용량 정보 조회
-        std::unique_ptr<sql::PreparedStatement> ps2(db.prepareStatement(
-            "SELECT u.storage_used, g.max_filesize "
-            "FROM users u JOIN grades g ON u.grade = g.grade WHERE u.no = ?"));
-        ps2->setInt(1, (int)uno);
-        std::unique_ptr<sql::ResultSet> rs2(ps2->executeQuery());
-        if (rs2->next()) {
-            storage_used  = rs2->getInt64(1);
-            storage_total = rs2->getInt64(2);
-        }
-    } catch (const sql::SQLException& e) {
+        // 용량 정보 조회 (등급은 세션 기준)
+        storage_used  = std::max<int64_t>(0, quota_used(db, uno));
+        storage_total = std::max<int64_t>(0, grade_max_filesize(db, ctx.grade));
+    } catch (const StorageError& e) {
         return make_resp(PKT_FILE_LIST_REQ, VALUE_ERR_DB,
                          std::string("DB 오류: ") + e.what());
     }
@@ -3,23 +3,20 @@
 // 목적: 서버 파일 기능 핸들러 선언
 //
 // [기존 코드와의 연결]
-//   skeleton_server.cpp의 worker_loop switch(type)에 아래 case 추가:
+//   skeleton_server.cpp의 dispatch_request switch(type)에 아래 case 추가:
 //
 //     case PKT_FILE_UPLOAD_REQ:
-//         out_payload = handle_file_upload_req(req, *conn);
-//         break;
+//         return handle_file_upload_req(ctx, req, db);
 //     case PKT_FILE_CHUNK:
-//         out_payload = handle_file_chunk(req, *conn);
-//         break;
+//         return handle_file_chunk(ctx, req, db);
 //     case PKT_FILE_DOWNLOAD_REQ:
-//         out_payload = handle_file_download_req(task.sock, req, *conn);
-//         break;
+//         return handle_file_download_req(ctx, req, db);
 //     case PKT_FILE_DELETE_REQ:
-//         out_payload = handle_file_delete_req(req, *conn);
-//         break;
+//         return handle_file_delete_req(ctx, req, db);
 //     case PKT_FILE_LIST_REQ:
-//         out_payload = handle_file_list_req(req, *conn);
-//         break;
+//         return handle_file_list_req(ctx, req, db);
+//
+//   유저(users.no / 등급)는 ctx(세션) 기준, 요청 최상위 user_no 는 쓰지 않음
 //
 //   main()에서 서버 시작 전:
 //     file_handler_init("/srv/3loud/files");
@@ -32,7 +29,8 @@
 
 #include <string>
 #include <nlohmann/json.hpp>
-#include <mariadb/conncpp.hpp>
+#include "storage.h"
+#include "request_context.h"
 
 using json = nlohmann::json;
 
@@ -44,22 +42,29 @@ extern std::string g_cloud_root;
 
 // 0x0020  업로드 요청 - 메타 검사 후 READY 응답
 // req payload: { "file_name": str, "file_size": int64, "folder": str }
-std::string handle_file_upload_req(const json& req, sql::Connection& db);
+std::string handle_file_upload_req(const RequestContext& ctx, const json& req, Storage& db);
 
 // 0x0021  청크 수신 - 파일 데이터 append, 마지막 청크면 DB INSERT
 // req payload: { "file_name": str, "folder": str,
 //                "chunk_index": int, "total_chunks": int,
 //                "data_b64": str, "file_size": int64 }
-std::string handle_file_chunk(const json& req, sql::Connection& db);
+std::string handle_file_chunk(const RequestContext& ctx, const json& req, Storage& db);
+
+// 청크가 마지막인지 (마지막 청크만 DB 작업이 있음)
+bool file_chunk_is_last(const json& req);
+
+// 0x0021  중간 청크 전용 - 디스크 쓰기만 하고 DB 커넥션을 쓰지 않음
+//         (worker 가 DB 커넥션을 대여하지 않고 처리)
+std::string handle_file_chunk_data(const RequestContext& ctx, const json& req);
 
-// 0x0022  다운로드 요청 - sock에 청크를 직접 전송 후 DONE 응답 반환
+// 0x0022  다운로드 요청 - ctx.sock에 청크를 직접 전송 후 DONE 응답 반환
 // req payload: { "file_id": int64 }
-std::string handle_file_download_req(int sock, const json& req, sql::Connection& db);
+std::string handle_file_download_req(const RequestContext& ctx, const json& req, Storage& db);
 
 // 0x0023  파일 삭제 - 파일시스템 + DB 삭제
 // req payload: { "file_id": int64 }
-std::string handle_file_delete_req(const json& req, sql::Connection& db);
+std::string handle_file_delete_req(const RequestContext& ctx, const json& req, Storage& db);
 
 // 0x0024  파일 목록 - DB SELECT 후 JSON 배열 반환
 // req payload: { "folder": str }  (빈 문자열이면 전체)
-std::string handle_file_list_req(const json& req, sql::Connection& db);
+std::string handle_file_list_req(const RequestContext& ctx, const json& req, Storage& db);
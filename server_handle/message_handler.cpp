@@ -6,43 +6,36 @@
 //             content, is_read, is_temp, sent_at
 //   blacklist: owner_user_id(→users.no), blocked_email
 //
-// 세션 맵: g_socket_users[sock] = email
+// 호출자: RequestContext (worker 가 세션 맵에서 요청당 한 번 복사)
 // ============================================================
 
 #include "message_handler.hpp"
 #include "protocol.h"
 #include "json_packet.hpp"
-#include "server.h"
+#include "request_context.h"
+#include "storage.h"
+#include "user_cache.h"
+#include "blacklist_cache.h"
+#include "message_writer.h"
+#include "unread_counter.h"
+#include "credential_pool.h"
+#include "logger.h"
+#include <algorithm>
+#include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 
 using json = nlohmann::json;
 
 // ──────────────────────────────────────────────
-// 내부 헬퍼: 현재 소켓의 세션 이메일 반환
+// 내부 헬퍼: 이메일 → users.no (없으면 0, 유저 캐시 사용)
 // ──────────────────────────────────────────────
-static std::string get_session_email(int sock)
-{
-    std::lock_guard<std::mutex> lock(g_login_m);
-    auto it = g_socket_users.find(sock);
-    if (it == g_socket_users.end())
-        return "";
-    return it->second;
-}
-
-// ──────────────────────────────────────────────
-// 내부 헬퍼: 이메일 → users.no (없으면 0)
-// ──────────────────────────────────────────────
-static unsigned int get_user_no(sql::Connection &db,
+static unsigned int get_user_no(Storage &db,
                                 const std::string &email)
 {
-    std::unique_ptr<sql::PreparedStatement> ps(
-        db.prepareStatement("SELECT no FROM users WHERE email = ? LIMIT 1"));
-    ps->setString(1, email);
-    std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-    if (rs->next())
-        return (unsigned int)rs->getUInt("no");
-    return 0;
+    UserPtr u = user_cache_by_email(db, email);
+    return u ? u->no : 0;
 }
 
 // ──────────────────────────────────────────────
@@ -53,39 +46,22 @@ static unsigned int get_user_no(sql::Connection &db,
 // 내부 헬퍼: 블랙리스트 체크 (시그니처 유지, 내부만 이메일 기반으로 정합)         // 설명
 // receiver_no(=users.no) -> owner_email(users.email) 변환 후 blacklist(owner_email) 조회 // 설명
 // ──────────────────────────────────────────────  // 구분 주석
-static bool is_blacklisted(sql::Connection &db,             // DB 커넥션
+static bool is_blacklisted(Storage &db,             // DB 커넥션
                            unsigned int receiver_no,        // 수신자 user_no (시그니처 유지)
                            const std::string &sender_email) // 송신자 이메일
 {
     try // 예외 보호
     {
-        // 1) receiver_no -> receiver_email 변환                                    // 변환 설명
-        std::unique_ptr<sql::PreparedStatement> ps_owner(      // owner 조회 statement
-            db.prepareStatement(                               // SQL 준비
-                "SELECT email FROM users WHERE no = ? LIMIT 1" // user_no -> email
-                ));
-        ps_owner->setUInt(1, receiver_no);                                  // receiver_no 바인딩
-        std::unique_ptr<sql::ResultSet> rs_owner(ps_owner->executeQuery()); // 실행
+        // 1) receiver_no -> receiver_email 변환 (유저 캐시)                         // 변환 설명
+        UserPtr owner = user_cache_by_no(db, receiver_no); // 캐시 조회
 
-        if (!rs_owner->next()) // 사용자가 없으면
+        if (!owner) // 사용자가 없으면
         {
             return false; // 차단 없음 처리
         }
 
-        std::string owner_email = rs_owner->getString("email").c_str(); // owner_email 확보
-
-        // 2) blacklist(owner_email, blocked_email) 조회                             // 조회 설명
-        std::unique_ptr<sql::PreparedStatement> ps(            // blacklist 조회 statement
-            db.prepareStatement(                               // SQL 준비
-                "SELECT 1 FROM blacklist "                     // 존재 체크
-                "WHERE owner_email = ? AND blocked_email = ? " // 조건
-                "LIMIT 1"                                      // 1개면 충분
-                ));
-        ps->setString(1, owner_email);                          // owner_email 바인딩
-        ps->setString(2, sender_email);                         // blocked_email 바인딩
-        std::unique_ptr<sql::ResultSet> rs(ps->executeQuery()); // 실행
-
-        return rs->next(); // 있으면 true
+        // 2) owner 의 차단 집합에서 조회 (메모리, owner 당 최초 1회만 DB)          // 조회 설명
+        return blacklist_cache_is_blocked(db, owner->email, sender_email); // 있으면 true
     }
     catch (...) // 예외 시
     {
@@ -105,63 +81,77 @@ static bool is_blacklisted(sql::Connection &db,             // DB 커넥션
 //   3. 수신자 이메일 → users.no  (없으면 VALUE_ERR_USER_NOT_FOUND)
 //   4. 블랙리스트 체크  (차단 시 조용히 SUCCESS 반환)
 //   5. DB INSERT messages
+//      (묶음 요청 밖이면 message_writer 큐 → 여러 전송을 한 commit 으로, commit 후 응답)
 // ============================================================
 // ============================================================
 // handle_msg_poll  (PKT_MSG_POLL_REQ = 0x0011)
 //
 // 폴링 전용 핸들러: 세션 없이 email+pw_hash로 직접 인증
 // 중복 로그인 체크 없이 has_unread 만 반환
+// (로그인된 소켓 / 요청 최상위 token 으로 세션에 묶인 소켓이면 email/pw_hash 없이 세션 기준
+//  → 메인 메뉴 / 로그인 묶음 요청 / 폴링 스레드에서 사용, pw_hash 는 구버전 클라이언트용)
+//
+// 요청 payload: { "email": "...", "pw_hash": "..." }  ← 세션이 있으면 생략 가능
+// 응답 payload: { "has_unread": true/false, "unread_count": N }
 //
-// 요청 payload: { "email": "...", "pw_hash": "..." }
-// 응답 payload: { "has_unread": true/false }
+// - 안읽은 수는 메모리 카운터(unread_counter)에서 → 적중이면 DB 조회 없음
+//   로그인 세션이면서 적중이면 worker 가 DB 커넥션도 빌리지 않음 (handle_msg_poll_cached)
 // ============================================================
-std::string handle_msg_poll(const json &req, sql::Connection &db)
+std::string handle_msg_poll(const RequestContext &ctx, const json &req, Storage &db)
 {
     try
     {
-        json payload = get_payload(req);
-        std::string email = payload.value("email", "");
-        std::string pw_hash = payload.value("pw_hash", "");
-
-        if (email.empty() || pw_hash.empty())
+        std::string email = ctx.email;
+        if (!ctx.logged_in)
         {
-            json res = make_response(PKT_MSG_POLL_REQ, VALUE_ERR_INVALID_PACKET);
-            res["msg"] = "email/pw_hash 누락";
-            return res.dump();
+            json payload = get_payload(req);
+            email = payload.value("email", "");
+            std::string pw_hash = payload.value("pw_hash", "");
+
+            if (email.empty() || pw_hash.empty())
+            {
+                json res = make_response(PKT_MSG_POLL_REQ, VALUE_ERR_INVALID_PACKET);
+                res["msg"] = "email/pw_hash 누락";
+                return res.dump();
+            }
+
+            // pw_hash 검증 (유저 캐시 → 5초마다 오는 폴링이 users 를 다시 읽지 않음)
+            // 해시 계산은 해싱 풀 + 검증 결과 캐시 → 두 번째 폴링부터는 캐시 적중
+            UserPtr user = user_cache_by_email(db, email);
+            PwCheck pc = user ? pw_check(user->pw_hash, pw_hash, ctx.resume, nullptr) : PwCheck::MISMATCH;
+            if (pc == PwCheck::PENDING)
+                return "";
+            if (pc == PwCheck::BUSY)
+            {
+                json res = make_response(PKT_MSG_POLL_REQ, VALUE_ERR_RATE_LIMITED);
+                res["msg"] = "잠시 후 다시 시도";
+                res["payload"] = {{"retry_after", 1}};
+                return res.dump();
+            }
+            if (pc != PwCheck::OK)
+            {
+                json res = make_response(PKT_MSG_POLL_REQ, VALUE_ERR_INVALID_PACKET);
+                res["msg"] = "인증 실패";
+                return res.dump();
+            }
         }
 
-        // pw_hash 검증
-        std::unique_ptr<sql::PreparedStatement> auth_st(
-            db.prepareStatement("SELECT pw_hash FROM users WHERE email = ? LIMIT 1"));
-        auth_st->setString(1, email);
-        std::unique_ptr<sql::ResultSet> auth_rs(auth_st->executeQuery());
-        if (!auth_rs->next() ||
-            std::string(auth_rs->getString("pw_hash").c_str()) != pw_hash)
+        int64_t unread = unread_counter_get(db, email);
+        if (unread < 0)
         {
-            json res = make_response(PKT_MSG_POLL_REQ, VALUE_ERR_INVALID_PACKET);
-            res["msg"] = "인증 실패";
+            json res = make_response(PKT_MSG_POLL_REQ, VALUE_ERR_USER_NOT_FOUND);
+            res["msg"] = "사용자 정보 없음";
             return res.dump();
         }
 
-        // has_unread 조회
-        std::unique_ptr<sql::PreparedStatement> pstmt(
-            db.prepareStatement(
-                "SELECT COUNT(*) AS cnt FROM messages "
-                "WHERE to_email = ? AND is_read = 0 LIMIT 1"));
-        pstmt->setString(1, email);
-        std::unique_ptr<sql::ResultSet> rs(pstmt->executeQuery());
-        bool has_unread = false;
-        if (rs->next())
-            has_unread = (rs->getInt("cnt") > 0);
-
         json res = make_response(PKT_MSG_POLL_REQ, VALUE_SUCCESS);
         res["msg"] = "ok";
-        res["payload"] = {{"has_unread", has_unread}};
+        res["payload"] = {{"has_unread", unread > 0}, {"unread_count", unread}};
         return res.dump();
     }
-    catch (const sql::SQLException &e)
+    catch (const StorageError &e)
     {
-        std::cerr << "[POLL] SQL 예외: " << e.what() << std::endl;
+        LOG_ERROR("[POLL] DB 예외: " << e.what());
         json res = make_response(PKT_MSG_POLL_REQ, VALUE_ERR_DB);
         res["msg"] = std::string("DB 오류: ") + e.what();
         return res.dump();
@@ -174,19 +164,33 @@ std::string handle_msg_poll(const json &req, sql::Connection &db)
     }
 }
 
-std::string handle_msg_send(const json &req, sql::Connection &db)
+// 로그인 세션 + 캐시 적중일 때만 (응답 형식은 handle_msg_poll 과 같음)
+std::string handle_msg_poll_cached(const RequestContext &ctx)
+{
+    int64_t unread = 0;
+    if (!ctx.logged_in || !unread_counter_peek(ctx.email, unread))
+        return "";
+    json res = make_response(PKT_MSG_POLL_REQ, VALUE_SUCCESS);
+    res["msg"] = "ok";
+    res["payload"] = {{"has_unread", unread > 0}, {"unread_count", unread}};
+    return res.dump();
+}
+
+std::string handle_msg_send(const RequestContext &ctx, const json &req, Storage &db,
+                            const std::function<void(std::string)> &reply)
 {
     try
     {
         // 1. 세션 확인
-        std::string sender_email = get_session_email(g_current_sock);
-        if (sender_email.empty())
+        if (!ctx.logged_in)
         {
             json res = make_response(PKT_MSG_SEND_REQ, VALUE_ERR_SESSION);
             res["msg"] = "로그인 세션 없음";
             return res.dump();
         }
 
+        const std::string &sender_email = ctx.email;
+
         // 2. payload 파싱
         json payload = get_payload(req);
         std::string receiver_email = payload.value("to", "");
@@ -228,25 +232,18 @@ std::string handle_msg_send(const json &req, sql::Connection &db)
         // =======================================================
         // [ADMIN NEW] 관리자가 보내는 메시지 앞부분에 [gm닉네임] 자동 추가
         // =======================================================
+        // 관리자 여부는 세션의 user_no 로 판단 → 일반 유저는 유저 캐시 조회 없음
         try
         {
-            // 보낸 사람의 user_no와 nickname을 DB에서 조회
-            std::unique_ptr<sql::PreparedStatement> ps_sender(
-                db.prepareStatement("SELECT no, nickname FROM users WHERE email = ? LIMIT 1"));
-            ps_sender->setString(1, sender_email);
-            std::unique_ptr<sql::ResultSet> rs_sender(ps_sender->executeQuery());
-
-            if (rs_sender->next())
+            if (ctx.is_admin())
             {
-                unsigned int sender_no = rs_sender->getUInt("no");
-                std::string sender_nickname = rs_sender->getString("nickname").c_str();
-
-                // 관리자 계정 (user_no 1~4)인 경우 접두사 추가
-                if (sender_no >= 1 && sender_no <= 4)
+                // 닉네임만 유저 캐시에서 조회
+                UserPtr sender = user_cache_by_email(db, sender_email);
+                if (sender)
                 {
                     // \033[95m : 밝은 핑크색 시작
                     // \033[0m  : 색상 초기화 (본문은 원래 색으로)
-                    content = "\033[95m[" + sender_nickname + "]\033[0m " + content;
+                    content = "\033[95m[" + sender->nickname + "]\033[0m " + content;
                 }
             }
         }
@@ -256,125 +253,160 @@ std::string handle_msg_send(const json &req, sql::Connection &db)
         }
         // =======================================================
         // 5. DB INSERT
-        std::unique_ptr<sql::PreparedStatement> pstmt(
-            db.prepareStatement(
-                "INSERT INTO messages (from_email, to_email, content) "
-                "VALUES (?, ?, ?)"));
-        pstmt->setString(1, sender_email);
-        pstmt->setString(2, receiver_email);
-        pstmt->setString(3, content);
-        pstmt->executeUpdate();
+        //    응답 콜백이 있으면 writer 큐로 → 묶음 commit 후 콜백으로 응답 (여기서는 빈 문자열 반환)
+        if (reply)
+        {
+            bool queued = message_writer_submit(
+                {sender_email, receiver_email, content,
+                 [reply](bool ok, const std::string &err)
+                 {
+                     json res = make_response(PKT_MSG_SEND_REQ, ok ? VALUE_SUCCESS : VALUE_ERR_DB);
+                     res["msg"] = ok ? std::string("전송 완료") : "DB 오류: " + err;
+                     reply(res.dump());
+                 }});
+            if (queued)
+                return "";
+        }
+
+        UnreadChange uc(&db, {receiver_email});
+        db.insert_messages({{sender_email, receiver_email, content}});
+        uc.add(receiver_email, 1);
 
         json res = make_response(PKT_MSG_SEND_REQ, VALUE_SUCCESS);
         res["msg"] = "전송 완료";
         return res.dump();
     }
-    catch (const sql::SQLException &e)
+    catch (const StorageError &e)
     {
-        std::cerr << "[MSG_SEND] SQL 예외: " << e.what() << std::endl;
+        LOG_ERROR("[MSG_SEND] DB 예외: " << e.what());
         json res = make_response(PKT_MSG_SEND_REQ, VALUE_ERR_DB);
         res["msg"] = std::string("DB 오류: ") + e.what();
         return res.dump();
     }
     catch (const std::exception &e)
     {
-        std::cerr << "[MSG_SEND] 예외: " << e.what() << std::endl;
+        LOG_ERROR("[MSG_SEND] 예외: " << e.what());
         json res = make_response(PKT_MSG_SEND_REQ, VALUE_ERR_UNKNOWN);
         res["msg"] = std::string("오류: ") + e.what();
         return res.dump();
     }
     catch (...)
     {
-        std::cerr << "[MSG_SEND] 알 수 없는 예외 발생" << std::endl;
+        LOG_ERROR("[MSG_SEND] 알 수 없는 예외 발생");
         json res = make_response(PKT_MSG_SEND_REQ, VALUE_ERR_UNKNOWN);
         res["msg"] = "알 수 없는 오류";
         return res.dump();
     }
 }
 
+// 메시지 목록 한 페이지 크기
+static constexpr int MSG_LIST_PAGE_SIZE = 20;
+
 // ============================================================
 // handle_msg_list  (PKT_MSG_LIST_REQ = 0x0012)
 //
 // 요청 payload:
-//   { "page": 0 }   ← 생략 가능, 기본 0 (20개씩)
+//   { "cursor": { "sent_at": "...", "msg_id": N } }  ← 이전 응답의 next_cursor (권장)
+//   { "page": 0 }   ← cursor 없을 때만 사용, 생략 가능, 기본 0 (20개씩, 하위 호환)
 //
 // 응답 payload:
 //   {
-//     "messages":  [{ msg_id, from_email, content, is_read, sent_at }],
-//     "has_unread": true/false,
-//     "page":       0
+//     "messages":    [{ msg_id, from_email, content, is_read, sent_at }],
+//     "has_unread":  true/false,      ← 이 페이지가 아니라 수신함 전체 기준 (unread_counter)
+//     "unread_count": N,
+//     "page":        0,
+//     "next_cursor": { "sent_at": "...", "msg_id": N } | null   ← 더 없으면 null
+//     "head_cursor": { "sent_at": "...", "msg_id": N } | null   ← 이 페이지 첫 행
 //   }
 //
 // - 수신 메시지 기준 (to_user_id = 내 no)
-// - 최신순, 20개씩 페이징
+// - 최신순 (sent_at, msg_id) 내림차순, 20개씩
+// - cursor 는 마지막 행 다음부터 seek → 몇 번째 페이지든 인덱스
+//   (messages(to_email, sent_at, msg_id), db/migrations/001 참고) 범위 스캔 20행
+// - page 는 OFFSET 방식이라 깊은 페이지일수록 느림
 // ============================================================
-std::string handle_msg_list(const json &req, sql::Connection &db)
+std::string handle_msg_list(const RequestContext &ctx, const json &req, Storage &db)
 {
     try
     {
         // 1. 세션 확인
-        std::string user_email = get_session_email(g_current_sock);
-        if (user_email.empty())
+        const std::string &user_email = ctx.email;
+        if (!ctx.logged_in)
         {
             json res = make_response(PKT_MSG_LIST_REQ, VALUE_ERR_SESSION);
             res["msg"] = "로그인 세션 없음";
             return res.dump();
         }
 
-        // 2. page 처리
+        // 2. cursor / page 처리
         json payload = get_payload(req);
         int page = payload.value("page", 0);
         if (page < 0)
             page = 0;
-        int offset = page * 20;
+        int offset = page * MSG_LIST_PAGE_SIZE;
+
+        bool use_cursor = false;
+        std::string cursor_sent_at;
+        unsigned int cursor_msg_id = 0;
+        if (payload.contains("cursor") && payload["cursor"].is_object())
+        {
+            const json &cur = payload["cursor"];
+            cursor_sent_at = cur.value("sent_at", "");
+            cursor_msg_id = cur.value("msg_id", 0u);
+            if (cursor_sent_at.empty() || cursor_msg_id == 0)
+            {
+                json res = make_response(PKT_MSG_LIST_REQ, VALUE_ERR_INVALID_PACKET);
+                res["msg"] = "잘못된 cursor";
+                return res.dump();
+            }
+            use_cursor = true;
+        }
 
         // 3. 블랙리스트 필터 포함 조회
-        std::unique_ptr<sql::PreparedStatement> pstmt(
-            db.prepareStatement(
-                "SELECT msg_id, from_email, content, is_read, "
-                "DATE_FORMAT(sent_at, '%Y-%m-%d %H:%i:%s') AS sent_at "
-                "FROM messages m "
-                "WHERE m.to_email = ? "
-                "AND NOT EXISTS ( "
-                "    SELECT 1 FROM blacklist b "
-                "    WHERE b.owner_email = ? "
-                "    AND b.blocked_email = m.from_email "
-                ") "
-                "ORDER BY m.sent_at DESC "
-                "LIMIT 20 OFFSET ?"));
-
-        pstmt->setString(1, user_email); // to_email
-        pstmt->setString(2, user_email); // owner_email (블랙리스트 주인)
-        pstmt->setInt(3, offset);        // 페이지 offset
-
-        std::unique_ptr<sql::ResultSet> rs(pstmt->executeQuery());
+        //    차단 집합은 메모리 색인에서 가져와 제외 목록으로 넘김
+        //    (행마다 blacklist 서브쿼리를 돌지 않음, 차단 없으면 조건 자체 생략)
+        BlockSetPtr blocked = blacklist_cache_get(db, user_email);
+        std::vector<std::string> blocked_list(blocked->emails.begin(), blocked->emails.end());
+        MessageCursor after{cursor_sent_at, cursor_msg_id};
+        std::vector<MessageRow> rows = db.list_messages(user_email, use_cursor ? &after : nullptr,
+                                                        offset, MSG_LIST_PAGE_SIZE, blocked_list);
+
+        int64_t unread = unread_counter_get(db, user_email);
 
         json msg_list = json::array();
-        bool has_unread = false;
+        json next_cursor = nullptr;
+        json head_cursor = nullptr; // 첫 행 (모두 읽음 처리 up_to 용)
 
-        while (rs->next())
+        for (const MessageRow &r : rows)
         {
-            bool is_read = (rs->getInt("is_read") != 0);
-            if (!is_read)
-                has_unread = true;
-
-            msg_list.push_back({{"msg_id", (int)rs->getUInt("msg_id")},
-                                {"from_email", rs->getString("from_email").c_str()},
-                                {"content", rs->getString("content").c_str()},
-                                {"is_read", is_read},
-                                {"sent_at", rs->getString("sent_at").c_str()}});
+            // 마지막 행이 다음 페이지 커서 (sent_at 은 원본 정밀도 그대로)
+            next_cursor = {{"sent_at", r.sent_at_key},
+                           {"msg_id", r.msg_id}};
+            if (head_cursor.is_null())
+                head_cursor = next_cursor;
+
+            msg_list.push_back({{"msg_id", (int)r.msg_id},
+                                {"from_email", r.from_email},
+                                {"content", r.content},
+                                {"is_read", r.is_read},
+                                {"sent_at", r.sent_at}});
         }
 
         json res = make_response(PKT_MSG_LIST_REQ, VALUE_SUCCESS);
         res["msg"] = "조회 성공";
+        if (msg_list.size() < static_cast<size_t>(MSG_LIST_PAGE_SIZE))
+            next_cursor = nullptr; // 마지막 페이지
         res["payload"] = {
             {"messages", msg_list},
-            {"has_unread", has_unread},
-            {"page", page}};
+            {"has_unread", unread > 0},
+            {"unread_count", std::max<int64_t>(0, unread)},
+            {"page", page},
+            {"next_cursor", next_cursor},
+            {"head_cursor", head_cursor}};
 
         return res.dump();
     }
-    catch (const sql::SQLException &e)
+    catch (const StorageError &e)
     {
         json res = make_response(PKT_MSG_LIST_REQ, VALUE_ERR_DB);
         res["msg"] = std::string("DB 오류: ") + e.what();
@@ -387,6 +419,66 @@ std::string handle_msg_list(const json &req, sql::Connection &db)
         return res.dump();
     }
 }
+// 삭제 / 읽음 처리 한 번에 받는 msg_id 최대 개수
+static constexpr size_t MSG_BULK_MAX = 100;
+
+// ──────────────────────────────────────────────
+// 내부 헬퍼: msg_ids 배열 → 중복/잘못된 값 제거한 id 목록
+// ──────────────────────────────────────────────
+static std::vector<unsigned int> parse_msg_ids(const json &arr)
+{
+    std::vector<unsigned int> ids;
+    for (const auto &v : arr)
+    {
+        if (v.is_number_integer() && v.get<long long>() > 0)
+            ids.push_back(v.get<unsigned int>());
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+// ──────────────────────────────────────────────
+// 내부 헬퍼: 핸들러 안에서 여러 문장을 한 트랜잭션으로
+// - 이미 트랜잭션 안이면 (atomic 묶음 요청) 시작/commit 은 바깥에 맡김
+// - commit() 없이 scope 를 벗어나면 rollback
+// ──────────────────────────────────────────────
+namespace
+{
+class LocalTxn
+{
+public:
+    explicit LocalTxn(Storage &db) : db_(db), owner_(!db.in_transaction())
+    {
+        if (owner_)
+            db_.begin();
+    }
+    ~LocalTxn()
+    {
+        if (!owner_ || done_)
+            return;
+        try
+        {
+            db_.rollback();
+        }
+        catch (...)
+        {
+        }
+    }
+    void commit()
+    {
+        if (owner_)
+            db_.commit();
+        done_ = true;
+    }
+
+private:
+    Storage &db_;
+    bool owner_;
+    bool done_ = false;
+};
+} // namespace
+
 // ============================================================
 // handle_msg_delete  (PKT_MSG_DELETE_REQ = 0x0013)
 //
@@ -395,27 +487,22 @@ std::string handle_msg_list(const json &req, sql::Connection &db)
 //
 // 보안 규칙:
 //   - 수신자(to_user_id = 내 no) 또는 송신자(from_email = 내 이메일)만 삭제 가능
+//
+// - 저장소에 id 목록을 한 번에 넘김 (mariadb: DELETE ... IN (...) RETURNING msg_id 한 문장)
+//   실패 id = 요청 id - 실제 삭제된 id
 // ============================================================
-std::string handle_msg_delete(const json &req, sql::Connection &db)
+std::string handle_msg_delete(const RequestContext &ctx, const json &req, Storage &db)
 {
     try
     {
-        std::string user_email = get_session_email(g_current_sock);
-        if (user_email.empty())
+        const std::string &user_email = ctx.email;
+        if (!ctx.logged_in)
         {
             json res = make_response(PKT_MSG_DELETE_REQ, VALUE_ERR_SESSION);
             res["msg"] = "로그인 세션 없음";
             return res.dump();
         }
 
-        unsigned int user_no = get_user_no(db, user_email);
-        if (user_no == 0)
-        {
-            json res = make_response(PKT_MSG_DELETE_REQ, VALUE_ERR_DB);
-            res["msg"] = "사용자 정보 없음";
-            return res.dump();
-        }
-
         json payload = get_payload(req);
 
         if (!payload.contains("msg_ids") || !payload["msg_ids"].is_array() || payload["msg_ids"].empty())
@@ -426,38 +513,35 @@ std::string handle_msg_delete(const json &req, sql::Connection &db)
         }
 
         auto &id_arr = payload["msg_ids"];
-        if (id_arr.size() > 100)
+        if (id_arr.size() > MSG_BULK_MAX)
         {
             json res = make_response(PKT_MSG_DELETE_REQ, VALUE_ERR_INVALID_PACKET);
             res["msg"] = "한 번에 최대 100개까지 삭제 가능";
             return res.dump();
         }
 
-        // 수신자 또는 송신자 본인 메시지만 삭제
-        std::unique_ptr<sql::PreparedStatement> del_stmt(
-            db.prepareStatement(
-                "DELETE FROM messages "
-                "WHERE msg_id = ? "
-                "AND (to_email = ? OR from_email = ?)"));
+        std::vector<unsigned int> ids = parse_msg_ids(id_arr);
+        if (ids.empty())
+        {
+            json res = make_response(PKT_MSG_DELETE_REQ, VALUE_ERR_INVALID_PACKET);
+            res["msg"] = "유효한 msg_id 없음";
+            return res.dump();
+        }
 
-        int deleted_count = 0;
-        json failed_ids = json::array();
+        // 수신자 또는 송신자 본인 메시지만 삭제 (단일 문장 → 그 자체로 한 트랜잭션)
+        //    안읽은 채 지워진 만큼 수신자별 안읽은 수 감소 (남이 받은 메시지는 그 유저 항목만 제거)
+        UnreadChange uc(&db, {user_email});
+        UnreadDeltas unread_removed;
+        std::vector<unsigned int> deleted = db.delete_messages(user_email, ids, &unread_removed);
+        uc.add(unread_removed);
+        std::sort(deleted.begin(), deleted.end());
 
-        for (const auto &id_val : id_arr)
+        int deleted_count = static_cast<int>(deleted.size());
+        json failed_ids = json::array();
+        for (unsigned int id : ids)
         {
-            if (!id_val.is_number_integer())
-                continue;
-
-            int msg_id = id_val.get<int>();
-            del_stmt->setInt(1, msg_id);
-            del_stmt->setString(2, user_email);
-            del_stmt->setString(3, user_email);
-
-            int affected = del_stmt->executeUpdate();
-            if (affected > 0)
-                deleted_count++;
-            else
-                failed_ids.push_back(msg_id);
+            if (!std::binary_search(deleted.begin(), deleted.end(), id))
+                failed_ids.push_back(id);
         }
 
         if (deleted_count == 0 && !failed_ids.empty())
@@ -475,7 +559,7 @@ std::string handle_msg_delete(const json &req, sql::Connection &db)
             {"failed_ids", failed_ids}};
         return res.dump();
     }
-    catch (const sql::SQLException &e)
+    catch (const StorageError &e)
     {
         json res = make_response(PKT_MSG_DELETE_REQ, VALUE_ERR_DB);
         res["msg"] = std::string("DB 오류: ") + e.what();
@@ -492,31 +576,106 @@ std::string handle_msg_delete(const json &req, sql::Connection &db)
 // ============================================================
 // handle_msg_read  (PKT_MSG_READ_REQ = 0x0014)
 //
-// 요청 payload:  { "msg_id": 123 }
+// 요청 payload (셋 중 하나):
+//   { "msg_id": 123 }                                   ← 한 개
+//   { "msg_ids": [1, 2, 3] }                            ← 여러 개 (최대 100)
+//   { "up_to": { "sent_at": "...", "msg_id": N } }      ← 이 메시지와 그보다 오래된 것 모두
+//
+// 응답 payload (msg_ids / up_to 일 때):
+//   { "read_count": N, "failed_ids": [...] }            ← failed_ids 는 msg_ids 일 때만
 //
 // - 본인 수신 메시지(to_user_id = 내 no)만 읽음 처리 가능
+// - msg_ids 는 UPDATE + 확인 SELECT 를 한 트랜잭션으로 (id 마다 왕복하지 않음)
+// - up_to 는 목록 응답의 head_cursor / next_cursor 와 같은 형식
+//   (조회 이후 새로 도착한 메시지는 건드리지 않음)
 // ============================================================
-std::string handle_msg_read(const json &req, sql::Connection &db)
+static std::string msg_read_bulk(Storage &db, const std::string &user_email, const json &id_arr)
+{
+    if (id_arr.empty() || id_arr.size() > MSG_BULK_MAX)
+    {
+        json res = make_response(PKT_MSG_READ_REQ, VALUE_ERR_INVALID_PACKET);
+        res["msg"] = "msg_ids 는 1~100개";
+        return res.dump();
+    }
+
+    std::vector<unsigned int> ids = parse_msg_ids(id_arr);
+    if (ids.empty())
+    {
+        json res = make_response(PKT_MSG_READ_REQ, VALUE_ERR_INVALID_PACKET);
+        res["msg"] = "유효한 msg_id 없음";
+        return res.dump();
+    }
+
+    // 이미 읽은 메시지도 성공으로 보므로, 실패 id 는 "내 수신함에 없는 id"
+    UnreadChange uc(&db, {user_email}); // txn 보다 먼저 생성 → commit / rollback 뒤에 반영
+    LocalTxn txn(db);
+    int read_count = 0;
+    std::vector<unsigned int> found = db.mark_read_many(user_email, ids, &read_count);
+    txn.commit();
+    uc.add(user_email, -read_count);
+    std::sort(found.begin(), found.end());
+
+    json failed_ids = json::array();
+    for (unsigned int id : ids)
+    {
+        if (!std::binary_search(found.begin(), found.end(), id))
+            failed_ids.push_back(id);
+    }
+
+    if (found.empty())
+    {
+        json res = make_response(PKT_MSG_READ_REQ, VALUE_ERR_MSG_NOT_FOUND);
+        res["msg"] = "메시지 없음 또는 권한 없음";
+        res["payload"] = {{"read_count", 0}, {"failed_ids", failed_ids}};
+        return res.dump();
+    }
+
+    json res = make_response(PKT_MSG_READ_REQ, VALUE_SUCCESS);
+    res["msg"] = std::to_string(read_count) + "개 읽음 처리 완료";
+    res["payload"] = {{"read_count", read_count}, {"failed_ids", failed_ids}};
+    return res.dump();
+}
+
+static std::string msg_read_up_to(Storage &db, const std::string &user_email, const json &cur)
+{
+    std::string sent_at = cur.is_object() ? cur.value("sent_at", "") : "";
+    unsigned int msg_id = cur.is_object() ? cur.value("msg_id", 0u) : 0;
+    if (sent_at.empty() || msg_id == 0)
+    {
+        json res = make_response(PKT_MSG_READ_REQ, VALUE_ERR_INVALID_PACKET);
+        res["msg"] = "잘못된 up_to";
+        return res.dump();
+    }
+
+    // 목록과 같은 (sent_at, msg_id) 순서 기준, 커서 행 포함
+    UnreadChange uc(&db, {user_email});
+    int read_count = db.mark_read_up_to(user_email, {sent_at, msg_id});
+    uc.add(user_email, -read_count);
+
+    json res = make_response(PKT_MSG_READ_REQ, VALUE_SUCCESS);
+    res["msg"] = std::to_string(read_count) + "개 읽음 처리 완료";
+    res["payload"] = {{"read_count", read_count}};
+    return res.dump();
+}
+
+std::string handle_msg_read(const RequestContext &ctx, const json &req, Storage &db)
 {
     try
     {
-        std::string user_email = get_session_email(g_current_sock);
-        if (user_email.empty())
+        const std::string &user_email = ctx.email;
+        if (!ctx.logged_in)
         {
             json res = make_response(PKT_MSG_READ_REQ, VALUE_ERR_SESSION);
             res["msg"] = "로그인 세션 없음";
             return res.dump();
         }
 
-        unsigned int user_no = get_user_no(db, user_email);
-        if (user_no == 0)
-        {
-            json res = make_response(PKT_MSG_READ_REQ, VALUE_ERR_DB);
-            res["msg"] = "사용자 정보 없음";
-            return res.dump();
-        }
-
         json payload = get_payload(req);
+        if (payload.contains("msg_ids") && payload["msg_ids"].is_array())
+            return msg_read_bulk(db, user_email, payload["msg_ids"]);
+        if (payload.contains("up_to"))
+            return msg_read_up_to(db, user_email, payload["up_to"]);
+
         if (!payload.contains("msg_id") || !payload["msg_id"].is_number_integer())
         {
             json res = make_response(PKT_MSG_READ_REQ, VALUE_ERR_INVALID_PACKET);
@@ -526,14 +685,10 @@ std::string handle_msg_read(const json &req, sql::Connection &db)
 
         int msg_id = payload["msg_id"].get<int>();
 
-        std::unique_ptr<sql::PreparedStatement> pstmt(
-            db.prepareStatement(
-                "UPDATE messages SET is_read = 1 "
-                "WHERE msg_id = ? AND to_email = ?"));
-        pstmt->setInt(1, msg_id);
-        pstmt->setString(2, user_email);
-
-        int affected = pstmt->executeUpdate();
+        UnreadChange uc(&db, {user_email});
+        int changed = 0;
+        int affected = msg_id > 0 ? db.mark_read(user_email, static_cast<uint32_t>(msg_id), &changed) : 0;
+        uc.add(user_email, -changed);
         if (affected == 0)
         {
             json res = make_response(PKT_MSG_READ_REQ, VALUE_ERR_MSG_NOT_FOUND);
@@ -545,7 +700,7 @@ std::string handle_msg_read(const json &req, sql::Connection &db)
         res["msg"] = "읽음 처리 완료";
         return res.dump();
     }
-    catch (const sql::SQLException &e)
+    catch (const StorageError &e)
     {
         json res = make_response(PKT_MSG_READ_REQ, VALUE_ERR_DB);
         res["msg"] = std::string("DB 오류: ") + e.what();
@@ -562,49 +717,23 @@ std::string handle_msg_read(const json &req, sql::Connection &db)
 // handle_msg_setting_get
 // PKT_MSG_SETTING_GET_REQ = 0x0015
 // ============================================================
-std::string handle_msg_setting_get(const json &req, sql::Connection &db)
+std::string handle_msg_setting_get(const RequestContext &ctx, const json &req, Storage &db)
 {
     try
     {
-        // 1. 세션 확인
-        std::string email = get_session_email(g_current_sock);
-        if (email.empty())
+        // 1. 세션 확인 (user_no 는 로그인 때 확정된 값)
+        if (!ctx.logged_in)
         {
             json res = make_response(PKT_MSG_SETTING_GET_REQ, VALUE_ERR_SESSION);
             res["msg"] = "로그인 세션 없음";
             return res.dump();
         }
+        const unsigned int user_no = ctx.user_no;
 
-        // 2. user_no 조회
-        unsigned int user_no = get_user_no(db, email);
-        if (user_no == 0)
-        {
-            json res = make_response(PKT_MSG_SETTING_GET_REQ, VALUE_ERR_DB);
-            res["msg"] = "사용자 정보 없음";
-            return res.dump();
-        }
-
-        // 3. users 테이블에서 조회 (여기만 수정)
-        std::unique_ptr<sql::PreparedStatement> ps(
-            db.prepareStatement(
-                "SELECT default_prefix, default_suffix "
-                "FROM users "
-                "WHERE no = ? LIMIT 1"));
-        ps->setUInt(1, user_no);
-
-        std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-
+        // 3. users 의 기본 머리말/꼬리말 조회 (NULL 이면 빈 문자열)
         std::string prefix = "";
         std::string suffix = "";
-
-        if (rs->next())
-        {
-            if (!rs->isNull("default_prefix"))
-                prefix = rs->getString("default_prefix");
-
-            if (!rs->isNull("default_suffix"))
-                suffix = rs->getString("default_suffix");
-        }
+        db.message_prefs(user_no, prefix, suffix);
 
         json res = make_response(PKT_MSG_SETTING_GET_REQ, VALUE_SUCCESS);
         res["msg"] = "조회 성공";
@@ -614,7 +743,7 @@ std::string handle_msg_setting_get(const json &req, sql::Connection &db)
 
         return res.dump();
     }
-    catch (const sql::SQLException &e)
+    catch (const StorageError &e)
     {
         json res = make_response(PKT_MSG_SETTING_GET_REQ, VALUE_ERR_DB);
         res["msg"] = std::string("DB 오류: ") + e.what();
@@ -633,27 +762,18 @@ std::string handle_msg_setting_get(const json &req, sql::Connection &db)
 // payload:
 //   { "prefix": "...", "suffix": "..." }
 // ============================================================
-std::string handle_msg_setting_update(const json &req, sql::Connection &db)
+std::string handle_msg_setting_update(const RequestContext &ctx, const json &req, Storage &db)
 {
     try
     {
-        // 1. 세션 확인
-        std::string email = get_session_email(g_current_sock);
-        if (email.empty())
+        // 1. 세션 확인 (user_no 는 로그인 때 확정된 값)
+        if (!ctx.logged_in)
         {
             json res = make_response(PKT_MSG_SETTING_UPDATE_REQ, VALUE_ERR_SESSION);
             res["msg"] = "로그인 세션 없음";
             return res.dump();
         }
-
-        // 2. user_no 조회
-        unsigned int user_no = get_user_no(db, email);
-        if (user_no == 0)
-        {
-            json res = make_response(PKT_MSG_SETTING_UPDATE_REQ, VALUE_ERR_DB);
-            res["msg"] = "사용자 정보 없음";
-            return res.dump();
-        }
+        const unsigned int user_no = ctx.user_no;
 
         // 3. payload 파싱
         json payload = get_payload(req);
@@ -661,25 +781,14 @@ std::string handle_msg_setting_update(const json &req, sql::Connection &db)
         std::string prefix = payload.value("prefix", "");
         std::string suffix = payload.value("suffix", "");
 
-        // 4. users 테이블 직접 UPDATE
-        std::unique_ptr<sql::PreparedStatement> ps(
-            db.prepareStatement(
-                "UPDATE users "
-                "SET default_prefix = ?, "
-                "    default_suffix = ? "
-                "WHERE no = ?"));
-
-        ps->setString(1, prefix);
-        ps->setString(2, suffix);
-        ps->setUInt(3, user_no);
-
-        int affected = ps->executeUpdate();
+        // 4. users 기본 머리말/꼬리말 UPDATE
+        db.set_message_prefs(user_no, prefix, suffix);
 
         json res = make_response(PKT_MSG_SETTING_UPDATE_REQ, VALUE_SUCCESS);
         res["msg"] = "설정 저장 완료";
         return res.dump();
     }
-    catch (const sql::SQLException &e)
+    catch (const StorageError &e)
     {
         json res = make_response(PKT_MSG_SETTING_UPDATE_REQ, VALUE_ERR_DB);
         res["msg"] = std::string("DB 오류: ") + e.what();
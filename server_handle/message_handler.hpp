@@ -1,28 +1,36 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <nlohmann/json.hpp>
-#include <mariadb/conncpp.hpp>
+#include "storage.h"
+#include "request_context.h"
 
 using json = nlohmann::json;
 
-// 읽지 않은 메시지 폴링 (세션 없이 email+pw_hash 인증)
-std::string handle_msg_poll(const json& req, sql::Connection& db);
+// 읽지 않은 메시지 폴링 (세션이 없으면 payload 의 email+pw_hash 로 인증)
+std::string handle_msg_poll(const RequestContext& ctx, const json& req, Storage& db);
+
+// 로그인 세션의 폴링을 안읽은 수 캐시로만 답함 (DB 커넥션 없이, worker 가 대여 전에 호출)
+// 세션이 없거나 캐시에 없으면 빈 문자열 → handle_msg_poll 로
+std::string handle_msg_poll_cached(const RequestContext& ctx);
 
 // 메시지 전송
-std::string handle_msg_send(const json& req, sql::Connection& db);
+// reply 가 있으면 INSERT 는 묶음 writer 로 넘기고 빈 문자열 반환 (commit 후 reply 로 응답)
+std::string handle_msg_send(const RequestContext& ctx, const json& req, Storage& db,
+                            const std::function<void(std::string)>& reply);
 
 // 메시지 목록 조회
-std::string handle_msg_list(const json& req, sql::Connection& db);
+std::string handle_msg_list(const RequestContext& ctx, const json& req, Storage& db);
 
 // 메시지 삭제
-std::string handle_msg_delete(const json& req, sql::Connection& db);
+std::string handle_msg_delete(const RequestContext& ctx, const json& req, Storage& db);
 
 // 메시지 읽음 처리
-std::string handle_msg_read(const json& req, sql::Connection& db);
+std::string handle_msg_read(const RequestContext& ctx, const json& req, Storage& db);
 
 // 메시지 설정 조회
-std::string handle_msg_setting_get(const nlohmann::json& req, sql::Connection& db);
+std::string handle_msg_setting_get(const RequestContext& ctx, const nlohmann::json& req, Storage& db);
 
 // 메시지 설정 저장
-std::string handle_msg_setting_update(const nlohmann::json& req, sql::Connection& db);
\ No newline at end of file
+std::string handle_msg_setting_update(const RequestContext& ctx, const nlohmann::json& req, Storage& db);
\ No newline at end of file
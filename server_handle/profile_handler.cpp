@@ -14,20 +14,27 @@
 #include <sys/time.h>
 #include <unistd.h>
 #include <iomanip>
-#include <mariadb/conncpp.hpp>
+#include "storage.h"
+#include "user_cache.h"
+#include "session_tokens.h"
+#include "credential_pool.h"
+#include "logger.h"
 #include <mutex>
 #include <map> // map 헤더 추가
+#include <cstdlib>
 
 extern std::mutex g_fail_m;
 extern std::map<std::string, int> g_fail_counts;
 extern std::mutex g_login_m;
 extern std::unordered_map<std::string, int> g_login_users;  // Email -> Socket
-extern std::unordered_map<int, std::string> g_socket_users; // Socket -> Email
+extern std::unordered_map<int, SessionIdentity> g_socket_users; // Socket -> 세션 정보
 
-std::string handle_settings_verify_req(const json &req, sql::Connection &db)
+std::string handle_settings_verify_req(const RequestContext &ctx, const json &req, Storage &db)
 {
-    // 1. 패킷 파싱
-    int user_no = req.value("user_no", 0);
+    // 1. 패킷 파싱 (유저는 세션 기준)
+    if (!ctx.logged_in)
+        return make_resp(PKT_SETTINGS_VERIFY_REQ, VALUE_ERR_SESSION, "로그인 세션 없음", json::object()).dump();
+    int user_no = static_cast<int>(ctx.user_no);
     json payload;
     try
     {
@@ -44,16 +51,14 @@ std::string handle_settings_verify_req(const json &req, sql::Connection &db)
 
     try
     {
-        // 2. DB 조회
-        std::unique_ptr<sql::PreparedStatement> st(db.prepareStatement("SELECT email, pw_hash, is_active FROM users WHERE no = ?"));
-        st->setInt(1, user_no);
-        std::unique_ptr<sql::ResultSet> res(st->executeQuery());
+        // 2. 유저 조회 (유저 캐시, 잠금 시 아래에서 무효화)
+        UserPtr user = user_cache_by_no(db, static_cast<uint32_t>(user_no));
 
-        if (res->next())
+        if (user)
         {
-            std::string email = res->getString("email").c_str();
-            std::string db_pw_hash = res->getString("pw_hash").c_str();
-            int is_active = res->getInt("is_active");
+            std::string email = user->email;
+            std::string db_pw_hash = user->pw_hash;
+            int is_active = user->is_active ? 1 : 0;
 
             // 2-1. 이미 정지된 계정인지 체크
             if (is_active == 0)
@@ -62,8 +67,15 @@ std::string handle_settings_verify_req(const json &req, sql::Connection &db)
                 return make_resp(PKT_SETTINGS_VERIFY_REQ, VALUE_ERR_PERMISSION, "계정이 정지되었습니다.", json::object()).dump();
             }
 
-            // 3. 비밀번호 비교
-            if (db_pw_hash == client_pw_hash)
+            // 3. 비밀번호 비교 (해싱 풀, 결과 캐시 miss 면 계산 후 요청이 다시 들어옴)
+            PwCheck pc = pw_check(db_pw_hash, client_pw_hash, ctx.resume, nullptr);
+            if (pc == PwCheck::PENDING)
+                return "";
+            if (pc == PwCheck::BUSY)
+                return make_resp(PKT_SETTINGS_VERIFY_REQ, VALUE_ERR_RATE_LIMITED, "요청이 많습니다. 잠시 후 다시 시도해주세요.",
+                                 json{{"retry_after", 1}})
+                    .dump();
+            if (pc == PwCheck::OK)
             {
                 // [성공] 실패 카운트 초기화
                 {
@@ -84,9 +96,8 @@ std::string handle_settings_verify_req(const json &req, sql::Connection &db)
                 // 3-1. ★ 5회 도달 시 정지 처리 (VALUE_ERR_PERMISSION)
                 if (current_fail >= 5)
                 {
-                    std::unique_ptr<sql::PreparedStatement> lock_st(db.prepareStatement("UPDATE users SET is_active = 0 WHERE email = ?"));
-                    lock_st->setString(1, email);
-                    lock_st->executeUpdate();
+                    db.deactivate_user_by_email(email);
+                    user_cache_invalidate_email(email); // 정지 상태 즉시 반영
                     // 실패 카운트 초기화
                     {
                         std::lock_guard<std::mutex> lock(g_fail_m);
@@ -103,13 +114,21 @@ std::string handle_settings_verify_req(const json &req, sql::Connection &db)
                         {
                             int target_sock = it->second;
 
-                            // 맵에서 깨끗이 지워줌
+                            // 맵에서 깨끗이 지워줌 (토큰으로 묶인 보조 소켓 세션 포함)
                             g_socket_users.erase(target_sock);
                             g_login_users.erase(it);
-
-                            std::cout << ">> [System] 정지된 계정(" << email << ") 세션 강제 제거 완료.\n";
+                            for (auto s = g_socket_users.begin(); s != g_socket_users.end();)
+                            {
+                                if (s->second.email == email)
+                                    s = g_socket_users.erase(s);
+                                else
+                                    ++s;
+                            }
+
+                            LOG_INFO(">> [System] 정지된 계정(" << email << ") 세션 강제 제거 완료.");
                         }
                     }
+                    session_token_revoke_email(email); // 발급한 세션 토큰 폐기
 
                     // ★ 중요: 5회 넘었을 때만 PERMISSION 에러 전송
                     return make_resp(PKT_SETTINGS_VERIFY_REQ, VALUE_ERR_PERMISSION,
@@ -127,17 +146,19 @@ std::string handle_settings_verify_req(const json &req, sql::Connection &db)
             return make_resp(PKT_SETTINGS_VERIFY_REQ, VALUE_ERR_UNKNOWN, "사용자 정보 없음", json::object()).dump();
         }
     }
-    catch (sql::SQLException &e)
+    catch (StorageError &e)
     {
         return make_resp(PKT_SETTINGS_VERIFY_REQ, VALUE_ERR_DB, "DB Error", json::object()).dump();
     }
 }
 
 // [중요 3] static 제거
-std::string handle_settings_set_req(const json &req, sql::Connection &db)
+std::string handle_settings_set_req(const RequestContext &ctx, const json &req, Storage &db)
 {
-    // 1. 패킷 파싱
-    int user_no = req.value("user_no", 0);
+    // 1. 패킷 파싱 (유저는 세션 기준)
+    if (!ctx.logged_in)
+        return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_SESSION, "로그인 세션 없음", json::object()).dump();
+    int user_no = static_cast<int>(ctx.user_no);
     json payload;
     try
     {
@@ -158,36 +179,60 @@ std::string handle_settings_set_req(const json &req, sql::Connection &db)
 
     try
     {
-        std::unique_ptr<sql::PreparedStatement> st;
-
-        // 2. 타입에 따른 쿼리 준비
+        // 2. 타입에 따른 컬럼 선택
+        UserField field;
         if (type == "email")
         {
-            st.reset(db.prepareStatement("UPDATE users SET email = ? WHERE no = ?"));
+            field = UserField::EMAIL;
         }
         else if (type == "pw")
         {
-            st.reset(db.prepareStatement("UPDATE users SET pw_hash = ? WHERE no = ?"));
+            field = UserField::PW_HASH;
         }
         else if (type == "nickname")
         {
-            st.reset(db.prepareStatement("UPDATE users SET nickname = ? WHERE no = ?"));
+            field = UserField::NICKNAME;
         }
         else if (type == "grade")
         {
-            st.reset(db.prepareStatement("UPDATE users SET grade = ? WHERE no = ?"));
+            field = UserField::GRADE;
         }
         else
         {
             return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_INVALID_PACKET, "알 수 없는 설정 타입", json::object()).dump();
         }
-        // 값 바인딩 (grade는 int 컬럼이지만 setString으로 넣어도 MariaDB가 자동 형변환 처리함)
-        st->setString(1, value);
-        st->setInt(2, user_no);
-
-        int rows = st->executeUpdate();
+        // 비밀번호는 저장 형식(PBKDF2)으로 바꿔서 저장 (해싱 풀에서 계산, 끝나면 요청이 다시 들어옴)
+        std::string stored = value;
+        if (field == UserField::PW_HASH)
+        {
+            switch (pw_hash_new("user:" + std::to_string(user_no), value, ctx.resume, &stored))
+            {
+            case PwCheck::PENDING:
+                return "";
+            case PwCheck::BUSY:
+                return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_RATE_LIMITED, "요청이 많습니다. 잠시 후 다시 시도해주세요.",
+                                 json{{"retry_after", 1}})
+                    .dump();
+            default:
+                break;
+            }
+        }
+        if (stored.empty())
+            return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_UNKNOWN, "비밀번호 처리 실패", json::object()).dump();
+        int rows = db.update_user_field(static_cast<uint32_t>(user_no), field, stored);
         if (rows > 0)
         {
+            // 바뀐 값 다시 읽도록 + 세션 정보도 새 값으로 (atomic 묶음이면 commit 뒤에)
+            uint32_t uno = static_cast<uint32_t>(user_no);
+            bool ident = field == UserField::EMAIL || field == UserField::GRADE;
+            std::string new_email = field == UserField::EMAIL ? value : ctx.email;
+            int new_grade = field == UserField::GRADE ? std::atoi(value.c_str()) : ctx.grade;
+            after_commit(db, [uno, ident, new_email, new_grade]
+                         {
+                             user_cache_invalidate(uno);
+                             if (ident)
+                                 session_identity_update(uno, new_email, new_grade);
+                         });
             return make_resp(PKT_SETTINGS_SET_REQ, VALUE_SUCCESS, "변경되었습니다.", json::object()).dump();
         }
         else
@@ -195,7 +240,7 @@ std::string handle_settings_set_req(const json &req, sql::Connection &db)
             return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_DB, "변경 실패 (DB 오류)", json::object()).dump();
         }
     }
-    catch (sql::SQLException &e)
+    catch (StorageError &e)
     {
         return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_DB, "DB 에러 발생", json::object()).dump();
     }
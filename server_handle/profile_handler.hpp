@@ -3,7 +3,8 @@
 #include "json_packet.hpp"
 #include <string>
 #include <nlohmann/json.hpp>
-#include <mariadb/conncpp.hpp>
+#include "storage.h"
+#include "request_context.h"
 
-std::string handle_settings_verify_req(const json &req, sql::Connection &db);
-std::string handle_settings_set_req(const json &req, sql::Connection &db);
\ No newline at end of file
+std::string handle_settings_verify_req(const RequestContext &ctx, const json &req, Storage &db);
+std::string handle_settings_set_req(const RequestContext &ctx, const json &req, Storage &db);
\ No newline at end of file
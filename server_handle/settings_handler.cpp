@@ -9,6 +9,12 @@
 #include "settings_handler.hpp"
 #include "file_handler.hpp" // g_cloud_root extern 선언 포함
 #include "protocol.h"       // PKT_SETTINGS_*, VALUE_*
+#include "storage.h"        // 저장소 인터페이스
+#include "user_cache.h"     // users 조회 캐시 (변경 시 무효화)
+#include "grade_table.h"    // grades 스냅샷 (등급별 최대 용량)
+#include "quota_ledger.h"   // 사용량 장부 (storage_used)
+#include "credential_pool.h" // 비밀번호 저장 형식 (PBKDF2)
+#include "logger.h"          // 비동기 로그
 
 #include <filesystem>
 #include <iostream>
@@ -33,42 +39,35 @@ static std::string make_resp(int type, int code,
 }
 
 // ─────────────────────────────────────────────────────────────────
-//  내부 유틸: user_no 유저의 등급별 최대 허용 용량 조회 (grades 테이블)
+//  내부 유틸: 등급별 최대 허용 용량 조회
+//  (등급은 세션(RequestContext), 용량은 grades 스냅샷). 조회 실패 시 0
 // ─────────────────────────────────────────────────────────────────
-static int64_t get_storage_total(uint32_t uno, sql::Connection &db)
+static int64_t get_storage_total(int grade, Storage &db)
 {
     try
     {
-        // grades 테이블과 JOIN 해서 등급별 최대 용량 조회
-        std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(
-            "SELECT g.max_filesize "
-            "FROM users u JOIN grades g ON u.grade = g.grade "
-            "WHERE u.no = ?"));
-        ps->setInt(1, (int)uno);
-        std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-        if (rs->next())
-            return rs->getInt64(1); // 조회된 최대 용량 반환
+        int64_t total = grade_max_filesize(db, grade);
+        if (total >= 0)
+            return total; // 등급별 최대 용량 반환
     }
     catch (...)
     {
     }
 
-    return 104857600LL; // 조회 실패 시 기본값 100MB
+    return 0; // 조회 실패 시 0 (남은 용량도 0 으로 표시)
 }
 
 // ─────────────────────────────────────────────────────────────────
 //  내부 유틸: user_no 유저의 현재 사용 용량 조회 (users.storage_used)
 // ─────────────────────────────────────────────────────────────────
-static int64_t get_storage_used(uint32_t uno, sql::Connection &db)
+static int64_t get_storage_used(uint32_t uno, Storage &db)
 {
     try
     {
-        std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(
-            "SELECT storage_used FROM users WHERE no = ?"));
-        ps->setInt(1, (int)uno);
-        std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-        if (rs->next())
-            return rs->getInt64(1); // 현재 사용 용량 반환
+        // 사용량 장부 (업로드 확정/삭제가 바로 반영됨, DB 반영은 장부가 모아서)
+        int64_t used = quota_used(db, uno);
+        if (used >= 0)
+            return used; // 현재 사용 용량 반환
     }
     catch (...)
     {
@@ -81,19 +80,19 @@ static int64_t get_storage_used(uint32_t uno, sql::Connection &db)
 //  PKT_SETTINGS_GET_REQ (0x0030): 설정 조회 핸들러
 //  현재 지원 query: "storage" → 용량 정보 반환
 // ─────────────────────────────────────────────────────────────────
-std::string handle_settings_get(const json &req, sql::Connection &db)
+std::string handle_settings_get(const RequestContext &ctx, const json &req, Storage &db)
 {
-    json pl = req.value("payload", json::object());   // 요청 payload 추출
-    uint32_t uno = req.value("user_no", (uint32_t)0); // 유저 번호 추출
-    std::string query = pl.value("query", "");        // 조회 대상 ("storage" 등)
+    json pl = req.value("payload", json::object()); // 요청 payload 추출
+    uint32_t uno = ctx.user_no;                     // 유저 번호 (세션 기준)
+    std::string query = pl.value("query", "");      // 조회 대상 ("storage" 등)
 
-    if (uno == 0) // 유저 번호 없으면 오류
-        return make_resp(PKT_SETTINGS_GET_REQ, VALUE_ERR_INVALID_PACKET, "user_no 누락");
+    if (!ctx.logged_in) // 세션 없으면 오류
+        return make_resp(PKT_SETTINGS_GET_REQ, VALUE_ERR_SESSION, "로그인 세션 없음");
 
     // ── "storage" 쿼리: 용량 정보 반환 ──────────────────────────
     if (query == "storage" || query.empty())
     {                                               // query 가 storage 이거나 비어있으면
-        int64_t total = get_storage_total(uno, db); // 등급별 최대 용량 조회
+        int64_t total = get_storage_total(ctx.grade, db); // 등급별 최대 용량 조회
         int64_t used = get_storage_used(uno, db);   // 현재 사용 용량 조회
 
         json ep;
@@ -101,8 +100,8 @@ std::string handle_settings_get(const json &req, sql::Connection &db)
         ep["storage_total"] = total;       // 전체 허용 용량
         ep["storage_free"] = total - used; // 남은 용량 미리 계산
 
-        std::cout << "[Settings] GET storage user=" << uno
-                  << " used=" << used << " total=" << total << "\n"; // 서버 로그
+        LOG_INFO("[Settings] GET storage user=" << uno
+                 << " used=" << used << " total=" << total); // 서버 로그
 
         return make_resp(PKT_SETTINGS_GET_REQ, VALUE_SUCCESS, "용량 조회 성공", ep);
     }
@@ -121,10 +120,10 @@ std::string handle_settings_get(const json &req, sql::Connection &db)
 //    payload["folder"] 폴더를 삭제
 //    내부에 파일이 있으면 VALUE_ERR_UNKNOWN 으로 거절 (요구사항 13-3-4)
 // ─────────────────────────────────────────────────────────────────
-std::string handle_settings_set(const json &req, sql::Connection &db)
+std::string handle_settings_set(const RequestContext &ctx, const json &req, Storage &db)
 {
-    json pl = req.value("payload", json::object());   // 요청 payload 추출
-    uint32_t uno = req.value("user_no", (uint32_t)0); // 유저 번호
+    json pl = req.value("payload", json::object()); // 요청 payload 추출
+    uint32_t uno = ctx.user_no;                     // 유저 번호 (세션 기준)
 
     // 값 추출
     std::string update_type = pl.value("update_type", "");
@@ -132,8 +131,8 @@ std::string handle_settings_set(const json &req, sql::Connection &db)
     std::string action = pl.value("action", "");
     std::string folder = pl.value("folder", "");
 
-    if (uno == 0) // 유저 번호 없으면 오류
-        return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_INVALID_PACKET, "user_no 누락");
+    if (!ctx.logged_in) // 세션 없으면 오류
+        return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_SESSION, "로그인 세션 없음");
 
     // ─────────────────────────────────────────────────────────────────
     // [1] 개인정보 변경 로직 (이 부분이 반드시 action 체크보다 먼저 와야 함)
@@ -145,16 +144,16 @@ std::string handle_settings_set(const json &req, sql::Connection &db)
             return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_INVALID_PACKET, "변경할 값이 없습니다.");
         }
 
-        std::string col_name;
-        // 클라이언트가 보내는 키워드("pw")와 DB 컬럼명("pw_hash") 매핑
+        UserField field;
+        // 클라이언트가 보내는 키워드("pw")와 users 컬럼(pw_hash) 매핑
         if (update_type == "email")
-            col_name = "email";
+            field = UserField::EMAIL;
         else if (update_type == "pw")
-            col_name = "pw_hash";
+            field = UserField::PW_HASH;
         else if (update_type == "nickname")
-            col_name = "nickname";
+            field = UserField::NICKNAME;
         else if (update_type == "grade")
-            col_name = "grade";
+            field = UserField::GRADE;
         else
         {
             return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_INVALID_PACKET, "알 수 없는 변경 타입입니다.");
@@ -162,25 +161,44 @@ std::string handle_settings_set(const json &req, sql::Connection &db)
 
         try
         {
-            std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(
-                "UPDATE users SET " + col_name + " = ? WHERE no = ?"));
-
-            // grade는 정수로 변환해서 저장 권장 (DB 스키마에 따라 유연하게)
-            if (update_type == "grade")
+            // grade는 정수로 정규화해서 저장 (숫자가 아니면 아래 catch(...) 로)
+            // 비밀번호는 저장 형식(PBKDF2)으로 — 해싱 풀에서 계산, 끝나면 요청이 다시 들어옴
+            std::string stored;
+            if (field == UserField::PW_HASH)
             {
-                ps->setInt(1, std::stoi(value));
+                switch (pw_hash_new("user:" + std::to_string(uno), value, ctx.resume, &stored))
+                {
+                case PwCheck::PENDING:
+                    return "";
+                case PwCheck::BUSY:
+                    return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_RATE_LIMITED,
+                                     "요청이 많습니다. 잠시 후 다시 시도해주세요.", json{{"retry_after", 1}});
+                default:
+                    break;
+                }
             }
             else
             {
-                ps->setString(1, value);
+                stored = (field == UserField::GRADE) ? std::to_string(std::stoi(value)) : value;
             }
-            ps->setInt(2, (int)uno);
+            if (stored.empty())
+                return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_UNKNOWN, "비밀번호 처리 실패");
 
-            int rows = ps->executeUpdate(); // DB 업데이트 실행
+            int rows = db.update_user_field(uno, field, stored); // DB 업데이트 실행
 
             if (rows > 0)
             {
-                std::cout << "[Settings] User " << uno << " updated " << update_type << "\n";
+                // 바뀐 값 다시 읽도록 + 세션 정보도 새 값으로 (atomic 묶음이면 commit 뒤에)
+                bool ident = field == UserField::EMAIL || field == UserField::GRADE;
+                std::string new_email = field == UserField::EMAIL ? stored : ctx.email;
+                int new_grade = field == UserField::GRADE ? std::stoi(stored) : ctx.grade;
+                after_commit(db, [uno, ident, new_email, new_grade]
+                             {
+                                 user_cache_invalidate(uno);
+                                 if (ident)
+                                     session_identity_update(uno, new_email, new_grade);
+                             });
+                LOG_INFO("[Settings] User " << uno << " updated " << update_type);
                 return make_resp(PKT_SETTINGS_SET_REQ, VALUE_SUCCESS, "정보가 변경되었습니다.");
             }
             else
@@ -188,7 +206,7 @@ std::string handle_settings_set(const json &req, sql::Connection &db)
                 return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_UNKNOWN, "변경 사항이 없거나 계정을 찾을 수 없습니다.");
             }
         }
-        catch (const sql::SQLException &e)
+        catch (const StorageError &e)
         {
             // 중복된 이메일/닉네임 등 DB 제약조건 위반 시
             return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_DB, "이미 사용 중인 정보이거나 DB 오류입니다.");
@@ -225,8 +243,8 @@ std::string handle_settings_set(const json &req, sql::Connection &db)
         }
         json ep;
         ep["folders"] = folders_arr;
-        std::cout << "[Settings] list_folders user=" << uno
-                  << " count=" << folders_arr.size() << "\n";
+        LOG_INFO("[Settings] list_folders user=" << uno
+                 << " count=" << folders_arr.size());
         return make_resp(PKT_SETTINGS_SET_REQ, VALUE_SUCCESS, "폴더 목록 조회 완료", ep);
     }
 
@@ -263,7 +281,7 @@ std::string handle_settings_set(const json &req, sql::Connection &db)
 
         json ep;
         ep["folder"] = folder;
-        std::cout << "[Settings] 폴더 생성 user=" << uno << " folder=" << folder << "\n";
+        LOG_INFO("[Settings] 폴더 생성 user=" << uno << " folder=" << folder);
         return make_resp(PKT_SETTINGS_SET_REQ, VALUE_SUCCESS, "폴더 생성 완료", ep);
     }
 
@@ -279,15 +297,9 @@ std::string handle_settings_set(const json &req, sql::Connection &db)
         int file_count = 0;
         try
         {
-            std::unique_ptr<sql::PreparedStatement> ps(db.prepareStatement(
-                "SELECT COUNT(*) FROM files WHERE no = ? AND file_path LIKE ?"));
-            ps->setInt(1, (int)uno);
-            ps->setString(2, target + "/%");
-            std::unique_ptr<sql::ResultSet> rs(ps->executeQuery());
-            if (rs->next())
-                file_count = rs->getInt(1);
+            file_count = db.count_files(uno, target + "/");
         }
-        catch (const sql::SQLException &e)
+        catch (const StorageError &e)
         {
             return make_resp(PKT_SETTINGS_SET_REQ, VALUE_ERR_DB,
                              std::string("DB 오류: ") + e.what());
@@ -313,7 +325,7 @@ std::string handle_settings_set(const json &req, sql::Connection &db)
 
         json ep;
         ep["folder"] = folder;
-        std::cout << "[Settings] 폴더 삭제 user=" << uno << " folder=" << folder << "\n";
+        LOG_INFO("[Settings] 폴더 삭제 user=" << uno << " folder=" << folder);
         return make_resp(PKT_SETTINGS_SET_REQ, VALUE_SUCCESS, "폴더 삭제 완료", ep);
     }
 
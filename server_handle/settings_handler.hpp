@@ -9,11 +9,11 @@
 //
 // skeleton_server.cpp 의 switch(type) 에 아래 case 추가:
 //   case PKT_SETTINGS_GET_REQ:
-//       out_payload = handle_settings_get(req, *conn);
-//       break;
+//       return handle_settings_get(ctx, req, db);
 //   case PKT_SETTINGS_SET_REQ:
-//       out_payload = handle_settings_set(req, *conn);
-//       break;
+//       return handle_settings_set(ctx, req, db);
+//
+// 유저는 ctx(세션) 기준, 요청 최상위 user_no 는 쓰지 않음
 //
 // 서버 파일 저장 루트는 file_handler.cpp 와 동일한 경로 공유
 //   extern std::string g_cloud_root;  // file_handler.cpp 에서 정의
@@ -21,16 +21,17 @@
 
 #include <string>
 #include <nlohmann/json.hpp>
-#include <mariadb/conncpp.hpp>
+#include "storage.h"
+#include "request_context.h"
 
 using json = nlohmann::json;
 
 // PKT_SETTINGS_GET_REQ (0x0030)
 // payload: { "query": "storage" }
 // 응답  : { "storage_used": int64, "storage_total": int64 }
-std::string handle_settings_get(const json& req, sql::Connection& db);
+std::string handle_settings_get(const RequestContext& ctx, const json& req, Storage& db);
 
 // PKT_SETTINGS_SET_REQ (0x0031)
 // payload action = "create_folder" → { "folder": str }
 // payload action = "delete_folder" → { "folder": str }  (내부 파일 있으면 오류)
-std::string handle_settings_set(const json& req, sql::Connection& db);
+std::string handle_settings_set(const RequestContext& ctx, const json& req, Storage& db);
@@ -0,0 +1,199 @@
+// ============================================================================
+// 파일명: batch_atomic_test.cpp
+// 목적: atomic 묶음 요청이 되돌릴 수 없는 하위 요청을 받지 않는지 확인 (ctest)
+//
+// - 빈 임시 폴더에서 server_app 을 memory 백엔드로 띄우고 프로토콜로만 확인
+//   (파일 저장 폴더 ./cloud_storage 가 임시 폴더 안에 생김, 끝나면 지움)
+// - 파일을 하나 올린 뒤 FILE_DELETE 가 든 atomic 묶음을 보냄
+//   → 묶음은 거절 (committed=false), 디스크 파일 / 파일 목록 / 사용량은 그대로여야 함
+// - 같은 묶음을 atomic 없이 보내면 삭제가 실제로 일어나는지도 확인 (검사 자체가 맞는지)
+//
+// 사용 예:
+//   ctest --test-dir build -R batch_atomic --output-on-failure
+//   ./batch_atomic_test ./server_app 5931
+// ============================================================================
+#include "packet.h"
+#include "protocol.h"
+#include "protocol_schema.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static int g_failures = 0;
+
+#define EXPECT(cond, what)                                                                                    \
+    do                                                                                                        \
+    {                                                                                                         \
+        if (!(cond))                                                                                          \
+        {                                                                                                     \
+            std::fprintf(stderr, "FAIL %s:%d %s\n", __FILE__, __LINE__, what);                                \
+            g_failures++;                                                                                     \
+        }                                                                                                     \
+    } while (0)
+
+// 요청 하나 보내고 응답 하나 받음 (실패하면 discarded json)
+static json call(int sock, const json &req)
+{
+    std::string out = req.dump();
+    if (packet_send(sock, out.data(), static_cast<uint32_t>(out.size())) < 0)
+        return json::value_t::discarded;
+    char *buf = nullptr;
+    uint32_t len = 0;
+    if (packet_recv(sock, &buf, &len) < 0)
+        return json::value_t::discarded;
+    json res = json::parse(buf, buf + len, nullptr, false);
+    free(buf);
+    return res;
+}
+
+static json with_token(json req, const std::string &token)
+{
+    req["token"] = token;
+    return req;
+}
+
+static int connect_retry(int port)
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0)
+            return sock;
+        ::close(sock);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return -1;
+}
+
+static int64_t storage_used(int sock, const std::string &token)
+{
+    json res = call(sock, with_token(make_req(PKT_SETTINGS_GET_REQ, {{"query", "storage"}}), token));
+    return res.is_discarded() ? -1 : res["payload"].value("storage_used", static_cast<int64_t>(-1));
+}
+
+static bool file_listed(int sock, const std::string &token, int64_t file_id)
+{
+    json res = call(sock, with_token(make_req(PKT_FILE_LIST_REQ), token));
+    if (res.is_discarded())
+        return false;
+    for (const auto &f : res["payload"].value("files", json::array()))
+        if (f.value("file_id", static_cast<int64_t>(0)) == file_id)
+            return true;
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: batch_atomic_test <server_app> [port]\n");
+        return 2;
+    }
+    std::string server = fs::absolute(argv[1]).string();
+    int port = argc > 2 ? std::atoi(argv[2]) : 5931;
+
+    char tmpl[] = "/tmp/loud_batch_test.XXXXXX";
+    if (!mkdtemp(tmpl))
+    {
+        std::perror("mkdtemp");
+        return 2;
+    }
+    std::string dir = tmpl;
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        if (chdir(dir.c_str()) != 0)
+            _exit(127);
+        setenv("LOUD_DB", "memory", 1);
+        setenv("LOUD_MEM_SEED_USERS", "1", 1);
+        setenv("LOUD_METRICS_PORT", "0", 1);
+        setenv("LOUD_EMAIL_OUTBOX", "", 1);
+        std::string port_arg = std::to_string(port);
+        execl(server.c_str(), server.c_str(), port_arg.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+
+    int sock = connect_retry(port);
+    EXPECT(sock >= 0, "server did not accept connections");
+    if (sock >= 0)
+    {
+        json login = call(sock, AuthSchema::make_login_req(PKT_AUTH_LOGIN_REQ, "bench1@bench.local", "bench"));
+        EXPECT(!login.is_discarded() && login.value("code", -1) == VALUE_SUCCESS, "login");
+        std::string token = login.is_discarded() ? "" : login["payload"].value("token", "");
+
+        // 1KB 파일 하나 (청크 1개, "xxx" 의 base64 = "eHh4")
+        const std::string content(1024, 'x');
+        std::string b64;
+        for (int i = 0; i < 341; ++i)
+            b64 += "eHh4";
+        b64 += "eA==";
+        json up = call(sock, with_token(make_req(PKT_FILE_UPLOAD_REQ,
+                                                 {{"file_name", "keep.bin"}, {"file_size", content.size()}, {"folder", ""}}),
+                                        token));
+        EXPECT(!up.is_discarded() && up.value("code", -1) == VALUE_SUCCESS, "upload request");
+        std::string resolved = up.is_discarded() ? "" : up["payload"].value("resolved_name", "");
+        json chunk = call(sock, with_token(make_req(PKT_FILE_CHUNK, {{"file_name", resolved},
+                                                                     {"folder", ""},
+                                                                     {"chunk_index", 0},
+                                                                     {"total_chunks", 1},
+                                                                     {"data_b64", b64},
+                                                                     {"file_size", content.size()}}),
+                                           token));
+        EXPECT(!chunk.is_discarded() && chunk.value("code", -1) == VALUE_SUCCESS, "upload chunk");
+        int64_t file_id = chunk.is_discarded() ? 0 : chunk["payload"].value("file_id", static_cast<int64_t>(0));
+        EXPECT(file_id > 0, "file_id");
+
+        fs::path on_disk = fs::path(dir) / "cloud_storage" / "1" / resolved;
+        int64_t used_before = storage_used(sock, token);
+        EXPECT(fs::exists(on_disk), "uploaded file on disk");
+        EXPECT(used_before > 0, "storage_used after upload");
+
+        // atomic 묶음 안의 삭제 → 묶음 전체 거절, 아무것도 안 바뀜
+        json subs = json::array({make_req(PKT_FILE_DELETE_REQ, {{"file_id", file_id}}), make_req(PKT_MSG_LIST_REQ)});
+        json batch = call(sock, with_token(make_req(PKT_BATCH, {{"atomic", true}, {"requests", subs}}), token));
+        EXPECT(!batch.is_discarded() && batch.value("code", VALUE_SUCCESS) != VALUE_SUCCESS, "atomic batch rejected");
+        EXPECT(fs::exists(on_disk), "file kept after rejected atomic batch");
+        EXPECT(file_listed(sock, token, file_id), "file row kept after rejected atomic batch");
+        EXPECT(storage_used(sock, token) == used_before, "storage_used unchanged after rejected atomic batch");
+
+        // atomic 이 아니면 삭제가 그대로 실행됨
+        batch = call(sock, with_token(make_req(PKT_BATCH, {{"atomic", false}, {"requests", subs}}), token));
+        EXPECT(!batch.is_discarded() && batch["payload"].value("committed", false), "plain batch runs");
+        EXPECT(!fs::exists(on_disk), "file removed by plain batch");
+        EXPECT(!file_listed(sock, token, file_id), "file row removed by plain batch");
+        EXPECT(storage_used(sock, token) < used_before, "storage_used credited by plain batch");
+
+        ::close(sock);
+    }
+
+    kill(pid, SIGTERM);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+
+    if (g_failures)
+    {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("batch_atomic_test: ok\n");
+    return 0;
+}
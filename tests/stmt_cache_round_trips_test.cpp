@@ -0,0 +1,301 @@
+// ============================================================================
+// 파일명: stmt_cache_round_trips_test.cpp
+// 목적: statement 캐시 on/off 에서 MSG_SEND 1건당 prepare / 실행 / DB 왕복 수 비교 (ctest)
+//
+// - server_app 을 mariadb 백엔드로 두 번 띄움 (LOUD_STMT_CACHE=0, LOUD_STMT_CACHE=1)
+// - 로그인 + 예열(WARMUP 건) 뒤 지표 포트의 loud_db_*_total 을 읽고,
+//   MSG_SEND 를 SENDS 건 보낸 다음 다시 읽어 차이 / SENDS 를 출력
+//   (message writer 가 쓰는 INSERT 도 잡히도록 왕복 수가 멈출 때까지 기다린 뒤 읽음)
+// - 캐시 on 이면 prepare/req 가 캐시 off 보다 작아야 함
+//   (실행 수는 message writer 가 몇 건씩 묶어 쓰는지에 따라 달라질 수 있어 출력만)
+// - DB 가 없으면 건너뜀 (종료 코드 77): 아래 환경변수가 있어야 실행
+//     LOUD_TEST_DB_URL            (예: jdbc:mariadb://127.0.0.1:3306/loud)
+//     LOUD_TEST_DB_USER / LOUD_TEST_DB_PASSWORD
+//     LOUD_TEST_EMAIL / LOUD_TEST_PW_HASH   (DB 에 있는 계정, 받는 사람도 이 계정)
+//
+// 사용 예:
+//   export LOUD_TEST_DB_URL=... LOUD_TEST_EMAIL=a@b.c LOUD_TEST_PW_HASH=...
+//   ctest --test-dir build -R stmt_cache_round_trips --output-on-failure
+//   ./stmt_cache_round_trips_test ./server_app 5941
+// ============================================================================
+#include "packet.h"
+#include "protocol.h"
+#include "protocol_schema.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static constexpr int SKIP = 77; // CMake SKIP_RETURN_CODE
+static constexpr int WARMUP = 20;
+static constexpr int SENDS = 200;
+
+static int g_failures = 0;
+
+#define EXPECT(cond, what)                                                                                    \
+    do                                                                                                        \
+    {                                                                                                         \
+        if (!(cond))                                                                                          \
+        {                                                                                                     \
+            std::fprintf(stderr, "FAIL %s:%d %s\n", __FILE__, __LINE__, what);                                \
+            g_failures++;                                                                                     \
+        }                                                                                                     \
+    } while (0)
+
+// 요청 하나 보내고 응답 하나 받음 (실패하면 discarded json)
+static json call(int sock, const json &req)
+{
+    std::string out = req.dump();
+    if (packet_send(sock, out.data(), static_cast<uint32_t>(out.size())) < 0)
+        return json::value_t::discarded;
+    char *buf = nullptr;
+    uint32_t len = 0;
+    if (packet_recv(sock, &buf, &len) < 0)
+        return json::value_t::discarded;
+    json res = json::parse(buf, buf + len, nullptr, false);
+    free(buf);
+    return res;
+}
+
+static json with_token(json req, const std::string &token)
+{
+    req["token"] = token;
+    return req;
+}
+
+static int connect_once(int port)
+{
+    int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0)
+        return sock;
+    ::close(sock);
+    return -1;
+}
+
+static int connect_retry(int port)
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        int sock = connect_once(port);
+        if (sock >= 0)
+            return sock;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return -1;
+}
+
+struct Totals
+{
+    double prepares = -1;
+    double executes = -1;
+    double round_trips = -1;
+};
+
+// 지표 포트에서 /metrics 를 읽어 loud_db_*_total 값만 꺼냄 (실패하면 -1)
+static Totals scrape(int metrics_port)
+{
+    Totals t;
+    int sock = connect_retry(metrics_port);
+    if (sock < 0)
+        return t;
+    const std::string req = "GET /metrics HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n";
+    if (::send(sock, req.data(), req.size(), 0) != static_cast<ssize_t>(req.size()))
+    {
+        ::close(sock);
+        return t;
+    }
+    std::string body;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::recv(sock, buf, sizeof(buf), 0)) > 0)
+        body.append(buf, static_cast<size_t>(n));
+    ::close(sock);
+
+    auto value = [&body](const std::string &name) {
+        size_t pos = body.find("\n" + name + " ");
+        return pos == std::string::npos ? -1.0 : std::atof(body.c_str() + pos + name.size() + 2);
+    };
+    t.prepares = value("loud_db_prepares_total");
+    t.executes = value("loud_db_executes_total");
+    t.round_trips = value("loud_db_round_trips_total");
+    return t;
+}
+
+// message writer 가 남은 INSERT 를 다 쓸 때까지 (왕복 수가 멈출 때까지) 기다린 뒤 읽음
+static Totals scrape_settled(int metrics_port)
+{
+    Totals last = scrape(metrics_port);
+    for (int i = 0; i < 50; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        Totals now = scrape(metrics_port);
+        if (now.round_trips == last.round_trips)
+            return now;
+        last = now;
+    }
+    return last;
+}
+
+struct Result
+{
+    bool ran = false;
+    bool db_unavailable = false;
+    double prepares = 0;
+    double executes = 0;
+    double round_trips = 0;
+};
+
+static Result run_mode(const std::string &server, int port, bool cache, const std::string &email,
+                       const std::string &pw_hash)
+{
+    Result r;
+    int metrics_port = port + 1000;
+
+    char tmpl[] = "/tmp/loud_stmt_rt_test.XXXXXX";
+    if (!mkdtemp(tmpl))
+    {
+        std::perror("mkdtemp");
+        return r;
+    }
+    std::string dir = tmpl;
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        if (chdir(dir.c_str()) != 0)
+            _exit(127);
+        setenv("LOUD_DB", "mariadb", 1);
+        setenv("LOUD_DB_URL", std::getenv("LOUD_TEST_DB_URL"), 1);
+        if (const char *u = std::getenv("LOUD_TEST_DB_USER"))
+            setenv("LOUD_DB_USER", u, 1);
+        if (const char *p = std::getenv("LOUD_TEST_DB_PASSWORD"))
+            setenv("LOUD_DB_PASSWORD", p, 1);
+        setenv("LOUD_STMT_CACHE", cache ? "1" : "0", 1);
+        setenv("LOUD_METRICS_PORT", std::to_string(metrics_port).c_str(), 1);
+        setenv("LOUD_EMAIL_OUTBOX", "", 1);
+        std::string port_arg = std::to_string(port);
+        execl(server.c_str(), server.c_str(), port_arg.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+
+    int sock = connect_retry(port);
+    int status = 0;
+    if (sock < 0 && waitpid(pid, &status, WNOHANG) == pid)
+    {
+        r.db_unavailable = true; // mariadb 백엔드로 못 뜸 (DB 설정 / 접속 실패)
+        pid = -1;
+    }
+    else
+    {
+        EXPECT(sock >= 0, "server did not accept connections");
+    }
+    if (sock >= 0)
+    {
+        json login = call(sock, AuthSchema::make_login_req(PKT_AUTH_LOGIN_REQ, email, pw_hash));
+        int code = login.is_discarded() ? -1 : login.value("code", -1);
+        if (code == VALUE_ERR_DB)
+        {
+            r.db_unavailable = true;
+        }
+        else
+        {
+            EXPECT(code == VALUE_SUCCESS, "login");
+            std::string token = login.is_discarded() ? "" : login["payload"].value("token", "");
+
+            auto send_one = [&](int i) {
+                json res = call(sock, with_token(MessageSchema::make_send_req(
+                                                     PKT_MSG_SEND_REQ, email, "stmt cache test " + std::to_string(i)),
+                                                 token));
+                return !res.is_discarded() && res.value("code", -1) == VALUE_SUCCESS;
+            };
+
+            bool ok = true;
+            for (int i = 0; i < WARMUP && ok; ++i)
+                ok = send_one(i);
+            Totals before = scrape_settled(metrics_port);
+            for (int i = 0; i < SENDS && ok; ++i)
+                ok = send_one(WARMUP + i);
+            Totals after = scrape_settled(metrics_port);
+            EXPECT(ok, "MSG_SEND");
+            EXPECT(before.round_trips >= 0 && after.round_trips >= 0, "metrics scrape");
+
+            r.ran = ok && before.round_trips >= 0 && after.round_trips >= 0;
+            r.prepares = (after.prepares - before.prepares) / SENDS;
+            r.executes = (after.executes - before.executes) / SENDS;
+            r.round_trips = (after.round_trips - before.round_trips) / SENDS;
+        }
+        ::close(sock);
+    }
+
+    if (pid > 0)
+    {
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+    }
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: stmt_cache_round_trips_test <server_app> [port]\n");
+        return 2;
+    }
+    const char *url = std::getenv("LOUD_TEST_DB_URL");
+    const char *email = std::getenv("LOUD_TEST_EMAIL");
+    const char *pw_hash = std::getenv("LOUD_TEST_PW_HASH");
+    if (!url || !*url || !email || !*email || !pw_hash)
+    {
+        std::printf("stmt_cache_round_trips_test: skipped (LOUD_TEST_DB_URL / LOUD_TEST_EMAIL / LOUD_TEST_PW_HASH not set)\n");
+        return SKIP;
+    }
+    std::string server = fs::absolute(argv[1]).string();
+    int port = argc > 2 ? std::atoi(argv[2]) : 5941;
+
+    Result off = run_mode(server, port, false, email, pw_hash);
+    Result on = run_mode(server, port + 1, true, email, pw_hash);
+    if (off.db_unavailable || on.db_unavailable)
+    {
+        std::printf("stmt_cache_round_trips_test: skipped (DB unavailable)\n");
+        return SKIP;
+    }
+
+    std::printf("MSG_SEND x%d (after %d warm-up sends)\n", SENDS, WARMUP);
+    std::printf("  LOUD_STMT_CACHE=0  prepares/req=%.2f executes/req=%.2f round_trips/req=%.2f\n", off.prepares,
+                off.executes, off.round_trips);
+    std::printf("  LOUD_STMT_CACHE=1  prepares/req=%.2f executes/req=%.2f round_trips/req=%.2f\n", on.prepares,
+                on.executes, on.round_trips);
+
+    EXPECT(off.ran && on.ran, "both modes measured");
+    if (off.ran && on.ran)
+    {
+        EXPECT(off.prepares > 0, "cache off prepares every statement");
+        EXPECT(on.prepares < off.prepares, "cache on prepares less than cache off");
+    }
+
+    if (g_failures)
+    {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("stmt_cache_round_trips_test: ok\n");
+    return 0;
+}